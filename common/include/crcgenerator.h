@@ -19,4 +19,11 @@
 
 extern unsigned long Crc32Table[256];
 void getCRC(uint32_t *checksum, const uint8_t *inputBytes, size_t length, unsigned long crcTable[]);
+// Updates numChecksums CRCs of the Crc32Table polynomial, each from its own value, with the same data:
+// the data is read once, whatever the number of CRCs. The results are those of getCRC() with Crc32Table.
+void getCRCs(uint32_t *checksums, size_t numChecksums, const uint8_t *inputBytes, size_t length);
+// Name of the update path of getCRC() with Crc32Table and getCRCs(): "c" (slicing-by-16), "pclmul" or "crc32".
+// VK_VIDEO_CRC_SIMD_ISA set to one of them forces it, as setCRCIsa() does: false if the CPU does not support it.
+const char* getCRCIsa();
+bool setCRCIsa(const char* isaName);
 #endif //_CRC_GENERATOR_INCLUDED
@@ -50,8 +50,12 @@ struct DecoderConfig {
         videoHeight = 0;
         queueCount = 1;
         numDecodeImagesInFlight = 8;
+        parserLookahead = 0;
         numDecodeImagesToPreallocate = -1; // pre-allocate the maximum num of images
         numBitstreamBuffersToPreallocate = 8;
+        bitstreamRingSizeMB = 0;
+        maxTemporalId = -1; // no cap
+        av1OperatingPoint = 0;
         backBufferCount = 3;
         ticksPerSecond = 30;
         vsync = true;
@@ -71,14 +75,24 @@ struct DecoderConfig {
         decoderQueueSize = 5;
         enablePostProcessFilter = -1,
         enableStreamDemuxing = true;
+        numPreparseThreads = 0;
         deviceId = (uint32_t)-1;
         directMode = false;
         enableHwLoadBalancing = false;
+        skipNonReference = false;
+        keyFramesOnly = false;
+        resyncOnError = false;
         selectVideoWithComputeQueue = false;
         outputy4m = true; // by default, use Y4M
         outputcrcPerFrame = false;
         outputcrc = false;
+        outputDirectIo = false;
+        outputNativeLayout = false;
+        outputLsbAligned = false;
+        verifyPictureHash = false;
+        numOutputBuffers = 0;
         crcOutputFileName.clear();
+        streamIndexFileName.clear();
         help = false;
     }
 
@@ -117,6 +131,24 @@ struct DecoderConfig {
                     enableStreamDemuxing = false;
                     return true;
                 }},
+            {"--preparseThreads", nullptr, 1,
+                "Split elementary streams into access units ahead of decoding, "
+                "using the given number of threads (0 disables pre-parsing)",
+                [this](const char **args, const ProgramArgs &a) {
+                    numPreparseThreads = std::atoi(args[0]);
+                    if (numPreparseThreads < 0) {
+                        std::cerr << "preparseThreads must not be negative" << std::endl;
+                        return false;
+                    }
+                    return true;
+                }},
+            {"--streamIndex", nullptr, 1,
+                "Random access index file of the elementary stream: loaded if it matches the "
+                "stream, otherwise built and saved (enables access unit pre-parsing)",
+                [this](const char **args, const ProgramArgs &a) {
+                    streamIndexFileName = args[0];
+                    return true;
+                }},
             {"--codec", nullptr, 1, "Codec to use, if no stream auto-detect is in use",
                 [this](const char **args, const ProgramArgs &a) {
                     if ((strcmp(args[0], "hevc") == 0) ||
@@ -214,6 +246,68 @@ struct DecoderConfig {
                     numDecodeImagesInFlight = std::atoi(args[0]);
                     return true;
                 }},
+            {"--parserLookahead", nullptr, 1,
+                "Demux, parse and submit the decoding of up to this number of frames ahead of the consumer, "
+                "on a thread of its own (0 parses on the thread getting the frames). "
+                "At most half of --decodeImagesInFlight",
+                [this](const char **args, const ProgramArgs &a) {
+                    parserLookahead = std::atoi(args[0]);
+                    if (parserLookahead < 0) {
+                        std::cerr << "parserLookahead must not be negative" << std::endl;
+                        return false;
+                    }
+                    return true;
+                }},
+            {"--bitstreamRingSize", nullptr, 1,
+                "Size in MB of a single ring buffer holding the bitstream of the pictures in flight, "
+                "instead of a buffer per picture (0 disables the ring)",
+                [this](const char **args, const ProgramArgs &a) {
+                    bitstreamRingSizeMB = std::atoi(args[0]);
+                    if (bitstreamRingSizeMB < 0) {
+                        std::cerr << "bitstreamRingSize must not be negative" << std::endl;
+                        return false;
+                    }
+                    return true;
+                }},
+            {"--skipNonRef", nullptr, 0,
+                "Skip the non-reference pictures at parse time (the highest decoded sub-layer for H.265)",
+                [this](const char **args, const ProgramArgs &a) {
+                    skipNonReference = true;
+                    return true;
+                }},
+            {"--keyFramesOnly", nullptr, 0,
+                "Decode only the key frames (IDR/IRAP pictures, AV1 key frames), skip all the others at parse time",
+                [this](const char **args, const ProgramArgs &a) {
+                    keyFramesOnly = true;
+                    return true;
+                }},
+            {"--resyncOnError", nullptr, 0,
+                "After a stream error or a missing reference, skip the pictures up to the next random access point",
+                [this](const char **args, const ProgramArgs &a) {
+                    resyncOnError = true;
+                    return true;
+                }},
+            {"--maxTemporalId", nullptr, 1,
+                "Skip the pictures of the temporal layers above this id (H.265 and AV1)",
+                [this](const char **args, const ProgramArgs &a) {
+                    maxTemporalId = std::atoi(args[0]);
+                    if (maxTemporalId < 0) {
+                        std::cerr << "maxTemporalId must not be negative" << std::endl;
+                        return false;
+                    }
+                    return true;
+                }},
+            {"--av1OperatingPoint", nullptr, 1,
+                "AV1 operating point to decode, from the sequence header (0 by default)",
+                [this](const char **args, const ProgramArgs &a) {
+                    int operatingPoint = std::atoi(args[0]);
+                    if (operatingPoint < 0) {
+                        std::cerr << "av1OperatingPoint must not be negative" << std::endl;
+                        return false;
+                    }
+                    av1OperatingPoint = (uint32_t)operatingPoint;
+                    return true;
+                }},
             {"--displayBackBufferSize", nullptr, 1,
                 "Size of display back-buffers swapchain queue size",
                 [this](const char **args, const ProgramArgs &a) {
@@ -328,6 +422,43 @@ struct DecoderConfig {
                     crcInitValue = crcInitValueTemp;
                     return true;
                 }},
+            {"--outputNative", nullptr, 0,
+                "Output the planes as decoded (NV12, P010...) to a raw YUV file, instead of planar YUV",
+                [this](const char **args, const ProgramArgs &a) {
+                    outputNativeLayout = true;
+                    outputy4m = false;
+                    return true;
+                }},
+            {"--outputLsbAligned", nullptr, 0,
+                "Output the 10 and 12-bit samples LSB-aligned (yuv420p10le...), instead of MSB-aligned in 16 bits",
+                [this](const char **args, const ProgramArgs &a) {
+                    outputLsbAligned = true;
+                    return true;
+                }},
+            {"--verifyPictureHash", nullptr, 0,
+                "Verify the decoded frames against the decoded picture hash SEI of the stream (H.265), "
+                "without writing them, and report the mismatches per frame",
+                [this](const char **args, const ProgramArgs &a) {
+                    verifyPictureHash = true;
+                    return true;
+                }},
+            {"--outputBuffers", nullptr, 1,
+                "Write the output file from a separate thread, with the given number of host frame buffers "
+                "in flight (0 writes each frame before the next one is decoded, the default)",
+                [this](const char **args, const ProgramArgs &a) {
+                    numOutputBuffers = std::atoi(args[0]);
+                    if (numOutputBuffers < 0) {
+                        std::cerr << "outputBuffers must not be negative" << std::endl;
+                        return false;
+                    }
+                    return true;
+                }},
+            {"--outputDirectIo", nullptr, 0,
+                "Write the output file with O_DIRECT, bypassing the page cache (Linux, with --outputBuffers)",
+                [this](const char **args, const ProgramArgs &a) {
+                    outputDirectIo = true;
+                    return true;
+                }},
         };
 
         for (int i = 1; i < argc; i++) {
@@ -380,6 +511,16 @@ struct DecoderConfig {
             i += flag->numArgs;
         }
 
+        if (outputNativeLayout && outputy4m) {
+            std::cerr << "--outputNative writes raw YUV, it can't be used with --y4m" << std::endl;
+            return false;
+        }
+
+        if (verifyPictureHash && !outputFileName.empty()) {
+            std::cerr << "--verifyPictureHash writes no output file, it can't be used with -o" << std::endl;
+            return false;
+        }
+
         // Resolve the CRC request in case there is a --crcinit specified.
         if (((outputcrcPerFrame != 0) || (outputcrc != 0))) {
             if (crcInitValue.empty() != false) {
@@ -399,6 +540,7 @@ struct DecoderConfig {
     }
 
     std::string crcOutputFileName;
+    std::string streamIndexFileName;
     std::string appName;
     vk::DeviceUuidUtils deviceUUID;
     int initialWidth;
@@ -408,8 +550,12 @@ struct DecoderConfig {
     int videoHeight;
     int queueCount;
     int32_t numDecodeImagesInFlight;
+    int32_t parserLookahead;
     int32_t numDecodeImagesToPreallocate;
     int32_t numBitstreamBuffersToPreallocate;
+    int32_t bitstreamRingSizeMB;
+    int32_t maxTemporalId;
+    uint32_t av1OperatingPoint;
     int backBufferCount;
     int ticksPerSecond;
     int maxFrameCount;
@@ -425,6 +571,8 @@ struct DecoderConfig {
     uint32_t deviceId;
     uint32_t decoderQueueSize;
     int32_t enablePostProcessFilter;
+    int32_t numPreparseThreads;
+    int32_t numOutputBuffers;
     uint32_t enableStreamDemuxing : 1;
     uint32_t directMode : 1;
     uint32_t vsync : 1;
@@ -433,10 +581,17 @@ struct DecoderConfig {
     uint32_t verbose : 1;
     uint32_t noPresent : 1;
     uint32_t enableHwLoadBalancing : 1;
+    uint32_t skipNonReference : 1;
+    uint32_t keyFramesOnly : 1;
+    uint32_t resyncOnError : 1;
     uint32_t selectVideoWithComputeQueue : 1;
     uint32_t outputy4m : 1;
     uint32_t outputcrc : 1;
     uint32_t outputcrcPerFrame : 1;
+    uint32_t outputDirectIo : 1;
+    uint32_t outputNativeLayout : 1;
+    uint32_t outputLsbAligned : 1;
+    uint32_t verifyPictureHash : 1;
 };
 
 #endif /* _PROGRAMSETTINGS_H_ */
@@ -17,6 +17,7 @@
 #ifndef _VKCODECUTILS_VKTHREADSAFEQUEUE_H_
 #define _VKCODECUTILS_VKTHREADSAFEQUEUE_H_
 
+#include <assert.h>
 #include <queue>
 #include <atomic>
 #include <condition_variable>
@@ -40,8 +41,12 @@ public:
             return false;
         }
 
-        // Wait for the consumer to consume the previous node item(s)
-        m_condProducer.wait(lock, [this]{ return (!m_queueIsFlushing && (m_queue.size() < m_maxPendingQueueNodes)); });
+        // Wait for the consumer to consume the previous node item(s), or for the queue to be flushed
+        m_condProducer.wait(lock, [this]{ return (m_queueIsFlushing || (m_queue.size() < m_maxPendingQueueNodes)); });
+
+        if (m_queueIsFlushing) {
+            return false;
+        }
 
         m_queue.push(node);
         m_condConsumer.notify_one();
@@ -61,9 +66,11 @@ public:
             return TryPopNoLock(node);
         }
 
-        m_condConsumer.wait(lock, [this]{ return ((m_queueIsFlushing == false) && !m_queue.empty()); });
-        node = m_queue.front();
-        m_queue.pop();
+        // Once flushing, the nodes left are still popped, then false is returned
+        m_condConsumer.wait(lock, [this]{ return (m_queueIsFlushing || !m_queue.empty()); });
+        if (!TryPopNoLock(node)) {
+            return false;
+        }
         // Notify the producer
         m_condProducer.notify_one();
 
@@ -90,6 +97,15 @@ public:
         m_condConsumer.notify_one();
     }
 
+    // Takes a flushed queue, once emptied, back into use
+    void Reset()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+
+        assert(m_queue.empty());
+        m_queueIsFlushing = false;
+    }
+
     bool ExitQueue() {
         std::unique_lock<std::mutex> lock(m_mutex);
         return ((m_queueIsFlushing == true) && m_queue.empty());
@@ -47,6 +47,13 @@ public:
      * @param crcOutputFile File name for CRC output
      * @param crcInitValue Initial CRC values
      * @param frameToFile Reference to store the created instance
+     * @param numOutputBuffers Number of host frame buffers handed to a writer thread,
+     *                         0 to write each frame from OutputFrame()
+     * @param directIo Whether the writer thread bypasses the page cache (O_DIRECT, Linux only)
+     * @param nativeLayout Whether to write the planes as decoded (NV12, P010...), raw YUV only
+     * @param lsbAligned Whether to write the 10 and 12-bit samples LSB-aligned (yuv420p10le...)
+     * @param verifyPictureHash Whether to verify the frames against the decoded picture hashes of the
+     *                          stream instead of writing them, fileName must then be nullptr
      * @return VkResult VK_SUCCESS on success, error code otherwise
      */
     static VkResult Create(const char* fileName,
@@ -54,27 +61,48 @@ public:
                           bool outputcrcPerFrame = false,
                           const char* crcOutputFile = nullptr,
                           const std::vector<uint32_t>& crcInitValue = std::vector<uint32_t>(),
-                          VkSharedBaseObj<VkVideoFrameOutput>& frameToFile = invalidFrameToFile);
+                          VkSharedBaseObj<VkVideoFrameOutput>& frameToFile = invalidFrameToFile,
+                          uint32_t numOutputBuffers = 0,
+                          bool directIo = false,
+                          bool nativeLayout = false,
+                          bool lsbAligned = false,
+                          bool verifyPictureHash = false);
 
     virtual ~VkVideoFrameOutput() = default;
 
     /**
      * @brief Outputs a decoded frame to file
      *
+     * With a writer thread, the frame is copied to a free host buffer and queued:
+     * the frame can be released as soon as this returns.
+     *
      * @param pFrame Pointer to the decoded frame
      * @param vkDevCtx Vulkan device context
-     * @return size_t Number of bytes written, (size_t)-1 on error
+     * @return size_t Number of bytes written (queued with a writer thread), (size_t)-1 on error
      */
     virtual size_t OutputFrame(VulkanDecodedFrame* pFrame, const VulkanDeviceContext* vkDevCtx) = 0;
 
     /**
      * @brief Get the CRC values for the frame
      *
+     * Waits for the writer thread, if any, to process the queued frames.
+     *
      * @param pCrcValues Pointer to store the CRC values
      * @param buffSize Size of the buffer to store the CRC values
      * @return size_t Number of CRC values written, (size_t)-1 on error
      */
     virtual size_t GetCrcValues(uint32_t* pCrcValues, size_t buffSize) const  = 0;
+
+    /**
+     * @brief Get the results of the decoded picture hash verification
+     *
+     * Waits for the writer thread, if any, to process the queued frames.
+     *
+     * @param pNumVerifiedFrames Optional pointer to store the number of frames with a hash
+     * @param pNumFramesWithoutHash Optional pointer to store the number of frames without a hash
+     * @return uint32_t Number of frames whose hash does not match
+     */
+    virtual uint32_t GetPictureHashResults(uint32_t* pNumVerifiedFrames, uint32_t* pNumFramesWithoutHash) const = 0;
 protected:
     VkVideoFrameOutput() = default;
 
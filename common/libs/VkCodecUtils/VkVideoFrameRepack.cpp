@@ -0,0 +1,397 @@
+/*
+* Copyright 2024 NVIDIA Corporation.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include <future>
+#include <vector>
+#include "VkThreadPool.h"
+#include "VkVideoFrameRepack.h"
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define VK_VIDEO_REPACK_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#define VK_VIDEO_REPACK_NEON 1
+#include <arm_neon.h>
+#endif
+
+// The x86 kernels are built for their ISA in this translation unit, and only called if the CPU has it.
+// MSVC accepts the intrinsics of any ISA without a target.
+#if defined(VK_VIDEO_REPACK_X86) && (defined(__GNUC__) || defined(__clang__))
+#define VK_VIDEO_REPACK_TARGET(isa) __attribute__((target(isa)))
+#else
+#define VK_VIDEO_REPACK_TARGET(isa)
+#endif
+
+// The kernels of one row: count is the number of output samples of each plane
+struct RepackRowKernels {
+    void (*splitRow8)(const uint8_t* pSrc, uint8_t* pCb, uint8_t* pCr, uint32_t count);
+    void (*splitRow16)(const uint16_t* pSrc, uint16_t* pCb, uint16_t* pCr, uint32_t count, uint32_t shift);
+    void (*shiftRow16)(const uint16_t* pSrc, uint16_t* pDst, uint32_t count, uint32_t shift);
+};
+
+static void SplitRow8C(const uint8_t* pSrc, uint8_t* pCb, uint8_t* pCr, uint32_t count)
+{
+    for (uint32_t i = 0; i < count; i++) {
+        pCb[i] = pSrc[2 * i];
+        pCr[i] = pSrc[2 * i + 1];
+    }
+}
+
+static void SplitRow16C(const uint16_t* pSrc, uint16_t* pCb, uint16_t* pCr, uint32_t count, uint32_t shift)
+{
+    for (uint32_t i = 0; i < count; i++) {
+        pCb[i] = (uint16_t)(pSrc[2 * i] >> shift);
+        pCr[i] = (uint16_t)(pSrc[2 * i + 1] >> shift);
+    }
+}
+
+static void ShiftRow16C(const uint16_t* pSrc, uint16_t* pDst, uint32_t count, uint32_t shift)
+{
+    for (uint32_t i = 0; i < count; i++) {
+        pDst[i] = (uint16_t)(pSrc[i] >> shift);
+    }
+}
+
+#if defined(VK_VIDEO_REPACK_X86)
+
+VK_VIDEO_REPACK_TARGET("sse4.1")
+static void SplitRow8SSE41(const uint8_t* pSrc, uint8_t* pCb, uint8_t* pCr, uint32_t count)
+{
+    const __m128i mask = _mm_set1_epi16(0x00FF);
+    uint32_t i = 0;
+    for (; (i + 16) <= count; i += 16) {
+        __m128i a = _mm_loadu_si128((const __m128i*)(pSrc + 2 * i));
+        __m128i b = _mm_loadu_si128((const __m128i*)(pSrc + 2 * i + 16));
+        __m128i cb = _mm_packus_epi16(_mm_and_si128(a, mask), _mm_and_si128(b, mask));
+        __m128i cr = _mm_packus_epi16(_mm_srli_epi16(a, 8), _mm_srli_epi16(b, 8));
+        _mm_storeu_si128((__m128i*)(pCb + i), cb);
+        _mm_storeu_si128((__m128i*)(pCr + i), cr);
+    }
+    SplitRow8C(pSrc + 2 * i, pCb + i, pCr + i, count - i);
+}
+
+VK_VIDEO_REPACK_TARGET("sse4.1")
+static void SplitRow16SSE41(const uint16_t* pSrc, uint16_t* pCb, uint16_t* pCr, uint32_t count, uint32_t shift)
+{
+    const __m128i mask = _mm_set1_epi32(0xFFFF);
+    const __m128i shiftCount = _mm_cvtsi32_si128((int)shift);
+    uint32_t i = 0;
+    for (; (i + 8) <= count; i += 8) {
+        __m128i a = _mm_srl_epi16(_mm_loadu_si128((const __m128i*)(pSrc + 2 * i)), shiftCount);
+        __m128i b = _mm_srl_epi16(_mm_loadu_si128((const __m128i*)(pSrc + 2 * i + 8)), shiftCount);
+        __m128i cb = _mm_packus_epi32(_mm_and_si128(a, mask), _mm_and_si128(b, mask));
+        __m128i cr = _mm_packus_epi32(_mm_srli_epi32(a, 16), _mm_srli_epi32(b, 16));
+        _mm_storeu_si128((__m128i*)(pCb + i), cb);
+        _mm_storeu_si128((__m128i*)(pCr + i), cr);
+    }
+    SplitRow16C(pSrc + 2 * i, pCb + i, pCr + i, count - i, shift);
+}
+
+VK_VIDEO_REPACK_TARGET("sse4.1")
+static void ShiftRow16SSE41(const uint16_t* pSrc, uint16_t* pDst, uint32_t count, uint32_t shift)
+{
+    const __m128i shiftCount = _mm_cvtsi32_si128((int)shift);
+    uint32_t i = 0;
+    for (; (i + 8) <= count; i += 8) {
+        __m128i a = _mm_loadu_si128((const __m128i*)(pSrc + i));
+        _mm_storeu_si128((__m128i*)(pDst + i), _mm_srl_epi16(a, shiftCount));
+    }
+    ShiftRow16C(pSrc + i, pDst + i, count - i, shift);
+}
+
+// The 256-bit packs work within each 128-bit lane: the 64-bit quarters are put back in order after them.
+VK_VIDEO_REPACK_TARGET("avx2")
+static void SplitRow8AVX2(const uint8_t* pSrc, uint8_t* pCb, uint8_t* pCr, uint32_t count)
+{
+    const __m256i mask = _mm256_set1_epi16(0x00FF);
+    uint32_t i = 0;
+    for (; (i + 32) <= count; i += 32) {
+        __m256i a = _mm256_loadu_si256((const __m256i*)(pSrc + 2 * i));
+        __m256i b = _mm256_loadu_si256((const __m256i*)(pSrc + 2 * i + 32));
+        __m256i cb = _mm256_packus_epi16(_mm256_and_si256(a, mask), _mm256_and_si256(b, mask));
+        __m256i cr = _mm256_packus_epi16(_mm256_srli_epi16(a, 8), _mm256_srli_epi16(b, 8));
+        _mm256_storeu_si256((__m256i*)(pCb + i), _mm256_permute4x64_epi64(cb, 0xD8));
+        _mm256_storeu_si256((__m256i*)(pCr + i), _mm256_permute4x64_epi64(cr, 0xD8));
+    }
+    SplitRow8SSE41(pSrc + 2 * i, pCb + i, pCr + i, count - i);
+}
+
+VK_VIDEO_REPACK_TARGET("avx2")
+static void SplitRow16AVX2(const uint16_t* pSrc, uint16_t* pCb, uint16_t* pCr, uint32_t count, uint32_t shift)
+{
+    const __m256i mask = _mm256_set1_epi32(0xFFFF);
+    const __m128i shiftCount = _mm_cvtsi32_si128((int)shift);
+    uint32_t i = 0;
+    for (; (i + 16) <= count; i += 16) {
+        __m256i a = _mm256_srl_epi16(_mm256_loadu_si256((const __m256i*)(pSrc + 2 * i)), shiftCount);
+        __m256i b = _mm256_srl_epi16(_mm256_loadu_si256((const __m256i*)(pSrc + 2 * i + 16)), shiftCount);
+        __m256i cb = _mm256_packus_epi32(_mm256_and_si256(a, mask), _mm256_and_si256(b, mask));
+        __m256i cr = _mm256_packus_epi32(_mm256_srli_epi32(a, 16), _mm256_srli_epi32(b, 16));
+        _mm256_storeu_si256((__m256i*)(pCb + i), _mm256_permute4x64_epi64(cb, 0xD8));
+        _mm256_storeu_si256((__m256i*)(pCr + i), _mm256_permute4x64_epi64(cr, 0xD8));
+    }
+    SplitRow16SSE41(pSrc + 2 * i, pCb + i, pCr + i, count - i, shift);
+}
+
+VK_VIDEO_REPACK_TARGET("avx2")
+static void ShiftRow16AVX2(const uint16_t* pSrc, uint16_t* pDst, uint32_t count, uint32_t shift)
+{
+    const __m128i shiftCount = _mm_cvtsi32_si128((int)shift);
+    uint32_t i = 0;
+    for (; (i + 16) <= count; i += 16) {
+        __m256i a = _mm256_loadu_si256((const __m256i*)(pSrc + i));
+        _mm256_storeu_si256((__m256i*)(pDst + i), _mm256_srl_epi16(a, shiftCount));
+    }
+    ShiftRow16SSE41(pSrc + i, pDst + i, count - i, shift);
+}
+
+#elif defined(VK_VIDEO_REPACK_NEON)
+
+static void SplitRow8NEON(const uint8_t* pSrc, uint8_t* pCb, uint8_t* pCr, uint32_t count)
+{
+    uint32_t i = 0;
+    for (; (i + 16) <= count; i += 16) {
+        uint8x16x2_t cbcr = vld2q_u8(pSrc + 2 * i);
+        vst1q_u8(pCb + i, cbcr.val[0]);
+        vst1q_u8(pCr + i, cbcr.val[1]);
+    }
+    SplitRow8C(pSrc + 2 * i, pCb + i, pCr + i, count - i);
+}
+
+static void SplitRow16NEON(const uint16_t* pSrc, uint16_t* pCb, uint16_t* pCr, uint32_t count, uint32_t shift)
+{
+    const int16x8_t shiftCount = vdupq_n_s16(-(int16_t)shift);
+    uint32_t i = 0;
+    for (; (i + 8) <= count; i += 8) {
+        uint16x8x2_t cbcr = vld2q_u16(pSrc + 2 * i);
+        vst1q_u16(pCb + i, vshlq_u16(cbcr.val[0], shiftCount));
+        vst1q_u16(pCr + i, vshlq_u16(cbcr.val[1], shiftCount));
+    }
+    SplitRow16C(pSrc + 2 * i, pCb + i, pCr + i, count - i, shift);
+}
+
+static void ShiftRow16NEON(const uint16_t* pSrc, uint16_t* pDst, uint32_t count, uint32_t shift)
+{
+    const int16x8_t shiftCount = vdupq_n_s16(-(int16_t)shift);
+    uint32_t i = 0;
+    for (; (i + 8) <= count; i += 8) {
+        vst1q_u16(pDst + i, vshlq_u16(vld1q_u16(pSrc + i), shiftCount));
+    }
+    ShiftRow16C(pSrc + i, pDst + i, count - i, shift);
+}
+
+#endif
+
+static VkVideoFrameRepack::SimdIsa DetectSimdIsa()
+{
+#if defined(VK_VIDEO_REPACK_X86) && (defined(__GNUC__) || defined(__clang__))
+    if (__builtin_cpu_supports("avx2")) {
+        return VkVideoFrameRepack::SIMD_ISA_AVX2;
+    } else if (__builtin_cpu_supports("sse4.1")) {
+        return VkVideoFrameRepack::SIMD_ISA_SSE41;
+    }
+#elif defined(VK_VIDEO_REPACK_X86)
+    int cpuInfo[4] = {};
+    __cpuid(cpuInfo, 0);
+    const int numIds = cpuInfo[0];
+    if (numIds >= 7) {
+        __cpuidex(cpuInfo, 7, 0);
+        if (cpuInfo[1] & (1 << 5)) {
+            return VkVideoFrameRepack::SIMD_ISA_AVX2;
+        }
+    }
+    if (numIds >= 1) {
+        __cpuidex(cpuInfo, 1, 0);
+        if (cpuInfo[2] & (1 << 19)) {
+            return VkVideoFrameRepack::SIMD_ISA_SSE41;
+        }
+    }
+#elif defined(VK_VIDEO_REPACK_NEON)
+    return VkVideoFrameRepack::SIMD_ISA_NEON;
+#endif
+    return VkVideoFrameRepack::SIMD_ISA_C;
+}
+
+static VkVideoFrameRepack::SimdIsa SelectSimdIsa()
+{
+    const VkVideoFrameRepack::SimdIsa detected = DetectSimdIsa();
+
+#if defined(_MSC_VER)
+#pragma warning(suppress : 4996)
+#endif
+    const char* pIsaName = getenv("VK_VIDEO_REPACK_SIMD_ISA");
+    if (pIsaName == nullptr) {
+        return detected;
+    }
+
+    static const struct {
+        const char*                 name;
+        VkVideoFrameRepack::SimdIsa isa;
+    } isaNames[] = {
+        { "c",      VkVideoFrameRepack::SIMD_ISA_C },
+        { "sse41",  VkVideoFrameRepack::SIMD_ISA_SSE41 },
+        { "avx2",   VkVideoFrameRepack::SIMD_ISA_AVX2 },
+        { "neon",   VkVideoFrameRepack::SIMD_ISA_NEON },
+    };
+    for (const auto& isaName : isaNames) {
+        if (strcmp(pIsaName, isaName.name) != 0) {
+            continue;
+        }
+        // The C kernels, or a lower x86 ISA than the detected one
+        const bool isX86Isa = (isaName.isa == VkVideoFrameRepack::SIMD_ISA_SSE41) ||
+                              (isaName.isa == VkVideoFrameRepack::SIMD_ISA_AVX2);
+        const bool isX86Detected = (detected == VkVideoFrameRepack::SIMD_ISA_SSE41) ||
+                                   (detected == VkVideoFrameRepack::SIMD_ISA_AVX2);
+        if ((isaName.isa == VkVideoFrameRepack::SIMD_ISA_C) ||
+            (isX86Isa && isX86Detected && (isaName.isa <= detected))) {
+            return isaName.isa;
+        }
+    }
+    return detected;
+}
+
+VkVideoFrameRepack::SimdIsa VkVideoFrameRepack::GetSimdIsa()
+{
+    static const SimdIsa simdIsa = SelectSimdIsa();
+    return simdIsa;
+}
+
+static RepackRowKernels SelectRowKernels(VkVideoFrameRepack::SimdIsa simdIsa)
+{
+    switch (simdIsa) {
+#if defined(VK_VIDEO_REPACK_X86)
+    case VkVideoFrameRepack::SIMD_ISA_AVX2:
+        return { SplitRow8AVX2, SplitRow16AVX2, ShiftRow16AVX2 };
+    case VkVideoFrameRepack::SIMD_ISA_SSE41:
+        return { SplitRow8SSE41, SplitRow16SSE41, ShiftRow16SSE41 };
+#elif defined(VK_VIDEO_REPACK_NEON)
+    case VkVideoFrameRepack::SIMD_ISA_NEON:
+        return { SplitRow8NEON, SplitRow16NEON, ShiftRow16NEON };
+#endif
+    default:
+        return { SplitRow8C, SplitRow16C, ShiftRow16C };
+    }
+}
+
+static const RepackRowKernels& GetRowKernels()
+{
+    static const RepackRowKernels rowKernels = SelectRowKernels(VkVideoFrameRepack::GetSimdIsa());
+    return rowKernels;
+}
+
+static void CopyRow(const RepackRowKernels& kernels, const uint8_t* pSrc, uint8_t* pDst,
+                    uint32_t count, uint32_t bytesPerSample, uint32_t shift)
+{
+    if ((bytesPerSample == 2) && (shift != 0)) {
+        kernels.shiftRow16((const uint16_t*)pSrc, (uint16_t*)pDst, count, shift);
+    } else {
+        memcpy(pDst, pSrc, (size_t)count * bytesPerSample);
+    }
+}
+
+// Repacks the luma rows [lumaRowBegin, lumaRowEnd) and the chroma rows [chromaRowBegin, chromaRowEnd)
+static void RepackRows(const VkVideoFrameRepack::Frame& frame, VkVideoFrameRepack::OutputLayout outputLayout,
+                       uint8_t* pOutput, uint32_t lumaRowBegin, uint32_t lumaRowEnd,
+                       uint32_t chromaRowBegin, uint32_t chromaRowEnd)
+{
+    const RepackRowKernels& kernels = GetRowKernels();
+    const uint32_t bytesPerSample = frame.bytesPerSample;
+    const size_t lumaRowSize = (size_t)frame.width * bytesPerSample;
+    const size_t chromaRowSize = (size_t)frame.chromaWidth * bytesPerSample;
+    const size_t lumaPlaneSize = lumaRowSize * frame.height;
+    const size_t chromaPlaneSize = chromaRowSize * frame.chromaHeight;
+
+    for (uint32_t row = lumaRowBegin; row < lumaRowEnd; row++) {
+        CopyRow(kernels, frame.pPlanes[0] + row * frame.rowPitches[0], pOutput + row * lumaRowSize,
+                frame.width, bytesPerSample, frame.shift);
+    }
+
+    if (frame.numPlanes == 2) {
+        for (uint32_t row = chromaRowBegin; row < chromaRowEnd; row++) {
+            const uint8_t* pSrc = frame.pPlanes[1] + row * frame.rowPitches[1];
+            if (outputLayout == VkVideoFrameRepack::OUTPUT_LAYOUT_NATIVE) {
+                CopyRow(kernels, pSrc, pOutput + lumaPlaneSize + row * 2 * chromaRowSize,
+                        2 * frame.chromaWidth, bytesPerSample, frame.shift);
+                continue;
+            }
+
+            uint8_t* pCb = pOutput + lumaPlaneSize + row * chromaRowSize;
+            uint8_t* pCr = pCb + chromaPlaneSize;
+            if (bytesPerSample == 1) {
+                kernels.splitRow8(pSrc, pCb, pCr, frame.chromaWidth);
+            } else {
+                kernels.splitRow16((const uint16_t*)pSrc, (uint16_t*)pCb, (uint16_t*)pCr,
+                                   frame.chromaWidth, frame.shift);
+            }
+        }
+    } else if (frame.numPlanes == 3) {
+        for (uint32_t plane = 1; plane < 3; plane++) {
+            uint8_t* pDst = pOutput + lumaPlaneSize + (plane - 1) * chromaPlaneSize;
+            for (uint32_t row = chromaRowBegin; row < chromaRowEnd; row++) {
+                CopyRow(kernels, frame.pPlanes[plane] + row * frame.rowPitches[plane], pDst + row * chromaRowSize,
+                        frame.chromaWidth, bytesPerSample, frame.shift);
+            }
+        }
+    }
+}
+
+size_t VkVideoFrameRepack::GetOutputSize(const Frame& frame)
+{
+    size_t outputSize = (size_t)frame.width * frame.height * frame.bytesPerSample;
+    if (frame.numPlanes > 1) {
+        outputSize += 2 * (size_t)frame.chromaWidth * frame.chromaHeight * frame.bytesPerSample;
+    }
+    return outputSize;
+}
+
+size_t VkVideoFrameRepack::Repack(const Frame& frame, OutputLayout outputLayout, uint8_t* pOutput,
+                                  VkThreadPool* pThreadPool, uint32_t numBands)
+{
+    assert((frame.bytesPerSample == 1) || (frame.bytesPerSample == 2));
+    assert((frame.numPlanes >= 1) && (frame.numPlanes <= 3));
+
+    if ((pThreadPool == nullptr) || (numBands < 2) || (frame.height < (2 * numBands))) {
+        RepackRows(frame, outputLayout, pOutput, 0, frame.height, 0, frame.chromaHeight);
+        return GetOutputSize(frame);
+    }
+
+    // Band 0 is repacked on this thread, while the pool takes the others
+    std::vector<std::future<void>> bands;
+    bands.reserve(numBands - 1);
+    for (uint32_t band = 1; band < numBands; band++) {
+        const uint32_t lumaRowBegin = (uint32_t)(((uint64_t)frame.height * band) / numBands);
+        const uint32_t lumaRowEnd = (uint32_t)(((uint64_t)frame.height * (band + 1)) / numBands);
+        const uint32_t chromaRowBegin = (uint32_t)(((uint64_t)frame.chromaHeight * band) / numBands);
+        const uint32_t chromaRowEnd = (uint32_t)(((uint64_t)frame.chromaHeight * (band + 1)) / numBands);
+        bands.push_back(pThreadPool->enqueue([&frame, outputLayout, pOutput, lumaRowBegin, lumaRowEnd,
+                                              chromaRowBegin, chromaRowEnd]() {
+            RepackRows(frame, outputLayout, pOutput, lumaRowBegin, lumaRowEnd, chromaRowBegin, chromaRowEnd);
+        }));
+    }
+
+    RepackRows(frame, outputLayout, pOutput, 0, frame.height / numBands, 0, frame.chromaHeight / numBands);
+
+    for (std::future<void>& band : bands) {
+        band.wait();
+    }
+    return GetOutputSize(frame);
+}
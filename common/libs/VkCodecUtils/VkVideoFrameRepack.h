@@ -0,0 +1,77 @@
+/*
+* Copyright 2024 NVIDIA Corporation.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#ifndef _VKCODECUTILS_VKVIDEOFRAMEREPACK_H_
+#define _VKCODECUTILS_VKVIDEOFRAMEREPACK_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+class VkThreadPool;
+
+// Packs the planes of a host-mapped YCbCr image into a contiguous output frame, without row padding.
+//
+// The interleaved CbCr plane of the semi-planar layouts (NV12, P010, P016, NV16, NV24...) is split into
+// the Cb and Cr planes in a single pass, so that the output is planar (I420, I010, I422, I444...). The
+// 16-bit samples can be shifted right on the way, to output the MSB-aligned 10 and 12-bit samples of the
+// decoder LSB-aligned (yuv420p10le). The native layout output copies the planes as they are.
+//
+// The rows are processed by SSE4.1, AVX2 or NEON kernels, selected once per process from the CPU
+// features. The VK_VIDEO_REPACK_SIMD_ISA environment variable (c, sse41, avx2 or neon) selects a lower
+// ISA than the detected one. Given a thread pool, the rows of the frame are split into bands, repacked
+// in parallel.
+class VkVideoFrameRepack
+{
+public:
+
+    enum SimdIsa {
+        SIMD_ISA_C = 0,
+        SIMD_ISA_SSE41,
+        SIMD_ISA_AVX2,
+        SIMD_ISA_NEON,
+    };
+
+    enum OutputLayout {
+        OUTPUT_LAYOUT_PLANAR = 0,   // Y, Cb then Cr planes
+        OUTPUT_LAYOUT_NATIVE,       // The planes of the image, without row padding
+    };
+
+    // The planes of the source image
+    struct Frame {
+        const uint8_t* pPlanes[3];      // Y, then the interleaved CbCr plane, or the Cb and Cr planes
+        size_t         rowPitches[3];
+        uint32_t       numPlanes;       // 1 (luma only), 2 (semi-planar) or 3 (planar)
+        uint32_t       width;           // Luma size, in samples
+        uint32_t       height;
+        uint32_t       chromaWidth;     // Size of each chroma component, in samples
+        uint32_t       chromaHeight;
+        uint32_t       bytesPerSample;  // 1 or 2
+        uint32_t       shift;           // Right shift of the 16-bit samples (0 keeps them as they are)
+    };
+
+    // Returns the size of the output frame
+    static size_t GetOutputSize(const Frame& frame);
+
+    // Packs the frame into pOutput, which must hold GetOutputSize() bytes, and returns that size. With a
+    // thread pool, numBands bands of rows are repacked in parallel, one of them on the calling thread.
+    static size_t Repack(const Frame& frame, OutputLayout outputLayout, uint8_t* pOutput,
+                         VkThreadPool* pThreadPool = nullptr, uint32_t numBands = 1);
+
+    // The ISA of the row kernels
+    static SimdIsa GetSimdIsa();
+};
+
+#endif /* _VKCODECUTILS_VKVIDEOFRAMEREPACK_H_ */
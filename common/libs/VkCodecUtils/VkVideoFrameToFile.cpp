@@ -16,6 +16,19 @@
 
 #include <cstring>
 #include <inttypes.h>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#if defined(__linux__)
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
 #include <vulkan/vulkan.h>
 #include "nvidia_utils/vulkan/ycbcrvkinfo.h"
 #include "VulkanDeviceContext.h"
@@ -23,50 +36,67 @@
 #include "VkImageResource.h"
 #include "VulkanDecodedFrame.h"
 #include "Helpers.h"
+#include "VkThreadPool.h"
 #include "VkVideoFrameOutput.h"
+#include "VkVideoFrameRepack.h"
+#include "VkVideoPictureHash.h"
 #include "crcgenerator.h"
 
-template<typename T>
-static void CopyPlaneData(const uint8_t* pSrc, uint8_t* pDst,
-                         size_t srcRowPitch, size_t dstRowPitch,
-                         int32_t width, int32_t height,
-                         size_t srcPixelStride = 1) {
-    const T* src = reinterpret_cast<const T*>(pSrc);
-    T* dst = reinterpret_cast<T*>(pDst);
-    const size_t srcStride = srcRowPitch / sizeof(T);
-    const size_t dstStride = dstRowPitch / sizeof(T);
-
-    for (int32_t y = 0; y < height; y++) {
-        if (srcPixelStride == 1) {
-            memcpy(dst, src, width * sizeof(T));
-        } else {
-            for (int32_t x = 0; x < width; x++) {
-                dst[x] = src[x * srcPixelStride];
-            }
-        }
-        src += srcStride;
-        dst += dstStride;
-    }
-}
-
+// Writes the decoded frames to a raw YUV or Y4M file, and computes their CRCs.
+//
+// Each frame is first repacked into a host frame buffer, out of the linear image of the frame. Without a
+// writer thread, the frame is then written from OutputFrame(), on the decode thread. With one, OutputFrame()
+// only waits for the frame and copies it to a free buffer of a bounded pool, then queues that buffer: the
+// decoded frame can go back to the frame buffer right away, while the writer thread does the CRCs, the
+// Y4M headers and the file writes, batching all the queued frames in one writev(). OutputFrame() blocks
+// only when all the buffers of the pool are queued.
+//
+// With direct I/O (Linux), the writer thread packs the batches into an aligned staging buffer and writes
+// it with pwrite() on an O_DIRECT descriptor, to keep the output of long streams out of the page cache.
+//
+// To verify the decoded picture hashes of the stream, the frames are repacked planar and LSB-aligned, at
+// the size of the decoded picture, and hashed by the writer thread instead of being written.
 class VkVideoFrameToFileImpl : public VkVideoFrameOutput {
 public:
     VkVideoFrameToFileImpl(bool outputy4m,
                           bool outputcrcPerFrame,
                           const char* crcOutputFile,
-                          const std::vector<uint32_t>& crcInitValue)
+                          const std::vector<uint32_t>& crcInitValue,
+                          uint32_t numOutputBuffers,
+                          bool nativeLayout,
+                          bool lsbAligned,
+                          bool verifyPictureHash)
         : m_refCount(0)
         , m_outputFile(nullptr)
-        , m_pLinearMemory(nullptr)
-        , m_allocationSize(0)
         , m_firstFrame(true)
         , m_height(0)
         , m_width(0)
         , m_outputy4m(outputy4m)
         , m_outputcrcPerFrame(outputcrcPerFrame)
+        , m_nativeLayout(nativeLayout && !verifyPictureHash)
+        , m_lsbAligned(lsbAligned || verifyPictureHash)
+        , m_verifyPictureHash(verifyPictureHash)
+        , m_numHashVerifiedFrames(0)
+        , m_numHashMismatches(0)
+        , m_numFramesWithoutHash(0)
         , m_crcOutputFile(nullptr)
         , m_crcInitValue(crcInitValue)
-        , m_crcAllocation() {
+        , m_crcAllocation()
+        , m_crcValues()
+        , m_repackThreadPool()
+        , m_numRepackBands(1)
+        , m_hostFrames(std::max(numOutputBuffers, 1U))
+        , m_freeHostFrames()
+        , m_queuedHostFrames()
+        , m_numQueuedHostFrames(0)
+        , m_stopWriter(false)
+        , m_writeFailed(false)
+        , m_writerThread()
+        , m_useWriterThread(numOutputBuffers > 0)
+        , m_directIo(false)
+        , m_pStagingMemory(nullptr)
+        , m_stagingSize(0)
+        , m_fileOffset(0) {
         if (crcOutputFile != nullptr) {
             m_crcOutputFile = fopen(crcOutputFile, "w");
         }
@@ -77,19 +107,40 @@ public:
                 m_crcAllocation[i] = m_crcInitValue[i];
             }
         }
+
+        for (size_t i = 0; i < m_hostFrames.size(); i++) {
+            m_freeHostFrames.push_back(&m_hostFrames[i]);
+        }
     }
 
     virtual ~VkVideoFrameToFileImpl() override {
-        if (m_pLinearMemory) {
-            delete[] m_pLinearMemory;
-            m_pLinearMemory = nullptr;
+        StopWriter();
+
+        for (size_t i = 0; i < m_hostFrames.size(); i++) {
+            if (m_hostFrames[i].pData) {
+                delete[] m_hostFrames[i].pData;
+                m_hostFrames[i].pData = nullptr;
+            }
+        }
+
+#if defined(__linux__)
+        if (m_pStagingMemory) {
+            free(m_pStagingMemory);
+            m_pStagingMemory = nullptr;
         }
+#endif
 
         if (m_outputFile) {
             fclose(m_outputFile);
             m_outputFile = nullptr;
         }
 
+        if (m_verifyPictureHash) {
+            std::cout << "Decoded picture hash: " << m_numHashVerifiedFrames << " frames verified, "
+                      << m_numHashMismatches << " mismatches, "
+                      << m_numFramesWithoutHash << " frames without hash" << std::endl;
+        }
+
         if (m_crcOutputFile) {
             if (!m_crcAllocation.empty()) {
                 fprintf(m_crcOutputFile, "CRC: ");
@@ -119,7 +170,7 @@ public:
     }
 
     virtual size_t OutputFrame(VulkanDecodedFrame* pFrame, const VulkanDeviceContext* vkDevCtx) override {
-        if (!IsFileStreamValid()) {
+        if (!IsOutputValid() || m_writeFailed) {
             return (size_t)-1;
         }
 
@@ -131,8 +182,14 @@ public:
         assert(pFrame->pictureIndex != -1);
 
         VkSharedBaseObj<VkImageResource> imageResource = imageResourceView->GetImageResource();
-        uint8_t* pOutputBuffer = EnsureAllocation(vkDevCtx, imageResource);
-        assert(pOutputBuffer != nullptr);
+
+        // Blocks while all the host frames are queued to the writer thread
+        HostFrame* pHostFrame = AcquireHostFrame();
+        uint8_t* pOutputBuffer = EnsureAllocation(pHostFrame, imageResource);
+        if (pOutputBuffer == nullptr) {
+            ReleaseHostFrame(pHostFrame);
+            return (size_t)-1;
+        }
 
         assert((pFrame->displayWidth >= 0) && (pFrame->displayHeight >= 0));
 
@@ -143,35 +200,49 @@ public:
                         pFrame->startQueryId,
                         pFrame->pictureIndex, false, "frameCompleteFence");
 
-        VkFormat format = imageResource->GetImageCreateInfo().format;
-        const VkMpFormatInfo* mpInfo = YcbcrVkFormatInfo(format);
-        size_t usedBufferSize = ConvertFrameToNv12(vkDevCtx, pFrame->displayWidth, pFrame->displayHeight,
-                                                  imageResource, pOutputBuffer, mpInfo);
-
-        if (m_outputcrcPerFrame && m_crcOutputFile) {
-            fprintf(m_crcOutputFile, "CRC Frame[%lld]:", (long long)pFrame->displayOrder);
-            for (size_t i = 0; i < m_crcInitValue.size(); i += 1) {
-                uint32_t frameCrc = m_crcInitValue[i];
-                getCRC(&frameCrc, pOutputBuffer, usedBufferSize, Crc32Table);
-                fprintf(m_crcOutputFile, "0x%08X ", frameCrc);
-            }
-            fprintf(m_crcOutputFile, "\n");
-            if (m_crcOutputFile != stdout) {
-                fflush(m_crcOutputFile);
-            }
+        const VkImageCreateInfo& imageCreateInfo = imageResource->GetImageCreateInfo();
+        const VkMpFormatInfo* mpInfo = YcbcrVkFormatInfo(imageCreateInfo.format);
+        int32_t frameWidth = pFrame->displayWidth;
+        int32_t frameHeight = pFrame->displayHeight;
+        pHostFrame->pictureHash = VkVideoDecodedPictureHash();
+        if (m_verifyPictureHash && (pFrame->decodedPictureHash.type != VkVideoDecodedPictureHash::TYPE_NONE)) {
+            // The hash covers the decoded picture, before the cropping to the display size
+            pHostFrame->pictureHash = pFrame->decodedPictureHash;
+            frameWidth = (int32_t)std::min(pFrame->decodedPictureHash.width, imageCreateInfo.extent.width);
+            frameHeight = (int32_t)std::min(pFrame->decodedPictureHash.height, imageCreateInfo.extent.height);
         }
-
-        if (!m_crcAllocation.empty()) {
-            for (size_t i = 0; i < m_crcAllocation.size(); i += 1) {
-                getCRC(&m_crcAllocation[i], pOutputBuffer, usedBufferSize, Crc32Table);
-            }
+        pHostFrame->usedSize = RepackFrame(vkDevCtx, frameWidth, frameHeight,
+                                           imageResource, pOutputBuffer, mpInfo);
+        pHostFrame->width = frameWidth;
+        pHostFrame->height = frameHeight;
+        pHostFrame->displayOrder = pFrame->displayOrder;
+        pHostFrame->mpInfo = mpInfo;
+
+        if (m_useWriterThread) {
+            size_t usedBufferSize = pHostFrame->usedSize;
+            QueueHostFrame(pHostFrame);
+            return usedBufferSize;
         }
 
-        if (m_outputy4m) {
-            return WriteFrameToFileY4M(0, usedBufferSize, pFrame->displayWidth, pFrame->displayHeight, mpInfo);
-        } else {
-            return WriteDataToFile(0, usedBufferSize);
+        UpdateCrc(*pHostFrame);
+        VerifyPictureHash(*pHostFrame);
+        if (!IsFileStreamValid()) {
+            size_t usedBufferSize = pHostFrame->usedSize;
+            ReleaseHostFrame(pHostFrame);
+            return usedBufferSize;
+        }
+        // The byte count of the frame, as the writer thread path returns, or an error if any write fails
+        const size_t usedBufferSize = pHostFrame->usedSize;
+        const size_t headerSize = FormatFrameHeader(*pHostFrame);
+        const bool written = ((headerSize == 0) || (fwrite(pHostFrame->header, headerSize, 1, m_outputFile) == 1)) &&
+                             ((usedBufferSize == 0) || (fwrite(pHostFrame->pData, usedBufferSize, 1, m_outputFile) == 1));
+        ReleaseHostFrame(pHostFrame);
+        if (!written) {
+            std::cerr << "Failed to write the output file" << std::endl;
+            m_writeFailed = true;
+            return (size_t)-1;
         }
+        return usedBufferSize;
     }
 
     bool hasExtension(const char* fileName, const char* extension) {
@@ -225,58 +296,39 @@ public:
         return m_outputFile != nullptr;
     }
 
-    operator bool() const {
-        return IsFileStreamValid();
-    }
-
-    size_t WriteDataToFile(size_t offset, size_t size) {
-        return fwrite(m_pLinearMemory + offset, size, 1, m_outputFile);
+    // The frames are either written or only hashed
+    bool IsOutputValid() const {
+        return IsFileStreamValid() || m_verifyPictureHash;
     }
 
-    size_t GetMaxFrameSize() {
-        return m_allocationSize;
+    operator bool() const {
+        return IsFileStreamValid();
     }
 
-    size_t WriteFrameToFileY4M(size_t offset, size_t size, size_t width, size_t height,
-                              const VkMpFormatInfo* mpInfo) {
-        if (m_firstFrame != false) {
-            m_firstFrame = false;
-            fprintf(m_outputFile, "YUV4MPEG2 ");
-            fprintf(m_outputFile, "W%i H%i ", (int)width, (int)height);
-            m_height = height;
-            m_width = width;
-            fprintf(m_outputFile, "F24:1 ");
-            fprintf(m_outputFile, "Ip ");
-            fprintf(m_outputFile, "A1:1 ");
-            if (mpInfo->planesLayout.secondaryPlaneSubsampledX == false) {
-                fprintf(m_outputFile, "C444");
-            } else {
-                fprintf(m_outputFile, "C420");
-            }
-
-            if (mpInfo->planesLayout.bpp != YCBCRA_8BPP) {
-                fprintf(m_outputFile, "p16");
-            }
-
-            fprintf(m_outputFile, "\n");
+    // Starts the writer thread, once the output file is attached
+    void StartWriter(bool directIo) {
+        if (!m_useWriterThread || !IsOutputValid()) {
+            return;
         }
 
-        fprintf(m_outputFile, "FRAME");
-        if ((m_width != width) || (m_height != height)) {
-            fprintf(m_outputFile, " ");
-            fprintf(m_outputFile, "W%i H%i", (int)width, (int)height);
-            m_height = height;
-            m_width = width;
+#if defined(__linux__)
+        if (directIo && IsFileStreamValid()) {
+            m_directIo = EnableDirectIo();
         }
+#else
+        if (directIo) {
+            std::cerr << "Direct I/O output is not supported on this platform, using buffered writes" << std::endl;
+        }
+#endif
 
-        fprintf(m_outputFile, "\n");
-        return WriteDataToFile(offset, size);
+        m_writerThread = std::thread(&VkVideoFrameToFileImpl::WriterThread, this);
     }
 
-    size_t ConvertFrameToNv12(const VulkanDeviceContext* vkDevCtx, int32_t frameWidth, int32_t frameHeight,
-                             VkSharedBaseObj<VkImageResource>& imageResource,
-                             uint8_t* pOutBuffer, const VkMpFormatInfo* mpInfo) {
-        size_t outputBufferSize = 0;
+    // Packs the planes of the linear image into pOutBuffer: planar (I420, I010...) or, with the native
+    // layout, as they are (NV12, P010...). Returns the size of the packed frame.
+    size_t RepackFrame(const VulkanDeviceContext* vkDevCtx, int32_t frameWidth, int32_t frameHeight,
+                       VkSharedBaseObj<VkImageResource>& imageResource,
+                       uint8_t* pOutBuffer, const VkMpFormatInfo* mpInfo) {
         VkDevice device   = imageResource->GetDevice();
         VkImage  srcImage = imageResource->GetImage();
         VkSharedBaseObj<VulkanDeviceMemoryImpl> srcImageDeviceMemory(imageResource->GetMemory());
@@ -290,7 +342,6 @@ public:
 
         int32_t secondaryPlaneWidth = frameWidth;
         int32_t secondaryPlaneHeight = frameHeight;
-        int32_t imageHeight = frameHeight;
         bool isUnnormalizedRgba = false;
         if (mpInfo && (mpInfo->planesLayout.layout == YCBCR_SINGLE_PLANE_UNNORMALIZED) && !(mpInfo->planesLayout.disjoint)) {
             isUnnormalizedRgba = true;
@@ -336,75 +387,40 @@ public:
             vkDevCtx->GetImageSubresourceLayout(device, srcImage, &subResource, &layouts[0]);
         }
 
-        const bool is8Bit = (mpInfo->planesLayout.bpp == YCBCRA_8BPP);
-        const uint32_t bytesPerPixel = is8Bit ? 1 : 2;
-        const uint32_t numPlanes = 3;
-
-        // Calculate plane layouts for output buffer
-        VkSubresourceLayout yuvPlaneLayouts[3] = {};
-        yuvPlaneLayouts[0].offset = 0;
-        yuvPlaneLayouts[0].rowPitch = frameWidth * bytesPerPixel;
-        yuvPlaneLayouts[1].offset = yuvPlaneLayouts[0].rowPitch * frameHeight;
-        yuvPlaneLayouts[1].rowPitch = secondaryPlaneWidth * bytesPerPixel;
-        yuvPlaneLayouts[2].offset = yuvPlaneLayouts[1].offset + (yuvPlaneLayouts[1].rowPitch * secondaryPlaneHeight);
-        yuvPlaneLayouts[2].rowPitch = secondaryPlaneWidth * bytesPerPixel;
-
-        // Copy the luma plane
-        const uint32_t numCompatiblePlanes = 1;
-        for (uint32_t plane = 0; plane < numCompatiblePlanes; plane++) {
-            const uint8_t* pSrc = readImagePtr + static_cast<size_t>(layouts[plane].offset);
-            uint8_t* pDst = pOutBuffer + static_cast<size_t>(yuvPlaneLayouts[plane].offset);
-
-            if (is8Bit) {
-                assert(layouts[plane].rowPitch <= SIZE_MAX);
-                assert(yuvPlaneLayouts[plane].rowPitch <= SIZE_MAX);
-                CopyPlaneData<uint8_t>(pSrc, pDst, static_cast<size_t>(layouts[plane].rowPitch), static_cast<size_t>(yuvPlaneLayouts[plane].rowPitch),
-                                      frameWidth, imageHeight);
-            } else {
-                assert(layouts[plane].rowPitch <= SIZE_MAX);
-                assert(yuvPlaneLayouts[plane].rowPitch <= SIZE_MAX);
-                CopyPlaneData<uint16_t>(pSrc, pDst, static_cast<size_t>(layouts[plane].rowPitch), static_cast<size_t>(yuvPlaneLayouts[plane].rowPitch),
-                                       frameWidth, imageHeight);
-            }
-        }
-
-        // Copy chroma planes
-        for (uint32_t plane = numCompatiblePlanes; plane < numPlanes; plane++) {
-            const uint32_t srcPlane = std::min(plane, mpInfo->planesLayout.numberOfExtraPlanes);
-            uint8_t* pDst = pOutBuffer + yuvPlaneLayouts[plane].offset;
-            const int32_t planeWidth = mpInfo->planesLayout.secondaryPlaneSubsampledX ? (frameWidth + 1) / 2 : frameWidth;
-
-            for (int32_t height = 0; height < secondaryPlaneHeight; height++) {
-                const uint8_t* pSrc;
-                if (srcPlane != plane) {
-                    pSrc = readImagePtr + layouts[srcPlane].offset + ((plane - 1) * bytesPerPixel) + (layouts[srcPlane].rowPitch * height);
-                } else {
-                    pSrc = readImagePtr + layouts[srcPlane].offset + (layouts[srcPlane].rowPitch * height);
-                }
+        const uint32_t bitsPerChannel = GetBitsPerChannel(mpInfo->planesLayout);
 
-                if (is8Bit) {
-                    assert(layouts[srcPlane].rowPitch <= SIZE_MAX);
-                    assert(yuvPlaneLayouts[plane].rowPitch <= SIZE_MAX);
-                    CopyPlaneData<uint8_t>(pSrc, pDst, static_cast<size_t>(layouts[srcPlane].rowPitch), static_cast<size_t>(yuvPlaneLayouts[plane].rowPitch),
-                                           planeWidth, 1, 2);
-                } else {
-                    assert(layouts[srcPlane].rowPitch <= SIZE_MAX);
-                    assert(yuvPlaneLayouts[plane].rowPitch <= SIZE_MAX);
-                    CopyPlaneData<uint16_t>(pSrc, pDst, static_cast<size_t>(layouts[srcPlane].rowPitch), static_cast<size_t>(yuvPlaneLayouts[plane].rowPitch),
-                                            planeWidth, 1, 2);
+        VkVideoFrameRepack::Frame frame = {};
+        frame.numPlanes = isUnnormalizedRgba ? 1 : std::min(1U + mpInfo->planesLayout.numberOfExtraPlanes, 3U);
+        for (uint32_t plane = 0; plane < frame.numPlanes; plane++) {
+            assert(layouts[plane].rowPitch <= SIZE_MAX);
+            frame.pPlanes[plane] = readImagePtr + static_cast<size_t>(layouts[plane].offset);
+            frame.rowPitches[plane] = static_cast<size_t>(layouts[plane].rowPitch);
+        }
+        frame.width = static_cast<uint32_t>(frameWidth);
+        frame.height = static_cast<uint32_t>(frameHeight);
+        frame.chromaWidth = static_cast<uint32_t>(secondaryPlaneWidth);
+        frame.chromaHeight = static_cast<uint32_t>(secondaryPlaneHeight);
+        // Treat all non 8bpp formats as 16bpp for output to prevent any loss.
+        frame.bytesPerSample = (bitsPerChannel > 8) ? 2 : 1;
+        frame.shift = (m_lsbAligned && !m_nativeLayout && (bitsPerChannel > 8)) ? (16 - bitsPerChannel) : 0;
+
+        // The rows of the large frames are split between this thread and a few workers
+        uint32_t numBands = 1;
+        if (((uint64_t)frame.width * frame.height) >= REPACK_BANDS_MIN_SAMPLES) {
+            if (!m_repackThreadPool) {
+                const uint32_t numCpus = std::thread::hardware_concurrency();
+                m_numRepackBands = std::min<uint32_t>(std::max<uint32_t>(numCpus, 1), MAX_REPACK_BANDS);
+                if (m_numRepackBands > 1) {
+                    m_repackThreadPool.reset(new VkThreadPool(m_numRepackBands - 1));
                 }
-                pDst += yuvPlaneLayouts[plane].rowPitch;
             }
+            numBands = m_numRepackBands;
         }
 
-        // Calculate total buffer size
-        outputBufferSize = static_cast<size_t>(yuvPlaneLayouts[0].rowPitch * imageHeight);
-        if (mpInfo->planesLayout.numberOfExtraPlanes >= 1) {
-            outputBufferSize += static_cast<size_t>(yuvPlaneLayouts[1].rowPitch * secondaryPlaneHeight);
-            outputBufferSize += static_cast<size_t>(yuvPlaneLayouts[2].rowPitch * secondaryPlaneHeight);
-        }
-
-        return outputBufferSize;
+        return VkVideoFrameRepack::Repack(frame,
+                                          m_nativeLayout ? VkVideoFrameRepack::OUTPUT_LAYOUT_NATIVE :
+                                                           VkVideoFrameRepack::OUTPUT_LAYOUT_PLANAR,
+                                          pOutBuffer, m_repackThreadPool.get(), numBands);
     }
 
     virtual size_t GetCrcValues(uint32_t* pCrcValues, size_t buffSize) const override {
@@ -412,6 +428,10 @@ public:
             return 0;
         }
 
+        // The writer thread updates the CRCs
+        std::unique_lock<std::mutex> lock(m_hostFramesMutex);
+        m_hostFrameReleased.wait(lock, [this] { return m_numQueuedHostFrames == 0; });
+
         size_t numValuesToWrite = std::min(buffSize, m_crcAllocation.size());
         for (size_t i = 0; i < numValuesToWrite; i++) {
             pCrcValues[i] = m_crcAllocation[i];
@@ -420,49 +440,465 @@ public:
         return numValuesToWrite;
     }
 
+    virtual uint32_t GetPictureHashResults(uint32_t* pNumVerifiedFrames, uint32_t* pNumFramesWithoutHash) const override {
+        // The writer thread verifies the hashes
+        std::unique_lock<std::mutex> lock(m_hostFramesMutex);
+        m_hostFrameReleased.wait(lock, [this] { return m_numQueuedHostFrames == 0; });
+
+        if (pNumVerifiedFrames != nullptr) {
+            *pNumVerifiedFrames = m_numHashVerifiedFrames;
+        }
+        if (pNumFramesWithoutHash != nullptr) {
+            *pNumFramesWithoutHash = m_numFramesWithoutHash;
+        }
+        return m_numHashMismatches;
+    }
+
 private:
-    uint8_t* EnsureAllocation(const VulkanDeviceContext* vkDevCtx,
+    enum {
+        // Frames from 4K up are repacked in up to 4 bands of rows
+        REPACK_BANDS_MIN_SAMPLES = 3840 * 2160,
+        MAX_REPACK_BANDS = 4,
+        // Y4M stream header and FRAME line
+        MAX_FRAME_HEADER_SIZE = 128,
+        // Alignment of the offsets, sizes and memory of the O_DIRECT writes
+        DIRECT_IO_ALIGNMENT = 4096,
+        DIRECT_IO_STAGING_SIZE = 8 * 1024 * 1024,
+    };
+
+    // A frame copied out of its linear image, written by the writer thread
+    struct HostFrame {
+        uint8_t*              pData = nullptr;
+        size_t                allocationSize = 0;
+        size_t                usedSize = 0;
+        int32_t               width = 0;
+        int32_t               height = 0;
+        int64_t               displayOrder = 0;
+        const VkMpFormatInfo* mpInfo = nullptr;
+        VkVideoDecodedPictureHash pictureHash = VkVideoDecodedPictureHash(); // To verify, if any
+        char                  header[MAX_FRAME_HEADER_SIZE];
+    };
+
+    uint8_t* EnsureAllocation(HostFrame* pHostFrame,
                              VkSharedBaseObj<VkImageResource>& imageResource) {
-        if (m_outputFile == nullptr) {
+        if (!IsOutputValid()) {
             return nullptr;
         }
 
         VkDeviceSize imageMemorySize = imageResource->GetImageDeviceMemorySize();
         assert(imageMemorySize <= SIZE_MAX);  // Ensure we don't lose data in conversion
 
-        if ((m_pLinearMemory == nullptr) || (imageMemorySize > m_allocationSize)) {
-            if (m_outputFile) {
+        if ((pHostFrame->pData == nullptr) || (imageMemorySize > pHostFrame->allocationSize)) {
+            if (!m_useWriterThread && IsFileStreamValid()) {
                 fflush(m_outputFile);
             }
 
-            if (m_pLinearMemory != nullptr) {
-                delete[] m_pLinearMemory;
-                m_pLinearMemory = nullptr;
+            if (pHostFrame->pData != nullptr) {
+                delete[] pHostFrame->pData;
+                pHostFrame->pData = nullptr;
             }
 
-            m_allocationSize = static_cast<size_t>(imageMemorySize);
-            m_pLinearMemory = new uint8_t[m_allocationSize];
-            if (m_pLinearMemory == nullptr) {
+            pHostFrame->allocationSize = static_cast<size_t>(imageMemorySize);
+            pHostFrame->pData = new uint8_t[pHostFrame->allocationSize];
+            if (pHostFrame->pData == nullptr) {
                 return nullptr;
             }
-            assert(m_pLinearMemory != nullptr);
+            assert(pHostFrame->pData != nullptr);
+        }
+        return pHostFrame->pData;
+    }
+
+    HostFrame* AcquireHostFrame() {
+        std::unique_lock<std::mutex> lock(m_hostFramesMutex);
+        m_hostFrameReleased.wait(lock, [this] { return !m_freeHostFrames.empty(); });
+        HostFrame* pHostFrame = m_freeHostFrames.back();
+        m_freeHostFrames.pop_back();
+        return pHostFrame;
+    }
+
+    void ReleaseHostFrame(HostFrame* pHostFrame) {
+        std::lock_guard<std::mutex> lock(m_hostFramesMutex);
+        m_freeHostFrames.push_back(pHostFrame);
+        m_hostFrameReleased.notify_all();
+    }
+
+    void QueueHostFrame(HostFrame* pHostFrame) {
+        std::lock_guard<std::mutex> lock(m_hostFramesMutex);
+        m_queuedHostFrames.push_back(pHostFrame);
+        m_numQueuedHostFrames++;
+        m_hostFrameQueued.notify_one();
+    }
+
+    void StopWriter() {
+        if (!m_writerThread.joinable()) {
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_hostFramesMutex);
+            m_stopWriter = true;
+            m_hostFrameQueued.notify_one();
+        }
+        m_writerThread.join();
+
+#if defined(__linux__)
+        if (m_directIo && !FlushStaging(true)) {
+            m_writeFailed = true;
+        }
+#endif
+        if (m_writeFailed) {
+            std::cerr << "Failed to write the output file" << std::endl;
+        }
+    }
+
+    // Takes all the queued frames at once, and returns them to the pool when they are written
+    void WriterThread() {
+        std::vector<HostFrame*> batch;
+        batch.reserve(m_hostFrames.size());
+
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(m_hostFramesMutex);
+                m_hostFrameQueued.wait(lock, [this] { return !m_queuedHostFrames.empty() || m_stopWriter; });
+                if (m_queuedHostFrames.empty()) {
+                    break;
+                }
+                batch.assign(m_queuedHostFrames.begin(), m_queuedHostFrames.end());
+                m_queuedHostFrames.clear();
+            }
+
+            if (!m_writeFailed && !WriteBatch(batch)) {
+                m_writeFailed = true;
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(m_hostFramesMutex);
+                for (HostFrame* pHostFrame : batch) {
+                    m_freeHostFrames.push_back(pHostFrame);
+                }
+                m_numQueuedHostFrames -= batch.size();
+                m_hostFrameReleased.notify_all();
+            }
+        }
+    }
+
+    bool WriteBatch(const std::vector<HostFrame*>& batch) {
+        for (HostFrame* pHostFrame : batch) {
+            UpdateCrc(*pHostFrame);
+            VerifyPictureHash(*pHostFrame);
+        }
+        if (!IsFileStreamValid()) {
+            return true;
+        }
+
+#if defined(__linux__)
+        if (m_directIo) {
+            for (HostFrame* pHostFrame : batch) {
+                size_t headerSize = FormatFrameHeader(*pHostFrame);
+                if (!AppendToStaging((const uint8_t*)pHostFrame->header, headerSize) ||
+                    !AppendToStaging(pHostFrame->pData, pHostFrame->usedSize)) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        std::vector<struct iovec> iov;
+        iov.reserve(2 * batch.size());
+        for (HostFrame* pHostFrame : batch) {
+            size_t headerSize = FormatFrameHeader(*pHostFrame);
+            if (headerSize > 0) {
+                iov.push_back({ pHostFrame->header, headerSize });
+            }
+            if (pHostFrame->usedSize > 0) {
+                iov.push_back({ pHostFrame->pData, pHostFrame->usedSize });
+            }
+        }
+        return WriteVector(fileno(m_outputFile), iov.data(), iov.size());
+#else
+        for (HostFrame* pHostFrame : batch) {
+            size_t headerSize = FormatFrameHeader(*pHostFrame);
+            if ((headerSize > 0) && (fwrite(pHostFrame->header, headerSize, 1, m_outputFile) != 1)) {
+                return false;
+            }
+            if ((pHostFrame->usedSize > 0) && (fwrite(pHostFrame->pData, pHostFrame->usedSize, 1, m_outputFile) != 1)) {
+                return false;
+            }
+        }
+        return true;
+#endif
+    }
+
+#if defined(__linux__)
+    // Writes all the buffers, resuming after the partial writes
+    static bool WriteVector(int fd, struct iovec* iov, size_t count) {
+        while (count > 0) {
+            ssize_t written = writev(fd, iov, (int)std::min<size_t>(count, IOV_MAX));
+            if (written < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return false;
+            }
+
+            size_t remaining = (size_t)written;
+            while ((count > 0) && (remaining >= iov->iov_len)) {
+                remaining -= iov->iov_len;
+                iov++;
+                count--;
+            }
+            if (remaining > 0) {
+                iov->iov_base = (uint8_t*)iov->iov_base + remaining;
+                iov->iov_len -= remaining;
+            }
         }
-        return m_pLinearMemory;
+        return true;
+    }
+
+    bool EnableDirectIo() {
+        void* pStagingMemory = nullptr;
+        if (posix_memalign(&pStagingMemory, DIRECT_IO_ALIGNMENT, DIRECT_IO_STAGING_SIZE) != 0) {
+            return false;
+        }
+
+        int fd = fileno(m_outputFile);
+        int flags = fcntl(fd, F_GETFL);
+        if ((flags == -1) || (fcntl(fd, F_SETFL, flags | O_DIRECT) == -1)) {
+            std::cerr << "Direct I/O is not supported for the output file, using buffered writes" << std::endl;
+            free(pStagingMemory);
+            return false;
+        }
+
+        m_pStagingMemory = (uint8_t*)pStagingMemory;
+        m_stagingSize = 0;
+        m_fileOffset = 0;
+        return true;
+    }
+
+    bool AppendToStaging(const uint8_t* pData, size_t size) {
+        while (size > 0) {
+            size_t copySize = std::min<size_t>(size, DIRECT_IO_STAGING_SIZE - m_stagingSize);
+            memcpy(m_pStagingMemory + m_stagingSize, pData, copySize);
+            m_stagingSize += copySize;
+            pData += copySize;
+            size -= copySize;
+
+            if ((m_stagingSize == DIRECT_IO_STAGING_SIZE) && !FlushStaging(false)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Writes the aligned part of the staging buffer, and moves the rest to its start. At the end of the
+    // stream, the unaligned tail is written after clearing O_DIRECT.
+    bool FlushStaging(bool endOfStream) {
+        int fd = fileno(m_outputFile);
+        size_t writeSize = m_stagingSize & ~(size_t)(DIRECT_IO_ALIGNMENT - 1);
+        if (endOfStream && (writeSize < m_stagingSize)) {
+            if (!WriteAt(fd, m_pStagingMemory, writeSize)) {
+                return false;
+            }
+            memmove(m_pStagingMemory, m_pStagingMemory + writeSize, m_stagingSize - writeSize);
+            m_stagingSize -= writeSize;
+
+            int flags = fcntl(fd, F_GETFL);
+            if ((flags == -1) || (fcntl(fd, F_SETFL, flags & ~O_DIRECT) == -1)) {
+                return false;
+            }
+            writeSize = m_stagingSize;
+        }
+
+        if (!WriteAt(fd, m_pStagingMemory, writeSize)) {
+            return false;
+        }
+        memmove(m_pStagingMemory, m_pStagingMemory + writeSize, m_stagingSize - writeSize);
+        m_stagingSize -= writeSize;
+        return true;
+    }
+
+    bool WriteAt(int fd, const uint8_t* pData, size_t size) {
+        while (size > 0) {
+            ssize_t written = pwrite(fd, pData, size, (off_t)m_fileOffset);
+            if (written < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return false;
+            }
+            pData += written;
+            size -= (size_t)written;
+            m_fileOffset += (uint64_t)written;
+        }
+        return true;
+    }
+#endif
+
+    void UpdateCrc(const HostFrame& hostFrame) {
+        // The CRCs of the frame, from the initial values, and the CRCs of the stream are all updated in one
+        // pass over the frame
+        const bool outputFrameCrc = m_outputcrcPerFrame && m_crcOutputFile;
+        m_crcValues.clear();
+        if (outputFrameCrc) {
+            m_crcValues.insert(m_crcValues.end(), m_crcInitValue.begin(), m_crcInitValue.end());
+        }
+        m_crcValues.insert(m_crcValues.end(), m_crcAllocation.begin(), m_crcAllocation.end());
+        getCRCs(m_crcValues.data(), m_crcValues.size(), hostFrame.pData, hostFrame.usedSize);
+
+        size_t crcIndex = 0;
+        if (outputFrameCrc) {
+            fprintf(m_crcOutputFile, "CRC Frame[%lld]:", (long long)hostFrame.displayOrder);
+            for (size_t i = 0; i < m_crcInitValue.size(); i += 1) {
+                fprintf(m_crcOutputFile, "0x%08X ", m_crcValues[crcIndex++]);
+            }
+            fprintf(m_crcOutputFile, "\n");
+            if (m_crcOutputFile != stdout) {
+                fflush(m_crcOutputFile);
+            }
+        }
+
+        for (size_t i = 0; i < m_crcAllocation.size(); i += 1) {
+            m_crcAllocation[i] = m_crcValues[crcIndex++];
+        }
+    }
+
+    // Hashes the planes of the frame (planar, LSB-aligned) and compares them with the hash of the stream
+    void VerifyPictureHash(const HostFrame& hostFrame) {
+        if (!m_verifyPictureHash) {
+            return;
+        }
+
+        const VkVideoDecodedPictureHash& expectedHash = hostFrame.pictureHash;
+        if (expectedHash.type == VkVideoDecodedPictureHash::TYPE_NONE) {
+            m_numFramesWithoutHash++;
+            return;
+        }
+
+        const VkMpFormatInfo* mpInfo = hostFrame.mpInfo;
+        const uint32_t bytesPerSample = (GetBitsPerChannel(mpInfo->planesLayout) > 8) ? 2 : 1;
+        uint32_t chromaWidth = (uint32_t)hostFrame.width;
+        uint32_t chromaHeight = (uint32_t)hostFrame.height;
+        if (mpInfo->planesLayout.secondaryPlaneSubsampledX) {
+            chromaWidth = (chromaWidth + 1) / 2;
+        }
+        if (mpInfo->planesLayout.secondaryPlaneSubsampledY) {
+            chromaHeight = (chromaHeight + 1) / 2;
+        }
+
+        bool hashMatches = true;
+        size_t planeOffset = 0;
+        for (uint32_t plane = 0; plane < expectedHash.numPlanes; plane++) {
+            const uint32_t width = (plane == 0) ? (uint32_t)hostFrame.width : chromaWidth;
+            const uint32_t height = (plane == 0) ? (uint32_t)hostFrame.height : chromaHeight;
+            const size_t planeSize = (size_t)width * height * bytesPerSample;
+            VkVideoDecodedPictureHash::PlaneHash planeHash = VkVideoDecodedPictureHash::PlaneHash();
+            if ((planeOffset + planeSize) <= hostFrame.usedSize) {
+                VkVideoPictureHash::ComputePlaneHash(expectedHash.type, hostFrame.pData + planeOffset,
+                                                     width, height, bytesPerSample, &planeHash);
+            }
+            planeOffset += planeSize;
+
+            if (!VkVideoPictureHash::IsEqual(expectedHash.type, planeHash, expectedHash.planes[plane])) {
+                char expectedString[33], decodedString[33];
+                VkVideoPictureHash::Format(expectedHash.type, expectedHash.planes[plane], expectedString);
+                VkVideoPictureHash::Format(expectedHash.type, planeHash, decodedString);
+                fprintf(stderr, "Frame %lld: %s mismatch in plane %u, expected %s, decoded %s\n",
+                        (long long)hostFrame.displayOrder, VkVideoPictureHash::GetTypeName(expectedHash.type),
+                        plane, expectedString, decodedString);
+                hashMatches = false;
+            }
+        }
+
+        m_numHashVerifiedFrames++;
+        if (!hashMatches) {
+            m_numHashMismatches++;
+        }
+    }
+
+    // Formats the Y4M stream header before the first frame and the FRAME line into the header of the
+    // frame, returns their size (0 for raw YUV). Called in output order.
+    size_t FormatFrameHeader(HostFrame& hostFrame) {
+        if (!m_outputy4m) {
+            return 0;
+        }
+
+        char* pHeader = hostFrame.header;
+        const size_t maxSize = sizeof(hostFrame.header);
+        const size_t width = (size_t)hostFrame.width;
+        const size_t height = (size_t)hostFrame.height;
+        const VkMpFormatInfo* mpInfo = hostFrame.mpInfo;
+        size_t size = 0;
+
+        if (m_firstFrame != false) {
+            m_firstFrame = false;
+            const char* pChromaFormat = "C420";
+            if (mpInfo->planesLayout.secondaryPlaneSubsampledX == false) {
+                pChromaFormat = "C444";
+            } else if (mpInfo->planesLayout.secondaryPlaneSubsampledY == false) {
+                pChromaFormat = "C422";
+            }
+            // The samples above 8 bits are output as 16 bits, MSB-aligned unless requested otherwise
+            const uint32_t bitsPerChannel = GetBitsPerChannel(mpInfo->planesLayout);
+            const uint32_t outputBitDepth = ((bitsPerChannel > 8) && !m_lsbAligned) ? 16 : bitsPerChannel;
+            size += snprintf(pHeader + size, maxSize - size, "YUV4MPEG2 W%i H%i F24:1 Ip A1:1 %s",
+                             (int)width, (int)height, pChromaFormat);
+            if (outputBitDepth > 8) {
+                size += snprintf(pHeader + size, maxSize - size, "p%u", outputBitDepth);
+            }
+            size += snprintf(pHeader + size, maxSize - size, "\n");
+            m_height = height;
+            m_width = width;
+        }
+
+        size += snprintf(pHeader + size, maxSize - size, "FRAME");
+        if ((m_width != width) || (m_height != height)) {
+            size += snprintf(pHeader + size, maxSize - size, " W%i H%i", (int)width, (int)height);
+            m_height = height;
+            m_width = width;
+        }
+        size += snprintf(pHeader + size, maxSize - size, "\n");
+        assert(size < maxSize);
+        return size;
     }
 
 private:
     std::atomic<int32_t>    m_refCount;
     FILE*    m_outputFile;
-    uint8_t* m_pLinearMemory;
-    size_t   m_allocationSize;
     bool     m_firstFrame;
     size_t   m_height;
     size_t   m_width;
     bool     m_outputy4m;
     bool     m_outputcrcPerFrame;
+    bool     m_nativeLayout;
+    bool     m_lsbAligned;
+    bool     m_verifyPictureHash;
+    // Decoded picture hash verification results, updated by the writer thread
+    uint32_t m_numHashVerifiedFrames;
+    uint32_t m_numHashMismatches;
+    uint32_t m_numFramesWithoutHash;
     FILE*    m_crcOutputFile;
     std::vector<uint32_t> m_crcInitValue;
     std::vector<uint32_t> m_crcAllocation;
+    std::vector<uint32_t> m_crcValues;      // Scratch of UpdateCrc()
+    std::unique_ptr<VkThreadPool> m_repackThreadPool;
+    uint32_t                m_numRepackBands;
+    // The pool of host frames, either free or queued to the writer thread
+    std::vector<HostFrame>  m_hostFrames;
+    std::vector<HostFrame*> m_freeHostFrames;
+    std::deque<HostFrame*>  m_queuedHostFrames;
+    size_t                  m_numQueuedHostFrames;
+    mutable std::mutex              m_hostFramesMutex;
+    mutable std::condition_variable m_hostFrameReleased;
+    std::condition_variable         m_hostFrameQueued;
+    bool                    m_stopWriter;
+    std::atomic<bool>       m_writeFailed;
+    std::thread             m_writerThread;
+    const bool              m_useWriterThread;
+    // Direct I/O state, owned by the writer thread
+    bool                    m_directIo;
+    uint8_t*                m_pStagingMemory;
+    size_t                  m_stagingSize;
+    uint64_t                m_fileOffset;
 };
 
 // Define the static member for invalid instance
@@ -474,19 +910,42 @@ VkResult VkVideoFrameOutput::Create(const char* fileName,
                                    bool outputcrcPerFrame,
                                    const char* crcOutputFile,
                                    const std::vector<uint32_t>& crcInitValue,
-                                   VkSharedBaseObj<VkVideoFrameOutput>& frameToFile) {
+                                   VkSharedBaseObj<VkVideoFrameOutput>& frameToFile,
+                                   uint32_t numOutputBuffers,
+                                   bool directIo,
+                                   bool nativeLayout,
+                                   bool lsbAligned,
+                                   bool verifyPictureHash) {
+    if (nativeLayout && outputy4m && !verifyPictureHash) {
+        // Y4M has no semi-planar formats
+        std::cerr << "The native layout output is raw YUV only" << std::endl;
+        return VK_ERROR_FORMAT_NOT_SUPPORTED;
+    }
+
+    if (verifyPictureHash && (fileName != nullptr)) {
+        // The frames are repacked for the hashes: they are not written
+        std::cerr << "The decoded picture hash verification writes no output file" << std::endl;
+        return VK_ERROR_INITIALIZATION_FAILED;
+    }
+
     VkVideoFrameToFileImpl* newFrameToFile = new VkVideoFrameToFileImpl(outputy4m, outputcrcPerFrame,
-                                                                       crcOutputFile, crcInitValue);
+                                                                       crcOutputFile, crcInitValue,
+                                                                       numOutputBuffers, nativeLayout,
+                                                                       lsbAligned, verifyPictureHash);
     if (!newFrameToFile) {
         return VK_ERROR_OUT_OF_HOST_MEMORY;
     }
 
-    FILE* outFile = newFrameToFile->AttachFile(fileName, outputy4m);
-    if ((fileName != nullptr) && (outFile == nullptr)) {
-        delete newFrameToFile;
-        return VK_ERROR_INITIALIZATION_FAILED;
+    if (fileName != nullptr) {
+        FILE* outFile = newFrameToFile->AttachFile(fileName, outputy4m);
+        if (outFile == nullptr) {
+            delete newFrameToFile;
+            return VK_ERROR_INITIALIZATION_FAILED;
+        }
     }
 
+    newFrameToFile->StartWriter(directIo);
+
     frameToFile = newFrameToFile;
     return VK_SUCCESS;
 }
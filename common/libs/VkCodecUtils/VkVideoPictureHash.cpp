@@ -0,0 +1,298 @@
+/*
+* Copyright 2024 NVIDIA Corporation.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include "VkVideoPictureHash.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define VK_VIDEO_PICTURE_HASH_SSE2 1
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#define VK_VIDEO_PICTURE_HASH_NEON 1
+#include <arm_neon.h>
+#endif
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// MD5 (RFC 1321)
+//
+
+namespace {
+
+class Md5
+{
+public:
+    Md5()
+        : m_state{ 0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476 }
+        , m_length(0)
+        , m_buffer()
+    {
+    }
+
+    void Update(const uint8_t* pData, size_t size)
+    {
+        size_t bufferUsed = (size_t)(m_length & 63);
+        m_length += size;
+        if (bufferUsed > 0) {
+            const size_t copySize = (size < (64 - bufferUsed)) ? size : (64 - bufferUsed);
+            memcpy(m_buffer + bufferUsed, pData, copySize);
+            bufferUsed += copySize;
+            pData += copySize;
+            size -= copySize;
+            if (bufferUsed < 64) {
+                return;
+            }
+            Transform(m_buffer);
+        }
+        for (; size >= 64; size -= 64, pData += 64) {
+            Transform(pData);
+        }
+        memcpy(m_buffer, pData, size);
+    }
+
+    void Final(uint8_t digest[16])
+    {
+        const uint64_t bitLength = m_length * 8;
+        uint8_t padding[72] = { 0x80 };
+        const size_t bufferUsed = (size_t)(m_length & 63);
+        const size_t paddingSize = ((bufferUsed < 56) ? 56 : 120) - bufferUsed;
+        for (uint32_t i = 0; i < 8; i++) {
+            padding[paddingSize + i] = (uint8_t)(bitLength >> (8 * i));
+        }
+        Update(padding, paddingSize + 8);
+        for (uint32_t i = 0; i < 16; i++) {
+            digest[i] = (uint8_t)(m_state[i / 4] >> (8 * (i % 4)));
+        }
+    }
+
+private:
+    static uint32_t RotateLeft(uint32_t x, uint32_t n) { return (x << n) | (x >> (32 - n)); }
+
+    void Transform(const uint8_t* pBlock)
+    {
+        static const uint32_t K[64] = {
+            0xd76aa478, 0xe8c7b756, 0x242070db, 0xc1bdceee, 0xf57c0faf, 0x4787c62a, 0xa8304613, 0xfd469501,
+            0x698098d8, 0x8b44f7af, 0xffff5bb1, 0x895cd7be, 0x6b901122, 0xfd987193, 0xa679438e, 0x49b40821,
+            0xf61e2562, 0xc040b340, 0x265e5a51, 0xe9b6c7aa, 0xd62f105d, 0x02441453, 0xd8a1e681, 0xe7d3fbc8,
+            0x21e1cde6, 0xc33707d6, 0xf4d50d87, 0x455a14ed, 0xa9e3e905, 0xfcefa3f8, 0x676f02d9, 0x8d2a4c8a,
+            0xfffa3942, 0x8771f681, 0x6d9d6122, 0xfde5380c, 0xa4beea44, 0x4bdecfa9, 0xf6bb4b60, 0xbebfbc70,
+            0x289b7ec6, 0xeaa127fa, 0xd4ef3085, 0x04881d05, 0xd9d4d039, 0xe6db99e5, 0x1fa27cf8, 0xc4ac5665,
+            0xf4292244, 0x432aff97, 0xab9423a7, 0xfc93a039, 0x655b59c3, 0x8f0ccc92, 0xffeff47d, 0x85845dd1,
+            0x6fa87e4f, 0xfe2ce6e0, 0xa3014314, 0x4e0811a1, 0xf7537e82, 0xbd3af235, 0x2ad7d2bb, 0xeb86d391,
+        };
+        static const uint32_t S[4][4] = { { 7, 12, 17, 22 }, { 5, 9, 14, 20 }, { 4, 11, 16, 23 }, { 6, 10, 15, 21 } };
+
+        uint32_t M[16];
+        for (uint32_t i = 0; i < 16; i++) {
+            M[i] = (uint32_t)pBlock[4 * i] | ((uint32_t)pBlock[4 * i + 1] << 8) |
+                   ((uint32_t)pBlock[4 * i + 2] << 16) | ((uint32_t)pBlock[4 * i + 3] << 24);
+        }
+
+        uint32_t a = m_state[0], b = m_state[1], c = m_state[2], d = m_state[3];
+        for (uint32_t i = 0; i < 64; i++) {
+            uint32_t f, g;
+            switch (i / 16) {
+            case 0:  f = (b & c) | (~b & d); g = i;                break;
+            case 1:  f = (d & b) | (~d & c); g = (5 * i + 1) & 15; break;
+            case 2:  f = b ^ c ^ d;          g = (3 * i + 5) & 15; break;
+            default: f = c ^ (b | ~d);       g = (7 * i) & 15;     break;
+            }
+            const uint32_t rotated = RotateLeft(a + f + K[i] + M[g], S[i / 16][i % 4]);
+            a = d;
+            d = c;
+            c = b;
+            b += rotated;
+        }
+        m_state[0] += a;
+        m_state[1] += b;
+        m_state[2] += c;
+        m_state[3] += d;
+    }
+
+    uint32_t m_state[4];
+    uint64_t m_length;
+    uint8_t  m_buffer[64];
+};
+
+} // namespace
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// CRC (D.3.19): CRC-16 of the CCITT polynomial (x^16 + x^12 + x^5 + 1), MSB first, from 0xffff, over the samples
+// followed by 2 zero bytes
+//
+
+static uint16_t s_crc16Table[256];
+
+static bool InitCrc16Table()
+{
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t crc = i << 8;
+        for (uint32_t bit = 0; bit < 8; bit++) {
+            crc = (crc & 0x8000) ? ((crc << 1) ^ 0x1021) : (crc << 1);
+        }
+        s_crc16Table[i] = (uint16_t)crc;
+    }
+    return true;
+}
+
+// The bits shifted out of the register by a byte only depend on its high byte: a byte is shifted in at once
+static uint32_t UpdateCrc16(uint32_t crc, const uint8_t* pData, size_t size)
+{
+    static const bool tableInitialized = InitCrc16Table();
+    (void)tableInitialized;
+    for (size_t i = 0; i < size; i++) {
+        crc = (((crc << 8) | pData[i]) & 0xffff) ^ s_crc16Table[crc >> 8];
+    }
+    return crc;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Checksum (D.3.19): each byte of a sample is xored with (x & 0xff) ^ (y & 0xff) ^ (x >> 8) ^ (y >> 8) and summed
+//
+
+// The sum of the bytes of a row: in a vector of 16 bytes starting at a multiple of 16 bytes, the mask of the
+// sample i of the vector is i ^ (the mask of the first sample)
+static uint64_t SumRowBytes(const uint8_t* pRow, uint32_t width, uint32_t bytesPerSample, uint32_t rowMask)
+{
+    const uint32_t rowSize = width * bytesPerSample;
+    uint32_t offset = 0;
+    uint64_t sum = 0;
+
+#if defined(VK_VIDEO_PICTURE_HASH_SSE2)
+    const __m128i sampleIndices = (bytesPerSample == 1) ?
+        _mm_setr_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15) :
+        _mm_setr_epi8(0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7);
+    const __m128i zero = _mm_setzero_si128();
+    __m128i sums = _mm_setzero_si128();
+    for (; (offset + 16) <= rowSize; offset += 16) {
+        const uint32_t x = offset / bytesPerSample;
+        const __m128i mask = _mm_xor_si128(sampleIndices, _mm_set1_epi8((char)((x & 0xff) ^ (x >> 8) ^ rowMask)));
+        const __m128i bytes = _mm_xor_si128(_mm_loadu_si128((const __m128i*)(pRow + offset)), mask);
+        sums = _mm_add_epi64(sums, _mm_sad_epu8(bytes, zero));
+    }
+    sum = (uint64_t)(uint32_t)_mm_cvtsi128_si32(sums) + (uint64_t)(uint32_t)_mm_cvtsi128_si32(_mm_srli_si128(sums, 8));
+#elif defined(VK_VIDEO_PICTURE_HASH_NEON)
+    static const uint8_t sampleIndices8[16] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15 };
+    static const uint8_t sampleIndices16[16] = { 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7 };
+    const uint8x16_t sampleIndices = vld1q_u8((bytesPerSample == 1) ? sampleIndices8 : sampleIndices16);
+    uint32x4_t sums = vdupq_n_u32(0);
+    for (; (offset + 16) <= rowSize; offset += 16) {
+        const uint32_t x = offset / bytesPerSample;
+        const uint8x16_t mask = veorq_u8(sampleIndices, vdupq_n_u8((uint8_t)((x & 0xff) ^ (x >> 8) ^ rowMask)));
+        const uint8x16_t bytes = veorq_u8(vld1q_u8(pRow + offset), mask);
+        sums = vpadalq_u16(sums, vpaddlq_u8(bytes));
+    }
+    const uint64x2_t sums64 = vpaddlq_u32(sums);
+    sum = vgetq_lane_u64(sums64, 0) + vgetq_lane_u64(sums64, 1);
+#endif
+
+    for (; offset < rowSize; offset++) {
+        const uint32_t x = offset / bytesPerSample;
+        sum += pRow[offset] ^ ((x & 0xff) ^ (x >> 8) ^ rowMask);
+    }
+    return sum;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+
+void VkVideoPictureHash::ComputePlaneHash(uint32_t type, const uint8_t* pSamples, uint32_t width, uint32_t height,
+                                          uint32_t bytesPerSample, VkVideoDecodedPictureHash::PlaneHash* pHash)
+{
+    const size_t planeSize = (size_t)width * height * bytesPerSample;
+    memset(pHash, 0, sizeof(*pHash));
+
+    switch (type) {
+    case VkVideoDecodedPictureHash::TYPE_MD5:
+        {
+            Md5 md5;
+            md5.Update(pSamples, planeSize);
+            md5.Final(pHash->md5);
+        }
+        break;
+    case VkVideoDecodedPictureHash::TYPE_CRC:
+        {
+            static const uint8_t zeros[2] = { 0, 0 };
+            uint32_t crc = UpdateCrc16(0xffff, pSamples, planeSize);
+            pHash->crc = UpdateCrc16(crc, zeros, sizeof(zeros));
+        }
+        break;
+    case VkVideoDecodedPictureHash::TYPE_CHECKSUM:
+        {
+            // The sum of a row is far below 2^64, the modulo 2^32 is applied at the end
+            uint64_t sum = 0;
+            for (uint32_t y = 0; y < height; y++) {
+                sum += SumRowBytes(pSamples + (size_t)y * width * bytesPerSample, width, bytesPerSample,
+                                   (y & 0xff) ^ (y >> 8));
+            }
+            pHash->checksum = (uint32_t)sum;
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+bool VkVideoPictureHash::IsEqual(uint32_t type, const VkVideoDecodedPictureHash::PlaneHash& hash0,
+                                 const VkVideoDecodedPictureHash::PlaneHash& hash1)
+{
+    switch (type) {
+    case VkVideoDecodedPictureHash::TYPE_MD5:
+        return memcmp(hash0.md5, hash1.md5, sizeof(hash0.md5)) == 0;
+    case VkVideoDecodedPictureHash::TYPE_CRC:
+        return hash0.crc == hash1.crc;
+    case VkVideoDecodedPictureHash::TYPE_CHECKSUM:
+        return hash0.checksum == hash1.checksum;
+    default:
+        return true;
+    }
+}
+
+void VkVideoPictureHash::Format(uint32_t type, const VkVideoDecodedPictureHash::PlaneHash& hash, char* pString)
+{
+    switch (type) {
+    case VkVideoDecodedPictureHash::TYPE_MD5:
+        for (uint32_t i = 0; i < 16; i++) {
+            snprintf(pString + 2 * i, 3, "%02x", hash.md5[i]);
+        }
+        break;
+    case VkVideoDecodedPictureHash::TYPE_CRC:
+        snprintf(pString, 33, "%04x", hash.crc);
+        break;
+    case VkVideoDecodedPictureHash::TYPE_CHECKSUM:
+        snprintf(pString, 33, "%08x", hash.checksum);
+        break;
+    default:
+        pString[0] = '\0';
+        break;
+    }
+}
+
+const char* VkVideoPictureHash::GetTypeName(uint32_t type)
+{
+    switch (type) {
+    case VkVideoDecodedPictureHash::TYPE_MD5:
+        return "MD5";
+    case VkVideoDecodedPictureHash::TYPE_CRC:
+        return "CRC";
+    case VkVideoDecodedPictureHash::TYPE_CHECKSUM:
+        return "checksum";
+    default:
+        return "none";
+    }
+}
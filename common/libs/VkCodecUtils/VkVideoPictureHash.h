@@ -0,0 +1,71 @@
+/*
+* Copyright 2024 NVIDIA Corporation.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#ifndef _VKCODECUTILS_VKVIDEOPICTUREHASH_H_
+#define _VKCODECUTILS_VKVIDEOPICTUREHASH_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+// The hash of the decoded samples of a picture, as carried by the stream (H.265 decoded picture hash SEI,
+// D.2.20 / D.3.19). A zero-initialized struct carries no hash.
+struct VkVideoDecodedPictureHash {
+    enum Type {
+        TYPE_NONE = 0,
+        TYPE_MD5,       // hash_type 0: MD5 of the samples of each plane
+        TYPE_CRC,       // hash_type 1: CRC-16 (CCITT polynomial) of the samples of each plane
+        TYPE_CHECKSUM,  // hash_type 2: 32-bit sum of the samples of each plane, xored with their position
+    };
+
+    union PlaneHash {
+        uint8_t  md5[16];
+        uint32_t crc;
+        uint32_t checksum;
+    };
+
+    uint32_t  type;             // Type
+    uint32_t  numPlanes;        // 1 (monochrome) or 3
+    uint32_t  width;            // pic_width_in_luma_samples: the hash covers the decoded picture, not the
+    uint32_t  height;           // cropped one
+    uint32_t  bitDepthLuma;
+    uint32_t  bitDepthChroma;
+    PlaneHash planes[3];
+};
+
+// Computes the decoded picture hashes of the planes of a frame, to verify them against the hashes of the stream.
+//
+// A plane is packed without padding, with a byte per sample up to 8 bits and 2 bytes (little-endian, LSB-aligned)
+// above, which is the layout the hashes are defined on. The checksum is computed 16 bytes at a time with SSE2 or
+// NEON; MD5 and the CRC are sequential by nature, the CRC is table-driven.
+class VkVideoPictureHash
+{
+public:
+    // Computes the hash of type (TYPE_MD5, TYPE_CRC or TYPE_CHECKSUM) of a plane of width x height samples
+    static void ComputePlaneHash(uint32_t type, const uint8_t* pSamples, uint32_t width, uint32_t height,
+                                 uint32_t bytesPerSample, VkVideoDecodedPictureHash::PlaneHash* pHash);
+
+    // Compares the hashes of a plane
+    static bool IsEqual(uint32_t type, const VkVideoDecodedPictureHash::PlaneHash& hash0,
+                        const VkVideoDecodedPictureHash::PlaneHash& hash1);
+
+    // Formats the hash of a plane (hex digits) into pString, which holds at least 33 characters
+    static void Format(uint32_t type, const VkVideoDecodedPictureHash::PlaneHash& hash, char* pString);
+
+    // The name of the type (MD5, CRC, checksum)
+    static const char* GetTypeName(uint32_t type);
+};
+
+#endif /* _VKCODECUTILS_VKVIDEOPICTUREHASH_H_ */
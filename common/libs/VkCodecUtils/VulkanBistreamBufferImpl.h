@@ -78,6 +78,7 @@ public:
 
     virtual VkBuffer GetBuffer() const { return m_buffer; }
     virtual VkDeviceMemory GetDeviceMemory() const { return *m_vulkanDeviceMemory; }
+    virtual VkDeviceSize GetBufferOffset() const { return 0; }
 
     virtual uint32_t  AddStreamMarker(uint32_t streamOffset);
     virtual uint32_t  SetStreamMarker(uint32_t streamOffset, uint32_t index);
@@ -50,6 +50,8 @@ public:
     virtual void InvalidateRange(VkDeviceSize offset, VkDeviceSize size) const = 0;
     virtual VkBuffer GetBuffer() const = 0;
     virtual VkDeviceMemory GetDeviceMemory() const = 0;
+    // Offset of this buffer's data within GetBuffer(), non-zero for a sub-range of a larger buffer
+    virtual VkDeviceSize GetBufferOffset() const = 0;
 
     virtual uint32_t  AddStreamMarker(uint32_t streamOffset) = 0;
     virtual uint32_t  SetStreamMarker(uint32_t streamOffset, uint32_t index) = 0;
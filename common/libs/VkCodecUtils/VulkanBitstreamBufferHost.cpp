@@ -0,0 +1,415 @@
+/*
+* Copyright 2024 NVIDIA Corporation.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#if defined(__linux__)
+#include <sys/mman.h>
+#include <unistd.h>
+#elif defined(_WIN32)
+#include <malloc.h>
+#endif
+#include "VkCodecUtils/VulkanBitstreamBufferHost.h"
+
+static inline VkDeviceSize AlignUp(VkDeviceSize value, VkDeviceSize alignment)
+{
+    return (alignment > 1) ? ((value + (alignment - 1)) & ~(alignment - 1)) : value;
+}
+
+VkResult
+VulkanBitstreamBufferHost::Create(VkDeviceSize bufferSize, VkDeviceSize bufferOffsetAlignment, VkDeviceSize bufferSizeAlignment,
+                                  const void* pInitializeBufferMemory, VkDeviceSize initializeBufferMemorySize,
+                                  bool useHugePages,
+                                  VkSharedBaseObj<VulkanBitstreamBufferHost>& vulkanBitstreamBuffer)
+{
+    VkSharedBaseObj<VulkanBitstreamBufferHost> vkBitstreamBuffer(new VulkanBitstreamBufferHost(bufferOffsetAlignment,
+                                                                                              bufferSizeAlignment,
+                                                                                              useHugePages));
+    if (!vkBitstreamBuffer) {
+        assert(!"Out of host memory!");
+        return VK_ERROR_OUT_OF_HOST_MEMORY;
+    }
+
+    VkResult result = vkBitstreamBuffer->Initialize(bufferSize,
+                                                    pInitializeBufferMemory,
+                                                    initializeBufferMemorySize);
+    if (result == VK_SUCCESS) {
+        vulkanBitstreamBuffer = vkBitstreamBuffer;
+    } else {
+        assert(!"Initialize failed!");
+    }
+
+    return result;
+}
+
+VkDeviceSize VulkanBitstreamBufferHost::Clone(VkDeviceSize newSize, VkDeviceSize copySize, VkDeviceSize copyOffset,
+                                              VkSharedBaseObj<VulkanBitstreamBuffer>& vulkanBitstreamBuffer)
+{
+    // The source buffer stays in use, so its pages can't be moved to the clone: the data is copied.
+    VkSharedBaseObj<VulkanBitstreamBufferHost> vkBitstreamBuffer(new VulkanBitstreamBufferHost(m_bufferOffsetAlignment,
+                                                                                              m_bufferSizeAlignment,
+                                                                                              m_useHugePages));
+    if (!vkBitstreamBuffer) {
+        assert(!"Out of host memory!");
+        return 0;
+    }
+
+    const uint8_t* oldBufPtr = nullptr;
+    if (copySize) {
+        oldBufPtr = CheckAccess(copyOffset, copySize);
+    }
+    VkResult result = vkBitstreamBuffer->Initialize(newSize, oldBufPtr, copySize);
+    if (result != VK_SUCCESS) {
+        assert(!"Initialize failed!");
+        return 0;
+    }
+
+    vulkanBitstreamBuffer = vkBitstreamBuffer;
+    return vkBitstreamBuffer->GetMaxSize();
+}
+
+VkDeviceSize VulkanBitstreamBufferHost::Allocate(VkDeviceSize size, VkDeviceSize alignment, bool useHugePages,
+                                                 uint8_t*& pData, MemoryType& memoryType)
+{
+    pData = nullptr;
+
+#if defined(__linux__)
+    // Mappings are page aligned, which covers any offset alignment a bitstream buffer asks for.
+    const VkDeviceSize pageSize = (VkDeviceSize)sysconf(_SC_PAGESIZE);
+    assert(alignment <= pageSize);
+    (void)alignment;
+
+    if (useHugePages) {
+        const VkDeviceSize allocationSize = AlignUp(size, HUGE_PAGE_SIZE);
+#ifdef MAP_HUGETLB
+        void* hugeTlbPtr = mmap(nullptr, (size_t)allocationSize, PROT_READ | PROT_WRITE,
+                                MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (hugeTlbPtr != MAP_FAILED) {
+            pData = (uint8_t*)hugeTlbPtr;
+            memoryType = MEMORY_TYPE_MAPPED_HUGETLB;
+            return allocationSize;
+        }
+#endif
+        // No hugetlbfs pages reserved, let the kernel back the mapping with transparent huge pages.
+        void* ptr = mmap(nullptr, (size_t)allocationSize, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (ptr == MAP_FAILED) {
+            return 0;
+        }
+#ifdef MADV_HUGEPAGE
+        madvise(ptr, (size_t)allocationSize, MADV_HUGEPAGE);
+#endif
+        pData = (uint8_t*)ptr;
+        memoryType = MEMORY_TYPE_MAPPED_THP;
+        return allocationSize;
+    }
+
+    const VkDeviceSize allocationSize = AlignUp(size, pageSize);
+    void* ptr = mmap(nullptr, (size_t)allocationSize, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (ptr == MAP_FAILED) {
+        return 0;
+    }
+    pData = (uint8_t*)ptr;
+    memoryType = MEMORY_TYPE_MAPPED;
+    return allocationSize;
+#else
+    (void)useHugePages;
+
+    // The size of the allocation must be a multiple of the alignment for aligned_alloc().
+    const VkDeviceSize allocationAlignment = (alignment > 64) ? alignment : 64;
+    const VkDeviceSize allocationSize = AlignUp(size, allocationAlignment);
+#if defined(_WIN32)
+    pData = (uint8_t*)_aligned_malloc((size_t)allocationSize, (size_t)allocationAlignment);
+#else
+    void* ptr = nullptr;
+    if (posix_memalign(&ptr, (size_t)allocationAlignment, (size_t)allocationSize) == 0) {
+        pData = (uint8_t*)ptr;
+    }
+#endif
+    if (pData == nullptr) {
+        return 0;
+    }
+    memoryType = MEMORY_TYPE_HEAP;
+    return allocationSize;
+#endif
+}
+
+void VulkanBitstreamBufferHost::Free(uint8_t* pData, VkDeviceSize allocationSize, MemoryType memoryType)
+{
+    if (pData == nullptr) {
+        return;
+    }
+
+#if defined(__linux__)
+    if (memoryType != MEMORY_TYPE_HEAP) {
+        munmap(pData, (size_t)allocationSize);
+        return;
+    }
+#else
+    (void)allocationSize;
+    (void)memoryType;
+#endif
+
+#if defined(_WIN32)
+    _aligned_free(pData);
+#else
+    free(pData);
+#endif
+}
+
+VkResult VulkanBitstreamBufferHost::Initialize(VkDeviceSize bufferSize,
+                                               const void* pInitializeBufferMemory,
+                                               VkDeviceSize initializeBufferMemorySize)
+{
+    if (m_bufferSize >= bufferSize) {
+        return VK_SUCCESS;
+    }
+
+    Deinitialize();
+
+    bufferSize = AlignUp(bufferSize, m_bufferSizeAlignment);
+
+    uint8_t* pData = nullptr;
+    MemoryType memoryType = MEMORY_TYPE_HEAP;
+    const VkDeviceSize allocationSize = Allocate(bufferSize, m_bufferOffsetAlignment, m_useHugePages,
+                                                 pData, memoryType);
+    if (allocationSize == 0) {
+        assert(!"Out of host memory!");
+        return VK_ERROR_OUT_OF_HOST_MEMORY;
+    }
+
+    if (pInitializeBufferMemory && initializeBufferMemorySize) {
+        assert(initializeBufferMemorySize <= bufferSize);
+        memcpy(pData, pInitializeBufferMemory, (size_t)initializeBufferMemorySize);
+    }
+
+    m_pData = pData;
+    m_allocationSize = allocationSize;
+    m_memoryType = memoryType;
+    m_bufferSize = bufferSize;
+
+    return VK_SUCCESS;
+}
+
+void VulkanBitstreamBufferHost::Deinitialize()
+{
+    Free(m_pData, m_allocationSize, m_memoryType);
+
+    m_pData = nullptr;
+    m_allocationSize = 0;
+    m_memoryType = MEMORY_TYPE_HEAP;
+    m_bufferSize = 0;
+}
+
+VkDeviceSize VulkanBitstreamBufferHost::Resize(VkDeviceSize newSize, VkDeviceSize copySize, VkDeviceSize copyOffset)
+{
+    if (m_bufferSize >= newSize) {
+        return m_bufferSize;
+    }
+
+    newSize = AlignUp(newSize, m_bufferSizeAlignment);
+
+#if defined(__linux__) && defined(MREMAP_MAYMOVE)
+    // The data to keep is already at the start of the buffer: grow the mapping in place, or let the
+    // kernel move its pages, instead of copying them. hugetlbfs mappings can't be remapped.
+    if ((copyOffset == 0) && ((m_memoryType == MEMORY_TYPE_MAPPED) || (m_memoryType == MEMORY_TYPE_MAPPED_THP))) {
+        const VkDeviceSize allocationSize = AlignUp(newSize, (m_memoryType == MEMORY_TYPE_MAPPED_THP) ?
+                                                                 (VkDeviceSize)HUGE_PAGE_SIZE :
+                                                                 (VkDeviceSize)sysconf(_SC_PAGESIZE));
+        void* ptr = mremap(m_pData, (size_t)m_allocationSize, (size_t)allocationSize, MREMAP_MAYMOVE);
+        if (ptr != MAP_FAILED) {
+#ifdef MADV_HUGEPAGE
+            if (m_memoryType == MEMORY_TYPE_MAPPED_THP) {
+                madvise(ptr, (size_t)allocationSize, MADV_HUGEPAGE);
+            }
+#endif
+            m_pData = (uint8_t*)ptr;
+            m_allocationSize = allocationSize;
+            m_bufferSize = newSize;
+            return newSize;
+        }
+    }
+#endif
+
+    uint8_t* pData = nullptr;
+    MemoryType memoryType = MEMORY_TYPE_HEAP;
+    const VkDeviceSize allocationSize = Allocate(newSize, m_bufferOffsetAlignment, m_useHugePages,
+                                                 pData, memoryType);
+    if (allocationSize == 0) {
+        assert(!"Out of host memory!");
+        return 0;
+    }
+
+    if (copySize) {
+        assert((copyOffset + copySize) <= m_bufferSize);
+        memcpy(pData, m_pData + copyOffset, (size_t)copySize);
+    }
+
+    Deinitialize();
+
+    m_pData = pData;
+    m_allocationSize = allocationSize;
+    m_memoryType = memoryType;
+    m_bufferSize = newSize;
+
+    return newSize;
+}
+
+uint8_t* VulkanBitstreamBufferHost::CheckAccess(VkDeviceSize offset, VkDeviceSize size) const
+{
+    if (offset + size <= m_bufferSize) {
+        return m_pData + offset;
+    }
+
+    assert(!"Bad buffer access - out of range!");
+    return nullptr;
+}
+
+int64_t VulkanBitstreamBufferHost::MemsetData(uint32_t value, VkDeviceSize offset, VkDeviceSize size)
+{
+    if (size == 0) {
+        return 0;
+    }
+    uint8_t* pData = CheckAccess(offset, size);
+    if (pData == nullptr) {
+        return -1;
+    }
+    memset(pData, (int)value, (size_t)size);
+    return size;
+}
+
+int64_t VulkanBitstreamBufferHost::CopyDataToBuffer(uint8_t *dstBuffer, VkDeviceSize dstOffset,
+                                                    VkDeviceSize srcOffset, VkDeviceSize size) const
+{
+    if (size == 0) {
+        return 0;
+    }
+    const uint8_t* readData = CheckAccess(srcOffset, size);
+    if (readData == nullptr) {
+        assert(!"Could not CopyDataToBuffer!");
+        return -1;
+    }
+    memcpy(dstBuffer + dstOffset, readData, (size_t)size);
+    return size;
+}
+
+int64_t VulkanBitstreamBufferHost::CopyDataToBuffer(VkSharedBaseObj<VulkanBitstreamBuffer>& dstBuffer, VkDeviceSize dstOffset,
+                                                    VkDeviceSize srcOffset, VkDeviceSize size) const
+{
+    if (size == 0) {
+        return 0;
+    }
+    const uint8_t* readData = CheckAccess(srcOffset, size);
+    if (readData == nullptr) {
+        assert(!"Could not CopyDataToBuffer!");
+        return -1;
+    }
+    return dstBuffer->CopyDataFromBuffer(readData, 0, dstOffset, size);
+}
+
+int64_t VulkanBitstreamBufferHost::CopyDataFromBuffer(const uint8_t *sourceBuffer, VkDeviceSize srcOffset,
+                                                      VkDeviceSize dstOffset, VkDeviceSize size)
+{
+    if (size == 0) {
+        return 0;
+    }
+    uint8_t* writeData = CheckAccess(dstOffset, size);
+    if (writeData == nullptr) {
+        assert(!"Could not CopyDataFromBuffer!");
+        return -1;
+    }
+    memcpy(writeData, sourceBuffer + srcOffset, (size_t)size);
+    return size;
+}
+
+int64_t VulkanBitstreamBufferHost::CopyDataFromBuffer(const VkSharedBaseObj<VulkanBitstreamBuffer>& sourceBuffer,
+                                                      VkDeviceSize srcOffset, VkDeviceSize dstOffset, VkDeviceSize size)
+{
+    if (size == 0) {
+        return 0;
+    }
+    VkDeviceSize maxSize = 0;
+    const uint8_t* readData = sourceBuffer->GetReadOnlyDataPtr(srcOffset, maxSize);
+    if ((readData == nullptr) || (maxSize < size)) {
+        assert(!"Could not CopyDataFromBuffer!");
+        return -1;
+    }
+    return CopyDataFromBuffer(readData, 0, dstOffset, size);
+}
+
+uint8_t* VulkanBitstreamBufferHost::GetDataPtr(VkDeviceSize offset, VkDeviceSize &maxSize)
+{
+    uint8_t* readData = CheckAccess(offset, 1);
+    if (readData == nullptr) {
+        assert(!"Could not GetDataPtr()!");
+        return nullptr;
+    }
+    maxSize = m_bufferSize - offset;
+    return readData;
+}
+
+const uint8_t* VulkanBitstreamBufferHost::GetReadOnlyDataPtr(VkDeviceSize offset, VkDeviceSize &maxSize) const
+{
+    const uint8_t* readData = CheckAccess(offset, 1);
+    if (readData == nullptr) {
+        assert(!"Could not GetReadOnlyDataPtr()!");
+        return nullptr;
+    }
+    maxSize = m_bufferSize - offset;
+    return readData;
+}
+
+uint32_t VulkanBitstreamBufferHost::AddStreamMarker(uint32_t streamOffset)
+{
+    m_streamMarkers.push_back(streamOffset);
+    return (uint32_t)(m_streamMarkers.size() - 1);
+}
+
+uint32_t VulkanBitstreamBufferHost::SetStreamMarker(uint32_t streamOffset, uint32_t index)
+{
+    assert(index < (uint32_t)m_streamMarkers.size());
+    if (!(index < (uint32_t)m_streamMarkers.size())) {
+        return uint32_t(-1);
+    }
+    m_streamMarkers[index] = streamOffset;
+    return index;
+}
+
+uint32_t VulkanBitstreamBufferHost::GetStreamMarker(uint32_t index) const
+{
+    assert(index < (uint32_t)m_streamMarkers.size());
+    return m_streamMarkers[index];
+}
+
+uint32_t VulkanBitstreamBufferHost::GetStreamMarkersCount() const
+{
+    return (uint32_t)m_streamMarkers.size();
+}
+
+const uint32_t* VulkanBitstreamBufferHost::GetStreamMarkersPtr(uint32_t startIndex, uint32_t& maxCount) const
+{
+    maxCount = (uint32_t)m_streamMarkers.size() - startIndex;
+    return m_streamMarkers.data() + startIndex;
+}
+
+uint32_t VulkanBitstreamBufferHost::ResetStreamMarkers()
+{
+    uint32_t oldSize = (uint32_t)m_streamMarkers.size();
+    m_streamMarkers.clear();
+    return oldSize;
+}
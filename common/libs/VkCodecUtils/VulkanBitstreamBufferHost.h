@@ -0,0 +1,148 @@
+/*
+* Copyright 2024 NVIDIA Corporation.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#ifndef _VULKANBITSTREAMBUFFERHOST_H_
+#define _VULKANBITSTREAMBUFFERHOST_H_
+
+#include <assert.h>
+#include <atomic>
+#include <vector>
+#include "VkCodecUtils/VulkanBitstreamBuffer.h"
+
+// A bitstream buffer in plain host memory, for the clients of the parser that don't decode on a device:
+// GetBuffer() and GetDeviceMemory() return VK_NULL_HANDLE, and FlushRange()/InvalidateRange() do nothing.
+//
+// On Linux, the memory is mapped anonymously, which lets Resize() grow it in place with mremap().
+// With useHugePages, it is backed by 2 MB pages: hugetlbfs pages (MAP_HUGETLB) if the system reserved
+// some, otherwise transparent huge pages. Elsewhere, it is an aligned heap allocation.
+class VulkanBitstreamBufferHost : public VulkanBitstreamBuffer
+{
+public:
+
+    enum { HUGE_PAGE_SIZE = 2 * 1024 * 1024 };
+
+    static VkResult Create(VkDeviceSize bufferSize, VkDeviceSize bufferOffsetAlignment, VkDeviceSize bufferSizeAlignment,
+                           const void* pInitializeBufferMemory, VkDeviceSize initializeBufferMemorySize,
+                           bool useHugePages,
+                           VkSharedBaseObj<VulkanBitstreamBufferHost>& vulkanBitstreamBuffer);
+
+    virtual int32_t AddRef()
+    {
+        return ++m_refCount;
+    }
+
+    virtual int32_t Release()
+    {
+        uint32_t ret = --m_refCount;
+        // Destroy the buffer if ref-count reaches zero
+        if (ret == 0) {
+            delete this;
+        }
+        return ret;
+    }
+
+    virtual int32_t GetRefCount()
+    {
+        assert(m_refCount > 0);
+        return m_refCount;
+    }
+
+    virtual VkDeviceSize GetMaxSize() const { return m_bufferSize; }
+    virtual VkDeviceSize GetOffsetAlignment() const { return m_bufferOffsetAlignment; }
+    virtual VkDeviceSize GetSizeAlignment() const { return m_bufferSizeAlignment; }
+    virtual VkDeviceSize Resize(VkDeviceSize newSize, VkDeviceSize copySize = 0, VkDeviceSize copyOffset = 0);
+    virtual VkDeviceSize Clone(VkDeviceSize newSize, VkDeviceSize copySize, VkDeviceSize copyOffset,
+                               VkSharedBaseObj<VulkanBitstreamBuffer>& vulkanBitstreamBuffer);
+
+    virtual int64_t  MemsetData(uint32_t value, VkDeviceSize offset, VkDeviceSize size);
+    virtual int64_t  CopyDataToBuffer(uint8_t *dstBuffer, VkDeviceSize dstOffset,
+                                      VkDeviceSize srcOffset, VkDeviceSize size) const;
+    virtual int64_t  CopyDataToBuffer(VkSharedBaseObj<VulkanBitstreamBuffer>& dstBuffer, VkDeviceSize dstOffset,
+                                      VkDeviceSize srcOffset, VkDeviceSize size) const;
+    virtual int64_t  CopyDataFromBuffer(const uint8_t *sourceBuffer, VkDeviceSize srcOffset,
+                                        VkDeviceSize dstOffset, VkDeviceSize size);
+    virtual int64_t  CopyDataFromBuffer(const VkSharedBaseObj<VulkanBitstreamBuffer>& sourceBuffer, VkDeviceSize srcOffset,
+                                        VkDeviceSize dstOffset, VkDeviceSize size);
+    virtual uint8_t* GetDataPtr(VkDeviceSize offset, VkDeviceSize &maxSize);
+    virtual const uint8_t* GetReadOnlyDataPtr(VkDeviceSize offset, VkDeviceSize &maxSize) const;
+
+    // The memory is not shared with a device
+    virtual void FlushRange(VkDeviceSize, VkDeviceSize) const { }
+    virtual void InvalidateRange(VkDeviceSize, VkDeviceSize) const { }
+
+    virtual VkBuffer GetBuffer() const { return VK_NULL_HANDLE; }
+    virtual VkDeviceMemory GetDeviceMemory() const { return VK_NULL_HANDLE; }
+    virtual VkDeviceSize GetBufferOffset() const { return 0; }
+
+    virtual uint32_t  AddStreamMarker(uint32_t streamOffset);
+    virtual uint32_t  SetStreamMarker(uint32_t streamOffset, uint32_t index);
+    virtual uint32_t  GetStreamMarker(uint32_t index) const;
+    virtual uint32_t  GetStreamMarkersCount() const;
+    virtual const uint32_t* GetStreamMarkersPtr(uint32_t startIndex, uint32_t& maxCount) const;
+    virtual uint32_t  ResetStreamMarkers();
+
+    // True if the memory is backed by huge pages, or was advised to be
+    bool UsesHugePages() const { return (m_memoryType == MEMORY_TYPE_MAPPED_THP) || (m_memoryType == MEMORY_TYPE_MAPPED_HUGETLB); }
+
+private:
+
+    enum MemoryType {
+        MEMORY_TYPE_HEAP = 0,       // Aligned heap allocation
+        MEMORY_TYPE_MAPPED,         // Anonymous mapping
+        MEMORY_TYPE_MAPPED_THP,     // Anonymous mapping advised to use transparent huge pages
+        MEMORY_TYPE_MAPPED_HUGETLB, // Anonymous mapping of hugetlbfs pages
+    };
+
+    VulkanBitstreamBufferHost(VkDeviceSize bufferOffsetAlignment, VkDeviceSize bufferSizeAlignment, bool useHugePages)
+        : VulkanBitstreamBuffer()
+        , m_refCount(0)
+        , m_pData(nullptr)
+        , m_bufferSize(0)
+        , m_allocationSize(0)
+        , m_bufferOffsetAlignment(bufferOffsetAlignment)
+        , m_bufferSizeAlignment(bufferSizeAlignment)
+        , m_useHugePages(useHugePages)
+        , m_memoryType(MEMORY_TYPE_HEAP)
+        , m_streamMarkers()
+    {
+        m_streamMarkers.reserve(256);
+    }
+
+    virtual ~VulkanBitstreamBufferHost() { Deinitialize(); }
+
+    VkResult Initialize(VkDeviceSize bufferSize, const void* pInitializeBufferMemory, VkDeviceSize initializeBufferMemorySize);
+    void Deinitialize();
+
+    // Allocates at least size bytes, returns the allocated size (0 on failure)
+    static VkDeviceSize Allocate(VkDeviceSize size, VkDeviceSize alignment, bool useHugePages,
+                                 uint8_t*& pData, MemoryType& memoryType);
+    static void Free(uint8_t* pData, VkDeviceSize allocationSize, MemoryType memoryType);
+
+    uint8_t* CheckAccess(VkDeviceSize offset, VkDeviceSize size) const;
+
+private:
+    std::atomic<int32_t>       m_refCount;
+    uint8_t*                   m_pData;
+    VkDeviceSize               m_bufferSize;
+    VkDeviceSize               m_allocationSize;
+    VkDeviceSize               m_bufferOffsetAlignment;
+    VkDeviceSize               m_bufferSizeAlignment;
+    bool                       m_useHugePages;
+    MemoryType                 m_memoryType;
+    std::vector<uint32_t>      m_streamMarkers;
+};
+
+#endif /* _VULKANBITSTREAMBUFFERHOST_H_ */
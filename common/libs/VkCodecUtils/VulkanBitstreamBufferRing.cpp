@@ -0,0 +1,264 @@
+/*
+* Copyright 2024 NVIDIA Corporation.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include <string.h>
+#include <algorithm>
+#include "VkCodecUtils/VulkanBitstreamBufferRing.h"
+
+VkResult
+VulkanBitstreamBufferRing::Create(const VulkanDeviceContext* vkDevCtx,
+        uint32_t queueFamilyIndex, VkBufferUsageFlags usage,
+        VkDeviceSize ringSize, VkDeviceSize bufferOffsetAlignment, VkDeviceSize bufferSizeAlignment,
+        VkSharedBaseObj<VulkanBitstreamBufferRing>& bitstreamBufferRing)
+{
+    VkSharedBaseObj<VulkanBitstreamBufferImpl> buffer;
+    VkResult result = VulkanBitstreamBufferImpl::Create(vkDevCtx, queueFamilyIndex, usage,
+                                                        ringSize, bufferOffsetAlignment, bufferSizeAlignment,
+                                                        nullptr, 0, buffer);
+    if (result != VK_SUCCESS) {
+        return result;
+    }
+
+    VkSharedBaseObj<VulkanBitstreamBufferRing> ring(new VulkanBitstreamBufferRing(buffer));
+    if (!ring) {
+        assert(!"Out of host memory!");
+        return VK_ERROR_OUT_OF_HOST_MEMORY;
+    }
+
+    bitstreamBufferRing = ring;
+    return VK_SUCCESS;
+}
+
+VkResult VulkanBitstreamBufferRing::GetRange(VkDeviceSize size,
+                                             const void* pInitializeBufferMemory,
+                                             VkDeviceSize initializeBufferMemorySize,
+                                             VkSharedBaseObj<VulkanBitstreamBuffer>& bitstreamBuffer)
+{
+    assert(initializeBufferMemorySize <= size);
+
+    const VkDeviceSize sizeAlignment = std::max<VkDeviceSize>(m_buffer->GetSizeAlignment(), 1);
+    const VkDeviceSize offsetAlignment = std::max<VkDeviceSize>(m_buffer->GetOffsetAlignment(), 1);
+    size = ((size + (sizeAlignment - 1)) / sizeAlignment) * sizeAlignment;
+
+    VkDeviceSize offset = 0;
+    uint64_t allocationId = 0;
+    {
+        std::lock_guard<std::mutex> lock(m_ringMutex);
+
+        if (!m_allocator.Allocate(size, offsetAlignment, offset, allocationId)) {
+            return VK_ERROR_OUT_OF_POOL_MEMORY;
+        }
+        m_highWaterMark = std::max(m_highWaterMark, m_allocator.GetUsedSize());
+    }
+
+    VkSharedBaseObj<VulkanBitstreamBuffer> range(new VulkanBitstreamBufferRange(this, allocationId, offset, size));
+    if (!range) {
+        std::lock_guard<std::mutex> lock(m_ringMutex);
+        m_allocator.Free(allocationId);
+        assert(!"Out of host memory!");
+        return VK_ERROR_OUT_OF_HOST_MEMORY;
+    }
+
+    if (initializeBufferMemorySize) {
+        range->CopyDataFromBuffer((const uint8_t*)pInitializeBufferMemory, 0, 0, initializeBufferMemorySize);
+    }
+
+    bitstreamBuffer = range;
+    return VK_SUCCESS;
+}
+
+VkDeviceSize VulkanBitstreamBufferRing::GetUsedSize()
+{
+    std::lock_guard<std::mutex> lock(m_ringMutex);
+    return m_allocator.GetUsedSize();
+}
+
+VkDeviceSize VulkanBitstreamBufferRing::ShrinkRange(uint64_t allocationId, VkDeviceSize newSize)
+{
+    const VkDeviceSize sizeAlignment = std::max<VkDeviceSize>(m_buffer->GetSizeAlignment(), 1);
+    newSize = ((newSize + (sizeAlignment - 1)) / sizeAlignment) * sizeAlignment;
+
+    std::lock_guard<std::mutex> lock(m_ringMutex);
+    return m_allocator.Shrink(allocationId, newSize) ? newSize : 0;
+}
+
+void VulkanBitstreamBufferRing::FreeRange(uint64_t allocationId)
+{
+    std::lock_guard<std::mutex> lock(m_ringMutex);
+    m_allocator.Free(allocationId);
+}
+
+VkDeviceSize VulkanBitstreamBufferRange::Resize(VkDeviceSize newSize, VkDeviceSize, VkDeviceSize)
+{
+    if ((newSize > 0) && (newSize < m_size)) {
+        // Only the most recent range of the ring can shrink, any other one keeps its size
+        VkDeviceSize shrunkSize = m_ring->ShrinkRange(m_allocationId, newSize);
+        if (shrunkSize != 0) {
+            m_size = shrunkSize;
+        }
+    }
+    return m_size;
+}
+
+VkDeviceSize VulkanBitstreamBufferRange::Clone(VkDeviceSize newSize, VkDeviceSize copySize, VkDeviceSize copyOffset,
+                                               VkSharedBaseObj<VulkanBitstreamBuffer>& vulkanBitstreamBuffer)
+{
+    const uint8_t* pCopyData = nullptr;
+    if (copySize) {
+        VkDeviceSize maxSize = 0;
+        pCopyData = GetReadOnlyDataPtr(copyOffset, maxSize);
+        assert(copySize <= maxSize);
+    }
+    VkResult result = m_ring->GetRange(newSize, pCopyData, copySize, vulkanBitstreamBuffer);
+    if (result != VK_SUCCESS) {
+        return 0;
+    }
+    return vulkanBitstreamBuffer->GetMaxSize();
+}
+
+int64_t VulkanBitstreamBufferRange::MemsetData(uint32_t value, VkDeviceSize offset, VkDeviceSize size)
+{
+    if ((size == 0) || !CheckRange(offset, size)) {
+        return 0;
+    }
+    return m_ring->GetBuffer()->MemsetData(value, m_offset + offset, size);
+}
+
+int64_t VulkanBitstreamBufferRange::CopyDataToBuffer(uint8_t *dstBuffer, VkDeviceSize dstOffset,
+                                                     VkDeviceSize srcOffset, VkDeviceSize size) const
+{
+    if ((size == 0) || !CheckRange(srcOffset, size)) {
+        return 0;
+    }
+    return m_ring->GetBuffer()->CopyDataToBuffer(dstBuffer, dstOffset, m_offset + srcOffset, size);
+}
+
+int64_t VulkanBitstreamBufferRange::CopyDataToBuffer(VkSharedBaseObj<VulkanBitstreamBuffer>& dstBuffer, VkDeviceSize dstOffset,
+                                                     VkDeviceSize srcOffset, VkDeviceSize size) const
+{
+    if (size == 0) {
+        return 0;
+    }
+    VkDeviceSize maxSize = 0;
+    const uint8_t* readData = GetReadOnlyDataPtr(srcOffset, maxSize);
+    if ((readData == nullptr) || (size > maxSize)) {
+        assert(!"Could not CopyDataToBuffer!");
+        return -1;
+    }
+    return dstBuffer->CopyDataFromBuffer(readData, 0, dstOffset, size);
+}
+
+int64_t VulkanBitstreamBufferRange::CopyDataFromBuffer(const uint8_t *sourceBuffer, VkDeviceSize srcOffset,
+                                                       VkDeviceSize dstOffset, VkDeviceSize size)
+{
+    if ((size == 0) || !CheckRange(dstOffset, size)) {
+        return 0;
+    }
+    return m_ring->GetBuffer()->CopyDataFromBuffer(sourceBuffer, srcOffset, m_offset + dstOffset, size);
+}
+
+int64_t VulkanBitstreamBufferRange::CopyDataFromBuffer(const VkSharedBaseObj<VulkanBitstreamBuffer>& sourceBuffer,
+                                                       VkDeviceSize srcOffset, VkDeviceSize dstOffset, VkDeviceSize size)
+{
+    if (size == 0) {
+        return 0;
+    }
+    VkDeviceSize maxSize = 0;
+    const uint8_t* readData = sourceBuffer->GetReadOnlyDataPtr(srcOffset, maxSize);
+    if ((readData == nullptr) || (size > maxSize)) {
+        assert(!"Could not CopyDataFromBuffer!");
+        return -1;
+    }
+    return CopyDataFromBuffer(readData, 0, dstOffset, size);
+}
+
+uint8_t* VulkanBitstreamBufferRange::GetDataPtr(VkDeviceSize offset, VkDeviceSize &maxSize)
+{
+    if (!CheckRange(offset, 1)) {
+        return nullptr;
+    }
+    VkDeviceSize ringMaxSize = 0;
+    uint8_t* data = m_ring->GetBuffer()->GetDataPtr(m_offset + offset, ringMaxSize);
+    maxSize = m_size - offset;
+    return data;
+}
+
+const uint8_t* VulkanBitstreamBufferRange::GetReadOnlyDataPtr(VkDeviceSize offset, VkDeviceSize &maxSize) const
+{
+    if (!CheckRange(offset, 1)) {
+        return nullptr;
+    }
+    VkDeviceSize ringMaxSize = 0;
+    const uint8_t* data = m_ring->GetBuffer()->GetReadOnlyDataPtr(m_offset + offset, ringMaxSize);
+    maxSize = m_size - offset;
+    return data;
+}
+
+void VulkanBitstreamBufferRange::FlushRange(VkDeviceSize offset, VkDeviceSize size) const
+{
+    if (offset >= m_size) {
+        return;
+    }
+    m_ring->GetBuffer()->FlushRange(m_offset + offset, std::min(size, m_size - offset));
+}
+
+void VulkanBitstreamBufferRange::InvalidateRange(VkDeviceSize offset, VkDeviceSize size) const
+{
+    if (offset >= m_size) {
+        return;
+    }
+    m_ring->GetBuffer()->InvalidateRange(m_offset + offset, std::min(size, m_size - offset));
+}
+
+uint32_t VulkanBitstreamBufferRange::AddStreamMarker(uint32_t streamOffset)
+{
+    m_streamMarkers.push_back(streamOffset);
+    return (uint32_t)(m_streamMarkers.size() - 1);
+}
+
+uint32_t VulkanBitstreamBufferRange::SetStreamMarker(uint32_t streamOffset, uint32_t index)
+{
+    assert(index < (uint32_t)m_streamMarkers.size());
+    if (!(index < (uint32_t)m_streamMarkers.size())) {
+        return uint32_t(-1);
+    }
+    m_streamMarkers[index] = streamOffset;
+    return index;
+}
+
+uint32_t VulkanBitstreamBufferRange::GetStreamMarker(uint32_t index) const
+{
+    assert(index < (uint32_t)m_streamMarkers.size());
+    return m_streamMarkers[index];
+}
+
+uint32_t VulkanBitstreamBufferRange::GetStreamMarkersCount() const
+{
+    return (uint32_t)m_streamMarkers.size();
+}
+
+const uint32_t* VulkanBitstreamBufferRange::GetStreamMarkersPtr(uint32_t startIndex, uint32_t& maxCount) const
+{
+    maxCount = (uint32_t)m_streamMarkers.size() - startIndex;
+    return m_streamMarkers.data() + startIndex;
+}
+
+uint32_t VulkanBitstreamBufferRange::ResetStreamMarkers()
+{
+    uint32_t oldSize = (uint32_t)m_streamMarkers.size();
+    m_streamMarkers.clear();
+    return oldSize;
+}
@@ -0,0 +1,186 @@
+/*
+* Copyright 2024 NVIDIA Corporation.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#ifndef _VULKANBITSTREAMBUFFERRING_H_
+#define _VULKANBITSTREAMBUFFERRING_H_
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include "VkCodecUtils/VulkanBistreamBufferImpl.h"
+#include "VkCodecUtils/VulkanRingAllocator.h"
+
+// One large, persistently mapped bitstream buffer, handed out as a ring of per-picture ranges.
+//
+// Each range is a VulkanBitstreamBuffer of its own, addressing the ring's VkBuffer at
+// GetBufferOffset(). A range returns its space to the ring when its last reference is released,
+// which for a decoded picture happens once the frame buffer has waited for its decode to complete.
+class VulkanBitstreamBufferRing : public VkVideoRefCountBase
+{
+public:
+
+    static VkResult Create(const VulkanDeviceContext* vkDevCtx, uint32_t queueFamilyIndex, VkBufferUsageFlags usage,
+                           VkDeviceSize ringSize, VkDeviceSize bufferOffsetAlignment, VkDeviceSize bufferSizeAlignment,
+                           VkSharedBaseObj<VulkanBitstreamBufferRing>& bitstreamBufferRing);
+
+    virtual int32_t AddRef()
+    {
+        return ++m_refCount;
+    }
+
+    virtual int32_t Release()
+    {
+        uint32_t ret = --m_refCount;
+        // Destroy the ring if ref-count reaches zero, the ranges hold a reference to it
+        if (ret == 0) {
+            delete this;
+        }
+        return ret;
+    }
+
+    // Returns a range of at least size bytes initialized with pInitializeBufferMemory.
+    // Fails with VK_ERROR_OUT_OF_POOL_MEMORY when the ring has no space left for it.
+    VkResult GetRange(VkDeviceSize size, const void* pInitializeBufferMemory, VkDeviceSize initializeBufferMemorySize,
+                      VkSharedBaseObj<VulkanBitstreamBuffer>& bitstreamBuffer);
+
+    VkDeviceSize GetCapacity() const { return m_buffer->GetMaxSize(); }
+    VkDeviceSize GetUsedSize();
+    VkDeviceSize GetHighWaterMark() const { return m_highWaterMark; }
+
+    // Used by the ranges
+    VulkanBitstreamBufferImpl* GetBuffer() const { return m_buffer; }
+    VkDeviceSize ShrinkRange(uint64_t allocationId, VkDeviceSize newSize);
+    void FreeRange(uint64_t allocationId);
+
+private:
+
+    VulkanBitstreamBufferRing(VkSharedBaseObj<VulkanBitstreamBufferImpl>& buffer)
+        : m_refCount(0)
+        , m_ringMutex()
+        , m_buffer(buffer)
+        , m_allocator(buffer->GetMaxSize())
+        , m_highWaterMark(0) { }
+
+    virtual ~VulkanBitstreamBufferRing() { }
+
+private:
+    std::atomic<int32_t>                        m_refCount;
+    std::mutex                                  m_ringMutex;
+    VkSharedBaseObj<VulkanBitstreamBufferImpl>  m_buffer;
+    VulkanRingAllocator                         m_allocator;
+    VkDeviceSize                                m_highWaterMark;
+};
+
+// A picture's range of a VulkanBitstreamBufferRing.
+//
+// A range can't grow: the parser gets a larger buffer from its client instead. Resize() to a
+// smaller size returns the end of the most recent range to the ring, so that the next picture
+// starts right after the data of the current one.
+class VulkanBitstreamBufferRange : public VulkanBitstreamBuffer
+{
+public:
+
+    virtual int32_t AddRef()
+    {
+        return ++m_refCount;
+    }
+
+    virtual int32_t Release()
+    {
+        uint32_t ret = --m_refCount;
+        // Return the range to the ring if ref-count reaches zero
+        if (ret == 0) {
+            delete this;
+        }
+        return ret;
+    }
+
+    virtual int32_t GetRefCount()
+    {
+        assert(m_refCount > 0);
+        return m_refCount;
+    }
+
+    virtual VkDeviceSize GetMaxSize() const { return m_size; }
+    virtual VkDeviceSize GetOffsetAlignment() const { return m_ring->GetBuffer()->GetOffsetAlignment(); }
+    virtual VkDeviceSize GetSizeAlignment() const { return m_ring->GetBuffer()->GetSizeAlignment(); }
+    virtual VkDeviceSize Resize(VkDeviceSize newSize, VkDeviceSize copySize = 0, VkDeviceSize copyOffset = 0);
+    virtual VkDeviceSize Clone(VkDeviceSize newSize, VkDeviceSize copySize, VkDeviceSize copyOffset,
+                               VkSharedBaseObj<VulkanBitstreamBuffer>& vulkanBitstreamBuffer);
+
+    virtual int64_t  MemsetData(uint32_t value, VkDeviceSize offset, VkDeviceSize size);
+    virtual int64_t  CopyDataToBuffer(uint8_t *dstBuffer, VkDeviceSize dstOffset,
+                                      VkDeviceSize srcOffset, VkDeviceSize size) const;
+    virtual int64_t  CopyDataToBuffer(VkSharedBaseObj<VulkanBitstreamBuffer>& dstBuffer, VkDeviceSize dstOffset,
+                                      VkDeviceSize srcOffset, VkDeviceSize size) const;
+    virtual int64_t  CopyDataFromBuffer(const uint8_t *sourceBuffer, VkDeviceSize srcOffset,
+                                        VkDeviceSize dstOffset, VkDeviceSize size);
+    virtual int64_t  CopyDataFromBuffer(const VkSharedBaseObj<VulkanBitstreamBuffer>& sourceBuffer, VkDeviceSize srcOffset,
+                                        VkDeviceSize dstOffset, VkDeviceSize size);
+    virtual uint8_t* GetDataPtr(VkDeviceSize offset, VkDeviceSize &maxSize);
+    virtual const uint8_t* GetReadOnlyDataPtr(VkDeviceSize offset, VkDeviceSize &maxSize) const;
+
+    virtual void FlushRange(VkDeviceSize offset, VkDeviceSize size) const;
+    virtual void InvalidateRange(VkDeviceSize offset, VkDeviceSize size) const;
+
+    virtual VkBuffer GetBuffer() const { return m_ring->GetBuffer()->GetBuffer(); }
+    virtual VkDeviceMemory GetDeviceMemory() const { return m_ring->GetBuffer()->GetDeviceMemory(); }
+    virtual VkDeviceSize GetBufferOffset() const { return m_offset; }
+
+    virtual uint32_t  AddStreamMarker(uint32_t streamOffset);
+    virtual uint32_t  SetStreamMarker(uint32_t streamOffset, uint32_t index);
+    virtual uint32_t  GetStreamMarker(uint32_t index) const;
+    virtual uint32_t  GetStreamMarkersCount() const;
+    virtual const uint32_t* GetStreamMarkersPtr(uint32_t startIndex, uint32_t& maxCount) const;
+    virtual uint32_t  ResetStreamMarkers();
+
+private:
+    friend class VulkanBitstreamBufferRing;
+
+    VulkanBitstreamBufferRange(VulkanBitstreamBufferRing* ring, uint64_t allocationId,
+                               VkDeviceSize offset, VkDeviceSize size)
+        : VulkanBitstreamBuffer()
+        , m_refCount(0)
+        , m_ring(ring)
+        , m_allocationId(allocationId)
+        , m_offset(offset)
+        , m_size(size)
+        , m_streamMarkers()
+    {
+        m_streamMarkers.reserve(256);
+    }
+
+    virtual ~VulkanBitstreamBufferRange() { m_ring->FreeRange(m_allocationId); }
+
+    bool CheckRange(VkDeviceSize offset, VkDeviceSize size) const
+    {
+        if (offset + size <= m_size) {
+            return true;
+        }
+        assert(!"Bad buffer access - out of range!");
+        return false;
+    }
+
+private:
+    std::atomic<int32_t>                        m_refCount;
+    VkSharedBaseObj<VulkanBitstreamBufferRing>  m_ring;
+    uint64_t                                    m_allocationId;
+    VkDeviceSize                                m_offset;
+    VkDeviceSize                                m_size;
+    std::vector<uint32_t>                       m_streamMarkers;
+};
+
+#endif /* _VULKANBITSTREAMBUFFERRING_H_ */
@@ -19,11 +19,14 @@
 
 #include "VkCodecUtils/VkImageResource.h"
 #include "VkCodecUtils/VulkanDisplayFrame.h"
+#include "VkCodecUtils/VkVideoPictureHash.h"
 
 class VulkanDecodedFrame : public VulkanDisplayFrame {
 
 public:
-    VulkanDecodedFrame() : VulkanDisplayFrame() {}
+    VulkanDecodedFrame() : VulkanDisplayFrame(), decodedPictureHash() {}
+
+    VkVideoDecodedPictureHash decodedPictureHash; // Hash of the decoded samples carried by the stream, if any
 };
 
 #endif /* _VKCODECUTILS_VULKANDECODEDFRAME_H_ */
@@ -0,0 +1,142 @@
+/*
+* Copyright 2024 NVIDIA Corporation.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#ifndef _VULKANRINGALLOCATOR_H_
+#define _VULKANRINGALLOCATOR_H_
+
+#include <assert.h>
+#include <stdint.h>
+#include <deque>
+#include <vulkan_interfaces.h>
+
+// Sub-allocates ranges of a fixed size ring in FIFO order.
+//
+// Each allocation gets an ID, increasing by one per allocation. Allocations can be freed in any
+// order, but their space is only reclaimed once all the older allocations are freed as well, which
+// matches resources retired by a queue in submission order. The ring only keeps the bookkeeping:
+// the memory itself belongs to the caller, and a single thread must own the allocator.
+class VulkanRingAllocator {
+
+public:
+    VulkanRingAllocator(VkDeviceSize capacity = 0)
+    : m_capacity(capacity)
+    , m_head(0)
+    , m_firstAllocationId(0)
+    , m_allocations() { }
+
+    // Allocates size bytes at an offset aligned to alignment (a power of two).
+    // Returns false if the ring has no contiguous space left for them.
+    bool Allocate(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& offset, uint64_t& allocationId)
+    {
+        assert((alignment != 0) && ((alignment & (alignment - 1)) == 0));
+        if ((size == 0) || (size > m_capacity)) {
+            return false;
+        }
+
+        Allocation allocation = { m_head, 0, 0, false };
+        if (m_allocations.empty()) {
+            allocation.begin = m_head = 0;
+            allocation.offset = 0;
+        } else {
+            const VkDeviceSize tail = m_allocations.front().begin;
+            const VkDeviceSize alignedHead = AlignUp(m_head, alignment);
+            // The free space must stay non-empty, head == tail means an empty ring
+            if ((m_head >= tail) && (alignedHead + size <= m_capacity)) {
+                allocation.offset = alignedHead;
+            } else if ((m_head >= tail) && (size < tail)) {
+                // Wrap around, the end of the ring is padding owned by this allocation
+                allocation.offset = 0;
+            } else if ((m_head < tail) && (alignedHead + size < tail)) {
+                allocation.offset = alignedHead;
+            } else {
+                return false;
+            }
+        }
+        allocation.end = allocation.offset + size;
+
+        m_allocations.push_back(allocation);
+        m_head = allocation.end;
+
+        offset = allocation.offset;
+        allocationId = m_firstAllocationId + m_allocations.size() - 1;
+        return true;
+    }
+
+    // Returns the end of the most recent allocation to the ring, it can't grow.
+    bool Shrink(uint64_t allocationId, VkDeviceSize newSize)
+    {
+        if (m_allocations.empty() || (allocationId != (m_firstAllocationId + m_allocations.size() - 1))) {
+            return false;
+        }
+        Allocation& allocation = m_allocations.back();
+        if ((newSize == 0) || (allocation.offset + newSize > allocation.end)) {
+            return false;
+        }
+        allocation.end = allocation.offset + newSize;
+        m_head = allocation.end;
+        return true;
+    }
+
+    void Free(uint64_t allocationId)
+    {
+        assert(allocationId >= m_firstAllocationId);
+        assert(allocationId < (m_firstAllocationId + m_allocations.size()));
+        m_allocations[(size_t)(allocationId - m_firstAllocationId)].freed = true;
+
+        while (!m_allocations.empty() && m_allocations.front().freed) {
+            m_allocations.pop_front();
+            m_firstAllocationId++;
+        }
+        if (m_allocations.empty()) {
+            m_head = 0;
+        }
+    }
+
+    VkDeviceSize GetCapacity() const { return m_capacity; }
+
+    // Bytes not available for new allocations, including alignment and wrap-around padding
+    VkDeviceSize GetUsedSize() const
+    {
+        if (m_allocations.empty()) {
+            return 0;
+        }
+        const VkDeviceSize tail = m_allocations.front().begin;
+        return (m_head >= tail) ? (m_head - tail) : (m_capacity - tail + m_head);
+    }
+
+    uint32_t GetNumAllocations() const { return (uint32_t)m_allocations.size(); }
+
+private:
+    struct Allocation {
+        VkDeviceSize begin;     // End of the previous allocation, where the padding of this one starts
+        VkDeviceSize offset;
+        VkDeviceSize end;
+        bool         freed;
+    };
+
+    static VkDeviceSize AlignUp(VkDeviceSize value, VkDeviceSize alignment)
+    {
+        return (value + (alignment - 1)) & ~(alignment - 1);
+    }
+
+private:
+    VkDeviceSize               m_capacity;
+    VkDeviceSize               m_head;
+    uint64_t                   m_firstAllocationId;
+    std::deque<Allocation>     m_allocations;
+};
+
+#endif // _VULKANRINGALLOCATOR_H_
@@ -0,0 +1,218 @@
+/*
+* Copyright 2024 NVIDIA Corporation.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#ifndef _VULKANSIZECLASSEDBUFFERPOOL_H_
+#define _VULKANSIZECLASSEDBUFFERPOOL_H_
+
+#include <stdint.h>
+#include <vector>
+#include <algorithm>
+#include <mutex>
+#include "VkCodecUtils/VkVideoRefCountBase.h"
+#include <vulkan_interfaces.h>
+
+// A pool of reference counted buffers in power-of-two size classes.
+//
+// A request is served by an idle buffer of the smallest size class that holds it, so growing
+// a buffer reuses a larger pooled one instead of allocating new memory. A pooled buffer is idle
+// when the pool holds its only reference. The pool does not allocate by itself: GetBuffer() and
+// Reserve() take an allocate(size, buffer) callable returning a VkResult, which keeps the pooling
+// logic independent of the Vulkan device.
+//
+// Every trimInterval requests, each size class releases the idle buffers above the number of
+// buffers it had in use at its high-water mark since the previous trim.
+template <class BufferType>
+class VulkanSizeClassedBufferPool {
+
+public:
+    enum { MIN_SIZE_CLASS_LOG2 = 16 };      // 64 KB smallest size class
+    enum { NUM_SIZE_CLASSES = 16 };         // 2 GB largest size class
+    enum { DEFAULT_TRIM_INTERVAL = 256 };
+
+    struct SizeClassStats {
+        uint64_t allocations;               // Buffers created by the allocator
+        uint64_t reuses;                    // Requests served by an idle pooled buffer
+        uint64_t releases;                  // Idle buffers released by trimming
+        uint32_t numBuffers;                // Buffers currently held by the pool
+        uint32_t inUseHighWaterMark;        // Most buffers in use at once since the last trim
+    };
+
+    VulkanSizeClassedBufferPool(uint32_t maxBuffersPerClass = 32,
+                                uint32_t trimInterval = DEFAULT_TRIM_INTERVAL)
+    : m_poolMutex()
+    , m_maxBuffersPerClass(maxBuffersPerClass)
+    , m_trimInterval(trimInterval)
+    , m_requestsSinceTrim(0)
+    , m_sizeClasses(NUM_SIZE_CLASSES) { }
+
+    static uint32_t GetSizeClass(VkDeviceSize size)
+    {
+        uint32_t sizeClass = 0;
+        while ((sizeClass < (NUM_SIZE_CLASSES - 1)) && (GetSizeClassSize(sizeClass) < size)) {
+            sizeClass++;
+        }
+        return sizeClass;
+    }
+
+    static VkDeviceSize GetSizeClassSize(uint32_t sizeClass)
+    {
+        return (VkDeviceSize)1 << (MIN_SIZE_CLASS_LOG2 + sizeClass);
+    }
+
+    // Returns an idle buffer of at least size bytes, allocating one if the size class has none.
+    // Requests larger than the largest size class are allocated to size and not pooled.
+    template <class AllocateFunc>
+    VkResult GetBuffer(VkDeviceSize size, VkSharedBaseObj<BufferType>& buffer, AllocateFunc allocate)
+    {
+        std::lock_guard<std::mutex> lock(m_poolMutex);
+
+        const uint32_t sizeClass = GetSizeClass(size);
+        if (size > GetSizeClassSize(sizeClass)) {
+            return allocate(size, buffer);
+        }
+
+        SizeClass& pool = m_sizeClasses[sizeClass];
+        VkResult result = VK_SUCCESS;
+        int32_t idleBuffer = FindIdleBuffer(pool);
+        if (idleBuffer >= 0) {
+            buffer = pool.buffers[idleBuffer];
+            pool.stats.reuses++;
+        } else {
+            result = allocate(GetSizeClassSize(sizeClass), buffer);
+            if (result != VK_SUCCESS) {
+                return result;
+            }
+            pool.stats.allocations++;
+            if (pool.buffers.size() < m_maxBuffersPerClass) {
+                pool.buffers.push_back(buffer);
+                pool.stats.numBuffers = (uint32_t)pool.buffers.size();
+            }
+        }
+
+        pool.stats.inUseHighWaterMark = std::max(pool.stats.inUseHighWaterMark, GetNumBuffersInUse(pool));
+
+        if ((m_trimInterval > 0) && (++m_requestsSinceTrim >= m_trimInterval)) {
+            TrimLocked();
+        }
+        return result;
+    }
+
+    // Makes sure that the size class of size holds at least numBuffers buffers.
+    template <class AllocateFunc>
+    VkResult Reserve(VkDeviceSize size, uint32_t numBuffers, AllocateFunc allocate)
+    {
+        std::lock_guard<std::mutex> lock(m_poolMutex);
+
+        const uint32_t sizeClass = GetSizeClass(size);
+        SizeClass& pool = m_sizeClasses[sizeClass];
+        numBuffers = std::min(numBuffers, m_maxBuffersPerClass);
+        while (pool.buffers.size() < numBuffers) {
+            VkSharedBaseObj<BufferType> buffer;
+            VkResult result = allocate(GetSizeClassSize(sizeClass), buffer);
+            if (result != VK_SUCCESS) {
+                return result;
+            }
+            pool.stats.allocations++;
+            pool.buffers.push_back(buffer);
+        }
+        pool.stats.numBuffers = (uint32_t)pool.buffers.size();
+        // Reserved buffers count as used, so that the next trim keeps them
+        pool.stats.inUseHighWaterMark = std::max(pool.stats.inUseHighWaterMark, numBuffers);
+        return VK_SUCCESS;
+    }
+
+    uint32_t Trim()
+    {
+        std::lock_guard<std::mutex> lock(m_poolMutex);
+        return TrimLocked();
+    }
+
+    uint32_t GetNumIdleBuffers()
+    {
+        std::lock_guard<std::mutex> lock(m_poolMutex);
+
+        uint32_t numIdleBuffers = 0;
+        for (const SizeClass& pool : m_sizeClasses) {
+            numIdleBuffers += (uint32_t)pool.buffers.size() - GetNumBuffersInUse(pool);
+        }
+        return numIdleBuffers;
+    }
+
+    SizeClassStats GetStats(uint32_t sizeClass)
+    {
+        std::lock_guard<std::mutex> lock(m_poolMutex);
+
+        assert(sizeClass < NUM_SIZE_CLASSES);
+        return m_sizeClasses[sizeClass].stats;
+    }
+
+private:
+    struct SizeClass {
+        std::vector<VkSharedBaseObj<BufferType>> buffers;
+        SizeClassStats                           stats;
+
+        SizeClass() : buffers(), stats() {}
+    };
+
+    // These functions must be called with the m_poolMutex lock obtained
+    static int32_t FindIdleBuffer(const SizeClass& pool)
+    {
+        for (size_t i = 0; i < pool.buffers.size(); i++) {
+            if (pool.buffers[i]->GetRefCount() == 1) {
+                return (int32_t)i;
+            }
+        }
+        return -1;
+    }
+
+    static uint32_t GetNumBuffersInUse(const SizeClass& pool)
+    {
+        uint32_t numBuffersInUse = 0;
+        for (const VkSharedBaseObj<BufferType>& buffer : pool.buffers) {
+            if (buffer->GetRefCount() > 1) {
+                numBuffersInUse++;
+            }
+        }
+        return numBuffersInUse;
+    }
+
+    uint32_t TrimLocked()
+    {
+        uint32_t numReleased = 0;
+        for (SizeClass& pool : m_sizeClasses) {
+            for (size_t i = pool.buffers.size(); (i > 0) && (pool.buffers.size() > pool.stats.inUseHighWaterMark); i--) {
+                if (pool.buffers[i - 1]->GetRefCount() == 1) {
+                    pool.buffers.erase(pool.buffers.begin() + (i - 1));
+                    pool.stats.releases++;
+                    numReleased++;
+                }
+            }
+            pool.stats.numBuffers = (uint32_t)pool.buffers.size();
+            pool.stats.inUseHighWaterMark = GetNumBuffersInUse(pool);
+        }
+        m_requestsSinceTrim = 0;
+        return numReleased;
+    }
+
+private:
+    std::mutex                 m_poolMutex;
+    uint32_t                   m_maxBuffersPerClass;
+    uint32_t                   m_trimInterval;
+    uint32_t                   m_requestsSinceTrim;
+    std::vector<SizeClass>     m_sizeClasses;
+};
+
+#endif // _VULKANSIZECLASSEDBUFFERPOOL_H_
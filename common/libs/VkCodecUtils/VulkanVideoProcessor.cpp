@@ -23,6 +23,8 @@
 #include <string.h>
 #include <string>
 #include <vector>
+#include <thread>
+#include <algorithm>
 #include <fstream>
 #include <inttypes.h>
 
@@ -52,6 +54,7 @@ int32_t VulkanVideoProcessor::Initialize(const VulkanDeviceContext* vkDevCtx,
     const int32_t numDecodeImagesInFlight = std::max(programConfig.numDecodeImagesInFlight, 4);
     const int32_t numDecodeImagesToPreallocate = programConfig.numDecodeImagesToPreallocate;
     const int32_t numBitstreamBuffersToPreallocate = std::max(programConfig.numBitstreamBuffersToPreallocate, 4);
+    const VkDeviceSize bitstreamBufferRingSize = (VkDeviceSize)programConfig.bitstreamRingSizeMB * 1024 * 1024;
     const bool enableHwLoadBalancing = programConfig.enableHwLoadBalancing;
     const bool enablePostProcessFilter = (programConfig.enablePostProcessFilter >= 0);
     const bool enableDisplayPresent = (programConfig.noPresent == false);
@@ -75,8 +78,20 @@ int32_t VulkanVideoProcessor::Initialize(const VulkanDeviceContext* vkDevCtx,
     assert(videoStreamDemuxer);
     m_videoStreamDemuxer = videoStreamDemuxer;
 
+    if ((programConfig.numPreparseThreads > 0) || !programConfig.streamIndexFileName.empty()) {
+        const uint32_t numPreparseThreads = (programConfig.numPreparseThreads > 0) ?
+                                                (uint32_t)programConfig.numPreparseThreads :
+                                                std::max(std::thread::hardware_concurrency(), 1U);
+        const char* pIndexFileName = programConfig.streamIndexFileName.empty() ?
+                                         nullptr : programConfig.streamIndexFileName.c_str();
+        if (!m_videoStreamDemuxer->PreparseAccessUnits(numPreparseThreads, pIndexFileName) && verbose) {
+            std::cout << "Access unit pre-parsing is not available for this stream" << std::endl;
+        }
+    }
+
     m_usesStreamDemuxer = m_videoStreamDemuxer->IsStreamDemuxerEnabled();
     m_usesFramePreparser = m_videoStreamDemuxer->HasFramePreparser();
+    m_demuxesAccessUnits = m_videoStreamDemuxer->DemuxesAccessUnits();
 
     if (verbose) {
         m_videoStreamDemuxer->DumpStreamParameters();
@@ -115,6 +130,7 @@ int32_t VulkanVideoProcessor::Initialize(const VulkanDeviceContext* vkDevCtx,
                                     numDecodeImagesInFlight,
                                     numDecodeImagesToPreallocate,
                                     numBitstreamBuffersToPreallocate,
+                                    bitstreamBufferRingSize,
                                     m_vkVideoDecoder);
     assert(result == VK_SUCCESS);
     if (result != VK_SUCCESS) {
@@ -164,6 +180,13 @@ int32_t VulkanVideoProcessor::Initialize(const VulkanDeviceContext* vkDevCtx,
     m_startFrame = startFrame;
     m_maxFrameCount = maxFrameCount;
 
+    // The frames parsed ahead hold decode images on top of the DPB: leave at least half of the images in flight
+    // to the frames the consumer holds.
+    m_parserLookahead = std::min((uint32_t)programConfig.parserLookahead, (uint32_t)numDecodeImagesInFlight / 2);
+    if (m_parserLookahead > 0) {
+        m_readyFrames.SetMaxPendingQueueNodes(m_parserLookahead);
+    }
+
     return 0;
 }
 
@@ -247,12 +270,21 @@ bool VulkanVideoProcessor::StreamHasEnded() const
 }
 bool VulkanVideoProcessor::Seek(int stream_index, int64_t timestamp, int flags)
 {
+	StopParserThread();
 	m_videoStreamsCompleted = false;
-	return m_videoStreamDemuxer ? m_videoStreamDemuxer->Seek(stream_index, timestamp, flags) : false;
+	if (!m_videoStreamDemuxer || !m_videoStreamDemuxer->Seek(stream_index, timestamp, flags)) {
+		return false;
+	}
+	// The demuxer may have built its access unit index to seek.
+	m_usesFramePreparser = m_videoStreamDemuxer->HasFramePreparser();
+	m_demuxesAccessUnits = m_videoStreamDemuxer->DemuxesAccessUnits();
+	m_pendingDiscontinuity = true;
+	return true;
 }
 
 void VulkanVideoProcessor::Deinit()
 {
+    StopParserThread();
     m_vkParser = nullptr;
     m_vkVideoFrameBuffer = nullptr;
     m_vkVideoDecoder = nullptr;
@@ -518,6 +550,41 @@ size_t VulkanVideoProcessor::OutputFrameToFile(VulkanDecodedFrame* pFrame)
     return m_frameToFile->OutputFrame(pFrame, m_vkDevCtx);
 }
 
+int32_t VulkanVideoProcessor::OpenStream(VkSharedBaseObj<VideoStreamDemuxer>& videoStreamDemuxer)
+{
+    if (!m_vkParser || !m_vkVideoDecoder || !m_videoStreamDemuxer || !videoStreamDemuxer ||
+        (videoStreamDemuxer->GetVideoCodec() != m_videoStreamDemuxer->GetVideoCodec())) {
+        return -1;
+    }
+
+    StopParserThread();
+
+    m_videoStreamDemuxer = videoStreamDemuxer;
+
+    if (m_settings.numPreparseThreads > 0) {
+        m_videoStreamDemuxer->PreparseAccessUnits((uint32_t)m_settings.numPreparseThreads, nullptr);
+    }
+
+    m_usesStreamDemuxer = m_videoStreamDemuxer->IsStreamDemuxerEnabled();
+    m_usesFramePreparser = m_videoStreamDemuxer->HasFramePreparser();
+    m_demuxesAccessUnits = m_videoStreamDemuxer->DemuxesAccessUnits();
+
+    const VkParserDecodeSkipPolicy decodeSkipPolicy = GetDecodeSkipPolicy();
+    VkResult result = m_vkParser->Reset(m_videoStreamDemuxer->GetNalLengthSize(), &decodeSkipPolicy);
+    if (result != VK_SUCCESS) {
+        fprintf(stderr, "\nERROR: Reset of the parser result: 0x%x\n", result);
+        return -1;
+    }
+
+    m_currentBitstreamOffset = 0;
+    m_videoFrameNum = 0;
+    m_videoStreamsCompleted = false;
+    m_pendingDiscontinuity = false;
+    m_loopCount = m_settings.loopCount;
+
+    return 0;
+}
+
 uint32_t VulkanVideoProcessor::Restart(int64_t& bitstreamOffset)
 {
     m_videoStreamDemuxer->Rewind();
@@ -554,8 +621,15 @@ int32_t VulkanVideoProcessor::ParserProcessNextDataChunk()
     size_t  bitstreamBytesConsumed = 0;
     const uint8_t* pBitstreamData = nullptr;
     bool requiresPartialParsing = false;
+    int64_t timestamp = 0;
+    // Complete access units let the parser close the picture without scanning for the next one.
+    uint32_t parserFlags = m_demuxesAccessUnits ? VK_PARSER_PKT_ENDOFPICTURE : 0;
+    if (m_pendingDiscontinuity.exchange(false)) {
+        parserFlags |= VK_PARSER_PKT_DISCONTINUITY;
+    }
     if (m_usesFramePreparser || m_usesStreamDemuxer) {
         bitstreamChunkSize = m_videoStreamDemuxer->DemuxFrame(&pBitstreamData);
+        timestamp = m_videoStreamDemuxer->GetFrameTimestamp();
         assert(bitstreamBytesConsumed <= (size_t)std::numeric_limits<int32_t>::max());
         retValue = (int32_t)bitstreamChunkSize;
     } else {
@@ -567,7 +641,8 @@ int32_t VulkanVideoProcessor::ParserProcessNextDataChunk()
         assert((uint64_t)bitstreamChunkSize < (uint64_t)std::numeric_limits<size_t>::max());
         VkResult parserStatus = ParseVideoStreamData(pBitstreamData, (size_t)bitstreamChunkSize,
                                                      &bitstreamBytesConsumed,
-                                                     requiresPartialParsing);
+                                                     requiresPartialParsing,
+                                                     parserFlags, timestamp);
         if (parserStatus != VK_SUCCESS) {
             m_videoStreamsCompleted = true;
             std::cerr << "Parser: end of Video Stream with status  " << parserStatus << std::endl;
@@ -580,25 +655,109 @@ int32_t VulkanVideoProcessor::ParserProcessNextDataChunk()
     } else {
         // Call the parser one last time with zero buffer to flush the display queue.
         ParseVideoStreamData(nullptr, 0, &bitstreamBytesConsumed, requiresPartialParsing);
-        m_videoStreamsCompleted = StreamCompleted();
+        if (m_parserLookahead > 0) {
+            // The parser thread only signals the end of the stream: the consumer, which counts the frames,
+            // completes or restarts it once the frames parsed ahead are out.
+            m_videoStreamEnded = true;
+        } else {
+            m_videoStreamsCompleted = StreamCompleted();
+        }
         retValue = 0;
     }
 
     return retValue;
 }
 
-int32_t VulkanVideoProcessor::GetNextFrame(VulkanDecodedFrame* pFrame, bool* endOfStream)
+void VulkanVideoProcessor::ParserThread()
+{
+    while (!m_stopParserThread) {
+
+        VulkanDecodedFrame frame;
+        int32_t framesInQueue = m_vkVideoFrameBuffer->DequeueDecodedPicture(&frame);
+        if (framesInQueue == 0) {
+            if (m_videoStreamsCompleted || m_videoStreamEnded) {
+                break;
+            }
+            ParserProcessNextDataChunk();
+            continue;
+        }
+
+        // Blocks while parserLookahead frames are ready
+        if (!m_readyFrames.Push(frame)) {
+            // Stopped by the consumer
+            ReleaseFrame(&frame);
+            break;
+        }
+    }
+
+    // Let the consumer pop the frames left, then see the end of the stream
+    m_readyFrames.SetFlushAndExit();
+}
+
+int32_t VulkanVideoProcessor::DequeueParsedFrame(VulkanDecodedFrame* pFrame)
+{
+    while (!m_videoStreamsCompleted) {
+
+        if (!m_parserThread.joinable()) {
+            m_parserThread = std::thread(&VulkanVideoProcessor::ParserThread, this);
+        }
+
+        if (m_readyFrames.WaitAndPop(*pFrame)) {
+            return 1;
+        }
+
+        // The thread is done with the stream: loop it from here, where the frames are counted
+        m_parserThread.join();
+        m_readyFrames.Reset();
+        if (m_videoStreamEnded) {
+            m_videoStreamEnded = false;
+            m_videoStreamsCompleted = StreamCompleted();
+        }
+    }
+
+    // Frames the parser thread left in the frame buffer when stopped
+    return m_vkVideoFrameBuffer->DequeueDecodedPicture(pFrame);
+}
+
+void VulkanVideoProcessor::StopParserThread()
 {
-    // The below call to DequeueDecodedPicture allows returning the next frame without parsing of the stream.
-    // Parsing is only done when there are no more frames in the queue.
-    int32_t framesInQueue = m_vkVideoFrameBuffer->DequeueDecodedPicture(pFrame);
+    if (!m_parserThread.joinable()) {
+        return;
+    }
 
-    // Loop until a frame (or more) is parsed and added to the queue.
-    while ((framesInQueue == 0) && !m_videoStreamsCompleted) {
+    m_stopParserThread = true;
+    m_readyFrames.SetFlushAndExit();
+    m_parserThread.join();
+    m_stopParserThread = false;
+    // The caller repositions or completes the stream
+    m_videoStreamEnded = false;
 
-        ParserProcessNextDataChunk();
+    // Give the frames parsed ahead back to the frame buffer
+    VulkanDecodedFrame frame;
+    while (m_readyFrames.TryPop(frame)) {
+        ReleaseFrame(&frame);
+    }
+    m_readyFrames.Reset();
+}
 
+int32_t VulkanVideoProcessor::GetNextFrame(VulkanDecodedFrame* pFrame, bool* endOfStream)
+{
+    int32_t framesInQueue = 0;
+    if (m_parserLookahead > 0) {
+        // Waits for the parser thread, instead of parsing.
+        framesInQueue = DequeueParsedFrame(pFrame);
+    } else {
+        // The below call to DequeueDecodedPicture allows returning the next frame without parsing of the stream.
+        // Parsing is only done when there are no more frames in the queue.
         framesInQueue = m_vkVideoFrameBuffer->DequeueDecodedPicture(pFrame);
+
+        // Loop until a frame (or more) is parsed and added to the queue.
+        while ((framesInQueue == 0) && !m_videoStreamsCompleted) {
+
+            ParserProcessNextDataChunk();
+
+            framesInQueue = m_vkVideoFrameBuffer->DequeueDecodedPicture(pFrame);
+        }
     }
 
     if (framesInQueue) {
@@ -622,6 +781,7 @@ int32_t VulkanVideoProcessor::GetNextFrame(VulkanDecodedFrame* pFrame, bool* end
         std::cout << "Number of video frames " << m_videoFrameNum
                   << " of max frame number " << m_maxFrameCount << std::endl;
 #endif
+        StopParserThread();
         m_videoStreamsCompleted = StreamCompleted();
         *endOfStream = m_videoStreamsCompleted;
         return -1;
@@ -657,6 +817,26 @@ int32_t VulkanVideoProcessor::ReleaseFrame(VulkanDecodedFrame* pDisplayedFrame)
     return -1;
 }
 
+VkParserDecodeSkipPolicy VulkanVideoProcessor::GetDecodeSkipPolicy() const
+{
+    VkParserDecodeSkipPolicy decodeSkipPolicy = VkParserDecodeSkipPolicy();
+    if (m_settings.skipNonReference) {
+        decodeSkipPolicy.flags |= VK_PARSER_DECODE_SKIP_NON_REFERENCE;
+    }
+    if (m_settings.keyFramesOnly) {
+        decodeSkipPolicy.flags |= VK_PARSER_DECODE_SKIP_NON_KEY_FRAMES;
+    }
+    if (m_settings.resyncOnError) {
+        decodeSkipPolicy.flags |= VK_PARSER_DECODE_SKIP_TO_RANDOM_ACCESS_ON_ERROR;
+    }
+    if (m_settings.maxTemporalId >= 0) {
+        decodeSkipPolicy.flags |= VK_PARSER_DECODE_SKIP_ABOVE_MAX_TEMPORAL_ID;
+        decodeSkipPolicy.maxTemporalId = (uint32_t)m_settings.maxTemporalId;
+    }
+    decodeSkipPolicy.av1OperatingPoint = m_settings.av1OperatingPoint;
+    return decodeSkipPolicy;
+}
+
 VkResult VulkanVideoProcessor::CreateParser(const char*,
                                             VkVideoCodecOperationFlagBitsKHR vkCodecType,
                                             uint32_t defaultMinBufferSize,
@@ -682,6 +862,8 @@ VkResult VulkanVideoProcessor::CreateParser(const char*,
         return VK_ERROR_FORMAT_NOT_SUPPORTED;
     }
 
+    const VkParserDecodeSkipPolicy decodeSkipPolicy = GetDecodeSkipPolicy();
+
     VkSharedBaseObj<IVulkanVideoDecoderHandler> decoderHandler(m_vkVideoDecoder);
     VkSharedBaseObj<IVulkanVideoFrameBufferParserCb> videoFrameBufferCb(m_vkVideoFrameBuffer);
     return vulkanCreateVideoParser(decoderHandler,
@@ -694,7 +876,9 @@ VkResult VulkanVideoProcessor::CreateParser(const char*,
                                    bufferOffsetAlignment,
                                    bufferSizeAlignment,
                                    0, // clockRate - default 0 = 10Mhz
-                                   m_vkParser);
+                                   m_vkParser,
+                                   m_videoStreamDemuxer ? m_videoStreamDemuxer->GetNalLengthSize() : 0,
+                                   &decodeSkipPolicy);
 }
 
 VkResult VulkanVideoProcessor::ParseVideoStreamData(const uint8_t* pData, size_t size,
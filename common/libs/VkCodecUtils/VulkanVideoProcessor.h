@@ -17,10 +17,13 @@
 #ifndef _VULKANVIDEOPROCESSOR_H_
 #define _VULKANVIDEOPROCESSOR_H_
 
+#include <atomic>
+#include <thread>
 #include "DecoderConfig.h"
 #include "VkDecoderUtils/VideoStreamDemuxer.h"
 #include "VkVideoDecoder/VkVideoDecoder.h"
 #include "VkCodecUtils/VkVideoQueue.h"
+#include "VkCodecUtils/VkThreadSafeQueue.h"
 #include "VkVideoFrameOutput.h"
 
 // Forward declarations
@@ -57,6 +60,11 @@ public:
 
     void Deinit();
 
+    // Decodes another stream of the same codec with the current parser, decoder and frame buffer, once the
+    // frames of the current stream are out: the parser is reset, and the decoder keeps its video session and
+    // images if they are compatible with the new stream. Returns -1 if the stream needs Initialize() instead.
+    int32_t OpenStream(VkSharedBaseObj<VideoStreamDemuxer>& videoStreamDemuxer);
+
     virtual int32_t AddRef()
     {
         return ++m_refCount;
@@ -92,8 +100,15 @@ private:
         , m_currentBitstreamOffset(0)
         , m_videoFrameNum(0)
         , m_videoStreamsCompleted(false)
+        , m_pendingDiscontinuity(false)
         , m_usesStreamDemuxer(false)
         , m_usesFramePreparser(false)
+        , m_demuxesAccessUnits(false)
+        , m_parserLookahead(0)
+        , m_readyFrames()
+        , m_parserThread()
+        , m_stopParserThread(false)
+        , m_videoStreamEnded(false)
         , m_loopCount(1)
         , m_startFrame(0)
         , m_maxFrameCount(-1)
@@ -103,6 +118,8 @@ private:
 
     virtual ~VulkanVideoProcessor() { Deinit(); }
 
+    VkParserDecodeSkipPolicy GetDecodeSkipPolicy() const;
+
     VkResult CreateParser(const char* filename,
                           VkVideoCodecOperationFlagBitsKHR vkCodecType,
                           uint32_t defaultMinBufferSize,
@@ -116,6 +133,13 @@ private:
 
     bool StreamCompleted();
 
+    // With parserLookahead, the stream is demuxed, parsed and its decoding submitted by a thread of its own,
+    // started by GetNextFrame(), which pops the frames that thread dequeued from the frame buffer, up to
+    // parserLookahead of them ahead.
+    void ParserThread();
+    int32_t DequeueParsedFrame(VulkanDecodedFrame* pFrame);
+    void StopParserThread();
+
 private:
     std::atomic<int32_t>       m_refCount;
     const VulkanDeviceContext* m_vkDevCtx;
@@ -126,9 +150,17 @@ private:
     VkSharedBaseObj<VkVideoFrameOutput> m_frameToFile;
     int64_t  m_currentBitstreamOffset;
     uint32_t m_videoFrameNum;
-    uint32_t m_videoStreamsCompleted : 1;
+    // Written by the parser thread, with parserLookahead
+    std::atomic<bool> m_videoStreamsCompleted;
+    std::atomic<bool> m_pendingDiscontinuity;
     uint32_t m_usesStreamDemuxer : 1;
     uint32_t m_usesFramePreparser : 1;
+    uint32_t m_demuxesAccessUnits : 1;
+    uint32_t m_parserLookahead;
+    VkThreadSafeQueue<VulkanDecodedFrame> m_readyFrames;
+    std::thread m_parserThread;
+    std::atomic<bool> m_stopParserThread;
+    std::atomic<bool> m_videoStreamEnded; // Set by the parser thread at the end of the stream
     int32_t   m_loopCount;
     uint32_t  m_startFrame;
     int32_t   m_maxFrameCount;
@@ -15,10 +15,32 @@
 */
 
 #include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
 #include <inttypes.h>
+#include <atomic>
 
 #include "crcgenerator.h"
 
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define VK_VIDEO_CRC_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#elif defined(__ARM_FEATURE_CRC32)
+#define VK_VIDEO_CRC_ARM 1
+#include <arm_acle.h>
+#endif
+
+// The PCLMULQDQ kernel is built for its ISA whatever the target of the build, and only called if the CPU
+// supports it
+#if defined(VK_VIDEO_CRC_X86) && (defined(__GNUC__) || defined(__clang__))
+#define VK_VIDEO_CRC_TARGET(isa) __attribute__((target(isa)))
+#else
+#define VK_VIDEO_CRC_TARGET(isa)
+#endif
+
 unsigned long Crc32Table[256] = {
   // CRC32 lookup table
   // Generated by the following routine
@@ -97,9 +119,317 @@ unsigned long Crc32Table[256] = {
   0xb40bbe37,0xc30c8ea1,0x5a05df1b,0x2d02ef8d
 };
 
+// The CRC is updated without pre or post inversion, as the bytes of Crc32Table do: the register is the
+// remainder of the (reflected) message polynomial, multiplied by x^32, modulo the polynomial.
+typedef uint32_t (*Crc32UpdateFunc)(uint32_t crc, const uint8_t* pData, size_t length);
+
+namespace {
+
+struct Crc32Tables {
+    uint32_t slices[16][256];   // slices[k][i]: CRC of the byte i followed by k zero bytes
+    uint32_t x2n[32];           // x^(2^n) modulo the polynomial
+};
+
+} // namespace
+
+// a * b modulo the polynomial, in the reflected bit order of the CRC register (x^0 is the MSB)
+static uint32_t Crc32MultModP(uint32_t a, uint32_t b)
+{
+    uint32_t product = 0;
+    for (uint32_t m = 1u << 31; m != 0; m >>= 1) {
+        if (a & m) {
+            product ^= b;
+            if ((a & (m - 1)) == 0) {
+                break;
+            }
+        }
+        b = (b & 1) ? ((b >> 1) ^ 0xEDB88320) : (b >> 1);
+    }
+    return product;
+}
+
+static Crc32Tables InitCrc32Tables()
+{
+    Crc32Tables tables;
+    for (uint32_t i = 0; i < 256; i++) {
+        tables.slices[0][i] = (uint32_t)Crc32Table[i];
+    }
+    for (uint32_t k = 1; k < 16; k++) {
+        for (uint32_t i = 0; i < 256; i++) {
+            const uint32_t crc = tables.slices[k - 1][i];
+            tables.slices[k][i] = (crc >> 8) ^ tables.slices[0][crc & 0xff];
+        }
+    }
+    uint32_t x2n = 1u << 30; // x^1
+    for (uint32_t n = 0; n < 32; n++) {
+        tables.x2n[n] = x2n;
+        x2n = Crc32MultModP(x2n, x2n);
+    }
+    return tables;
+}
+
+static const Crc32Tables& GetCrc32Tables()
+{
+    static const Crc32Tables tables = InitCrc32Tables();
+    return tables;
+}
+
+// x^(8 * length) modulo the polynomial: the operator that appends length zero bytes to a CRC register
+static uint32_t Crc32ZeroBytesOperator(uint64_t length)
+{
+    const Crc32Tables& tables = GetCrc32Tables();
+    uint32_t op = 1u << 31; // x^0
+    for (uint32_t n = 3; length != 0; length >>= 1, n++) {
+        if (length & 1) {
+            op = Crc32MultModP(tables.x2n[n & 31], op);
+        }
+    }
+    return op;
+}
+
+static inline uint32_t LoadLe32(const uint8_t* p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+// Portable path: slicing-by-16, 16 table lookups for 16 bytes
+static uint32_t Crc32UpdateSlicing16(uint32_t crc, const uint8_t* pData, size_t length)
+{
+    const uint32_t (*slices)[256] = GetCrc32Tables().slices;
+    for (; length >= 16; length -= 16, pData += 16) {
+        const uint32_t word0 = LoadLe32(pData) ^ crc;
+        const uint32_t word1 = LoadLe32(pData + 4);
+        const uint32_t word2 = LoadLe32(pData + 8);
+        const uint32_t word3 = LoadLe32(pData + 12);
+        crc = slices[15][word0 & 0xff] ^ slices[14][(word0 >> 8) & 0xff] ^
+              slices[13][(word0 >> 16) & 0xff] ^ slices[12][word0 >> 24] ^
+              slices[11][word1 & 0xff] ^ slices[10][(word1 >> 8) & 0xff] ^
+              slices[9][(word1 >> 16) & 0xff] ^ slices[8][word1 >> 24] ^
+              slices[7][word2 & 0xff] ^ slices[6][(word2 >> 8) & 0xff] ^
+              slices[5][(word2 >> 16) & 0xff] ^ slices[4][word2 >> 24] ^
+              slices[3][word3 & 0xff] ^ slices[2][(word3 >> 8) & 0xff] ^
+              slices[1][(word3 >> 16) & 0xff] ^ slices[0][word3 >> 24];
+    }
+    for (; length > 0; length--, pData++) {
+        crc = slices[0][(crc ^ *pData) & 0xff] ^ (crc >> 8);
+    }
+    return crc;
+}
+
+#if defined(VK_VIDEO_CRC_X86)
+// Folds 64 bytes per iteration into 4 128-bit accumulators with carry-less multiplies, then reduces them
+// with a Barrett reduction (Intel, "Fast CRC Computation for Generic Polynomials Using PCLMULQDQ"). The
+// length must be a multiple of 16, and at least 64.
+VK_VIDEO_CRC_TARGET("pclmul,sse2")
+static uint32_t Crc32FoldPclmul(uint32_t crc, const uint8_t* pData, size_t length)
+{
+    const __m128i k1k2 = _mm_set_epi64x(0x01c6e41596, 0x0154442bd4);
+    const __m128i k3k4 = _mm_set_epi64x(0x00ccaa009e, 0x01751997d0);
+    const __m128i k5k0 = _mm_set_epi64x(0, 0x0163cd6124);
+    const __m128i poly = _mm_set_epi64x(0x01f7011641, 0x01db710641);
+
+    __m128i x1 = _mm_loadu_si128((const __m128i*)(pData + 0x00));
+    __m128i x2 = _mm_loadu_si128((const __m128i*)(pData + 0x10));
+    __m128i x3 = _mm_loadu_si128((const __m128i*)(pData + 0x20));
+    __m128i x4 = _mm_loadu_si128((const __m128i*)(pData + 0x30));
+    x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128((int)crc));
+    pData += 64;
+    length -= 64;
+
+    for (; length >= 64; length -= 64, pData += 64) {
+        const __m128i x5 = _mm_clmulepi64_si128(x1, k1k2, 0x00);
+        const __m128i x6 = _mm_clmulepi64_si128(x2, k1k2, 0x00);
+        const __m128i x7 = _mm_clmulepi64_si128(x3, k1k2, 0x00);
+        const __m128i x8 = _mm_clmulepi64_si128(x4, k1k2, 0x00);
+        x1 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x1, k1k2, 0x11), x5),
+                           _mm_loadu_si128((const __m128i*)(pData + 0x00)));
+        x2 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x2, k1k2, 0x11), x6),
+                           _mm_loadu_si128((const __m128i*)(pData + 0x10)));
+        x3 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x3, k1k2, 0x11), x7),
+                           _mm_loadu_si128((const __m128i*)(pData + 0x20)));
+        x4 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x4, k1k2, 0x11), x8),
+                           _mm_loadu_si128((const __m128i*)(pData + 0x30)));
+    }
+
+    // Fold the 4 accumulators into 1
+    __m128i x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+    x1 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x1, k3k4, 0x11), x2), x5);
+    x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+    x1 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x1, k3k4, 0x11), x3), x5);
+    x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+    x1 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x1, k3k4, 0x11), x4), x5);
+
+    // Then the remaining 16-byte blocks
+    for (; length >= 16; length -= 16, pData += 16) {
+        x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+        x1 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x1, k3k4, 0x11),
+                                         _mm_loadu_si128((const __m128i*)pData)), x5);
+    }
+
+    // Fold 128 to 64 bits
+    const __m128i mask32 = _mm_setr_epi32(~0, 0, ~0, 0);
+    x2 = _mm_clmulepi64_si128(x1, k3k4, 0x10);
+    x1 = _mm_xor_si128(_mm_srli_si128(x1, 8), x2);
+    x2 = _mm_srli_si128(x1, 4);
+    x1 = _mm_and_si128(x1, mask32);
+    x1 = _mm_clmulepi64_si128(x1, k5k0, 0x00);
+    x1 = _mm_xor_si128(x1, x2);
+
+    // Barrett reduction to 32 bits
+    x2 = _mm_and_si128(x1, mask32);
+    x2 = _mm_clmulepi64_si128(x2, poly, 0x10);
+    x2 = _mm_and_si128(x2, mask32);
+    x2 = _mm_clmulepi64_si128(x2, poly, 0x00);
+    x1 = _mm_xor_si128(x1, x2);
+
+    return (uint32_t)_mm_cvtsi128_si32(_mm_srli_si128(x1, 4));
+}
+
+static uint32_t Crc32UpdatePclmul(uint32_t crc, const uint8_t* pData, size_t length)
+{
+    if (length >= 64) {
+        const size_t foldLength = length & ~(size_t)15;
+        crc = Crc32FoldPclmul(crc, pData, foldLength);
+        pData += foldLength;
+        length -= foldLength;
+    }
+    return Crc32UpdateSlicing16(crc, pData, length);
+}
+
+static bool CpuSupportsPclmul()
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_cpu_supports("pclmul") && __builtin_cpu_supports("sse2");
+#elif defined(_MSC_VER)
+    int cpuInfo[4];
+    __cpuid(cpuInfo, 1);
+    return ((cpuInfo[2] & (1 << 1)) != 0) && ((cpuInfo[3] & (1 << 26)) != 0);
+#else
+    return false;
+#endif
+}
+#endif
+
+#if defined(VK_VIDEO_CRC_ARM)
+// The CRC32 instructions of ARMv8 use the same polynomial and register, 8 bytes per instruction
+static uint32_t Crc32UpdateArm(uint32_t crc, const uint8_t* pData, size_t length)
+{
+    for (; length >= 8; length -= 8, pData += 8) {
+        uint64_t word;
+        memcpy(&word, pData, sizeof(word));
+        crc = __crc32d(crc, word);
+    }
+    for (; length > 0; length--, pData++) {
+        crc = __crc32b(crc, *pData);
+    }
+    return crc;
+}
+#endif
+
+struct Crc32UpdateIsa {
+    const char*     pName;
+    Crc32UpdateFunc update;
+};
+
+// The update paths the CPU supports, the preferred one first
+static size_t GetCrc32UpdateIsas(Crc32UpdateIsa isas[3])
+{
+    size_t numIsas = 0;
+#if defined(VK_VIDEO_CRC_X86)
+    if (CpuSupportsPclmul()) {
+        isas[numIsas++] = { "pclmul", Crc32UpdatePclmul };
+    }
+#elif defined(VK_VIDEO_CRC_ARM)
+    isas[numIsas++] = { "crc32", Crc32UpdateArm };
+#endif
+    isas[numIsas++] = { "c", Crc32UpdateSlicing16 };
+    return numIsas;
+}
+
+static std::atomic<const Crc32UpdateIsa*> g_crc32UpdateIsa(nullptr);
+
+static const Crc32UpdateIsa* FindCrc32UpdateIsa(const char* pIsaName)
+{
+    static Crc32UpdateIsa isas[3];
+    static const size_t numIsas = GetCrc32UpdateIsas(isas);
+    if (pIsaName == nullptr) {
+        return &isas[0];
+    }
+    for (size_t i = 0; i < numIsas; i++) {
+        if (strcmp(isas[i].pName, pIsaName) == 0) {
+            return &isas[i];
+        }
+    }
+    return nullptr;
+}
+
+// Selected at the first CRC of the process. The VK_VIDEO_CRC_SIMD_ISA environment variable set to the name
+// of a path the CPU supports ("c" for the portable one, "pclmul" or "crc32") forces it.
+static const Crc32UpdateIsa* GetCrc32UpdateIsa()
+{
+    const Crc32UpdateIsa* pIsa = g_crc32UpdateIsa.load(std::memory_order_acquire);
+    if (pIsa == nullptr) {
+#if defined(_MSC_VER)
+#pragma warning(suppress : 4996)
+#endif
+        const char* pIsaName = getenv("VK_VIDEO_CRC_SIMD_ISA");
+        pIsa = (pIsaName != nullptr) ? FindCrc32UpdateIsa(pIsaName) : nullptr;
+        if (pIsa == nullptr) {
+            pIsa = FindCrc32UpdateIsa(nullptr);
+        }
+        const Crc32UpdateIsa* pExpected = nullptr;
+        if (!g_crc32UpdateIsa.compare_exchange_strong(pExpected, pIsa, std::memory_order_acq_rel)) {
+            pIsa = pExpected;
+        }
+    }
+    return pIsa;
+}
+
+static uint32_t Crc32Update(uint32_t crc, const uint8_t* pData, size_t length)
+{
+    return GetCrc32UpdateIsa()->update(crc, pData, length);
+}
+
+const char* getCRCIsa()
+{
+    return GetCrc32UpdateIsa()->pName;
+}
+
+bool setCRCIsa(const char* pIsaName)
+{
+    const Crc32UpdateIsa* pIsa = FindCrc32UpdateIsa(pIsaName);
+    if (pIsa == nullptr) {
+        return false;
+    }
+    g_crc32UpdateIsa.store(pIsa, std::memory_order_release);
+    return true;
+}
+
 void getCRC(uint32_t *checksum, const uint8_t *inputBytes, size_t length, unsigned long crcTable[])
 {
+    if (crcTable == Crc32Table) {
+        *checksum = Crc32Update(*checksum, inputBytes, length);
+        return;
+    }
     for (size_t i = 0; i < length; i += 1) {
         *checksum = crcTable[inputBytes[i] ^ (*checksum & 0xff)] ^ (*checksum >> 8);
     }
 }
+
+void getCRCs(uint32_t* checksums, size_t numChecksums, const uint8_t* inputBytes, size_t length)
+{
+    if (numChecksums == 0) {
+        return;
+    }
+    if (numChecksums == 1) {
+        checksums[0] = Crc32Update(checksums[0], inputBytes, length);
+        return;
+    }
+    // The CRC is linear: the CRC of the data from a start value is the CRC of the data from 0, xor the
+    // start value followed by length zero bytes. One pass over the data serves all the start values.
+    const uint32_t crcFromZero = Crc32Update(0, inputBytes, length);
+    const uint32_t zeroBytesOperator = Crc32ZeroBytesOperator(length);
+    for (size_t i = 0; i < numChecksums; i++) {
+        checksums[i] = Crc32MultModP(zeroBytesOperator, checksums[i]) ^ crcFromZero;
+    }
+}
@@ -20,6 +20,8 @@
 #include "VkCodecUtils/VkVideoRefCountBase.h"
 #include "VulkanVideoParserParams.h"
 
+struct VkParserMetadataRecord;
+
 class IVulkanVideoDecoderHandler : public VkVideoRefCountBase {
 public:
     virtual int32_t StartVideoSequence(VkParserDetectedVideoFormat* pVideoFormat) = 0;
@@ -36,6 +38,18 @@ public:
                                       VkDeviceSize initializeBufferMemorySize,
                                       VkSharedBaseObj<VulkanBitstreamBuffer>& bitstreamBuffer) = 0;
 
+    // Optional: a handler that returns true gets the SEI messages / AV1 metadata OBUs of each picture through
+    // PictureMetadata(), before the picture is sent to DecodePictureWithParameters().
+    virtual bool WantsPictureMetadata() const { return false; }
+
+    // Optional: a handler that returns true gets the time spent in the parsing stages in the parser statistics
+    virtual bool WantsParserStatisticsTiming() const { return false; }
+
+    // The records locate the payloads in bitstreamBuffer, which is the bitstream buffer of the picture:
+    // hold a reference to the buffer to read them later. pRecords is only valid during the call.
+    virtual void PictureMetadata(int32_t /*pictureIndex*/, const VkParserMetadataRecord* /*pRecords*/, uint32_t /*numRecords*/,
+                                 VkSharedBaseObj<VulkanBitstreamBuffer>& /*bitstreamBuffer*/) { }
+
     virtual ~IVulkanVideoDecoderHandler() { }
 };
 
@@ -52,6 +66,8 @@ public:
 };
 
 struct VkParserSourceDataPacket;
+struct VkParserDecodeSkipPolicy;
+struct VkParserStatistics;
 class IVulkanVideoParser : public VkVideoRefCountBase {
 public:
     static VkResult Create(
@@ -65,13 +81,25 @@ public:
         uint32_t bufferSizeAlignment,
         uint64_t clockRate,
         uint32_t errorThreshold,
-        VkSharedBaseObj<IVulkanVideoParser>& vulkanVideoParser);
+        VkSharedBaseObj<IVulkanVideoParser>& vulkanVideoParser,
+        uint32_t nalLengthSize = 0,
+        const VkParserDecodeSkipPolicy* pDecodeSkipPolicy = nullptr);
 
     // doPartialParsing 0: parse entire packet, 1: parse until next decode/display event
     virtual VkResult ParseVideoData(VkParserSourceDataPacket* pPacket,
                                     size_t* pParsedBytes,
                                     bool doPartialParsing = false) = 0;
 
+    // Polls the parser statistics, from any thread.
+    // Returns VK_ERROR_FEATURE_NOT_PRESENT if the parser is built with DISABLE_VK_VIDEO_PARSER_STATISTICS.
+    virtual VkResult GetParserStatistics(VkParserStatistics* pStats) const = 0;
+
+    // Restarts the parser for a new stream of the same codec, for the same decoder handler and frame buffer,
+    // as if it had just been created: this warm reset keeps the parser allocations (codec context, bitstream
+    // buffer), for the clients decoding many short streams. The pictures still pending in the parser are
+    // flushed first, as at the end of a stream.
+    virtual VkResult Reset(uint32_t nalLengthSize = 0, const VkParserDecodeSkipPolicy* pDecodeSkipPolicy = nullptr) = 0;
+
 protected:
     virtual ~IVulkanVideoParser() { }
 };
@@ -91,6 +119,8 @@ VkResult vulkanCreateVideoParser(
     uint32_t bufferOffsetAlignment,
     uint32_t bufferSizeAlignment,
     uint64_t clockRate,
-    VkSharedBaseObj<IVulkanVideoParser>& vulkanVideoParser);
+    VkSharedBaseObj<IVulkanVideoParser>& vulkanVideoParser,
+    uint32_t nalLengthSize = 0,
+    const VkParserDecodeSkipPolicy* pDecodeSkipPolicy = nullptr);
 
 #endif /* _VULKANVIDEOPARSER_H_ */
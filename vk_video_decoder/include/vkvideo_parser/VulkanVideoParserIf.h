@@ -23,6 +23,7 @@
 #include "VkCodecUtils/VkVideoRefCountBase.h"
 #include "vkvideo_parser/StdVideoPictureParametersSet.h"
 #include "VkCodecUtils/VulkanBitstreamBuffer.h"
+#include "VkCodecUtils/VkVideoPictureHash.h"
 
 static const uint32_t NV_VULKAN_VIDEO_PARSER_API_VERSION = VK_MAKE_VIDEO_STD_VERSION(0, 9, 9);
 
@@ -282,10 +283,10 @@ struct VkParserAv1PictureData {
 
     StdVideoAV1TileInfo tileInfo;
     // --- The following fields are referred to by pointer from tileInfo ---
-    uint16_t MiColStarts[64];
-    uint16_t MiRowStarts[64];
-    uint16_t width_in_sbs_minus_1[64];
-    uint16_t height_in_sbs_minus_1[64];
+    uint16_t MiColStarts[STD_VIDEO_AV1_MAX_TILE_COLS + 1];
+    uint16_t MiRowStarts[STD_VIDEO_AV1_MAX_TILE_ROWS + 1];
+    uint16_t width_in_sbs_minus_1[STD_VIDEO_AV1_MAX_TILE_COLS];
+    uint16_t height_in_sbs_minus_1[STD_VIDEO_AV1_MAX_TILE_ROWS];
     // --- End of tileInfo data ---
 
     StdVideoAV1Quantization quantization;
@@ -295,10 +296,10 @@ struct VkParserAv1PictureData {
     StdVideoAV1LoopRestoration loopRestoration;
     StdVideoAV1GlobalMotion globalMotion;
     StdVideoAV1FilmGrain filmGrain;
-    uint32_t tileOffsets[64];  // TODO: Hack until the interfaces get cleaned up (all the cached parameters should be ref-counted
-                               // etc, AV1_MAX_COLS*AV1_MAX_ROWS is larger than 64, switch to dynamic structure. Cheat while the CTS
-                               // uses simpler bitstreams)
-    uint32_t tileSizes[64];
+    // Tile table of the frame (khr_info.tileCount entries, up to TileCols * TileRows): owned by the parser,
+    // only valid during DecodePicture
+    uint32_t* tileOffsets;
+    uint32_t* tileSizes;
     // --- End of pKHR data ---
 
     const StdVideoPictureParametersSet* pStdSps;
@@ -354,6 +355,30 @@ typedef struct VkParserVp9PictureData {
     uint32_t tilesOffset;
 } VkParserVp9PictureData;
 
+// Well-known metadata payloads, recognized from the payload type (and the T.35 header for the captions)
+enum VkParserMetadataKind {
+    VK_PARSER_METADATA_KIND_OTHER = 0,
+    VK_PARSER_METADATA_KIND_CLOSED_CAPTIONS,        // ITU-T T.35 payload with the ATSC A/53 'GA94' identifier
+    VK_PARSER_METADATA_KIND_ITU_T_T35,              // Any other user_data_registered_itu_t_t35 / AV1 METADATA_TYPE_ITUT_T35
+    VK_PARSER_METADATA_KIND_USER_DATA_UNREGISTERED, // H.264/H.265 user_data_unregistered (UUID followed by the data)
+    VK_PARSER_METADATA_KIND_TIME_CODE,              // H.265 time_code, AV1 METADATA_TYPE_TIMECODE
+    VK_PARSER_METADATA_KIND_CONTENT_LIGHT_LEVEL,    // content_light_level_info, AV1 METADATA_TYPE_HDR_CLL
+    VK_PARSER_METADATA_KIND_MASTERING_DISPLAY,      // mastering_display_colour_volume, AV1 METADATA_TYPE_HDR_MDCV
+};
+
+// An SEI message (H.264/H.265) or a metadata OBU (AV1) of a picture. The payload is not copied: the record
+// locates it in the bitstream buffer of the picture (VkParserPictureData::bitstreamData).
+// The H.264/H.265 payloads are escaped: if emulationPrevention is set, the span contains emulation_prevention_three_bytes
+// that the client has to remove. The AV1 payloads follow metadata_type and end with the OBU trailing bits.
+typedef struct VkParserMetadataRecord {
+    uint32_t payloadType;               // SEI payloadType, or AV1 metadata_type
+    uint32_t kind;                      // VkParserMetadataKind
+    uint32_t offset;                    // Offset of the payload in the bitstream buffer
+    uint32_t size;                      // Size of the payload in the bitstream buffer
+    uint32_t suffix : 1;                // H.265 suffix SEI (follows the slices of the picture)
+    uint32_t emulationPrevention : 1;   // The span contains emulation_prevention_three_bytes
+} VkParserMetadataRecord;
+
 typedef struct VkParserPictureData {
     int32_t PicWidthInMbs;            // Coded Frame Size
     int32_t FrameHeightInMbs;         // Coded Frame Height
@@ -388,6 +413,11 @@ typedef struct VkParserPictureData {
     size_t bitstreamDataOffset;                            // bitstream data offset in bitstreamData buffer
     size_t bitstreamDataLen;                               // Number of bytes in bitstream data buffer
     VkSharedBaseObj<VulkanBitstreamBuffer> bitstreamData;  // bitstream data for this picture (slice-layer)
+    // Metadata of this picture, if the parser is initialized with pictureMetadata (only valid during DecodePicture)
+    const VkParserMetadataRecord* pMetadataRecords;
+    uint32_t numMetadataRecords;
+    // H.265: decoded picture hash SEI of this picture, nullptr if none (only valid during DecodePicture)
+    const VkVideoDecodedPictureHash* pDecodedPictureHash;
 } VkParserPictureData;
 
 // Packet input for parsing
@@ -492,6 +522,51 @@ class VkParserVideoDecodeClient {
     virtual ~VkParserVideoDecodeClient() {}
 };
 
+// Pictures that the parser drops before they are allocated a picture buffer or sent to the client
+enum {
+    // Pictures that no other picture references: H.264 nal_ref_idc == 0, H.265 sub-layer non-reference
+    // pictures of the highest decoded sub-layer, AV1 frames that refresh no reference slot
+    VK_PARSER_DECODE_SKIP_NON_REFERENCE = 0x01,
+    // All the pictures but the random access points: H.264 IDR, H.265 IRAP, AV1 key frames
+    VK_PARSER_DECODE_SKIP_NON_KEY_FRAMES = 0x02,
+    // Pictures with a temporal id above maxTemporalId (H.265 TemporalId, AV1 temporal_id)
+    VK_PARSER_DECODE_SKIP_ABOVE_MAX_TEMPORAL_ID = 0x04,
+    // After a stream error or a missing reference picture, all the pictures up to the next random access point:
+    // H.264 IDR, H.265 IRAP (a CRA being handled as a BLA), AV1 key frame, or the H.264/H.265 picture following a
+    // recovery point SEI. The damaged pictures are dropped instead of being decoded from stale references.
+    VK_PARSER_DECODE_SKIP_TO_RANDOM_ACCESS_ON_ERROR = 0x08,
+};
+
+typedef struct VkParserDecodeSkipPolicy {
+    uint32_t flags;             // VK_PARSER_DECODE_SKIP_XXX
+    uint32_t maxTemporalId;     // Highest temporal sub-layer to decode with VK_PARSER_DECODE_SKIP_ABOVE_MAX_TEMPORAL_ID
+    uint32_t av1OperatingPoint; // AV1 only: operating point to decode, the OBUs outside of it are dropped
+} VkParserDecodeSkipPolicy;
+
+// Parser statistics, accumulated since the parser was created (see IVulkanVideoParser::GetParserStatistics)
+enum { VK_PARSER_STATISTICS_MAX_UNIT_TYPES = 64 };
+
+typedef struct VkParserStatistics {
+    // Units parsed, per type: H.264/H.265 nal_unit_type, AV1 obu_type (VP9 frames are counted as type 0)
+    uint64_t unitCount[VK_PARSER_STATISTICS_MAX_UNIT_TYPES];
+    uint64_t unitBytes[VK_PARSER_STATISTICS_MAX_UNIT_TYPES];
+    uint64_t startCodeScanBytes;     // Annex-B data scanned for start codes
+    // The times are only measured if the parser is initialized with statisticsTiming, they stay 0 otherwise
+    uint64_t startCodeScanNs;        // Time spent scanning it (startCodeScanBytes / startCodeScanNs: scan speed)
+    uint64_t parseUnitNs;            // Time spent parsing the NAL units (ParseNalUnit) or the OBUs
+    uint64_t beginPictureNs;         // Time spent in BeginPicture
+    uint64_t endOfPictureNs;         // Time spent in end_of_picture, BeginPicture and the client DecodePicture included
+                                     // (VP9: the whole frame, header parsing included)
+    uint64_t bitstreamBufferResizes; // Bitstream buffers grown in the middle of a picture
+    uint64_t bitstreamSwapCopyBytes; // Data of a partial NAL unit copied to the next picture's bitstream buffer
+    uint64_t parameterSetUpdates;    // Parameter sets sent to the client (UpdatePictureParameters)
+    uint64_t dpbBumpingEvents;       // Pictures bumped out of the DPB for output (H.264/H.265)
+    uint64_t ptsQueueOverflows;      // Packet timestamps overwritten before being matched to a picture
+    uint64_t ptsDrops;               // Packet timestamps discarded at a discontinuity
+    uint64_t skippedPictures;        // Pictures dropped by the decode skip policy
+    uint64_t errorRecoveries;        // Skips to the next random access point (VK_PARSER_DECODE_SKIP_TO_RANDOM_ACCESS_ON_ERROR)
+} VkParserStatistics;
+
 // Initialization parameters for decoder class
 typedef struct VkParserInitDecodeParameters {
     uint32_t interfaceVersion;
@@ -508,6 +583,17 @@ typedef struct VkParserInitDecodeParameters {
 
     // If set, Picture Parameters are going to be provided via UpdatePictureParameters callback
     bool outOfBandPictureParameters;
+    // H.264/H.265 only: size of the big-endian length that precedes each NAL unit in the packets
+    // (avcC/hvcC lengthSizeMinusOne + 1), or 0 for Annex-B start codes
+    uint32_t nalLengthSize;
+    // Pictures to skip at parse time, to decode a subset of the stream (thumbnails, trick play)
+    VkParserDecodeSkipPolicy decodeSkipPolicy;
+    // If set, the SEI NAL units (H.264/H.265) are kept in the bitstream buffer of their picture and their messages,
+    // as well as the AV1 metadata OBUs, are described by VkParserPictureData::pMetadataRecords
+    bool pictureMetadata;
+    // If set, the parser statistics also time the parsing stages (VkParserStatistics::*Ns), which reads
+    // the clock twice per NAL unit and per start code scan
+    bool statisticsTiming;
 } VkParserInitDecodeParameters;
 
 // High-level interface to video decoder (Note that parsing and decoding
@@ -517,6 +603,8 @@ class VulkanVideoDecodeParser : public virtual VkVideoRefCountBase {
     virtual VkResult Initialize(const VkParserInitDecodeParameters* pParserPictureData) = 0;
     virtual bool ParseByteStream(const VkParserBitstreamPacket* pck, size_t* pParsedBytes = NULL) = 0;
     virtual bool GetDisplayMasteringInfo(VkParserDisplayMasteringInfo* pdisp) = 0;
+    // Safe to call from any thread; returns false if the parser is built without statistics
+    virtual bool GetStatistics(VkParserStatistics* pStats) const = 0;
 };
 
 /////////////////////////////////////////////////////////////////////////////////////////
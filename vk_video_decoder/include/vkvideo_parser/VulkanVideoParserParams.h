@@ -21,6 +21,7 @@
 #include <atomic>
 #include "vulkan_interfaces.h"
 #include "VkCodecUtils/VulkanBitstreamBuffer.h"
+#include "VkCodecUtils/VkVideoPictureHash.h"
 
 typedef int64_t VkVideotimestamp;
 
@@ -91,6 +92,7 @@ struct VkParserDecodePictureInfo {
     VkVideotimestamp timestamp; // decode time
     VkParserFrameSyncinfo frameSyncinfo;
     uint16_t viewId; // HEVC nuh_layer_id & from pictureInfoH264->ext.mvcext.view_id
+    VkVideoDecodedPictureHash decodedPictureHash; // Hash of the decoded samples carried by the stream, if any
 };
 
 struct VulkanVideoDisplayPictureInfo {
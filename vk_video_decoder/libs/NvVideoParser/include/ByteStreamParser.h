@@ -25,7 +25,18 @@ bool VulkanVideoDecoder::ParseByteStreamSimd(const VkParserBitstreamPacket* pck,
     // Handle discontinuity
     if (pck->bDiscontinuity)
     {
-        if (!m_bNoStartCodes)
+        if (m_nalLengthSize != 0)
+        {
+            // Only complete NAL units are buffered: decode the current picture (NOTE: may be truncated)
+            end_of_picture();
+            framesinpkt++;
+
+            m_bitstreamDataLen = swapBitstreamBuffer(0, 0);
+            m_nalu.start_offset = 0;
+            m_nalu.end_offset = 0;
+            m_bitstreamData.ResetStreamMarkers();
+        }
+        else if (!m_bNoStartCodes)
         {
             if (m_nalu.start_offset == 0)
                 m_llNaluStartLocation = m_llParsedBytes - m_nalu.end_offset;
@@ -48,12 +59,15 @@ bool VulkanVideoDecoder::ParseByteStreamSimd(const VkParserBitstreamPacket* pck,
         }
         // Reset the PTS queue to prevent timestamps from before the discontinuity to be associated with
         // a frame past the discontinuity
-        memset(&m_PTSQueue, 0, sizeof(m_PTSQueue));
+        discard_pts_queue();
         m_bDiscontinuityReported = true;
     }
     // Remember the packet PTS and its location in the byte stream
     if (pck->bPTSValid)
     {
+        if (m_PTSQueue[m_lPTSPos].bPTSValid) {
+            m_stats.AddPtsQueueOverflow();
+        }
         m_PTSQueue[m_lPTSPos].bPTSValid = true;
         m_PTSQueue[m_lPTSPos].llPTS = pck->llPTS;
         m_PTSQueue[m_lPTSPos].llPTSPos = m_llParsedBytes;
@@ -79,7 +93,10 @@ bool VulkanVideoDecoder::ParseByteStreamSimd(const VkParserBitstreamPacket* pck,
             m_llParsedBytes += curr_data_size;
             m_bitstreamData.ResetStreamMarkers();
             init_dbits();
-            if (ParseNalUnit() == NALU_SLICE)
+            const uint64_t parseStartTime = m_stats.Now();
+            const int32_t nal_type = ParseNalUnit();
+            m_stats.AddParseUnitTime(parseStartTime);
+            if (nal_type == NALU_SLICE)
             {
                 m_llFrameStartLocation = m_llNaluStartLocation;
                 m_bitstreamData.AddStreamMarker(0);
@@ -107,6 +124,17 @@ bool VulkanVideoDecoder::ParseByteStreamSimd(const VkParserBitstreamPacket* pck,
 
         return (m_eError == NV_NO_ERROR ? true : false);
     }
+    // NAL units preceded by their length (MP4/MKV samples) are delimited without scanning the data
+    if (m_nalLengthSize != 0)
+    {
+        return ParseLengthPrefixedNalUnits(pck, pdatain, curr_data_size, framesinpkt, pParsedBytes);
+    }
+    // Packet data of the start code prefix of the current NAL unit, if it is entirely within this packet
+    const uint8_t *pnalu = NULL;
+    // Start codes found ahead of pdatain by next_start_codes() (offsets relative to pscan)
+    const uint8_t *pscan = NULL;
+    uint32_t numStartCodes = 0, nextStartCode = 0;
+    bool scanAhead = true;
     // Parse start codes
     while (curr_data_size > 0) {
 
@@ -115,14 +143,75 @@ bool VulkanVideoDecoder::ParseByteStreamSimd(const VkParserBitstreamPacket* pck,
         // If bPartialParsing is set, we return immediately once we decoded or displayed a frame
         if ((pck->bPartialParsing) && (m_nCallbackEventCount != 0))
         {
+            if (pnalu != NULL)
+            {
+                // The data past the current start code may have been scanned already
+                m_BitBfr = 1;
+            }
             break;
         }
+        // Once a start code has been found in the packet, complete NAL units are parsed directly from the
+        // packet data: only the slices are copied to the bitstream buffer, without going through the swap.
+        if (pnalu != NULL)
+        {
+            if ((nextStartCode == numStartCodes) && scanAhead)
+            {
+                // Find all the start codes up to the end of the packet at once (or as many as the table holds)
+                pscan = pdatain;
+                const uint64_t scanStartTime = m_stats.Now();
+                const size_t scannedBytes = next_start_codes<T>(pdatain, (size_t)curr_data_size, m_startCodes, MAX_START_CODES_PER_SCAN, numStartCodes);
+                m_stats.AddStartCodeScan(scannedBytes, scanStartTime);
+                nextStartCode = 0;
+                scanAhead = (numStartCodes == MAX_START_CODES_PER_SCAN);
+            }
+            const bool found_start_code = (nextStartCode < numStartCodes);
+            if (found_start_code || pck->bEOP || pck->bEOS)
+            {
+                VkDeviceSize data_used = found_start_code ? (VkDeviceSize)((pscan + m_startCodes[nextStartCode++].offset) - pdatain)
+                                                          : curr_data_size;
+                m_nalu.end_offset += data_used;
+                m_llParsedBytes += data_used;
+                pdatain += data_used;
+                curr_data_size -= data_used;
+                if (found_start_code)
+                {
+                    if (m_nalu.start_offset == 0) {
+                        m_llNaluStartLocation = m_llParsedBytes - m_nalu.end_offset;
+                    }
+                    // Remove the trailing 00.00.01 from the NAL unit
+                    m_nalu.end_offset -= 3;
+                }
+                // Make room for the NAL unit and the start code prefix of the next one
+                if (((VkDeviceSize)(m_nalu.end_offset + 3) > m_bitstreamDataLen) &&
+                        !resizeBitstreamBuffer(m_nalu.end_offset + 3 - m_bitstreamDataLen)) {
+                    return false;
+                }
+                m_pInPlaceNaluData = pnalu + 3;
+                nal_unit();
+                m_pInPlaceNaluData = NULL;
+                if (m_bDecoderInitFailed)
+                {
+                    flush_deferred_copy();
+                    return false;
+                }
+                // Add back the start code prefix for the next NAL unit
+                m_bitstreamData.SetSliceStartCodeAtOffset(m_nalu.end_offset);
+                m_nalu.end_offset += 3;
+                pnalu = found_start_code ? (pdatain - 3) : NULL;
+                continue;
+            }
+            // The NAL unit continues in the next packet: rescan the remaining data below, so it gets copied
+            m_BitBfr = 1;
+            pnalu = NULL;
+        }
         if ((m_nalu.start_offset > 0) && ((m_nalu.end_offset - m_nalu.start_offset) < (int64_t)m_lMinBytesForBoundaryDetection))
         {
             buflen = std::min<VkDeviceSize>(buflen, (m_lMinBytesForBoundaryDetection - (m_nalu.end_offset - m_nalu.start_offset)));
         }
         bool found_start_code = false;
+        const uint64_t scanStartTime = m_stats.Now();
         VkDeviceSize start_offset = next_start_code<T>(pdatain, (size_t)buflen, found_start_code);
+        m_stats.AddStartCodeScan(found_start_code ? start_offset : buflen, scanStartTime);
         VkDeviceSize data_used = found_start_code ? start_offset : buflen;
         if (data_used > 0)
         {
@@ -143,7 +232,7 @@ bool VulkanVideoDecoder::ParseByteStreamSimd(const VkParserBitstreamPacket* pck,
             if ((m_nalu.start_offset > 0) && (m_nalu.end_offset == (m_nalu.start_offset + (int64_t)m_lMinBytesForBoundaryDetection)))
             {
                 init_dbits();
-                if (IsPictureBoundary(available_bits() >> 3)) {
+                if (IsPictureBoundary(available_bits() >> 3) && (m_bitstreamData.GetStreamMarkersCount() > 0)) {
                     // Decode only one frame if EOP is set and ignore remaining frames in current packet
                     if ((!pck->bEOP) || (pck->bEOP && (framesinpkt < 1)))
                     {
@@ -170,13 +259,17 @@ bool VulkanVideoDecoder::ParseByteStreamSimd(const VkParserBitstreamPacket* pck,
             nal_unit();
             if (m_bDecoderInitFailed)
             {
+                flush_deferred_copy();
                 return false;
             }
             // Add back the start code prefix for the next NAL unit
             m_bitstreamData.SetSliceStartCodeAtOffset(m_nalu.end_offset);
             m_nalu.end_offset += 3;
+            pnalu = (data_used >= 3) ? (pdatain - 3) : NULL;
         }
     }
+    // The packet data is only valid during this call
+    flush_deferred_copy();
     if (pParsedBytes)
     {
         assert(curr_data_size < std::numeric_limits<size_t>::max());
@@ -58,7 +58,7 @@
 #define MAX_TILE_WIDTH \
     (STD_VIDEO_AV1_MAX_TILE_COLS * STD_VIDEO_AV1_MAX_TILE_ROWS)  // maximum widht of a tile in units of luma samples
 #define MAX_TILE_AREA (MAX_TILE_WIDTH * 2304)                    // maximum area of a tile in units of luma samples
-#define MAX_TILES 512                                            // maximum number of tiles
+#define MAX_TILES (STD_VIDEO_AV1_MAX_TILE_COLS * STD_VIDEO_AV1_MAX_TILE_ROWS) // maximum number of tiles
 #define MIN_TILE_SIZE_BYTES 1
 
 // OBU types
@@ -332,6 +332,9 @@ class VulkanAV1Decoder : public VulkanVideoDecoder {
     int m_numOutFrames;
     VkPicIf* m_pOutFrame[MAX_NUM_SPATIAL_LAYERS];
     bool m_showableFrame[MAX_NUM_SPATIAL_LAYERS];
+    // Tile offsets followed by the tile sizes of the current frame, sized from its tile info. It only grows, so
+    // that the frames reuse the same allocation, and is filled in by the tile groups: it is never cleared.
+    std::vector<uint32_t> m_tileTable;
 
    public:
     VulkanAV1Decoder(VkVideoCodecOperationFlagBitsKHR std, bool annexB = false);
@@ -410,6 +413,7 @@ class VulkanAV1Decoder : public VulkanVideoDecoder {
     bool ReadObuHeader(const uint8_t* pData, uint32_t datasize, AV1ObuHeader* hdr);
 
     bool ParseObuTemporalDelimiter();
+    void ParseObuMetadata(const uint8_t* pPayload, uint32_t payloadSize);
     bool ParseObuSequenceHeader();
     bool ParseObuFrameHeader();
     bool ParseObuTileGroup(const AV1ObuHeader&);
@@ -804,6 +804,8 @@ private:
     bool pred_weight_table(slice_header_s *slh, int chromaArrayType);
     void dec_ref_pic_marking(slice_header_s *slh);
     void nal_unit_header_extension();
+    bool skip_slice(int nal_ref_idc, bool IdrPicFlag);
+    bool frame_num_gap(const seq_parameter_set_s *sps, const slice_header_s *slh) const;
 
     // DPB management
     bool dpb_sequence_start(slice_header_s *slh);
@@ -888,6 +890,7 @@ private:
     uint32_t m_idr_found_flag : 1;   // true in steady-state once we found an IDR picture
     uint32_t m_aso : 1;                 // true if ASO detected in current picture
     uint32_t m_prefix_nalu_valid : 1;
+    uint32_t m_recovery_point_resync : 1; // the next picture resumes decoding at a recovery point SEI after an error
     int m_last_sps_id;
     int m_last_sei_pic_struct;
     int m_last_primary_pic_type;
@@ -770,6 +770,7 @@ protected:
     void vui_parameters(hevc_seq_param_s *sps, int sps_max_sub_layers_minus1);
     void hrd_parameters(hevc_video_hrd_param_s* pStdHrdParameters, bool commonInfPresentFlag, uint8_t maxNumSubLayersMinus1);
     void sub_layer_hrd_parameters(StdVideoH265SubLayerHrdParameters* pStdSubLayerHrdParameters, int subLayerId, int cpb_cnt_minus1, int sub_pic_cpb_params_present_flag);
+    bool skip_slice(int nal_unit_type, int nuh_temporal_id_plus1);
     bool slice_header(int nal_unit_type, int nuh_temporal_id_plus1);
     uint32_t getNumRefLayerPics(const hevc_video_param_s* vps, hevc_slice_header_s *pSliceHeader);
     void getNumActiveRefLayerPics(const hevc_video_param_s *pVideoParamSet, hevc_slice_header_s *pSliceHeader);
@@ -787,7 +788,8 @@ protected:
     void reference_picture_set(hevc_slice_header_s *slh, int PicOrderCntVal);
     int  create_lost_ref_pic(int lostPOC, int layerID, int marking_flag);
     // SEI layer
-    void sei_payload();
+    void sei_payload(bool suffix);
+    void decoded_picture_hash(int payloadSize);
 
 protected:
     H265ParserData *m_pParserData;
@@ -797,6 +799,10 @@ protected:
     int m_prevPicOrderCntLsb;
     uint32_t m_intra_pic_flag : 1;
     uint32_t  NoRaslOutputFlag : 1;
+    uint32_t  HandleCraAsBlaFlag : 1;   // Set for the CRA picture that decoding resumes at after an error
+    uint32_t  m_bRefPicMissing : 1;     // A reference picture of the current picture is not in the DPB
+    int m_recoveryPocCnt;               // recovery_poc_cnt of the recovery point SEI that decoding resumes at, -1 if none
+    int m_RecoveryPointPoc;             // Until this POC, the pictures after a recovery point may miss references
     int m_NumBitsForShortTermRPSInSlice;
     int m_NumDeltaPocsOfRefRpsIdx;
     int m_NumPocTotalCurr;
@@ -0,0 +1,137 @@
+/*
+* Copyright 2024 NVIDIA Corporation.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#ifndef _VULKANPARAMETERSETCACHE_H_
+#define _VULKANPARAMETERSETCACHE_H_
+
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+#include <unordered_map>
+
+// Detects parameter sets that repeat, byte for byte, the last one parsed with the same type and id.
+//
+// Streams commonly resend their SPS/PPS (or AV1 sequence header) before every random access point.
+// The parser looks up the raw NAL unit (or OBU payload) before parsing it: on a hit, the parameter
+// set already stored by the parser is still valid and the NAL unit can be skipped. On a miss, the
+// entry is dropped, and Commit() records the new data once the parser has stored the parsed set,
+// so that a parameter set that failed to parse is never treated as a repeat.
+class VulkanParameterSetCache
+{
+public:
+    VulkanParameterSetCache()
+        : m_entries()
+        , m_pendingKey(0)
+        , m_pending()
+        , m_hasPending(false)
+        , m_hits(0)
+        , m_misses(0) { }
+
+    bool Lookup(uint32_t type, uint32_t id, const uint8_t* pData, size_t size)
+    {
+        // trailing_zero_8bits are not part of the parameter set
+        while ((size > 0) && (pData[size - 1] == 0)) {
+            size--;
+        }
+
+        const uint32_t key = GetKey(type, id);
+        const uint64_t hash = Hash(pData, size);
+        auto it = m_entries.find(key);
+        if ((it != m_entries.end()) && (it->second.hash == hash) &&
+            (it->second.data.size() == size) && ((size == 0) || (memcmp(it->second.data.data(), pData, size) == 0))) {
+            m_hasPending = false;
+            m_hits++;
+            return true;
+        }
+
+        if (it != m_entries.end()) {
+            m_entries.erase(it);
+        }
+        m_pendingKey = key;
+        m_pending.hash = hash;
+        m_pending.data.assign(pData, pData + size);
+        m_hasPending = true;
+        m_misses++;
+        return false;
+    }
+
+    // Records the data of the last missed Lookup(), call it after the parsed parameter set is stored.
+    void Commit()
+    {
+        if (m_hasPending) {
+            m_entries[m_pendingKey] = m_pending;
+            m_hasPending = false;
+        }
+    }
+
+    // Drops a parameter set that was replaced without a Lookup()
+    void Invalidate(uint32_t type, uint32_t id)
+    {
+        m_entries.erase(GetKey(type, id));
+        m_hasPending = false;
+    }
+
+    // Drops all the parameter sets of a type, when the parameter sets they depend on change
+    void InvalidateType(uint32_t type)
+    {
+        for (auto it = m_entries.begin(); it != m_entries.end(); ) {
+            if ((it->first >> 16) == type) {
+                it = m_entries.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    void Reset()
+    {
+        m_entries.clear();
+        m_hasPending = false;
+    }
+
+    uint64_t GetHits() const { return m_hits; }
+    uint64_t GetMisses() const { return m_misses; }
+
+private:
+    struct Entry {
+        uint64_t             hash;
+        std::vector<uint8_t> data;
+
+        Entry() : hash(0), data() {}
+    };
+
+    static uint32_t GetKey(uint32_t type, uint32_t id) { return (type << 16) | (id & 0xffff); }
+
+    // FNV-1a
+    static uint64_t Hash(const uint8_t* pData, size_t size)
+    {
+        uint64_t hash = 0xcbf29ce484222325ULL;
+        for (size_t i = 0; i < size; i++) {
+            hash = (hash ^ pData[i]) * 0x100000001b3ULL;
+        }
+        return hash;
+    }
+
+private:
+    std::unordered_map<uint32_t, Entry> m_entries;
+    uint32_t                            m_pendingKey;
+    Entry                               m_pending;
+    bool                                m_hasPending;
+    uint64_t                            m_hits;
+    uint64_t                            m_misses;
+};
+
+#endif // _VULKANPARAMETERSETCACHE_H_
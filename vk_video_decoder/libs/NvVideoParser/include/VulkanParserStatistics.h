@@ -0,0 +1,156 @@
+/*
+* Copyright 2024 NVIDIA Corporation.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#ifndef _VULKANPARSERSTATISTICS_H_
+#define _VULKANPARSERSTATISTICS_H_
+
+#include <stdint.h>
+#include <atomic>
+#include <chrono>
+#include "vkvideo_parser/VulkanVideoParserIf.h"
+
+// Counters of the work done by a parser, polled by the client through IVulkanVideoParser::GetParserStatistics().
+//
+// The parser thread is the only writer: a counter is updated with a relaxed load and store, which compiles
+// to plain moves (no locked instruction), and a reader on another thread sees each counter torn-free, if
+// possibly a few updates behind. Building with DISABLE_VK_VIDEO_PARSER_STATISTICS compiles all the updates out.
+// The times are only measured with SetTiming(true): reading the clock costs more than parsing a small NAL unit.
+class VulkanParserStatistics
+{
+public:
+#if !defined(DISABLE_VK_VIDEO_PARSER_STATISTICS)
+    enum { ENABLED = 1 };
+#else
+    enum { ENABLED = 0 };
+#endif
+
+    VulkanParserStatistics() : m_timing(false) { Reset(); }
+
+    void Reset()
+    {
+        for (uint32_t i = 0; i < VK_PARSER_STATISTICS_MAX_UNIT_TYPES; i++) {
+            m_unitCount[i].store(0, std::memory_order_relaxed);
+            m_unitBytes[i].store(0, std::memory_order_relaxed);
+        }
+        for (uint32_t i = 0; i < COUNTER_COUNT; i++) {
+            m_counters[i].store(0, std::memory_order_relaxed);
+        }
+    }
+
+    // Set by the parser thread, when it is initialized
+    void SetTiming(bool timing) { m_timing = timing; }
+
+    // Time stamp for the *Time() updates, 0 if the timing is off or the statistics are compiled out
+    uint64_t Now() const
+    {
+        if (!ENABLED || !m_timing) {
+            return 0;
+        }
+        return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    void AddUnit(uint32_t type, uint64_t size)
+    {
+        if (ENABLED && (type < VK_PARSER_STATISTICS_MAX_UNIT_TYPES)) {
+            Add(m_unitCount[type], 1);
+            Add(m_unitBytes[type], size);
+        }
+    }
+
+    void AddStartCodeScan(uint64_t bytes, uint64_t startTime) { AddTime(START_CODE_SCAN_NS, startTime); Add(START_CODE_SCAN_BYTES, bytes); }
+    void AddParseUnitTime(uint64_t startTime) { AddTime(PARSE_UNIT_NS, startTime); }
+    void AddBeginPictureTime(uint64_t startTime) { AddTime(BEGIN_PICTURE_NS, startTime); }
+    void AddEndOfPictureTime(uint64_t startTime) { AddTime(END_OF_PICTURE_NS, startTime); }
+    void AddBitstreamBufferResize() { Add(BITSTREAM_BUFFER_RESIZES, 1); }
+    void AddBitstreamSwapCopy(uint64_t bytes) { Add(BITSTREAM_SWAP_COPY_BYTES, bytes); }
+    void AddParameterSetUpdate() { Add(PARAMETER_SET_UPDATES, 1); }
+    void AddDpbBumping() { Add(DPB_BUMPING_EVENTS, 1); }
+    void AddPtsQueueOverflow() { Add(PTS_QUEUE_OVERFLOWS, 1); }
+    void AddPtsDrops(uint64_t count) { Add(PTS_DROPS, count); }
+    void AddErrorRecovery() { Add(ERROR_RECOVERIES, 1); }
+
+    // Returns false if the statistics are compiled out
+    bool Get(VkParserStatistics* pStats) const
+    {
+        if (!ENABLED || (pStats == nullptr)) {
+            return false;
+        }
+        for (uint32_t i = 0; i < VK_PARSER_STATISTICS_MAX_UNIT_TYPES; i++) {
+            pStats->unitCount[i] = m_unitCount[i].load(std::memory_order_relaxed);
+            pStats->unitBytes[i] = m_unitBytes[i].load(std::memory_order_relaxed);
+        }
+        pStats->startCodeScanBytes = Get(START_CODE_SCAN_BYTES);
+        pStats->startCodeScanNs = Get(START_CODE_SCAN_NS);
+        pStats->parseUnitNs = Get(PARSE_UNIT_NS);
+        pStats->beginPictureNs = Get(BEGIN_PICTURE_NS);
+        pStats->endOfPictureNs = Get(END_OF_PICTURE_NS);
+        pStats->bitstreamBufferResizes = Get(BITSTREAM_BUFFER_RESIZES);
+        pStats->bitstreamSwapCopyBytes = Get(BITSTREAM_SWAP_COPY_BYTES);
+        pStats->parameterSetUpdates = Get(PARAMETER_SET_UPDATES);
+        pStats->dpbBumpingEvents = Get(DPB_BUMPING_EVENTS);
+        pStats->ptsQueueOverflows = Get(PTS_QUEUE_OVERFLOWS);
+        pStats->ptsDrops = Get(PTS_DROPS);
+        pStats->errorRecoveries = Get(ERROR_RECOVERIES);
+        return true;
+    }
+
+private:
+    enum Counter {
+        START_CODE_SCAN_BYTES = 0,
+        START_CODE_SCAN_NS,
+        PARSE_UNIT_NS,
+        BEGIN_PICTURE_NS,
+        END_OF_PICTURE_NS,
+        BITSTREAM_BUFFER_RESIZES,
+        BITSTREAM_SWAP_COPY_BYTES,
+        PARAMETER_SET_UPDATES,
+        DPB_BUMPING_EVENTS,
+        PTS_QUEUE_OVERFLOWS,
+        PTS_DROPS,
+        ERROR_RECOVERIES,
+        COUNTER_COUNT
+    };
+
+    // Single writer: no read-modify-write needed
+    static void Add(std::atomic<uint64_t>& counter, uint64_t value)
+    {
+        counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+    }
+
+    void Add(Counter counter, uint64_t value)
+    {
+        if (ENABLED) {
+            Add(m_counters[counter], value);
+        }
+    }
+
+    void AddTime(Counter counter, uint64_t startTime)
+    {
+        if (ENABLED && m_timing) {
+            Add(m_counters[counter], Now() - startTime);
+        }
+    }
+
+    uint64_t Get(Counter counter) const { return m_counters[counter].load(std::memory_order_relaxed); }
+
+    std::atomic<uint64_t> m_unitCount[VK_PARSER_STATISTICS_MAX_UNIT_TYPES];
+    std::atomic<uint64_t> m_unitBytes[VK_PARSER_STATISTICS_MAX_UNIT_TYPES];
+    std::atomic<uint64_t> m_counters[COUNTER_COUNT];
+    bool                  m_timing;
+};
+
+#endif /* _VULKANPARSERSTATISTICS_H_ */
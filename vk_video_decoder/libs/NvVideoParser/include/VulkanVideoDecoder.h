@@ -19,9 +19,14 @@
 
 #include <atomic>
 #include <limits>
+#include <vector>
+#include <algorithm>
+#include <assert.h>
 
 #include <cpudetect.h>
 #include "VkCodecUtils/VulkanBitstreamBuffer.h"
+#include "VulkanParameterSetCache.h"
+#include "VulkanParserStatistics.h"
 
 #define UNUSED_LOCAL_VAR(expr) do { (void)(expr); } while (0)
 
@@ -29,13 +34,29 @@ typedef struct NvVkNalUnit
 {
     int64_t start_offset;     // Start offset in byte stream buffer
     int64_t end_offset;       // End offset in byte
-    int64_t get_offset;       // Current read ptr in this NALU
-    int32_t get_zerocnt;     // Zero byte count
-    uint32_t get_bfr;        // Bit buffer for reading
-    uint32_t get_bfroffs;    // Offset in bit buffer
-    uint32_t get_emulcnt;    // Emulation prevention byte count
+    int64_t get_offset;       // Next byte stream offset to be unescaped into the RBSP buffer
+    uint32_t get_prefix;      // Number of start code prefix bytes skipped at the start of the NALU
+    uint32_t get_emulcnt;     // Emulation prevention byte count
+    const uint8_t* rbsp;      // RBSP data (scratch buffer, or the byte stream buffer when there is no emulation prevention)
+    size_t rbsp_size;         // Number of RBSP bytes available in rbsp
+    size_t rbsp_bitpos;       // Current read position in rbsp (in bits)
 } NvVkNalUnit;
 
+// Start code found by next_start_codes()
+typedef struct NvVkStartCode
+{
+    size_t offset;            // Offset of the first byte following the 00.00.01 start code prefix
+    uint8_t nal_header;       // First byte of the NAL unit header (0 if the start code prefix ends the data)
+} NvVkStartCode;
+
+// Slice data parsed in place in the caller's packet that has not been copied to the bitstream buffer yet
+typedef struct NvVkDeferredCopy
+{
+    const uint8_t* pSrc;      // Packet data
+    int64_t dst_offset;       // Destination offset in byte stream buffer
+    int64_t size;             // Number of bytes to copy
+} NvVkDeferredCopy;
+
 // Presentation information stored with every decoded frame
 typedef struct NvVkPresentationInfo
 {
@@ -58,15 +79,22 @@ public:
     enum { MAX_SLICES = 8192 };             // Up to 8K slices per picture
     enum { MAX_DELAY = 32 };                // Maximum frame delay between decode & display
     enum { MAX_QUEUED_PTS = 16};            // Size of PTS queue
+    enum { RBSP_CHUNK_SIZE = 512 };         // Number of byte stream bytes unescaped at a time into the RBSP buffer
+    enum { RBSP_PADDING_SIZE = 8 };         // Zero padding after the RBSP data (allows unconditional 64-bit reads)
+    enum { MAX_START_CODES_PER_SCAN = 256 };// Size of the start code table filled by next_start_codes()
     enum {
         NALU_DISCARD=0, // Discard this nal unit
         NALU_SLICE,     // This NALU contains picture data (keep)
         NALU_UNKNOWN,   // This NALU type is not supported (callback client)
+        NALU_METADATA,  // This NALU contains metadata recorded in m_metadataRecords (keep, not a slice)
     };
     typedef enum {
         NV_NO_ERROR = 0,         // No error detected
         NV_NON_COMPLIANT_STREAM  // Stream is not compliant with codec standards
     } NVCodecErrors;
+    // Returns the offset of the first emulation_prevention_three_byte in [begin, end), or end if there is none
+    typedef size_t (*FindEmulationPreventionByteFunc)(const uint8_t *pdatain, size_t begin, size_t end);
+    typedef bool (VulkanVideoDecoder::*ParseByteStreamFunc)(const VkParserBitstreamPacket *pck, size_t *pParsedBytes);
 
 protected:
     std::atomic<int32_t>             m_refCount;
@@ -74,6 +102,7 @@ protected:
     uint32_t                         m_264SvcEnabled:1;    // enabled NVCS_H264_SVC
     uint32_t                         m_outOfBandPictureParameters:1; // Enable out of band parameters cb
     uint32_t                         m_initSequenceIsCalled:1;
+    uint32_t                         m_pictureMetadata:1; // Keep the SEI NAL units and record their messages
     VkParserVideoDecodeClient *m_pClient;  // Interface to decoder client
     uint32_t m_defaultMinBufferSize;       // Minimum default buffer size that the parser is going to allocate
     uint32_t m_bufferOffsetAlignment;      // Minimum buffer offset alignment of the bitstream data for each frame
@@ -113,6 +142,21 @@ protected:
     int32_t m_lCheckPTS;                        // Run the m_bFilterTimestamps for the first few framew to look for out of order PTS
     NVCodecErrors m_eError;
     SIMD_ISA m_NextStartCode;
+    std::vector<uint8_t> m_rbspBuffer;          // Scratch buffer for the unescaped RBSP of the current NAL unit
+    ParseByteStreamFunc m_pfnParseByteStream;   // SIMD_ISA specific byte stream parse loop, selected by Initialize()
+    FindEmulationPreventionByteFunc m_pfnFindEmulationPreventionByte; // SIMD_ISA specific emulation prevention search
+    NvVkStartCode m_startCodes[MAX_START_CODES_PER_SCAN]; // Start codes found ahead of the current position in the packet
+    const uint8_t* m_pInPlaceNaluData;          // Packet data of the current NAL unit (past the start code prefix) when it is parsed in place
+    uint32_t m_nalLengthSize;                   // Size of the NAL unit length prefix (avcC/hvcC lengthSizeMinusOne + 1), 0 for Annex-B
+    NvVkDeferredCopy m_deferredCopy;            // Contiguous slice data to be copied to the bitstream buffer in one go
+    VulkanParameterSetCache m_parameterSetCache; // Raw data of the last parameter sets, to skip the repeated ones
+    VkParserDecodeSkipPolicy m_decodeSkipPolicy; // Pictures to drop at parse time, before they get a picture buffer
+    std::atomic<uint64_t> m_numSkippedPictures; // Pictures dropped because of m_decodeSkipPolicy
+    bool m_bErrorRecovery;                      // Dropping the pictures up to the next random access point after an error
+    int32_t m_recoveryPointCnt;                 // recovery_frame_cnt/recovery_poc_cnt of a recovery point SEI for the next picture, -1 if none
+    VulkanParserStatistics m_stats;             // Counters polled by the client through GetStatistics()
+    std::vector<VkParserMetadataRecord> m_metadataRecords; // Metadata of the current picture (m_pictureMetadata)
+    VkVideoDecodedPictureHash m_decodedPictureHash; // Decoded picture hash SEI of the current picture (TYPE_NONE if none)
 public:
     VulkanVideoDecoder(VkVideoCodecOperationFlagBitsKHR std);
     virtual ~VulkanVideoDecoder();
@@ -143,6 +187,8 @@ public:
     template <SIMD_ISA T>
     bool ParseByteStreamSimd(const VkParserBitstreamPacket *pck, size_t *pParsedBytes);
     bool ParseByteStreamC(const VkParserBitstreamPacket *pck, size_t *pParsedBytes);
+    bool ParseLengthPrefixedNalUnits(const VkParserBitstreamPacket *pck, const uint8_t *pdatain, VkDeviceSize datasize,
+                                     unsigned int framesinpkt, size_t *pParsedBytes);
 #if defined(__x86_64__) || defined (_M_X64)
     bool ParseByteStreamAVX2(const VkParserBitstreamPacket* pck, size_t *pParsedBytes);
     bool ParseByteStreamAVX512(const VkParserBitstreamPacket* pck, size_t *pParsedBytes);
@@ -152,8 +198,28 @@ public:
     bool ParseByteStreamNEON(const VkParserBitstreamPacket* pck, size_t *pParsedBytes);
 #elif defined(__ARM_ARCH_7A__)
     bool ParseByteStreamNEON(const VkParserBitstreamPacket* pck, size_t *pParsedBytes);
+#endif
+    template <SIMD_ISA T>
+    static size_t find_emulation_prevention_byte(const uint8_t *pdatain, size_t begin, size_t end);
+    static size_t FindEmulationPreventionByteC(const uint8_t *pdatain, size_t begin, size_t end);
+#if defined(__x86_64__) || defined (_M_X64)
+    static size_t FindEmulationPreventionByteAVX2(const uint8_t *pdatain, size_t begin, size_t end);
+    static size_t FindEmulationPreventionByteAVX512(const uint8_t *pdatain, size_t begin, size_t end);
+    static size_t FindEmulationPreventionByteSSSE3(const uint8_t *pdatain, size_t begin, size_t end);
+#elif defined(__aarch64__) || defined(_M_ARM64)
+    static size_t FindEmulationPreventionByteSVE(const uint8_t *pdatain, size_t begin, size_t end);
+    static size_t FindEmulationPreventionByteNEON(const uint8_t *pdatain, size_t begin, size_t end);
+#elif defined(__ARM_ARCH_7A__)
+    static size_t FindEmulationPreventionByteNEON(const uint8_t *pdatain, size_t begin, size_t end);
 #endif
     virtual bool GetDisplayMasteringInfo(VkParserDisplayMasteringInfo *) { return false; }
+    // Number of parameter sets skipped as repeats (hits) and parsed (misses) since the parser was created
+    void GetParameterSetCacheStats(uint64_t& hits, uint64_t& misses) const {
+        hits = m_parameterSetCache.GetHits();
+        misses = m_parameterSetCache.GetMisses(); }
+    // Number of pictures dropped by the decode skip policy since the parser was created
+    uint64_t GetNumSkippedPictures() const { return m_numSkippedPictures.load(std::memory_order_relaxed); }
+    virtual bool GetStatistics(VkParserStatistics* pStats) const;
 
 protected:
     virtual void CreatePrivateContext() = 0;                   // Implemented by derived classes
@@ -169,27 +235,74 @@ protected:
     // Byte stream parsing
     template<SIMD_ISA T>
     size_t next_start_code(const uint8_t *pdatain, size_t datasize, bool& found_start_code);
+    // Scans the data once and records all the start codes (up to maxStartCodes) in pStartCodes.
+    // Returns the number of bytes scanned: datasize, or the offset of the last start code if the table is full.
+    template<SIMD_ISA T>
+    size_t next_start_codes(const uint8_t *pdatain, size_t datasize,
+                            NvVkStartCode *pStartCodes, uint32_t maxStartCodes, uint32_t& numStartCodes);
     void nal_unit();
+    // With VK_PARSER_DECODE_SKIP_TO_RANDOM_ACCESS_ON_ERROR, starts dropping the pictures up to the next random access point
+    void StartErrorRecovery();
     void init_dbits();
+    // Returns the NAL unit data at the given byte stream buffer offset: a NAL unit parsed in place is still in
+    // the caller's packet and only reaches the bitstream buffer (through m_deferredCopy) if it is kept.
+    // The offset must be past the start code prefix, which length-prefixed packets do not contain.
+    const uint8_t* nalu_data(int64_t offset) {
+        return (m_pInPlaceNaluData != nullptr) ? (m_pInPlaceNaluData + (offset - m_nalu.start_offset - 3))
+                                               : (m_bitstreamData.GetBitstreamPtr() + offset); }
+    void defer_copy(const uint8_t* pSrc, int64_t dstOffset, int64_t size);
+    // Returns true if the current NAL unit repeats the last parameter set of this type (StdVideoPictureParametersSet::ParameterType)
+    // and id. Otherwise, the caller must parse and store it, then call m_parameterSetCache.Commit().
+    bool IsRepeatedParameterSet(uint32_t type, uint32_t id);
+    void flush_deferred_copy();
+    // Resets the PTS queue at a discontinuity, counting the timestamps that were never matched to a picture
+    void discard_pts_queue();
+    // Records the SEI message payload of payloadSize bytes at the current (byte aligned) RBSP position,
+    // if m_pictureMetadata is set. The span is located in the escaped NAL unit data.
+    void add_sei_metadata(uint32_t payloadType, uint32_t payloadSize, bool suffix = false);
+    // Recognizes the A/53 closed captions in an ITU-T T.35 payload
+    static VkParserMetadataKind GetT35MetadataKind(const uint8_t* pPayload, size_t payloadSize);
+    // The bit reader works on the RBSP of the current NAL unit: the byte stream is unescaped in chunks of
+    // RBSP_CHUNK_SIZE into m_rbspBuffer as the reader advances, so that all reads are 64-bit big-endian loads.
     int32_t available_bits() {
-		// end_offset=566 - get_offset=568 for example are values seen in the debugger, causing an unsigned integer overflow below since get_btroffs is a uint32 while end_offset and get_offset are int64 explicitly casted to int32, which then gets implicitly casted to a unint32. This code could use a review from the original authors about the intentions here. The early return is to avoid the sanitizer violation and appears semantically correct.
-		if ((m_nalu.end_offset - m_nalu.get_offset) < 0)
-			return 0;
-		assert((m_nalu.end_offset - m_nalu.get_offset) < std::numeric_limits<int32_t>::max());
-                               return (int32_t)(m_nalu.end_offset - m_nalu.get_offset) * 8 + (32 - m_nalu.get_bfroffs); }
-    int32_t consumed_bits() { assert((m_nalu.get_offset - m_nalu.start_offset - m_nalu.get_emulcnt) < std::numeric_limits<int32_t>::max());
-                          return (int32_t)(m_nalu.get_offset - m_nalu.start_offset - m_nalu.get_emulcnt) * 8 - (32 - m_nalu.get_bfroffs); }
-    uint32_t next_bits(uint32_t n) { return (m_nalu.get_bfr << m_nalu.get_bfroffs) >> (32 - n); } // NOTE: n must be in the [1..25] range
-    void skip_bits(uint32_t n);  // advance bitstream position
-    uint32_t u(uint32_t n);   // return next n bits, advance bitstream position
+        const int64_t bits = ((int64_t)m_nalu.rbsp_size * 8 - (int64_t)m_nalu.rbsp_bitpos) +
+                             (std::max<int64_t>(m_nalu.end_offset - m_nalu.get_offset, 0) * 8);
+        if (bits <= 0)
+            return 0;
+        assert(bits < std::numeric_limits<int32_t>::max());
+        return (int32_t)bits; }
+    int32_t consumed_bits() { assert((m_nalu.get_prefix * 8 + m_nalu.rbsp_bitpos) < (size_t)std::numeric_limits<int32_t>::max());
+                          return (int32_t)(m_nalu.get_prefix * 8 + m_nalu.rbsp_bitpos); }
+    uint64_t peek_bits() {  // returns at least 57 valid bits, MSB aligned, starting at the current position
+        const size_t byteOffset = m_nalu.rbsp_bitpos >> 3;
+        const uint64_t bits = ((byteOffset + 8) <= m_nalu.rbsp_size) ? read_be64(m_nalu.rbsp + byteOffset) : peek_bits_slow(byteOffset);
+        return bits << (m_nalu.rbsp_bitpos & 7); }
+    uint32_t next_bits(uint32_t n) { return (uint32_t)(peek_bits() >> (64 - n)); } // NOTE: n must be in the [1..32] range
+    void skip_bits(uint32_t n) { m_nalu.rbsp_bitpos += n; }  // advance bitstream position
+    uint32_t u(uint32_t n) {  // return next n bits, advance bitstream position
+        if (n == 0)
+            return 0;
+        const uint32_t bits = next_bits(n);
+        skip_bits(n);
+        return bits; }
     bool flag()          { return (0 != u(1)); }     // returns flag value
     uint32_t u16_le()    { uint32_t tmp = u(8); tmp |= u(8) << 8; return tmp; }
     uint32_t u24_le()    { uint32_t tmp = u16_le(); tmp |= u(8) << 16; return tmp; }
     uint32_t u32_le()    { uint32_t tmp = u16_le(); tmp |= u16_le() << 16; return tmp; }
-    uint32_t ue();
-    int32_t se();
+    uint32_t ue() {
+        const uint64_t bits = peek_bits();
+        const int leadingZeroBits = (bits != 0) ? count_leading_zeros(bits) : 64;
+        if (leadingZeroBits > 28) // codeword doesn't fit in the 57 bits window
+            return ue_slow();
+        const uint32_t codeLen = 2 * leadingZeroBits + 1;
+        skip_bits(codeLen);
+        return (uint32_t)(bits >> (64 - codeLen)) - 1; }
+    int32_t se() {
+        const uint64_t codeNum = ue();  // Table 9-3
+        const uint64_t sign = (codeNum & 1) - 1; // 0 for odd, ~0 for even code numbers
+        return (int32_t)((((codeNum + 1) >> 1) ^ sign) - sign); }
     uint32_t f(uint32_t n, uint32_t) { return u(n); }
-    bool byte_aligned() const { return ((m_nalu.get_bfroffs & 7) == 0); }
+    bool byte_aligned() const { return ((m_nalu.rbsp_bitpos & 7) == 0); }
     void byte_alignment() { while (!byte_aligned()) u(1); }
     void end_of_picture();
     void end_of_stream();
@@ -197,8 +310,14 @@ protected:
     int32_t init_sequence(VkParserSequenceInfo *pnvsi);  // Must be called by derived classes to initialize the sequence
     void display_picture(VkPicIf *pPicBuf, bool bEvict = true);
     void rbsp_trailing_bits();
-    bool end() { return m_nalu.get_offset >= m_nalu.end_offset; }
+    bool end() { return available_bits() <= 0; }
     bool more_rbsp_data();
+    static uint64_t read_be64(const uint8_t* p) {
+        return ((uint64_t)p[0] << 56) | ((uint64_t)p[1] << 48) | ((uint64_t)p[2] << 40) | ((uint64_t)p[3] << 32) |
+               ((uint64_t)p[4] << 24) | ((uint64_t)p[5] << 16) | ((uint64_t)p[6] << 8) | (uint64_t)p[7]; }
+    uint64_t peek_bits_slow(size_t byteOffset);
+    uint32_t ue_slow();
+    void rbsp_unescape(size_t rbspBytesNeeded);
     bool resizeBitstreamBuffer(VkDeviceSize nExtrabytes);
     VkDeviceSize swapBitstreamBuffer(VkDeviceSize copyCurrBuffOffset, VkDeviceSize copyCurrBuffSize);
 };
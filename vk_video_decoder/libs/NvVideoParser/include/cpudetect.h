@@ -28,6 +28,24 @@ static int inline count_trailing_zeros(unsigned long long resmask)
     return offset;
 }
 
+static int inline count_leading_zeros(unsigned long long value)
+{
+#ifndef _WIN32
+    int count = __builtin_clzll(value);
+#elif defined(_BitScanReverse64)
+    unsigned long index = 0;
+    const unsigned char dummyIsNonZero = _BitScanReverse64(&index, value); // value can't be 0 here
+    int count = 63 - (int)index;
+#else // Fallback to the slow method.
+    int count = 0;
+    while (!(value & (1ULL << 63))) {
+        value <<= 1;
+        count++;
+    }
+#endif
+    return count;
+}
+
 SIMD_ISA check_simd_support();
 
 #endif
\ No newline at end of file
@@ -64,4 +64,103 @@ size_t VulkanVideoDecoder::next_start_code<SIMD_ISA::AVX2>(const uint8_t *pdatai
     return i;
 }
 
+
+template<>
+size_t VulkanVideoDecoder::next_start_codes<SIMD_ISA::AVX2>(const uint8_t *pdatain, size_t datasize,
+                                                            NvVkStartCode *pStartCodes, uint32_t maxStartCodes, uint32_t& numStartCodes)
+{
+    size_t i = 0;
+    size_t datasize64 = (datasize >> 6) << 6;
+    numStartCodes = 0;
+    if (datasize64 > 64)
+    {
+        const __m256i v1 = _mm256_set1_epi8(1);
+        __m256i vdata = _mm256_loadu_si256((const __m256i*)pdatain);
+        __m256i vBfr = _mm256_set1_epi16(((m_BitBfr << 8) & 0xFF00) | ((m_BitBfr >> 8) & 0xFF));
+        __m256i vdata_alignr16b_init = _mm256_permute2f128_si256(vBfr, vdata, 1 | (2<<4));
+        __m256i vdata_prev1 = _mm256_alignr_epi8(vdata, vdata_alignr16b_init, 15);
+        __m256i vdata_prev2 = _mm256_alignr_epi8(vdata, vdata_alignr16b_init, 14);
+        for ( ; i < datasize64 - 64; i += 64)
+        {
+            for (int c = 0; c < 64; c += 32)
+            {
+                // hotspot begin
+                __m256i vdata_prev1or2 = _mm256_or_si256(vdata_prev2, vdata_prev1);
+                __m256i vmask = _mm256_cmpeq_epi8(_mm256_and_si256(vdata, _mm256_cmpeq_epi8(vdata_prev1or2, _mm256_setzero_si256())), v1);
+                uint32_t resmask = (uint32_t)_mm256_movemask_epi8(vmask);
+                // hotspot end
+                while (resmask)
+                {
+                    const size_t offset = count_trailing_zeros((uint64_t)resmask) + i + c + 1;
+                    pStartCodes[numStartCodes].offset = offset;
+                    pStartCodes[numStartCodes].nal_header = pdatain[offset];
+                    if (++numStartCodes == maxStartCodes) {
+                        m_BitBfr = 1;
+                        return offset;
+                    }
+                    resmask &= resmask - 1;
+                }
+                // hotspot begin
+                __m256i vdata_next = _mm256_loadu_si256((const __m256i*)&pdatain[i + c + 32]);
+                __m256i vdata_alignr16b_next = _mm256_permute2f128_si256(vdata, vdata_next, 1 | (2<<4));
+                vdata_prev1 = _mm256_alignr_epi8(vdata_next, vdata_alignr16b_next, 15);
+                vdata_prev2 = _mm256_alignr_epi8(vdata_next, vdata_alignr16b_next, 14);
+                vdata = vdata_next;
+                // hotspot end
+            }
+        } // main processing loop end
+        m_BitBfr = (pdatain[i-2] << 8) | pdatain[i-1];
+    }
+    // process a tail (rest):
+    uint32_t bfr = m_BitBfr;
+    while (i < datasize)
+    {
+        bfr = (bfr << 8) | pdatain[i++];
+        if ((bfr & 0x00ffffff) == 1) {
+            pStartCodes[numStartCodes].offset = i;
+            pStartCodes[numStartCodes].nal_header = (i < datasize) ? pdatain[i] : 0;
+            if (++numStartCodes == maxStartCodes) {
+                break;
+            }
+        }
+    }
+    m_BitBfr = bfr;
+    return i;
+}
+
+template<>
+size_t VulkanVideoDecoder::find_emulation_prevention_byte<SIMD_ISA::AVX2>(const uint8_t *pdatain, size_t begin, size_t end)
+{
+    size_t i = std::max<size_t>(begin, 2);
+    const __m256i v3 = _mm256_set1_epi8(3);
+    for ( ; (i + 32) <= end; i += 32)
+    {
+        // hotspot begin
+        __m256i vdata = _mm256_loadu_si256((const __m256i*)&pdatain[i]);
+        __m256i vdata_prev1 = _mm256_loadu_si256((const __m256i*)&pdatain[i - 1]);
+        __m256i vdata_prev2 = _mm256_loadu_si256((const __m256i*)&pdatain[i - 2]);
+        __m256i vdata_prev1or2 = _mm256_or_si256(vdata_prev2, vdata_prev1);
+        __m256i vmask = _mm256_and_si256(_mm256_cmpeq_epi8(vdata, v3), _mm256_cmpeq_epi8(vdata_prev1or2, _mm256_setzero_si256()));
+        const int resmask = _mm256_movemask_epi8(vmask);
+        // hotspot end
+        if (resmask)
+        {
+            return i + count_trailing_zeros((uint64_t) (resmask & 0xFFFFFFFF));
+        }
+    }
+    // process a tail (rest):
+    for ( ; i < end; i++)
+    {
+        if ((pdatain[i] == 0x03) && (pdatain[i - 1] == 0x00) && (pdatain[i - 2] == 0x00)) {
+            return i;
+        }
+    }
+    return end;
+}
+
+size_t VulkanVideoDecoder::FindEmulationPreventionByteAVX2(const uint8_t *pdatain, size_t begin, size_t end)
+{
+    return find_emulation_prevention_byte<SIMD_ISA::AVX2>(pdatain, begin, end);
+}
+
 #endif
\ No newline at end of file
@@ -67,4 +67,103 @@ size_t VulkanVideoDecoder::next_start_code<SIMD_ISA::AVX512>(const uint8_t *pdat
     found_start_code = ((bfr & 0x00ffffff) == 1);
     return i;
 }
+
+template<>
+size_t VulkanVideoDecoder::next_start_codes<SIMD_ISA::AVX512>(const uint8_t *pdatain, size_t datasize,
+                                                              NvVkStartCode *pStartCodes, uint32_t maxStartCodes, uint32_t& numStartCodes)
+{
+    size_t i = 0;
+    size_t datasize128 = (datasize >> 7) << 7;
+    numStartCodes = 0;
+    if (datasize128 > 128)
+    {
+        const __m512i v1 = _mm512_set1_epi8(1);
+        const __m512i v254 = _mm512_set1_epi8(-2);
+        __m512i vdata = _mm512_loadu_si512((const void*)pdatain);
+        __m512i vBfr = _mm512_set1_epi16(((m_BitBfr << 8) & 0xFF00) | ((m_BitBfr >> 8) & 0xFF));
+        __m512i vdata_alignr48b_init = _mm512_alignr_epi32(vdata, vBfr, 12);
+        __m512i vdata_prev1 = _mm512_alignr_epi8(vdata, vdata_alignr48b_init, 15);
+        __m512i vdata_prev2 = _mm512_alignr_epi8(vdata, vdata_alignr48b_init, 14);
+        for ( ; i < datasize128 - 128; i += 128)
+        {
+            for (int c = 0; c < 128; c += 64)
+            {
+                // hotspot begin
+                __m512i vmask0 = _mm512_ternarylogic_epi64(vdata_prev2, vdata_prev1, vdata, 0x2);
+                __m512i vmask1 = _mm512_ternarylogic_epi64(vdata_prev2, vdata_prev1, vdata, 0xFE);
+                uint64_t resmask = _mm512_cmpeq_epi8_mask(_mm512_ternarylogic_epi64(vmask0, v254, vmask1, 0xF8), v1);
+                // hotspot end
+                while (resmask)
+                {
+                    const size_t offset = count_trailing_zeros(resmask) + i + c + 1;
+                    pStartCodes[numStartCodes].offset = offset;
+                    pStartCodes[numStartCodes].nal_header = pdatain[offset];
+                    if (++numStartCodes == maxStartCodes) {
+                        m_BitBfr = 1;
+                        return offset;
+                    }
+                    resmask &= resmask - 1;
+                }
+                // hotspot begin
+                __m512i vdata_next = _mm512_loadu_si512((const void*)(&pdatain[i + c + 64]));
+                __m512i vdata_alignr48b_next = _mm512_alignr_epi32(vdata_next, vdata, 12);
+                vdata_prev1 = _mm512_alignr_epi8(vdata_next, vdata_alignr48b_next, 15);
+                vdata_prev2 = _mm512_alignr_epi8(vdata_next, vdata_alignr48b_next, 14);
+                vdata = vdata_next;
+                // hotspot end
+            }
+        } // main processing loop end
+        m_BitBfr = (pdatain[i-2] << 8) | pdatain[i-1];
+    }
+    // process a tail (rest):
+    uint32_t bfr = m_BitBfr;
+    while (i < datasize)
+    {
+        bfr = (bfr << 8) | pdatain[i++];
+        if ((bfr & 0x00ffffff) == 1) {
+            pStartCodes[numStartCodes].offset = i;
+            pStartCodes[numStartCodes].nal_header = (i < datasize) ? pdatain[i] : 0;
+            if (++numStartCodes == maxStartCodes) {
+                break;
+            }
+        }
+    }
+    m_BitBfr = bfr;
+    return i;
+}
+
+template<>
+size_t VulkanVideoDecoder::find_emulation_prevention_byte<SIMD_ISA::AVX512>(const uint8_t *pdatain, size_t begin, size_t end)
+{
+    size_t i = std::max<size_t>(begin, 2);
+    const __m512i v3 = _mm512_set1_epi8(3);
+    for ( ; (i + 64) <= end; i += 64)
+    {
+        // hotspot begin
+        __m512i vdata = _mm512_loadu_si512((const void*)&pdatain[i]);
+        __m512i vdata_prev1 = _mm512_loadu_si512((const void*)&pdatain[i - 1]);
+        __m512i vdata_prev2 = _mm512_loadu_si512((const void*)&pdatain[i - 2]);
+        const __mmask64 vzero = _mm512_cmpeq_epi8_mask(_mm512_or_si512(vdata_prev2, vdata_prev1), _mm512_setzero_si512());
+        const uint64_t resmask = _mm512_mask_cmpeq_epi8_mask(vzero, vdata, v3);
+        // hotspot end
+        if (resmask)
+        {
+            return i + count_trailing_zeros(resmask);
+        }
+    }
+    // process a tail (rest):
+    for ( ; i < end; i++)
+    {
+        if ((pdatain[i] == 0x03) && (pdatain[i - 1] == 0x00) && (pdatain[i - 2] == 0x00)) {
+            return i;
+        }
+    }
+    return end;
+}
+
+size_t VulkanVideoDecoder::FindEmulationPreventionByteAVX512(const uint8_t *pdatain, size_t begin, size_t end)
+{
+    return find_emulation_prevention_byte<SIMD_ISA::AVX512>(pdatain, begin, end);
+}
+
 #endif
\ No newline at end of file
@@ -23,4 +23,43 @@ size_t VulkanVideoDecoder::next_start_code<SIMD_ISA::NOSIMD>(const uint8_t *pdat
     m_BitBfr = bfr;
     found_start_code = ((bfr & 0x00ffffff) == 1);
     return i;
-}
\ No newline at end of file
+}
+
+template<>
+size_t VulkanVideoDecoder::next_start_codes<SIMD_ISA::NOSIMD>(const uint8_t *pdatain, size_t datasize,
+                                                              NvVkStartCode *pStartCodes, uint32_t maxStartCodes, uint32_t& numStartCodes)
+{
+    uint32_t bfr = m_BitBfr;
+    size_t i = 0;
+    numStartCodes = 0;
+    while (i < datasize)
+    {
+        bfr = (bfr << 8) | pdatain[i++];
+        if ((bfr & 0x00ffffff) == 1) {
+            pStartCodes[numStartCodes].offset = i;
+            pStartCodes[numStartCodes].nal_header = (i < datasize) ? pdatain[i] : 0;
+            if (++numStartCodes == maxStartCodes) {
+                break;
+            }
+        }
+    }
+    m_BitBfr = bfr;
+    return i;
+}
+
+template<>
+size_t VulkanVideoDecoder::find_emulation_prevention_byte<SIMD_ISA::NOSIMD>(const uint8_t *pdatain, size_t begin, size_t end)
+{
+    for (size_t i = std::max<size_t>(begin, 2); i < end; i++)
+    {
+        if ((pdatain[i] == 0x03) && (pdatain[i - 1] == 0x00) && (pdatain[i - 2] == 0x00)) {
+            return i;
+        }
+    }
+    return end;
+}
+
+size_t VulkanVideoDecoder::FindEmulationPreventionByteC(const uint8_t *pdatain, size_t begin, size_t end)
+{
+    return find_emulation_prevention_byte<SIMD_ISA::NOSIMD>(pdatain, begin, end);
+}
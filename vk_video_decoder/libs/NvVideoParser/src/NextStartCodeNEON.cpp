@@ -76,4 +76,120 @@ size_t VulkanVideoDecoder::next_start_code<SIMD_ISA::NEON>(const uint8_t *pdatai
     found_start_code = ((bfr & 0x00ffffff) == 1);
     return i;
 }
+
+template<>
+size_t VulkanVideoDecoder::next_start_codes<SIMD_ISA::NEON>(const uint8_t *pdatain, size_t datasize,
+                                                            NvVkStartCode *pStartCodes, uint32_t maxStartCodes, uint32_t& numStartCodes)
+{
+    size_t i = 0;
+    size_t datasize32 = (datasize >> 5) << 5;
+    numStartCodes = 0;
+    if (datasize32 > 32)
+    {
+        const uint8x16_t v0 = vdupq_n_u8(0);
+        const uint8x16_t v1 = vdupq_n_u8(1);
+        uint8x16_t vdata = vld1q_u8(pdatain);
+        uint8x16_t vBfr = vreinterpretq_u8_u16(vdupq_n_u16(((m_BitBfr << 8) & 0xFF00) | ((m_BitBfr >> 8) & 0xFF)));
+        uint8x16_t vdata_prev1 = vextq_u8(vBfr, vdata, 15);
+        uint8x16_t vdata_prev2 = vextq_u8(vBfr, vdata, 14);
+        for ( ; i < datasize32 - 32; i += 32)
+        {
+            for (int c = 0; c < 32; c += 16)
+            {
+                // hotspot begin
+                uint8x16_t vdata_prev1or2 = vorrq_u8(vdata_prev2, vdata_prev1);
+                uint8x16_t vmask = vceqq_u8(vandq_u8(vceqq_u8(vdata_prev1or2, v0), vdata), v1);
+                // narrow the byte mask to 4 bits per byte
+                uint64_t resmask = vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(vmask), 4)), 0);
+                // hotspot end
+                while (resmask)
+                {
+                    const int bit = count_trailing_zeros(resmask);
+                    const size_t offset = (size_t)(bit >> 2) + i + c + 1;
+                    pStartCodes[numStartCodes].offset = offset;
+                    pStartCodes[numStartCodes].nal_header = pdatain[offset];
+                    if (++numStartCodes == maxStartCodes) {
+                        m_BitBfr = 1;
+                        return offset;
+                    }
+                    resmask &= ~(0xFULL << (bit & ~3));
+                }
+                // hotspot begin
+                uint8x16_t vdata_next = vld1q_u8(&pdatain[i + c + 16]);
+                vdata_prev1 = vextq_u8(vdata, vdata_next, 15);
+                vdata_prev2 = vextq_u8(vdata, vdata_next, 14);
+                vdata = vdata_next;
+                // hotspot end
+            }
+        } // main processing loop end
+        m_BitBfr = (pdatain[i-2] << 8) | pdatain[i-1];
+    }
+    // process a tail (rest):
+    uint32_t bfr = m_BitBfr;
+    while (i < datasize)
+    {
+        bfr = (bfr << 8) | pdatain[i++];
+        if ((bfr & 0x00ffffff) == 1) {
+            pStartCodes[numStartCodes].offset = i;
+            pStartCodes[numStartCodes].nal_header = (i < datasize) ? pdatain[i] : 0;
+            if (++numStartCodes == maxStartCodes) {
+                break;
+            }
+        }
+    }
+    m_BitBfr = bfr;
+    return i;
+}
+
+template<>
+size_t VulkanVideoDecoder::find_emulation_prevention_byte<SIMD_ISA::NEON>(const uint8_t *pdatain, size_t begin, size_t end)
+{
+    size_t i = std::max<size_t>(begin, 2);
+    const uint8x16_t v0 = vdupq_n_u8(0);
+    const uint8x16_t v3 = vdupq_n_u8(3);
+    uint8_t idx0n[16] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15};
+    uint8x16_t v015 = vld1q_u8(idx0n);
+    for ( ; (i + 16) <= end; i += 16)
+    {
+        // hotspot begin
+        uint8x16_t vdata = vld1q_u8(&pdatain[i]);
+        uint8x16_t vdata_prev1 = vld1q_u8(&pdatain[i - 1]);
+        uint8x16_t vdata_prev2 = vld1q_u8(&pdatain[i - 2]);
+        uint8x16_t vdata_prev1or2 = vorrq_u8(vdata_prev2, vdata_prev1);
+        uint8x16_t vmask = vandq_u8(vceqq_u8(vdata, v3), vceqq_u8(vdata_prev1or2, v0));
+        // hotspot end
+#if defined (__aarch64__) || defined(_M_ARM64)
+        uint64_t resmask = vmaxvq_u8(vmask);
+#else
+        uint64_t resmask = vget_lane_u64(vreinterpret_u64_u8(vmax_u8(vget_low_u8(vmask), vget_high_u8(vmask))), 0);
+#endif
+        if (resmask)
+        {
+            uint8x16_t v015mask = vbslq_u8(vmask, v015, vdupq_n_u8(UINT8_MAX));
+#if defined (__aarch64__) || defined(_M_ARM64)
+            const uint8_t offset = vminvq_u8(v015mask);
+#else
+            uint8x8_t minval = vmin_u8(vget_low_u8(v015mask), vget_high_u8(v015mask));
+            minval = vpmin_u8(minval, minval);
+            minval = vpmin_u8(minval, minval);
+            const uint8_t offset = vget_lane_u8(vpmin_u8(minval, minval), 0);
+#endif
+            return i + (size_t)offset;
+        }
+    }
+    // process a tail (rest):
+    for ( ; i < end; i++)
+    {
+        if ((pdatain[i] == 0x03) && (pdatain[i - 1] == 0x00) && (pdatain[i - 2] == 0x00)) {
+            return i;
+        }
+    }
+    return end;
+}
+
+size_t VulkanVideoDecoder::FindEmulationPreventionByteNEON(const uint8_t *pdatain, size_t begin, size_t end)
+{
+    return find_emulation_prevention_byte<SIMD_ISA::NEON>(pdatain, begin, end);
+}
+
 #endif
\ No newline at end of file
@@ -61,4 +61,101 @@ size_t VulkanVideoDecoder::next_start_code<SIMD_ISA::SSSE3>(const uint8_t *pdata
     found_start_code = ((bfr & 0x00ffffff) == 1);
     return i;
 }
+
+template<>
+size_t VulkanVideoDecoder::next_start_codes<SIMD_ISA::SSSE3>(const uint8_t *pdatain, size_t datasize,
+                                                             NvVkStartCode *pStartCodes, uint32_t maxStartCodes, uint32_t& numStartCodes)
+{
+    size_t i = 0;
+    size_t datasize32 = (datasize >> 5) << 5;
+    numStartCodes = 0;
+    if (datasize32 > 32)
+    {
+        const __m128i v1 = _mm_set1_epi8(1);
+        __m128i vdata = _mm_loadu_si128((const __m128i*)pdatain);
+        __m128i vBfr = _mm_set1_epi16(((m_BitBfr << 8) & 0xFF00) | ((m_BitBfr >> 8) & 0xFF));
+        __m128i vdata_prev1 = _mm_alignr_epi8(vdata, vBfr, 15);
+        __m128i vdata_prev2 = _mm_alignr_epi8(vdata, vBfr, 14);
+        for ( ; i < datasize32 - 32; i += 32)
+        {
+            for (int c = 0; c < 32; c += 16)
+            {
+                // hotspot begin
+                __m128i vdata_prev1or2 = _mm_or_si128(vdata_prev2, vdata_prev1);
+                __m128i vmask = _mm_cmpeq_epi8(_mm_and_si128(vdata, _mm_cmpeq_epi8(vdata_prev1or2, _mm_setzero_si128())), v1);
+                uint32_t resmask = (uint32_t)_mm_movemask_epi8(vmask);
+                // hotspot end
+                while (resmask)
+                {
+                    const size_t offset = count_trailing_zeros((uint64_t)resmask) + i + c + 1;
+                    pStartCodes[numStartCodes].offset = offset;
+                    pStartCodes[numStartCodes].nal_header = pdatain[offset];
+                    if (++numStartCodes == maxStartCodes) {
+                        m_BitBfr = 1;
+                        return offset;
+                    }
+                    resmask &= resmask - 1;
+                }
+                // hotspot begin
+                __m128i vdata_next = _mm_loadu_si128((const __m128i*)&pdatain[i + c + 16]);
+                vdata_prev1 = _mm_alignr_epi8(vdata_next, vdata, 15);
+                vdata_prev2 = _mm_alignr_epi8(vdata_next, vdata, 14);
+                vdata = vdata_next;
+                // hotspot end
+            }
+        } // main processing loop end
+        m_BitBfr = (pdatain[i-2] << 8) | pdatain[i-1];
+    }
+    // process a tail (rest):
+    uint32_t bfr = m_BitBfr;
+    while (i < datasize)
+    {
+        bfr = (bfr << 8) | pdatain[i++];
+        if ((bfr & 0x00ffffff) == 1) {
+            pStartCodes[numStartCodes].offset = i;
+            pStartCodes[numStartCodes].nal_header = (i < datasize) ? pdatain[i] : 0;
+            if (++numStartCodes == maxStartCodes) {
+                break;
+            }
+        }
+    }
+    m_BitBfr = bfr;
+    return i;
+}
+
+template<>
+size_t VulkanVideoDecoder::find_emulation_prevention_byte<SIMD_ISA::SSSE3>(const uint8_t *pdatain, size_t begin, size_t end)
+{
+    size_t i = std::max<size_t>(begin, 2);
+    const __m128i v3 = _mm_set1_epi8(3);
+    for ( ; (i + 16) <= end; i += 16)
+    {
+        // hotspot begin
+        __m128i vdata = _mm_loadu_si128((const __m128i*)&pdatain[i]);
+        __m128i vdata_prev1 = _mm_loadu_si128((const __m128i*)&pdatain[i - 1]);
+        __m128i vdata_prev2 = _mm_loadu_si128((const __m128i*)&pdatain[i - 2]);
+        __m128i vdata_prev1or2 = _mm_or_si128(vdata_prev2, vdata_prev1);
+        __m128i vmask = _mm_and_si128(_mm_cmpeq_epi8(vdata, v3), _mm_cmpeq_epi8(vdata_prev1or2, _mm_setzero_si128()));
+        const int resmask = _mm_movemask_epi8(vmask);
+        // hotspot end
+        if (resmask)
+        {
+            return i + count_trailing_zeros((uint64_t) (resmask & 0xFFFF));
+        }
+    }
+    // process a tail (rest):
+    for ( ; i < end; i++)
+    {
+        if ((pdatain[i] == 0x03) && (pdatain[i - 1] == 0x00) && (pdatain[i - 2] == 0x00)) {
+            return i;
+        }
+    }
+    return end;
+}
+
+size_t VulkanVideoDecoder::FindEmulationPreventionByteSSSE3(const uint8_t *pdatain, size_t begin, size_t end)
+{
+    return find_emulation_prevention_byte<SIMD_ISA::SSSE3>(pdatain, begin, end);
+}
+
 #endif
\ No newline at end of file
@@ -74,4 +74,101 @@ size_t VulkanVideoDecoder::next_start_code<SIMD_ISA::SVE>(const uint8_t *pdatain
     return datasize;
 }
 #undef SVE_REGISTER_MAX_BYTES
+
+#define SVE_REGISTER_MAX_BYTES 256 // 2048 bits
+template<>
+size_t VulkanVideoDecoder::next_start_codes<SIMD_ISA::SVE>(const uint8_t *pdatain, size_t datasize,
+                                                           NvVkStartCode *pStartCodes, uint32_t maxStartCodes, uint32_t& numStartCodes)
+{
+    size_t i = 0;
+    numStartCodes = 0;
+    {
+        static const int lanes = (int)svcntb();
+
+        svbool_t pred = svwhilelt_b8_u64(i, datasize);
+        svbool_t pred_next = svpfalse_b();
+
+        svuint8_t vdata = svld1_u8(pred, pdatain);
+        svuint8_t vBfr = svreinterpret_u8_u16(svdup_n_u16(((m_BitBfr << 8) & 0xFF00) | ((m_BitBfr >> 8) & 0xFF)));
+
+        static uint8_t data0n[SVE_REGISTER_MAX_BYTES];
+        static uint8_t isArrayFilled = 0;
+        if (!isArrayFilled)
+        {
+            for (int idx = 0; idx < lanes; idx++)
+            {
+                data0n[idx] = idx;
+            }
+            isArrayFilled = 1;
+        }
+        svuint8_t v0n = svld1_u8(svptrue_b8(), data0n);
+
+        const svbool_t vext15_mask = svcmpge_n_u8(svptrue_b8(), v0n, lanes-1);
+        const svbool_t vext14_mask = svcmpge_n_u8(svptrue_b8(), v0n, lanes-2);
+        svuint8_t vdata_prev1 = svsplice_u8(vext15_mask, vBfr, vdata);
+        svuint8_t vdata_prev2 = svsplice_u8(vext14_mask, vBfr, vdata);
+
+        for ( ; i < datasize; i += lanes)
+        {
+            // hotspot begin
+            svuint8_t vdata_prev1or2 = svorr_u8_z(pred, vdata_prev2, vdata_prev1);
+            svbool_t vmask = svcmpeq_n_u8(svcmpeq_n_u8(pred, vdata_prev1or2, 0), vdata, 1);
+            // hotspot end
+            while (svptest_any(pred, vmask))
+            {
+                const size_t offset = (size_t)svcntp_b8(pred, svbrkb_b_z(pred, vmask)) + i + 1;
+                pStartCodes[numStartCodes].offset = offset;
+                pStartCodes[numStartCodes].nal_header = (offset < datasize) ? pdatain[offset] : 0;
+                if (++numStartCodes == maxStartCodes) {
+                    m_BitBfr = 1;
+                    return offset;
+                }
+                // clear the lane of the start code that was just recorded
+                vmask = svbic_b_z(pred, vmask, svbrka_b_z(pred, vmask));
+            }
+            // hotspot begin
+            pred_next = svwhilelt_b8_u64(i + lanes, datasize);
+            svuint8_t vdata_next = svld1_u8(pred_next, &pdatain[i + lanes]);
+            vdata_prev1 = svsplice_u8(vext15_mask, vdata, vdata_next);
+            vdata_prev2 = svsplice_u8(vext14_mask, vdata, vdata_next);
+            pred = pred_next;
+            vdata = vdata_next;
+            // hotspot end
+        }
+    }
+    if (datasize >= 2) {
+        m_BitBfr = pdatain[datasize-2];
+    }
+    m_BitBfr = (m_BitBfr << 8) | pdatain[datasize >= 1 ? datasize - 1 : 0];
+    return datasize;
+}
+#undef SVE_REGISTER_MAX_BYTES
+
+template<>
+size_t VulkanVideoDecoder::find_emulation_prevention_byte<SIMD_ISA::SVE>(const uint8_t *pdatain, size_t begin, size_t end)
+{
+    const size_t lanes = svcntb();
+    for (size_t i = std::max<size_t>(begin, 2); i < end; i += lanes)
+    {
+        // hotspot begin
+        svbool_t pred = svwhilelt_b8_u64(i, end);
+        svuint8_t vdata = svld1_u8(pred, &pdatain[i]);
+        svuint8_t vdata_prev1 = svld1_u8(pred, &pdatain[i - 1]);
+        svuint8_t vdata_prev2 = svld1_u8(pred, &pdatain[i - 2]);
+        svbool_t vzero = svcmpeq_n_u8(pred, svorr_u8_z(pred, vdata_prev2, vdata_prev1), 0);
+        svbool_t vmask = svcmpeq_n_u8(vzero, vdata, 3);
+        // hotspot end
+        if (svptest_any(pred, vmask))
+        {
+            return i + (size_t)svcntp_b8(pred, svbrkb_b_z(pred, vmask));
+        }
+    }
+    return end;
+}
+
+size_t VulkanVideoDecoder::FindEmulationPreventionByteSVE(const uint8_t *pdatain, size_t begin, size_t end)
+{
+    return find_emulation_prevention_byte<SIMD_ISA::SVE>(pdatain, begin, end);
+}
+
 #endif
\ No newline at end of file
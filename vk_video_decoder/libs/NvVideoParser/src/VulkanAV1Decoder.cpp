@@ -77,6 +77,7 @@ VulkanAV1Decoder::VulkanAV1Decoder(VkVideoCodecOperationFlagBitsKHR std, bool an
     , m_numOutFrames()
     , m_pOutFrame{}
     , m_showableFrame{}
+    , m_tileTable()
 
 {
     for (uint32_t i = 0; i < STD_VIDEO_AV1_NUM_REF_FRAMES; i++) {
@@ -212,6 +213,35 @@ bool VulkanAV1Decoder::end_of_picture(uint32_t frameSize)
     m_pVkPictureData->bitstreamDataLen = frameSize;
     m_pVkPictureData->bitstreamData = m_bitstreamData.GetBitstreamBuffer();
     m_pVkPictureData->bitstreamDataOffset = 0; // TODO: The extra storage in this library and necessarily the app is silly.
+    if (!m_metadataRecords.empty()) {
+        m_pVkPictureData->pMetadataRecords = m_metadataRecords.data();
+        m_pVkPictureData->numMetadataRecords = (uint32_t)m_metadataRecords.size();
+    }
+
+    // Error recovery: an inter frame that predicts from an empty reference slot is dropped, as well as the frames
+    // that follow it up to the next key frame
+    if ((pStd->frame_type == STD_VIDEO_AV1_FRAME_TYPE_INTER) || (pStd->frame_type == STD_VIDEO_AV1_FRAME_TYPE_SWITCH)) {
+        for (uint32_t i = 0; i < STD_VIDEO_AV1_REFS_PER_FRAME; i++) {
+            if ((ref_frame_idx[i] < 0) || !m_pBuffers[ref_frame_idx[i]].buffer) {
+                StartErrorRecovery();
+                break;
+            }
+        }
+    } else if (m_bErrorRecovery && (pStd->frame_type == STD_VIDEO_AV1_FRAME_TYPE_KEY)) {
+        nvParserLog("Resuming at key frame\n");
+        m_bErrorRecovery = false;
+    }
+
+    // Decode-skip policy: a skipped frame is not sent to the client and takes no picture buffer.
+    // The reference slots it refreshes are emptied, so that no later frame can predict from a stale picture.
+    const uint32_t skipFlags = m_decodeSkipPolicy.flags;
+    if (m_bErrorRecovery ||
+        ((skipFlags & VK_PARSER_DECODE_SKIP_NON_KEY_FRAMES) && (pStd->frame_type != STD_VIDEO_AV1_FRAME_TYPE_KEY)) ||
+        ((skipFlags & VK_PARSER_DECODE_SKIP_NON_REFERENCE) && (pStd->refresh_frame_flags == 0))) {
+        UpdateFramePointers(nullptr);
+        m_numSkippedPictures++;
+        return true;
+    }
 
     m_PicData.needsSessionReset = m_bSPSChanged;
     m_bSPSChanged = false;
@@ -220,7 +250,10 @@ bool VulkanAV1Decoder::end_of_picture(uint32_t frameSize)
     memcpy(&m_pVkPictureData->CodecSpecific.av1, &m_PicData, sizeof(m_PicData));
     m_pVkPictureData->intra_pic_flag = (pStd->frame_type == STD_VIDEO_AV1_FRAME_TYPE_KEY);
 
-    if (!BeginPicture(m_pVkPictureData)) {
+    const uint64_t beginPictureStartTime = m_stats.Now();
+    const bool pictureStarted = BeginPicture(m_pVkPictureData);
+    m_stats.AddBeginPictureTime(beginPictureStartTime);
+    if (!pictureStarted) {
         // Error: BeginPicture failed
         return false;
     }
@@ -566,6 +599,38 @@ bool VulkanAV1Decoder::ParseObuTemporalDelimiter()
     return true;
 }
 
+// Records the metadata OBU for the next frame, if m_pictureMetadata is set (the payload is at m_nalu.start_offset)
+void VulkanAV1Decoder::ParseObuMetadata(const uint8_t* pPayload, uint32_t payloadSize)
+{
+    uint32_t metadata_type = 0, metadata_type_size = 0;
+    if (!m_pictureMetadata || !ReadObuSize(pPayload, payloadSize, &metadata_type, &metadata_type_size)) {
+        return;
+    }
+
+    VkParserMetadataRecord record = VkParserMetadataRecord();
+    record.payloadType = metadata_type;
+    switch (metadata_type) {
+    case 1: // METADATA_TYPE_HDR_CLL
+        record.kind = VK_PARSER_METADATA_KIND_CONTENT_LIGHT_LEVEL;
+        break;
+    case 2: // METADATA_TYPE_HDR_MDCV
+        record.kind = VK_PARSER_METADATA_KIND_MASTERING_DISPLAY;
+        break;
+    case 4: // METADATA_TYPE_ITUT_T35
+        record.kind = GetT35MetadataKind(pPayload + metadata_type_size, payloadSize - metadata_type_size);
+        break;
+    case 5: // METADATA_TYPE_TIMECODE
+        record.kind = VK_PARSER_METADATA_KIND_TIME_CODE;
+        break;
+    default:
+        record.kind = VK_PARSER_METADATA_KIND_OTHER;
+        break;
+    }
+    record.offset = (uint32_t)m_nalu.start_offset + metadata_type_size;
+    record.size = payloadSize - metadata_type_size;
+    m_metadataRecords.push_back(record);
+}
+
 void VulkanAV1Decoder::ReadTimingInfoHeader()
 {
     timing_info.num_units_in_display_tick = u(32);  // Number of units in a display tick
@@ -604,7 +669,9 @@ int VulkanAV1Decoder::ChooseOperatingPoint()
             OPInfo.av1.operating_points_idc[i] = m_sps->operating_point_idc[i];
         }
 
-        operating_point = 0; // GetOperatingPoint was deprecated because it always returned 0 - m_pClient->GetOperatingPoint(&OPInfo);
+        // GetOperatingPoint was deprecated because it always returned 0 - m_pClient->GetOperatingPoint(&OPInfo);
+        // The operating point is selected by the decode-skip policy instead (0 by default).
+        operating_point = (int)m_decodeSkipPolicy.av1OperatingPoint;
 
         if (operating_point < 0) {
             assert(!"GetOperatingPoint callback failed");
@@ -859,7 +926,7 @@ bool VulkanAV1Decoder::ParseObuSequenceHeader()
     sps->flags.film_grain_params_present = u(1);
 
     // check_trailing_bits()
-    int bits_before_byte_alignment = 8 - (m_nalu.get_bfroffs % 8);
+    int bits_before_byte_alignment = 8 - (consumed_bits() % 8);
     int trailing = u(bits_before_byte_alignment);
     if (trailing != (1 << (bits_before_byte_alignment - 1))) {
         // trailing bits of SPS corrupted
@@ -879,6 +946,7 @@ bool VulkanAV1Decoder::ParseObuSequenceHeader()
     VkSharedBaseObj<StdVideoPictureParametersSet> picParamObj(m_sps);
     m_PicData.pStdSps = picParamObj.Get();
     if (m_pClient) { // @review need to make sure this has really changed!
+        m_stats.AddParameterSetUpdate();
         bool success = m_pClient->UpdatePictureParameters(picParamObj, m_sps->client);
         assert(success);
         if (!success) {
@@ -1251,6 +1319,7 @@ bool VulkanAV1Decoder::DecodeTileInfo()
             widest_tile_sb = std::max(size_sb, widest_tile_sb);
             start_sb += size_sb;
         }
+        pic_data->MiColStarts[i] = start_sb;
         log2_tile_cols = tile_log2(1, i);
         pic_data->tileInfo.TileCols = i;
 
@@ -1268,10 +1337,20 @@ bool VulkanAV1Decoder::DecodeTileInfo()
             size_sb = pic_data->height_in_sbs_minus_1[i] + 1;
             start_sb += size_sb;
         }
+        pic_data->MiRowStarts[i] = start_sb;
         log2_tile_rows = tile_log2(1, i);
         pic_data->tileInfo.TileRows = i;
     }
 
+    // Size the tile table for all the tiles of the frame, whichever tile groups carry them
+    const size_t numTiles = (size_t)pic_data->tileInfo.TileCols * pic_data->tileInfo.TileRows;
+    if (m_tileTable.size() < (2 * numTiles)) {
+        m_tileTable.resize(2 * numTiles);
+    }
+    pic_data->tileOffsets = m_tileTable.data();
+    pic_data->tileSizes = m_tileTable.data() + numTiles;
+    pic_data->khr_info.tileCount = 0;
+
     pic_data->tileInfo.context_update_tile_id = 0;
     tile_size_bytes_minus_1 = 3;
     if (pic_data->tileInfo.TileRows * pic_data->tileInfo.TileCols > 1) {
@@ -2258,6 +2337,12 @@ bool VulkanAV1Decoder::ParseObuTileGroup(const AV1ObuHeader& hdr)
         tg_end = u(log2_num_tiles);
     }
 
+    // The tile groups of a frame come in order, and fill in the tile table sized by its tile info
+    if ((m_PicData.tileOffsets == nullptr) || (tg_start != (int)m_PicData.khr_info.tileCount) ||
+        (tg_end < tg_start) || (tg_end >= num_tiles)) {
+        return false;
+    }
+
 	byte_alignment();
 	// Tile payload
     int consumedBytes = (consumed_bits() + 7) / 8;
@@ -2272,6 +2357,9 @@ bool VulkanAV1Decoder::ParseObuTileGroup(const AV1ObuHeader& hdr)
         size_t tileSize = 0;
         if (lastTile)
         {
+            if ((uint32_t)consumedBytes > hdr.payload_size) {
+                return false; // Truncated tile group
+            }
             tileSize = hdr.payload_size - consumedBytes;
             m_PicData.tileOffsets[m_PicData.khr_info.tileCount] = (uint32_t)m_nalu.start_offset + (uint32_t)consumedBytes;
         }
@@ -2286,6 +2374,9 @@ bool VulkanAV1Decoder::ParseObuTileGroup(const AV1ObuHeader& hdr)
                 return false; // Tile size too large
             }
             tileSize = (size_t)(tile_size_minus_1 + 1);
+            if (((uint32_t)consumedBytes > hdr.payload_size) || (tileSize > (hdr.payload_size - (uint32_t)consumedBytes))) {
+                return false; // Truncated tile group
+            }
             consumedBytes += (uint32_t)tileSize;
 
             skip_bits((uint32_t)(tileSize * 8));
@@ -2334,7 +2425,12 @@ bool VulkanAV1Decoder::ParseOneFrame(const uint8_t*const pFrameStart, const int3
         temporal_id = hdr.temporal_id;
         spatial_id = hdr.spatial_id;
         if (hdr.type != AV1_OBU_TEMPORAL_DELIMITER && hdr.type != AV1_OBU_SEQUENCE_HEADER && hdr.type != AV1_OBU_PADDING) {
-            if (!IsObuInCurrentOperatingPoint(m_OperatingPointIDCActive, &hdr)) { // TODO: || !DecodeAllLayers
+            const bool aboveMaxTemporalId = (m_decodeSkipPolicy.flags & VK_PARSER_DECODE_SKIP_ABOVE_MAX_TEMPORAL_ID) &&
+                                            ((uint32_t)hdr.temporal_id > m_decodeSkipPolicy.maxTemporalId);
+            if (aboveMaxTemporalId && ((hdr.type == AV1_OBU_FRAME_HEADER) || (hdr.type == AV1_OBU_FRAME))) {
+                m_numSkippedPictures++;
+            }
+            if (aboveMaxTemporalId || !IsObuInCurrentOperatingPoint(m_OperatingPointIDCActive, &hdr)) { // TODO: || !DecodeAllLayers
                 m_nalu.start_offset += hdr.payload_size;
                 pCurrOBU  += (hdr.payload_size + hdr.header_size);
                 remainingFrameBytes -= (hdr.payload_size + hdr.header_size);
@@ -2342,26 +2438,31 @@ bool VulkanAV1Decoder::ParseOneFrame(const uint8_t*const pFrameStart, const int3
             }
         }
 
+        m_stats.AddUnit(hdr.type, hdr.header_size + hdr.payload_size);
+        uint64_t parseStartTime = m_stats.Now();
+
 		// Prime the bit buffer with the 4 bytes
         init_dbits();
         switch (hdr.type) {
         case AV1_OBU_TEMPORAL_DELIMITER:
             ParseObuTemporalDelimiter();
-			memset(m_PicData.tileOffsets, 0, sizeof(m_PicData.tileOffsets));
-			memset(m_PicData.tileSizes, 0, sizeof(m_PicData.tileSizes));
 			m_PicData.khr_info.tileCount = 0;
             break;
 
         case AV1_OBU_SEQUENCE_HEADER:
-            ParseObuSequenceHeader();
+            // A repeated sequence header keeps the current one, along with its session parameters
+            if (!m_parameterSetCache.Lookup(StdVideoPictureParametersSet::AV1_SPS_TYPE, 0,
+                                            pCurrOBU + hdr.header_size, hdr.payload_size) || !m_sps) {
+                if (ParseObuSequenceHeader()) {
+                    m_parameterSetCache.Commit();
+                }
+            }
             break;
 
         case AV1_OBU_FRAME_HEADER:
         case AV1_OBU_FRAME:
         {
-			memset(m_PicData.tileOffsets, 0, sizeof(m_PicData.tileOffsets));
 			m_PicData.khr_info.tileCount = 0;
-			memset(m_PicData.tileSizes, 0, sizeof(m_PicData.tileSizes));
 
             ParseObuFrameHeader();
 
@@ -2379,18 +2480,28 @@ bool VulkanAV1Decoder::ParseOneFrame(const uint8_t*const pFrameStart, const int3
         {
             if (ParseObuTileGroup(hdr)) {
 				// Last tile group for this frame
-                if (!end_of_picture(frameSizeBytes))
+                m_stats.AddParseUnitTime(parseStartTime);
+                const uint64_t endOfPictureStartTime = m_stats.Now();
+                const bool pictureDecoded = end_of_picture(frameSizeBytes);
+                m_stats.AddEndOfPictureTime(endOfPictureStartTime);
+                m_metadataRecords.clear(); // The metadata goes with the first frame that follows it
+                if (!pictureDecoded)
                     return false;
+                parseStartTime = m_stats.Now();
             }
 
             break;
         }
+        case AV1_OBU_METADATA:
+            ParseObuMetadata(pCurrOBU + hdr.header_size, hdr.payload_size);
+            break;
+
         case AV1_OBU_REDUNDANT_FRAME_HEADER:
         case AV1_OBU_PADDING:
-        case AV1_OBU_METADATA:
         default:
             break;
         }
+        m_stats.AddParseUnitTime(parseStartTime);
 
 		// The header was skipped over to parse the payload.
         m_nalu.start_offset += hdr.payload_size;
@@ -2428,11 +2539,14 @@ bool VulkanAV1Decoder::ParseByteStream(const VkParserBitstreamPacket* pck, size_
     // Handle discontinuity
     if (pck->bDiscontinuity) {
         memset(&m_nalu, 0, sizeof(m_nalu));
-        memset(&m_PTSQueue, 0, sizeof(m_PTSQueue));
+        discard_pts_queue();
         m_bDiscontinuityReported = true;
     }
 
     if (pck->bPTSValid) {
+        if (m_PTSQueue[m_lPTSPos].bPTSValid) {
+            m_stats.AddPtsQueueOverflow();
+        }
         m_PTSQueue[m_lPTSPos].bPTSValid = true;
         m_PTSQueue[m_lPTSPos].llPTS = pck->llPTS;
         m_PTSQueue[m_lPTSPos].llPTSPos = m_llParsedBytes;
@@ -2459,10 +2573,13 @@ bool VulkanAV1Decoder::ParseByteStream(const VkParserBitstreamPacket* pck, size_
             memcpy(m_bitstreamData.GetBitstreamPtr(), pdataStart, frame_size);
             m_llNaluStartLocation = m_llFrameStartLocation = m_llParsedBytes; // TODO: NaluStart and FrameStart are always the same here
             m_llParsedBytes += frame_size;
+            // The metadata of a previous packet that was not followed by a frame is gone
+            m_metadataRecords.clear();
 
         }
         int parsedBytes = 0;
         if (!ParseOneFrame(pdataStart, frame_size, pck, &parsedBytes)) {
+            StartErrorRecovery();
             return false;
         }
 
@@ -88,6 +88,24 @@ VulkanH264Decoder::~VulkanH264Decoder()
 
 void VulkanH264Decoder::CreatePrivateContext()
 {
+    if (m_pParserData) {
+        // Warm reset of the parser for a new stream. The client update counts are kept: the client's
+        // parameter set objects outlive the reset, so a reused id must be sent with a new update count.
+        uint64_t spssClientUpdateCount[MAX_NUM_SPS];
+        uint64_t spsmesClientUpdateCount[MAX_NUM_SPS];
+        uint64_t spssvcsClientUpdateCount[MAX_NUM_SPS];
+        uint64_t ppssClientUpdateCount[MAX_NUM_PPS];
+        memcpy(spssClientUpdateCount, m_pParserData->spssClientUpdateCount, sizeof(spssClientUpdateCount));
+        memcpy(spsmesClientUpdateCount, m_pParserData->spsmesClientUpdateCount, sizeof(spsmesClientUpdateCount));
+        memcpy(spssvcsClientUpdateCount, m_pParserData->spssvcsClientUpdateCount, sizeof(spssvcsClientUpdateCount));
+        memcpy(ppssClientUpdateCount, m_pParserData->ppssClientUpdateCount, sizeof(ppssClientUpdateCount));
+        *m_pParserData = H264ParserData();
+        memcpy(m_pParserData->spssClientUpdateCount, spssClientUpdateCount, sizeof(spssClientUpdateCount));
+        memcpy(m_pParserData->spsmesClientUpdateCount, spsmesClientUpdateCount, sizeof(spsmesClientUpdateCount));
+        memcpy(m_pParserData->spssvcsClientUpdateCount, spssvcsClientUpdateCount, sizeof(spssvcsClientUpdateCount));
+        memcpy(m_pParserData->ppssClientUpdateCount, ppssClientUpdateCount, sizeof(ppssClientUpdateCount));
+        return;
+    }
     m_pParserData = new H264ParserData();
 }
 
@@ -171,6 +189,7 @@ void VulkanH264Decoder::EndOfStream()
     m_last_sei_pic_struct = -1;
     m_last_primary_pic_type = -1;
     m_idr_found_flag = false;
+    m_recovery_point_resync = false;
     m_MaxDpbSize = 0;
     m_MaxRefFramesPerView = 0;
 
@@ -181,6 +200,7 @@ void VulkanH264Decoder::EndOfStream()
     for (uint32_t i = 0; i < sizeof (m_ppss) / sizeof (m_ppss[0]); i++) {
         m_ppss[i] = nullptr;
     }
+    m_parameterSetCache.Reset();
 
     // svc
     for (uint32_t i = 0; i < sizeof (m_layer_data) / sizeof (m_layer_data[0]); i++) {
@@ -1075,6 +1095,10 @@ bool VulkanH264Decoder::IsPictureBoundary(int32_t rbsp_size)
     }
     else
     {
+        // An SEI NAL unit that follows the slices starts the next access unit (7.4.1.2.3): it is only kept
+        // in the bitstream buffer with the picture metadata, and must then go with the next picture
+        if ((nal_unit_type == NAL_UNIT_SEI) && m_pictureMetadata)
+            return (m_bitstreamData.GetStreamMarkersCount() > 0);
         if ((nal_unit_type != 1) && (nal_unit_type != 5))
             return (nal_unit_type == 9);    // access_unit_delimiter
     }
@@ -1180,16 +1204,64 @@ bool VulkanH264Decoder::IsPictureBoundary(int32_t rbsp_size)
 }
 
 
+// Applies the decode-skip policy to a coded slice, before its header is parsed.
+// nal_ref_idc and IdrPicFlag are the same for all the slices of a picture, so a skipped picture never reaches
+// dpb_picture_start(): it takes no bitstream buffer and no DPB slot, and leaves the reference marking untouched.
+// The temporal layer cap does not apply to H.264, which is decoded as a single layer.
+// After an error, all the slices are skipped up to an IDR picture or a picture preceded by a recovery point SEI.
+bool VulkanH264Decoder::skip_slice(int nal_ref_idc, bool IdrPicFlag)
+{
+    const uint32_t skipFlags = m_decodeSkipPolicy.flags;
+    const bool first_slice = !!next_bits(1); // first_mb_in_slice == 0
+    const bool recovery_point = (m_recoveryPointCnt >= 0);
+    if (first_slice)
+    {
+        m_recoveryPointCnt = -1; // the recovery point SEI only applies to this picture
+    }
+    if (m_bErrorRecovery && first_slice && (IdrPicFlag || recovery_point))
+    {
+        nvParserLog("Resuming at %s\n", IdrPicFlag ? "IDR picture" : "recovery point");
+        m_bErrorRecovery = false;
+        m_recovery_point_resync = !IdrPicFlag;
+    }
+    if (!(m_bErrorRecovery ||
+          ((skipFlags & VK_PARSER_DECODE_SKIP_NON_REFERENCE) && (nal_ref_idc == 0)) ||
+          ((skipFlags & VK_PARSER_DECODE_SKIP_NON_KEY_FRAMES) && !IdrPicFlag)))
+    {
+        return false;
+    }
+    if (first_slice)
+    {
+        m_numSkippedPictures++;
+    }
+    // The SEI of the skipped picture must not carry over to the next one
+    m_last_sei_pic_struct = -1;
+    m_last_primary_pic_type = -1;
+    m_metadataRecords.clear();
+    return true;
+}
+
+// A gap in frame_num that the SPS does not allow means that reference pictures were lost (7.4.3, 8.2.5.2)
+bool VulkanH264Decoder::frame_num_gap(const seq_parameter_set_s *sps, const slice_header_s *slh) const
+{
+    if (slh->IdrPicFlag || sps->flags.gaps_in_frame_num_value_allowed_flag)
+        return false;
+    const int MaxFrameNum = 1 << (sps->log2_max_frame_num_minus4 + 4); // (7-1)
+    return (slh->frame_num != PrevRefFrameNum) && (slh->frame_num != ((PrevRefFrameNum + 1) % MaxFrameNum));
+}
+
 int32_t VulkanH264Decoder::ParseNalUnit()
 {
     slice_header_s slh;
     int nal_ref_idc, nal_unit_type, picture_boundary;
     int retval = NALU_DISCARD;
 
-    picture_boundary = (m_nalu.start_offset == 0);
+    // The SEI NAL units kept with the picture metadata may precede the first slice
+    picture_boundary = (m_bitstreamData.GetStreamMarkersCount() == 0);
     f(1, 0);    // forbidden_zero_bit
     nal_ref_idc = u(2);
     nal_unit_type = u(5);
+    m_stats.AddUnit(nal_unit_type, m_nalu.end_offset - m_nalu.start_offset - 3);
     if (nal_unit_type == NAL_UNIT_CODED_SLICE_PREFIX || nal_unit_type == NAL_UNIT_CODED_SLICE_SCALABLE)
     {
         if(m_bUseMVC || m_bUseSVC)
@@ -1201,6 +1273,8 @@ int32_t VulkanH264Decoder::ParseNalUnit()
     {
     case NAL_UNIT_CODED_SLICE:
     case NAL_UNIT_CODED_SLICE_IDR:
+        if (skip_slice(nal_ref_idc, (nal_unit_type == NAL_UNIT_CODED_SLICE_IDR)))
+            break;
         if (slice_header(&slh, nal_ref_idc, nal_unit_type))
         {
             if (picture_boundary)
@@ -1215,6 +1289,30 @@ int32_t VulkanH264Decoder::ParseNalUnit()
                         return NALU_UNKNOWN;
                     }
                 }
+                else if (!m_recovery_point_resync && frame_num_gap(sps, &slh))
+                {
+                    // The picture is dropped with the ones that follow it, up to the next random access point
+                    StartErrorRecovery();
+                    if (m_bErrorRecovery)
+                    {
+                        m_numSkippedPictures++;
+                        m_last_sei_pic_struct = -1;
+                        m_last_primary_pic_type = -1;
+                        m_metadataRecords.clear();
+                        break;
+                    }
+                }
+                if (m_recovery_point_resync)
+                {
+                    // Decoding restarts at the recovery point: the frame_num gap to the pictures decoded before the
+                    // error is not filled with "non-existing" frames, the references that are missing are not recovered
+                    if (!slh.IdrPicFlag)
+                    {
+                        const int MaxFrameNum = 1 << (sps->log2_max_frame_num_minus4 + 4);
+                        PrevRefFrameNum = (slh.frame_num + MaxFrameNum - 1) % MaxFrameNum;
+                    }
+                    m_recovery_point_resync = false;
+                }
                 slh.sei_pic_struct = m_last_sei_pic_struct;
                 slh.primary_pic_type = m_last_primary_pic_type;
                 m_last_sei_pic_struct = -1;
@@ -1240,6 +1338,9 @@ int32_t VulkanH264Decoder::ParseNalUnit()
         break;
     case NAL_UNIT_CODED_SLICE_SCALABLE:
     case NAL_UNIT_CODED_SLICE_IDR_SCALABLE:
+        if ((m_bUseMVC || m_bUseSVC) &&
+            skip_slice(nal_ref_idc, m_nhe.svc_extension_flag ? !!m_nhe.svc.idr_flag : !m_nhe.mvc.non_idr_flag))
+            break;
         if ((m_bUseMVC || m_bUseSVC) && (slice_header(&slh, nal_ref_idc, nal_unit_type)))
         {
             if (picture_boundary)
@@ -1297,6 +1398,7 @@ int32_t VulkanH264Decoder::ParseNalUnit()
                 break;
             }
             bitsUsed = consumed_bits();
+            add_sei_metadata(payloadType, payloadSize);
             sei_payload(payloadType, payloadSize);
             // Skip over unknown payloads (NOTE: assumes that emulation prevention bytes are not present)
             skip = payloadSize * 8 - (consumed_bits() - bitsUsed);
@@ -1304,6 +1406,9 @@ int32_t VulkanH264Decoder::ParseNalUnit()
                 skip_bits(skip);
             }
         }
+        if (!m_bUseMVC && !m_bUseSVC) {
+            retval = NALU_METADATA; // kept if add_sei_metadata() recorded messages
+        }
         break;
     case NAL_UNIT_SPS:
         seq_parameter_set_rbsp();
@@ -1511,6 +1616,19 @@ int32_t VulkanH264Decoder::seq_parameter_set_rbsp(SpsNalUnitTarget spsNalUnitTar
     }
     m_last_sps_id = sps_id;
 
+    if (spssvc == nullptr) {
+        if (spsNalUnitTarget == SPS_NAL_UNIT_TARGET_SPS) {
+            if (IsRepeatedParameterSet(StdVideoPictureParametersSet::SPS_TYPE, sps_id) && m_spss[sps_id]) {
+                return sps_id;
+            }
+            // The PPSs must be sent again to refer to the new SPS
+            m_parameterSetCache.InvalidateType(StdVideoPictureParametersSet::PPS_TYPE);
+        } else {
+            // A subset SPS replaces the SPS with the same id
+            m_parameterSetCache.Invalidate(StdVideoPictureParametersSet::SPS_TYPE, sps_id);
+        }
+    }
+
     VkSharedBaseObj<seq_parameter_set_s> sps(spssvc);
     if (spssvc == nullptr) {
         VkResult result = seq_parameter_set_s::Create(0, sps);
@@ -1677,6 +1795,7 @@ int32_t VulkanH264Decoder::seq_parameter_set_rbsp(SpsNalUnitTarget spsNalUnitTar
 
             sps->SetSequenceCount(m_pParserData->spssClientUpdateCount[sps_id]++);
             VkSharedBaseObj<StdVideoPictureParametersSet> picParamObj(sps);
+            m_stats.AddParameterSetUpdate();
             bool success = m_pClient->UpdatePictureParameters(picParamObj, sps->client);
             assert(success);
             if (success == false) {
@@ -1684,6 +1803,9 @@ int32_t VulkanH264Decoder::seq_parameter_set_rbsp(SpsNalUnitTarget spsNalUnitTar
             }
         }
         m_spss[sps_id] = sps;
+        if (spsNalUnitTarget == SPS_NAL_UNIT_TARGET_SPS) {
+            m_parameterSetCache.Commit();
+        }
     }
 
     return sps_id;
@@ -1739,6 +1861,7 @@ bool VulkanH264Decoder::seq_parameter_set_svc_extension_rbsp()
         assert(sps_id == m_last_sps_id);
         spssvc->SetSequenceCount(m_pParserData->spssvcsClientUpdateCount[m_last_sps_id]++);
         VkSharedBaseObj<StdVideoPictureParametersSet> picParamObj(spssvc);
+        m_stats.AddParameterSetUpdate();
         bool success = m_pClient->UpdatePictureParameters(picParamObj, spssvc->client);
         assert(success);
         if (success == false) {
@@ -1846,6 +1969,7 @@ bool VulkanH264Decoder::seq_parameter_set_mvc_extension_rbsp(int32_t sps_id)
 
         m_spss[sps_id]->SetSequenceCount(m_pParserData->spsmesClientUpdateCount[sps_id]++);
         VkSharedBaseObj<StdVideoPictureParametersSet> picParamObj(m_spss[sps_id]);
+        m_stats.AddParameterSetUpdate();
         bool success = m_pClient->UpdatePictureParameters(picParamObj, m_spss[sps_id]->client);
         assert(success);
         if (success == false) {
@@ -1994,7 +2118,7 @@ void VulkanH264Decoder::hrd_parameters(vui_parameters_s *vui, hrd_parameters_s *
         hrd->bit_rate = (ue() + 1) << hrd->bit_rate_scale;   // bit_rate_value_minus1[SchedSelIdx]
         hrd->cbp_size = (ue() + 1) << hrd->cpb_size_scale;   // cpb_size_value_minus1[SchedSelIdx]
         u(1);   // cbr_flag[SchedSelIdx]
-        if (m_nalu.get_offset >= m_nalu.end_offset) { // In case of bitstream error
+        if (end()) { // In case of bitstream error
             break;
         }
     }
@@ -2041,6 +2165,10 @@ bool VulkanH264Decoder::pic_parameter_set_rbsp()
     }
     m_last_sps_id = sps_id;
 
+    if (IsRepeatedParameterSet(StdVideoPictureParametersSet::PPS_TYPE, pps_id) && m_ppss[pps_id]) {
+        return true;
+    }
+
     VkSharedBaseObj<pic_parameter_set_s> pps;
     VkResult result = pic_parameter_set_s::Create(0, pps);
     assert((result == VK_SUCCESS) && pps);
@@ -2165,6 +2293,7 @@ bool VulkanH264Decoder::pic_parameter_set_rbsp()
 
         pps->SetSequenceCount(m_pParserData->ppssClientUpdateCount[pps_id]++);
         VkSharedBaseObj<StdVideoPictureParametersSet> picParamObj(pps);
+        m_stats.AddParameterSetUpdate();
         bool success = m_pClient->UpdatePictureParameters(picParamObj, pps->client);
         assert(success);
         if (success == false) {
@@ -2173,6 +2302,7 @@ bool VulkanH264Decoder::pic_parameter_set_rbsp()
     }
 
     m_ppss[pps_id] = pps;
+    m_parameterSetCache.Commit();
     return true;
 }
 
@@ -3958,6 +4088,7 @@ void VulkanH264Decoder::gaps_in_frame_num_SVC()
 
 void VulkanH264Decoder::dpb_bumping_SVC(dependency_state_s *ds)
 {
+    m_stats.AddDpbBumping();
     // find entry with smallest POC
     int kmin = -1;
     int minPOC = 0;
@@ -4431,6 +4562,8 @@ void VulkanH264Decoder::dpb_bumping(int MaxDpbSize)
 {
     int i, pocMin, iMin, VOIdxMin;
 
+    m_stats.AddDpbBumping();
+
     // select the frame buffer that contains the picture having the smallest value
     // of PicOrderCnt of all pictures in the DPB marked as "needed for output"
     // when PicOrderCnt is the same (MVC), select the picture with smallest VOIdx
@@ -4643,7 +4776,7 @@ void VulkanH264Decoder::sei_payload(int payloadType, int payloadSize)
                     {
                         u(sps->vui.initial_cpb_removal_delay_length);   // initial_cpb_removal_delay
                         u(sps->vui.initial_cpb_removal_delay_length);   // initial_cpb_removal_delay_offset
-                        if (m_nalu.get_offset >= m_nalu.end_offset)     // bitstream error
+                        if (end())     // bitstream error
                             break;
                     }
                 }
@@ -4653,7 +4786,7 @@ void VulkanH264Decoder::sei_payload(int payloadType, int payloadSize)
                     {
                         u(sps->vui.initial_cpb_removal_delay_length); // initial_cpb_removal_delay
                         u(sps->vui.initial_cpb_removal_delay_length); // initial_cpb_removal_delay_offset
-                        if (m_nalu.get_offset >= m_nalu.end_offset)   // bitstream error
+                        if (end())   // bitstream error
                             break;
                     }
                 }
@@ -4677,6 +4810,9 @@ void VulkanH264Decoder::sei_payload(int payloadType, int payloadSize)
             }
         }
         break;
+    case 6: // recovery_point (D.1.7)
+        m_recoveryPointCnt = ue(); // recovery_frame_cnt
+        break;
     case 45: // frame_packing_arrangement
         {
             int frame_packing_arrangement_cancel_flag;
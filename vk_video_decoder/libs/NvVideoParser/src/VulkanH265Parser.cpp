@@ -55,6 +55,21 @@ VulkanH265Decoder::~VulkanH265Decoder()
 
 void VulkanH265Decoder::CreatePrivateContext()
 {
+    if (m_pParserData) {
+        // Warm reset of the parser for a new stream. The client update counts are kept: the client's
+        // parameter set objects outlive the reset, so a reused id must be sent with a new update count.
+        uint64_t spsClientUpdateCount[MAX_NUM_SPS];
+        uint64_t ppsClientUpdateCount[MAX_NUM_PPS];
+        uint64_t vpsClientUpdateCount[MAX_NUM_VPS];
+        memcpy(spsClientUpdateCount, m_pParserData->spsClientUpdateCount, sizeof(spsClientUpdateCount));
+        memcpy(ppsClientUpdateCount, m_pParserData->ppsClientUpdateCount, sizeof(ppsClientUpdateCount));
+        memcpy(vpsClientUpdateCount, m_pParserData->vpsClientUpdateCount, sizeof(vpsClientUpdateCount));
+        *m_pParserData = H265ParserData();
+        memcpy(m_pParserData->spsClientUpdateCount, spsClientUpdateCount, sizeof(spsClientUpdateCount));
+        memcpy(m_pParserData->ppsClientUpdateCount, ppsClientUpdateCount, sizeof(ppsClientUpdateCount));
+        memcpy(m_pParserData->vpsClientUpdateCount, vpsClientUpdateCount, sizeof(vpsClientUpdateCount));
+        return;
+    }
     m_pParserData = new H265ParserData();
 }
 
@@ -101,6 +116,7 @@ void VulkanH265Decoder::EndOfStream()
     }
 
     m_active_vps = nullptr;
+    m_parameterSetCache.Reset();
 
     memset(&m_dpb, 0, sizeof(m_dpb));
     m_dpb_cur = NULL;
@@ -108,6 +124,10 @@ void VulkanH265Decoder::EndOfStream()
     m_bPictureStarted = false;
     m_prevPicOrderCntMsb = 0;
     m_prevPicOrderCntLsb = -1;
+    HandleCraAsBlaFlag = 0;
+    m_bRefPicMissing = 0;
+    m_recoveryPocCnt = -1;
+    m_RecoveryPointPoc = INT_MIN;
     m_display = NULL;
 }
 
@@ -250,6 +270,10 @@ bool VulkanH265Decoder::IsPictureBoundary(int32_t rbsp_size)
     if (((nal_unit_type >= NUT_VPS_NUT) && (nal_unit_type <= NUT_EOB_NUT))
      || ((nal_unit_type >= 41) && (nal_unit_type <= 47)))    // NUT_RSV_NVCL41..47
         return true;
+    // A prefix SEI NAL unit is only kept in the bitstream buffer with the picture metadata, and then goes with
+    // the next picture, unless it carries a decoding unit information message (sent in between the slices)
+    if (nal_unit_type == NUT_PREFIX_SEI_NUT)
+        return m_pictureMetadata && (next_bits(8) != 130);
     // If we get a slice layer rbsp, return a boundary
     if ((nal_unit_type >= NUT_TRAIL_N && nal_unit_type <= NUT_RASL_R) || (nal_unit_type >= NUT_BLA_W_LP && nal_unit_type <= NUT_CRA_NUT))
     {
@@ -264,6 +288,57 @@ bool VulkanH265Decoder::IsPictureBoundary(int32_t rbsp_size)
 }
 
 
+// Applies the decode-skip policy to a slice segment, before its header is parsed (C.5.2.2, 8.1.2):
+// - the sub-layers above the temporal id cap are dropped, which leaves a conforming sub-bitstream,
+// - the sub-layer non-reference pictures are dropped from the highest sub-layer that is decoded only,
+//   since the pictures of the same sub-layer may reference them in the lower ones,
+// - in key frame mode, all the non-IRAP pictures are dropped, RASL and RADL included.
+// A skipped picture never reaches dpb_picture_start(), so it takes no bitstream buffer and no DPB slot.
+// After an error, all the slices are skipped up to an IRAP picture or a picture preceded by a recovery point SEI,
+// and the RASL pictures of a CRA that decoding resumes at are skipped as well, their references being unavailable.
+bool VulkanH265Decoder::skip_slice(int nal_unit_type, int nuh_temporal_id_plus1)
+{
+    const uint32_t skipFlags = m_decodeSkipPolicy.flags;
+    const int TemporalId = nuh_temporal_id_plus1 - 1;
+    int HighestTid = MAX_NUM_SUB_LAYERS - 1;
+    if ((skipFlags & VK_PARSER_DECODE_SKIP_ABOVE_MAX_TEMPORAL_ID) && (m_decodeSkipPolicy.maxTemporalId < (uint32_t)HighestTid)) {
+        HighestTid = (int)m_decodeSkipPolicy.maxTemporalId;
+    }
+    if (m_active_sps[m_nuh_layer_id]) {
+        HighestTid = std::min<int>(HighestTid, m_active_sps[m_nuh_layer_id]->sps_max_sub_layers_minus1);
+    }
+    const bool isIrapPic = (nal_unit_type >= NUT_BLA_W_LP) && (nal_unit_type <= NUT_CRA_NUT);
+    const bool isSubLayerNonReferencePic = (nal_unit_type <= NUT_RASL_R) && !(nal_unit_type & 1);
+    const bool isRaslPic = (nal_unit_type == NUT_RASL_N) || (nal_unit_type == NUT_RASL_R);
+
+    const bool firstSliceSegment = !!next_bits(1); // first_slice_segment_in_pic_flag
+    const int recoveryPointCnt = m_recoveryPointCnt;
+    if (firstSliceSegment) {
+        m_recoveryPointCnt = -1; // The recovery point SEI only applies to this picture
+    }
+    if (m_bErrorRecovery && firstSliceSegment && (TemporalId <= HighestTid) && (isIrapPic || (recoveryPointCnt >= 0))) {
+        nvParserLog("Resuming at %s\n", isIrapPic ? "IRAP picture" : "recovery point");
+        m_bErrorRecovery = false;
+        HandleCraAsBlaFlag = (nal_unit_type == NUT_CRA_NUT);
+        m_recoveryPocCnt = isIrapPic ? -1 : recoveryPointCnt;
+    }
+
+    if (!(m_bErrorRecovery ||
+          ((skipFlags & VK_PARSER_DECODE_SKIP_TO_RANDOM_ACCESS_ON_ERROR) && isRaslPic && NoRaslOutputFlag) ||
+          (TemporalId > HighestTid) ||
+          ((skipFlags & VK_PARSER_DECODE_SKIP_NON_REFERENCE) && isSubLayerNonReferencePic && (TemporalId == HighestTid)) ||
+          ((skipFlags & VK_PARSER_DECODE_SKIP_NON_KEY_FRAMES) && !isIrapPic)))
+    {
+        return false;
+    }
+    if (firstSliceSegment) {
+        m_numSkippedPictures++;
+    }
+    // The prefix SEI of the skipped picture must not carry over to the next one
+    m_metadataRecords.clear();
+    return true;
+}
+
 int32_t VulkanH265Decoder::ParseNalUnit()
 {
     int retval = NALU_DISCARD;
@@ -287,6 +362,7 @@ int32_t VulkanH265Decoder::ParseNalUnit()
         return NALU_DISCARD;
     }
     m_nuh_layer_id = nuh_layer_id;
+    m_stats.AddUnit(nal_unit_type, m_nalu.end_offset - m_nalu.start_offset - 3);
     switch(nal_unit_type)
     {
     case NUT_SPS_NUT:
@@ -300,11 +376,19 @@ int32_t VulkanH265Decoder::ParseNalUnit()
         break;
     case NUT_PREFIX_SEI_NUT:
     case NUT_SUFFIX_SEI_NUT:
-        sei_payload();
+        sei_payload(nal_unit_type == NUT_SUFFIX_SEI_NUT);
+        // A suffix SEI goes with the slices that precede it (kept if sei_payload() recorded messages)
+        if ((nal_unit_type == NUT_PREFIX_SEI_NUT) || (m_bitstreamData.GetStreamMarkersCount() > 0)) {
+            retval = NALU_METADATA;
+        }
         break;
     default:
         if ((nal_unit_type >= NUT_TRAIL_N && nal_unit_type <= NUT_RASL_R) || (nal_unit_type >= NUT_BLA_W_LP && nal_unit_type <= NUT_CRA_NUT))
         {
+            if (skip_slice(nal_unit_type, nuh_temporal_id_plus1))
+            {
+                break;
+            }
             // slice_layer_rbsp
             if (slice_header(nal_unit_type, nuh_temporal_id_plus1))
             {
@@ -321,7 +405,12 @@ int32_t VulkanH265Decoder::ParseNalUnit()
                     }
 
                     if (isIrapPic) {
-                        NoRaslOutputFlag = (nal_unit_type <= NUT_IDR_N_LP); // BLA or IDR
+                        // When only the IRAP pictures are decoded, or when decoding resumes at a CRA after an error,
+                        // the CRA is handled as a BLA (HandleCraAsBlaFlag)
+                        NoRaslOutputFlag = (nal_unit_type <= NUT_IDR_N_LP) || // BLA or IDR
+                                           (m_decodeSkipPolicy.flags & VK_PARSER_DECODE_SKIP_NON_KEY_FRAMES) ||
+                                           HandleCraAsBlaFlag;
+                        HandleCraAsBlaFlag = 0;
                     }
 
                     StdVideoH265SequenceParameterSet* p_active_sps(*m_active_sps[m_nuh_layer_id]);
@@ -336,7 +425,8 @@ int32_t VulkanH265Decoder::ParseNalUnit()
                     }
 
                     if ((isIrapPic && NoRaslOutputFlag) || (discontinuity) || (!m_MaxDpbSize)) {
-                        int NoOutputOfPriorPicsFlag = (slh->nal_unit_type == NUT_CRA_NUT) ? 1 : slh->no_output_of_prior_pics_flag;
+                        int NoOutputOfPriorPicsFlag = ((slh->nal_unit_type == NUT_CRA_NUT) && !(m_decodeSkipPolicy.flags & VK_PARSER_DECODE_SKIP_NON_KEY_FRAMES)) ?
+                                                          1 : slh->no_output_of_prior_pics_flag;
                         if (m_nuh_layer_id == 0) {
                             flush_decoded_picture_buffer(NoOutputOfPriorPicsFlag);
                         }
@@ -361,6 +451,13 @@ int32_t VulkanH265Decoder::ParseNalUnit()
                     m_max_dec_pic_buffering = std::max(sps->max_dec_pic_buffering, vps_max_dec_pic_buffering);
 
                     dpb_picture_start(pps, slh);
+                    if (!m_bPictureStarted) {
+                        // Dropped for a missing reference picture, with the pictures that follow it up to the
+                        // next random access point (skip_slice() drops its other slice segments)
+                        m_numSkippedPictures++;
+                        m_metadataRecords.clear();
+                        return NALU_DISCARD;
+                    }
                     m_intra_pic_flag = 1; // updated further down
                 }
                 else
@@ -393,43 +490,61 @@ int32_t VulkanH265Decoder::ParseNalUnit()
 
 void VulkanH265Decoder::seq_parameter_set_rbsp()
 {
-
-    VkSharedBaseObj<hevc_seq_param_s> sps;
-    VkResult result = hevc_seq_param_s::Create(0, sps);
-    assert((result == VK_SUCCESS) && sps);
-    if (result != VK_SUCCESS) {
-        return;
-    }
-
-    sps->sps_video_parameter_set_id = (uint8_t)u(4);
-    const hevc_video_param_s* vps = m_vpss[sps->sps_video_parameter_set_id];
+    // The syntax elements up to the SPS id are parsed before creating the SPS, which is skipped if repeated
+    const uint8_t sps_video_parameter_set_id = (uint8_t)u(4);
+    const hevc_video_param_s* vps = m_vpss[sps_video_parameter_set_id];
 
     if ((m_nuh_layer_id > 0) && (vps == NULL)) {
         return;
     }
 
     bool MultiLayerExtSpsFlag = false;
+    uint8_t sps_max_sub_layers_minus1 = 0;
     if (m_nuh_layer_id == 0) {
-        sps->sps_max_sub_layers_minus1 = (uint8_t)u(3);
+        sps_max_sub_layers_minus1 = (uint8_t)u(3);
     } else {
         uint8_t tmp = (uint8_t)u(3);
         MultiLayerExtSpsFlag = (m_nuh_layer_id != 0) && (tmp == 7);
-        sps->sps_max_sub_layers_minus1 = (tmp == 7 ? vps->vps_max_sub_layers_minus1 : tmp);
+        sps_max_sub_layers_minus1 = (tmp == 7 ? vps->vps_max_sub_layers_minus1 : tmp);
     }
 
-    if (sps->sps_max_sub_layers_minus1 >= MAX_NUM_SUB_LAYERS) { // fatal
+    if (sps_max_sub_layers_minus1 >= MAX_NUM_SUB_LAYERS) { // fatal
         assert(!"Too many layers");
         return;
     }
 
+    bool sps_temporal_id_nesting_flag = false;
+    StdVideoH265ProfileTierLevel stdProfileTierLevel = StdVideoH265ProfileTierLevel();
     if (!MultiLayerExtSpsFlag) {
-        sps->flags.sps_temporal_id_nesting_flag = u(1);
-        if ((!sps->sps_max_sub_layers_minus1) && (sps->flags.sps_temporal_id_nesting_flag != true)) {
+        sps_temporal_id_nesting_flag = u(1);
+        if ((!sps_max_sub_layers_minus1) && (sps_temporal_id_nesting_flag != true)) {
             return;
         }
-        sps->pProfileTierLevel = profile_tier_level(&sps->stdProfileTierLevel, sps->sps_max_sub_layers_minus1);
+        profile_tier_level(&stdProfileTierLevel, sps_max_sub_layers_minus1);
     }
     uint8_t seq_parameter_set_id = ue();
+    if ((seq_parameter_set_id < MAX_NUM_SPS) &&
+        IsRepeatedParameterSet(StdVideoPictureParametersSet::SPS_TYPE, seq_parameter_set_id) &&
+        m_spss[seq_parameter_set_id]) {
+        return;
+    }
+    // The PPSs must be sent again to refer to the new SPS
+    m_parameterSetCache.InvalidateType(StdVideoPictureParametersSet::PPS_TYPE);
+
+    VkSharedBaseObj<hevc_seq_param_s> sps;
+    VkResult result = hevc_seq_param_s::Create(0, sps);
+    assert((result == VK_SUCCESS) && sps);
+    if (result != VK_SUCCESS) {
+        return;
+    }
+
+    sps->sps_video_parameter_set_id = sps_video_parameter_set_id;
+    sps->sps_max_sub_layers_minus1 = sps_max_sub_layers_minus1;
+    if (!MultiLayerExtSpsFlag) {
+        sps->flags.sps_temporal_id_nesting_flag = sps_temporal_id_nesting_flag;
+        sps->stdProfileTierLevel = stdProfileTierLevel;
+        sps->pProfileTierLevel = &sps->stdProfileTierLevel;
+    }
     bool sps_error = false;
     sps_error |= (seq_parameter_set_id >= MAX_NUM_SPS);
     sps->sps_seq_parameter_set_id = (uint8_t)seq_parameter_set_id;
@@ -698,6 +813,7 @@ void VulkanH265Decoder::seq_parameter_set_rbsp()
 
         sps->SetSequenceCount(m_pParserData->spsClientUpdateCount[seq_parameter_set_id]++);
         VkSharedBaseObj<StdVideoPictureParametersSet> picParamObj(sps);
+        m_stats.AddParameterSetUpdate();
         bool success = m_pClient->UpdatePictureParameters(picParamObj, sps->client);
         assert(success);
         if (success == false) {
@@ -706,11 +822,24 @@ void VulkanH265Decoder::seq_parameter_set_rbsp()
     }
 
     m_spss[seq_parameter_set_id] = sps;
+    m_parameterSetCache.Commit();
 }
 
 
 void VulkanH265Decoder::pic_parameter_set_rbsp()
 {
+    uint32_t pic_parameter_set_id = ue();
+    uint32_t seq_parameter_set_id = ue();
+    if ((pic_parameter_set_id >= MAX_NUM_PPS) || (seq_parameter_set_id >= MAX_NUM_SPS))
+    {
+        nvParserLog("Invalid PPS (pps_id=%d, sps_id=%d)\n", pic_parameter_set_id, seq_parameter_set_id);
+        return;
+    }
+
+    if (IsRepeatedParameterSet(StdVideoPictureParametersSet::PPS_TYPE, pic_parameter_set_id) && m_ppss[pic_parameter_set_id]) {
+        return;
+    }
+
     VkSharedBaseObj<hevc_pic_param_s> pps;
     VkResult result = hevc_pic_param_s::Create(0, pps);
     assert((result == VK_SUCCESS) && pps);
@@ -719,14 +848,6 @@ void VulkanH265Decoder::pic_parameter_set_rbsp()
     }
 
     pps->flags.uniform_spacing_flag = 1;
-
-    uint32_t pic_parameter_set_id = ue();
-    uint32_t seq_parameter_set_id = ue();
-    if ((pic_parameter_set_id >= MAX_NUM_PPS) || (seq_parameter_set_id >= MAX_NUM_SPS))
-    {
-        nvParserLog("Invalid PPS (pps_id=%d, sps_id=%d)\n", pic_parameter_set_id, seq_parameter_set_id);
-        return;
-    }
     pps->pps_pic_parameter_set_id = (uint8_t)pic_parameter_set_id;
     pps->pps_seq_parameter_set_id = (uint8_t)seq_parameter_set_id;
     const hevc_seq_param_s* sps = m_spss[pps->pps_seq_parameter_set_id];
@@ -892,6 +1013,7 @@ void VulkanH265Decoder::pic_parameter_set_rbsp()
 
         pps->SetSequenceCount(m_pParserData->ppsClientUpdateCount[pic_parameter_set_id]++);
         VkSharedBaseObj<StdVideoPictureParametersSet> picParamObj(pps);
+        m_stats.AddParameterSetUpdate();
         bool success = m_pClient->UpdatePictureParameters(picParamObj, pps->client);
         assert(success);
         if (success == false) {
@@ -900,6 +1022,7 @@ void VulkanH265Decoder::pic_parameter_set_rbsp()
     }
 
     m_ppss[pic_parameter_set_id] = pps;
+    m_parameterSetCache.Commit();
 }
 
 /* Decode video parameter set information from the stream. */
@@ -912,6 +1035,13 @@ void VulkanH265Decoder::video_parameter_set_rbsp()
         return;
     }
 
+    if (IsRepeatedParameterSet(StdVideoPictureParametersSet::VPS_TYPE, vps_video_parameter_set_id) && m_vpss[vps_video_parameter_set_id]) {
+        return;
+    }
+    // The SPSs and PPSs must be sent again to refer to the new VPS
+    m_parameterSetCache.InvalidateType(StdVideoPictureParametersSet::SPS_TYPE);
+    m_parameterSetCache.InvalidateType(StdVideoPictureParametersSet::PPS_TYPE);
+
     VkSharedBaseObj<hevc_video_param_s> vps;
     VkResult result = hevc_video_param_s::Create(0, vps);
     assert((result == VK_SUCCESS) && vps);
@@ -1072,6 +1202,7 @@ void VulkanH265Decoder::video_parameter_set_rbsp()
 
         vps->SetSequenceCount(m_pParserData->vpsClientUpdateCount[vps_video_parameter_set_id]++);
         VkSharedBaseObj<StdVideoPictureParametersSet> picParamObj(vps);
+        m_stats.AddParameterSetUpdate();
         bool success = m_pClient->UpdatePictureParameters(picParamObj, vps->client);
         assert(success);
         if (success == false) {
@@ -1080,6 +1211,7 @@ void VulkanH265Decoder::video_parameter_set_rbsp()
     }
 
     m_vpss[vps_video_parameter_set_id] = vps;
+    m_parameterSetCache.Commit();
 
     return;
 } // video_parameter_set_rbsp()
@@ -2603,6 +2735,8 @@ bool VulkanH265Decoder::dpb_bumping(int maxAllowedDpbSize)
     int pocMin = 0;
     int i;
 
+    m_stats.AddDpbBumping();
+
     for (i = 0; i < HEVC_DPB_SIZE; i++)
     {
         if (m_dpb[i].state == 1)
@@ -2684,11 +2818,34 @@ void VulkanH265Decoder::dpb_picture_start(VkSharedBaseObj<hevc_pic_param_s>& pps
     bool isIrapPic = slh->nal_unit_type >= NUT_BLA_W_LP && slh->nal_unit_type <= 23;
 
     int PicOrderCntVal = picture_order_count(slh);
+    const bool isRecoveryPointPic = (m_recoveryPocCnt >= 0);
+    if (isIrapPic && NoRaslOutputFlag) {
+        m_RecoveryPointPoc = INT_MIN;
+    }
+    if (isRecoveryPointPic) {
+        // Decoding resumes at a recovery point (D.3.8): the pictures preceding the recovery point POC in output
+        // order may reference pictures that were never decoded
+        m_RecoveryPointPoc = PicOrderCntVal + m_recoveryPocCnt;
+        m_recoveryPocCnt = -1;
+    }
+    m_bRefPicMissing = 0;
     reference_picture_set(slh, PicOrderCntVal);
+    if (m_bRefPicMissing && !isRecoveryPointPic && (PicOrderCntVal >= m_RecoveryPointPoc)) {
+        // The reference marking of the RPS is kept, but the picture is not decoded. The recovery point picture itself
+        // is exempt: with a recovery_poc_cnt of 0 it would otherwise restart the recovery, since its RPS may still
+        // list the pictures dropped before it.
+        StartErrorRecovery();
+        if (m_bErrorRecovery) {
+            m_bPictureStarted = false;
+            return;
+        }
+    }
     int PicOutputFlag = (((slh->nal_unit_type == NUT_RASL_N) || (slh->nal_unit_type == NUT_RASL_R)) && NoRaslOutputFlag) ? 0 : slh->pic_output_flag;
     if (isIrapPic && NoRaslOutputFlag)
     {
-        int NoOutputOfPriorPicsFlag = (slh->nal_unit_type == NUT_CRA_NUT) ? 1 : slh->no_output_of_prior_pics_flag;
+        // The key frames decoded on their own are all output, CRA included
+        int NoOutputOfPriorPicsFlag = ((slh->nal_unit_type == NUT_CRA_NUT) && !(m_decodeSkipPolicy.flags & VK_PARSER_DECODE_SKIP_NON_KEY_FRAMES)) ?
+                                      1 : slh->no_output_of_prior_pics_flag;
         if (NoOutputOfPriorPicsFlag)
         {
             for (i = 0; i < HEVC_DPB_SIZE; i++)
@@ -3122,6 +3279,7 @@ int VulkanH265Decoder::create_lost_ref_pic(int lostPOC, int layerID, int marking
     {
         nvParserLog("Generating reference picture %d instead of picture %d\n",m_dpb[returnDPBPos].PicOrderCntVal,lostPOC);
     }
+    m_bRefPicMissing = 1;
     return returnDPBPos;
 }
 
@@ -3130,7 +3288,7 @@ int VulkanH265Decoder::create_lost_ref_pic(int lostPOC, int layerID, int marking
 // SEI payload (D.2)
 //
 
-void VulkanH265Decoder::sei_payload()
+void VulkanH265Decoder::sei_payload(bool suffix)
 {
     while (available_bits() >= 3 * 8)
     {
@@ -3154,9 +3312,20 @@ void VulkanH265Decoder::sei_payload()
             break;
         }
         bitsUsed = consumed_bits();
+        add_sei_metadata(payloadType, payloadSize, suffix);
 
         switch (payloadType)
         {
+        case 6: // recovery_point (D.2.8)
+            if (!suffix) {
+                m_recoveryPointCnt = std::max<int32_t>(se(), 0); // recovery_poc_cnt
+            }
+            break;
+        case 132: // decoded_picture_hash (D.2.20)
+            if (suffix) {
+                decoded_picture_hash(payloadSize);
+            }
+            break;
         case 137: // mastering_display_colour_volume
             {
                 mastering_display_colour_volume _display;
@@ -3197,6 +3366,41 @@ void VulkanH265Decoder::sei_payload()
     }
 }
 
+// Records the hash of the picture whose slices precede the suffix SEI, attached to the picture by end_of_picture()
+void VulkanH265Decoder::decoded_picture_hash(int payloadSize)
+{
+    const hevc_seq_param_s* const sps = m_active_sps[m_nuh_layer_id];
+    if ((sps == nullptr) || (m_bitstreamData.GetStreamMarkersCount() == 0)) {
+        return;
+    }
+    const uint32_t hash_type = u(8);
+    const uint32_t numPlanes = (sps->chroma_format_idc == 0) ? 1 : 3;
+    const uint32_t hashSize = (hash_type == 0) ? 16 : (hash_type == 1) ? 2 : (hash_type == 2) ? 4 : 0;
+    if ((hashSize == 0) || ((uint32_t)payloadSize < 1 + numPlanes * hashSize)) {
+        return;
+    }
+
+    VkVideoDecodedPictureHash* const hash = &m_decodedPictureHash;
+    *hash = VkVideoDecodedPictureHash();
+    for (uint32_t cIdx = 0; cIdx < numPlanes; cIdx++) {
+        if (hash_type == 0) {
+            for (uint32_t i = 0; i < 16; i++) {
+                hash->planes[cIdx].md5[i] = (uint8_t)u(8); // picture_md5
+            }
+        } else if (hash_type == 1) {
+            hash->planes[cIdx].crc = u(16); // picture_crc
+        } else {
+            hash->planes[cIdx].checksum = u(32); // picture_checksum
+        }
+    }
+    hash->numPlanes = numPlanes;
+    hash->width = sps->pic_width_in_luma_samples;
+    hash->height = sps->pic_height_in_luma_samples;
+    hash->bitDepthLuma = sps->bit_depth_luma_minus8 + 8;
+    hash->bitDepthChroma = sps->bit_depth_chroma_minus8 + 8;
+    hash->type = VkVideoDecodedPictureHash::TYPE_MD5 + hash_type;
+}
+
 bool VulkanH265Decoder::GetDisplayMasteringInfo(VkParserDisplayMasteringInfo *pdisp)
 {
     if (m_display)
@@ -97,12 +97,15 @@ bool VulkanVP9Decoder::ParseByteStream(const VkParserBitstreamPacket* pck, size_
     // Handle discontinuity
     if (pck->bDiscontinuity) {
         memset(&m_nalu, 0, sizeof(m_nalu));
-        memset(&m_PTSQueue, 0, sizeof(m_PTSQueue));
+        discard_pts_queue();
         m_bDiscontinuityReported = true;
         m_pictureStarted = false;
     }
 
     if (pck->bPTSValid) {
+        if (m_PTSQueue[m_lPTSPos].bPTSValid) {
+            m_stats.AddPtsQueueOverflow();
+        }
         m_PTSQueue[m_lPTSPos].bPTSValid = true;
         m_PTSQueue[m_lPTSPos].llPTS = pck->llPTS;
         m_PTSQueue[m_lPTSPos].llPTSPos = m_llParsedBytes;
@@ -187,7 +190,11 @@ bool VulkanVP9Decoder::ParseByteStream(const VkParserBitstreamPacket* pck, size_
 
                 }
 
+                // A VP9 frame is parsed and sent to the client in one go
+                m_stats.AddUnit(0, frame_size);
+                const uint64_t frameStartTime = m_stats.Now();
                 ParseFrameHeader(frame_size);
+                m_stats.AddEndOfPictureTime(frameStartTime);
 
                 if (frames_in_superframe > 0) {
                     sizeparsed += frame_sizes[framesdone];
@@ -260,7 +267,10 @@ bool VulkanVP9Decoder::ParseFrameHeader(uint32_t framesize)
     m_pVkPictureData->bitstreamData = m_bitstreamData.GetBitstreamBuffer();
     m_pVkPictureData->bitstreamDataOffset = (size_t)(m_nalu.start_offset & ~((int64_t)m_bufferOffsetAlignment - 1));
 
-    if (!BeginPicture(m_pVkPictureData)) {
+    const uint64_t beginPictureStartTime = m_stats.Now();
+    const bool pictureStarted = BeginPicture(m_pVkPictureData);
+    m_stats.AddBeginPictureTime(beginPictureStartTime);
+    if (!pictureStarted) {
         assert(!"BeginPicture failed");
         return false;
     }
@@ -27,6 +27,7 @@ VulkanVideoDecoder::VulkanVideoDecoder(VkVideoCodecOperationFlagBitsKHR std)
     , m_264SvcEnabled(false)
     , m_outOfBandPictureParameters(false)
     , m_initSequenceIsCalled(false)
+    , m_pictureMetadata(false)
     , m_pClient()
     , m_defaultMinBufferSize(2 * 1024 * 1024)
     , m_bufferOffsetAlignment(256)
@@ -60,6 +61,22 @@ VulkanVideoDecoder::VulkanVideoDecoder(VkVideoCodecOperationFlagBitsKHR std)
     , m_bDecoderInitFailed()
     , m_lCheckPTS()
     , m_eError(NV_NO_ERROR)
+    , m_NextStartCode(SIMD_ISA::NOSIMD)
+    , m_rbspBuffer(RBSP_CHUNK_SIZE + RBSP_PADDING_SIZE)
+    , m_pfnParseByteStream(&VulkanVideoDecoder::ParseByteStreamC)
+    , m_pfnFindEmulationPreventionByte(&VulkanVideoDecoder::FindEmulationPreventionByteC)
+    , m_startCodes()
+    , m_pInPlaceNaluData()
+    , m_nalLengthSize(0)
+    , m_deferredCopy()
+    , m_parameterSetCache()
+    , m_decodeSkipPolicy()
+    , m_numSkippedPictures(0)
+    , m_bErrorRecovery(false)
+    , m_recoveryPointCnt(-1)
+    , m_stats()
+    , m_metadataRecords()
+    , m_decodedPictureHash()
 {
     if (m_264SvcEnabled) {
         m_pVkPictureData = new VkParserPictureData[128];
@@ -90,7 +107,16 @@ VkResult VulkanVideoDecoder::Initialize(const VkParserInitDecodeParameters *pPar
         return VK_ERROR_INCOMPATIBLE_DRIVER;
     }
 
-    Deinitialize();
+    // Initializing the parser again starts a new stream. For the same client and bitstream buffer requirements,
+    // this is a warm reset: the codec context and the bitstream buffer of the last stream are kept, rather than
+    // allocated again, which takes the parser setup off the critical path of the clients decoding short streams.
+    const bool warmReset = m_bitstreamData && (m_pClient == pParserPictureData->pClient) &&
+                           (m_bufferOffsetAlignment == pParserPictureData->bufferOffsetAlignment) &&
+                           (m_bufferSizeAlignment == pParserPictureData->bufferSizeAlignment) &&
+                           (m_bitstreamDataLen >= pParserPictureData->defaultMinBufferSize);
+    if (!warmReset) {
+        Deinitialize();
+    }
     m_pClient = pParserPictureData->pClient;
     m_defaultMinBufferSize  = pParserPictureData->defaultMinBufferSize;
     m_bufferOffsetAlignment = pParserPictureData->bufferOffsetAlignment;
@@ -102,6 +128,22 @@ VkResult VulkanVideoDecoder::Initialize(const VkParserInitDecodeParameters *pPar
     m_lFrameDuration = 0;
     m_llExpectedPTS = 0;
     m_bNoStartCodes = false;
+    // Length-prefixed NAL units are only defined for H.264 and H.265 (ISO/IEC 14496-15)
+    m_nalLengthSize = ((m_standard == VK_VIDEO_CODEC_OPERATION_DECODE_H264_BIT_KHR) ||
+                       (m_standard == VK_VIDEO_CODEC_OPERATION_DECODE_H265_BIT_KHR)) ? pParserPictureData->nalLengthSize : 0;
+    if (m_nalLengthSize > 4) {
+        return VK_ERROR_INITIALIZATION_FAILED;
+    }
+    m_decodeSkipPolicy = pParserPictureData->decodeSkipPolicy;
+    m_bErrorRecovery = false;
+    m_recoveryPointCnt = -1;
+    m_pictureMetadata = pParserPictureData->pictureMetadata;
+    m_stats.SetTiming(pParserPictureData->statisticsTiming);
+    m_metadataRecords.clear();
+    m_decodedPictureHash.type = VkVideoDecodedPictureHash::TYPE_NONE;
+    if (m_pictureMetadata) {
+        m_metadataRecords.reserve(16);
+    }
     m_bFilterTimestamps = false;
     m_lCheckPTS = 16;
     m_bEmulBytesPresent = false;
@@ -112,18 +154,23 @@ VkResult VulkanVideoDecoder::Initialize(const VkParserInitDecodeParameters *pPar
         memset(&m_ExtSeqInfo, 0, sizeof(m_ExtSeqInfo));
     }
 
-    m_bitstreamDataLen = m_defaultMinBufferSize; // dynamically increase size if it's not enough
-    VkSharedBaseObj<VulkanBitstreamBuffer> bitstreamBuffer;
-    m_pClient->GetBitstreamBuffer(m_bitstreamDataLen,
-                                  m_bufferOffsetAlignment, m_bufferSizeAlignment,
-                                  nullptr, 0, bitstreamBuffer);
-    assert(bitstreamBuffer);
-    if (!bitstreamBuffer) {
-        return VK_ERROR_OUT_OF_HOST_MEMORY;
+    if (!warmReset) {
+        m_bitstreamDataLen = m_defaultMinBufferSize; // dynamically increase size if it's not enough
+        VkSharedBaseObj<VulkanBitstreamBuffer> bitstreamBuffer;
+        m_pClient->GetBitstreamBuffer(m_bitstreamDataLen,
+                                      m_bufferOffsetAlignment, m_bufferSizeAlignment,
+                                      nullptr, 0, bitstreamBuffer);
+        assert(bitstreamBuffer);
+        if (!bitstreamBuffer) {
+            return VK_ERROR_OUT_OF_HOST_MEMORY;
+        }
+        m_bitstreamDataLen = m_bitstreamData.SetBitstreamBuffer(bitstreamBuffer);
     }
-    m_bitstreamDataLen = m_bitstreamData.SetBitstreamBuffer(bitstreamBuffer);
-    CreatePrivateContext();
+    CreatePrivateContext(); // Resets the context of a warm reset
     memset(&m_nalu, 0, sizeof(m_nalu));
+    memset(&m_deferredCopy, 0, sizeof(m_deferredCopy));
+    m_pInPlaceNaluData = nullptr;
+    m_parameterSetCache.Reset();
     memset(&m_PrevSeqInfo, 0, sizeof(m_PrevSeqInfo));
     memset(&m_DispInfo, 0, sizeof(m_DispInfo));
     memset(&m_PTSQueue, 0, sizeof(m_PTSQueue));
@@ -137,7 +184,42 @@ VkResult VulkanVideoDecoder::Initialize(const VkParserInitDecodeParameters *pPar
     m_lPTSPos = 0;
     InitParser();
     memset(&m_nalu, 0, sizeof(m_nalu)); // reset nalu again (in case parser used init_dbits during initialization)
+    // The ISA specific kernels are selected once here, rather than for every packet
     m_NextStartCode = check_simd_support();
+    m_pfnParseByteStream = &VulkanVideoDecoder::ParseByteStreamC;
+    m_pfnFindEmulationPreventionByte = &VulkanVideoDecoder::FindEmulationPreventionByteC;
+#if !defined(DISABLE_VK_VIDEO_PARSER_SIMD_OPTIMIZATIONS)
+#if defined(__x86_64__) || defined (_M_X64)
+    if (m_NextStartCode == SIMD_ISA::AVX512)
+    {
+        m_pfnParseByteStream = &VulkanVideoDecoder::ParseByteStreamAVX512;
+        m_pfnFindEmulationPreventionByte = &VulkanVideoDecoder::FindEmulationPreventionByteAVX512;
+    }
+    else if (m_NextStartCode == SIMD_ISA::AVX2)
+    {
+        m_pfnParseByteStream = &VulkanVideoDecoder::ParseByteStreamAVX2;
+        m_pfnFindEmulationPreventionByte = &VulkanVideoDecoder::FindEmulationPreventionByteAVX2;
+    }
+    else if (m_NextStartCode == SIMD_ISA::SSSE3)
+    {
+        m_pfnParseByteStream = &VulkanVideoDecoder::ParseByteStreamSSSE3;
+        m_pfnFindEmulationPreventionByte = &VulkanVideoDecoder::FindEmulationPreventionByteSSSE3;
+    }
+#elif defined(__aarch64__) || defined(__ARM_ARCH_7A__) || defined(_M_ARM64)
+#if defined(__aarch64__)
+    if (m_NextStartCode == SIMD_ISA::SVE)
+    {
+        m_pfnParseByteStream = &VulkanVideoDecoder::ParseByteStreamSVE;
+        m_pfnFindEmulationPreventionByte = &VulkanVideoDecoder::FindEmulationPreventionByteSVE;
+    } else
+#endif //__aarch64__
+    if (m_NextStartCode == SIMD_ISA::NEON)
+    {
+        m_pfnParseByteStream = &VulkanVideoDecoder::ParseByteStreamNEON;
+        m_pfnFindEmulationPreventionByte = &VulkanVideoDecoder::FindEmulationPreventionByteNEON;
+    }
+#endif
+#endif // DISABLE_VK_VIDEO_PARSER_SIMD_OPTIMIZATIONS
 
     return VK_SUCCESS;
 }
@@ -153,50 +235,79 @@ bool VulkanVideoDecoder::Deinitialize()
 
 void VulkanVideoDecoder::init_dbits()
 {
-    m_nalu.get_offset = m_nalu.start_offset + ((m_bNoStartCodes) ? 0 : 3);  // Skip over start_code_prefix
-    m_nalu.get_zerocnt = 0;
+    m_nalu.get_prefix = (m_bNoStartCodes) ? 0 : 3;  // Skip over start_code_prefix
+    m_nalu.get_offset = m_nalu.start_offset + m_nalu.get_prefix;
     m_nalu.get_emulcnt = 0;
-    m_nalu.get_bfr = 0;
-    // prime bit buffer
-    m_nalu.get_bfroffs = 32;
-    skip_bits(0);
+    m_nalu.rbsp_bitpos = 0;
+    if (m_bEmulBytesPresent)
+    {
+        // The RBSP is unescaped on demand into the scratch buffer
+        m_nalu.rbsp = m_rbspBuffer.data();
+        m_nalu.rbsp_size = 0;
+    } else
+    {
+        // No emulation prevention bytes: read the byte stream buffer directly
+        const int64_t size = m_nalu.end_offset - m_nalu.get_offset;
+        m_nalu.rbsp = (!!m_bitstreamData && (size > 0)) ? nalu_data(m_nalu.get_offset) : nullptr;
+        m_nalu.rbsp_size = (m_nalu.rbsp != nullptr) ? (size_t)size : 0;
+        m_nalu.get_offset = std::max(m_nalu.get_offset, m_nalu.end_offset);
+    }
 }
 
 
-void VulkanVideoDecoder::skip_bits(uint32_t n)
+void VulkanVideoDecoder::rbsp_unescape(size_t rbspBytesNeeded)
 {
-    m_nalu.get_bfroffs += n;
-    while (m_nalu.get_bfroffs >= 8)
+    if (!m_bitstreamData)
+        return;
+    const int64_t payloadOffset = m_nalu.start_offset + m_nalu.get_prefix;
+    const uint8_t* pPayload = nalu_data(payloadOffset);
+    const size_t payloadSize = (size_t)(m_nalu.end_offset - payloadOffset);
+    while ((m_nalu.rbsp_size < rbspBytesNeeded) && (m_nalu.get_offset < m_nalu.end_offset))
     {
-        m_nalu.get_bfr <<= 8;
-        if (m_nalu.get_offset < m_nalu.end_offset)
+        size_t rawOffset = (size_t)(m_nalu.get_offset - payloadOffset);
+        const size_t rawEnd = std::min<size_t>(payloadSize, rawOffset + std::max<size_t>(rbspBytesNeeded - m_nalu.rbsp_size, RBSP_CHUNK_SIZE));
+        if (m_rbspBuffer.size() < (m_nalu.rbsp_size + (rawEnd - rawOffset) + RBSP_PADDING_SIZE))
         {
-            VkDeviceSize c = m_bitstreamData[m_nalu.get_offset++];
-            if (m_bEmulBytesPresent)
+            m_rbspBuffer.resize(std::max<size_t>(2 * m_rbspBuffer.size(), m_nalu.rbsp_size + (rawEnd - rawOffset) + RBSP_PADDING_SIZE));
+        }
+        uint8_t* pRbsp = m_rbspBuffer.data();
+        // Copy the runs in between emulation_prevention_three_bytes
+        while (rawOffset < rawEnd)
+        {
+            const size_t emulOffset = m_pfnFindEmulationPreventionByte(pPayload, rawOffset, rawEnd);
+            memcpy(pRbsp + m_nalu.rbsp_size, pPayload + rawOffset, emulOffset - rawOffset);
+            m_nalu.rbsp_size += emulOffset - rawOffset;
+            rawOffset = emulOffset;
+            if (emulOffset < rawEnd)
             {
-                // detect / discard emulation_prevention_three_byte
-                if (m_nalu.get_zerocnt == 2)
-                {
-                    if (c == 3)
-                    {
-                        m_nalu.get_zerocnt = 0;
-                        c = (m_nalu.get_offset < m_nalu.end_offset) ? m_bitstreamData[m_nalu.get_offset] : 0;
-                        m_nalu.get_offset++;
-                        m_nalu.get_emulcnt++;
-                    }
-                }
-                if (c != 0)
-                    m_nalu.get_zerocnt = 0;
-                else
-                    m_nalu.get_zerocnt += (m_nalu.get_zerocnt < 2);
+                rawOffset++; // discard emulation_prevention_three_byte
+                m_nalu.get_emulcnt++;
             }
-            m_nalu.get_bfr |= c;
-        } else
+        }
+        memset(pRbsp + m_nalu.rbsp_size, 0, RBSP_PADDING_SIZE);
+        m_nalu.rbsp = pRbsp;
+        m_nalu.get_offset = payloadOffset + rawOffset;
+    }
+}
+
+
+uint64_t VulkanVideoDecoder::peek_bits_slow(size_t byteOffset)
+{
+    if (m_bEmulBytesPresent)
+    {
+        rbsp_unescape(byteOffset + 8);
+        if ((byteOffset + 8) <= m_nalu.rbsp_size)
         {
-            m_nalu.get_offset++;
+            return read_be64(m_nalu.rbsp + byteOffset);
         }
-        m_nalu.get_bfroffs -= 8;
     }
+    // End of the NAL unit: the bits past the end read as zeros
+    uint64_t bits = 0;
+    for (size_t i = byteOffset; i < byteOffset + 8; i++)
+    {
+        bits = (bits << 8) | ((i < m_nalu.rbsp_size) ? m_nalu.rbsp[i] : 0);
+    }
+    return bits;
 }
 
 void VulkanVideoDecoder::rbsp_trailing_bits()
@@ -209,39 +320,17 @@ void VulkanVideoDecoder::rbsp_trailing_bits()
 bool VulkanVideoDecoder::more_rbsp_data()
 {
     // If the NAL unit contains any non-zero bits past the next bit we have more RBSP data.
-    // These non-zero bits may either already be in bfr (first check)
+    // These non-zero bits may either already be in the 57 bits window (first check)
     // or may not have been read yet (second check).
-    // Note that the assumption that end() == false implies that there are more unread
+    // Note that the assumption that available bits past the window imply that there are more unread
     // non-zero bits is invalid for CABAC slices (because of cabac_zero_word). This is not
-    // a problem because more_rbsp_data is not used in CABAC slices. 
-    return (m_nalu.get_bfr << (m_nalu.get_bfroffs+1)) != 0 || !end();
-}
-
-uint32_t VulkanVideoDecoder::u(uint32_t n)
-{
-    uint32_t bits = 0;
-    
-    if (n > 0)
-    {
-        if (n + m_nalu.get_bfroffs <= 32)
-        {
-            bits = next_bits(n);
-            skip_bits(n);
-        } else
-        {
-            // n == 26..32
-            bits = next_bits(n-25) << 25;
-            skip_bits(n-25);
-            bits |= next_bits(25);
-            skip_bits(25);
-        }
-    }
-    return bits;
+    // a problem because more_rbsp_data is not used in CABAC slices.
+    return ((peek_bits() << 1) >> 8) != 0 || (available_bits() > 57);
 }
 
 
-// 9.1
-uint32_t VulkanVideoDecoder::ue()
+// 9.1 (codewords that don't fit in the peek_bits() window, normally only seen in corrupted streams)
+uint32_t VulkanVideoDecoder::ue_slow()
 {
     int leadingZeroBits, b, codeNum;
 
@@ -260,42 +349,52 @@ uint32_t VulkanVideoDecoder::ue()
     return codeNum;
 }
 
-
-// 9.1.1
-int32_t VulkanVideoDecoder::se()
-{
-    uint32_t eg = ue();  // Table 9-3
-    int32_t codeNum;
-    
-    if (eg & 1)
-        codeNum = (int32_t)((eg>>1)+1);
-    else
-        codeNum = -(int32_t)(eg>>1);
-    return codeNum;
-}
-
 bool VulkanVideoDecoder::resizeBitstreamBuffer(VkDeviceSize extraBytes)
 {
+    flush_deferred_copy();
+
     // increasing min 2MB size per resizeBitstreamBuffer()
     VkDeviceSize newBitstreamDataLen = m_bitstreamDataLen + std::max<VkDeviceSize>(extraBytes, (2 * 1024 * 1024));
 
-    VkDeviceSize retSize = m_bitstreamData.ResizeBitstreamBuffer(newBitstreamDataLen, m_bitstreamDataLen, 0);
-    if (retSize < newBitstreamDataLen)
+    // Get the larger buffer from the client, which pools them, with the current data copied over
+    VkSharedBaseObj<VulkanBitstreamBuffer> currentBitstreamBuffer(m_bitstreamData.GetBitstreamBuffer());
+    VkSharedBaseObj<VulkanBitstreamBuffer> newBitstreamBuffer;
+    VkDeviceSize maxSize = 0;
+    const uint8_t* pCopyData = currentBitstreamBuffer->GetReadOnlyDataPtr(0, maxSize);
+    VkDeviceSize retSize = m_pClient->GetBitstreamBuffer(newBitstreamDataLen,
+                                                         m_bufferOffsetAlignment, m_bufferSizeAlignment,
+                                                         pCopyData, m_bitstreamDataLen, newBitstreamBuffer);
+    if (!newBitstreamBuffer || (retSize < newBitstreamDataLen))
     {
         assert(!"bitstream buffer resize failed");
         nvParserLog("ERROR: bitstream buffer resize failed\n");
         return false;
     }
+    m_stats.AddBitstreamBufferResize();
 
-    m_bitstreamDataLen = (VkDeviceSize)retSize;
+    // Keep the slices of the current picture
+    uint32_t numStreamMarkers = 0;
+    const uint32_t* pStreamMarkers = currentBitstreamBuffer->GetStreamMarkersPtr(0, numStreamMarkers);
+    m_bitstreamDataLen = m_bitstreamData.SetBitstreamBuffer(newBitstreamBuffer);
+    for (uint32_t i = 0; i < numStreamMarkers; i++)
+    {
+        m_bitstreamData.AddStreamMarker(pStreamMarkers[i]);
+    }
     return true;
 }
 
 VkDeviceSize VulkanVideoDecoder::swapBitstreamBuffer(VkDeviceSize copyCurrBuffOffset, VkDeviceSize copyCurrBuffSize)
 {
+    flush_deferred_copy();
+
     VkSharedBaseObj<VulkanBitstreamBuffer> currentBitstreamBuffer(m_bitstreamData.GetBitstreamBuffer());
     VkSharedBaseObj<VulkanBitstreamBuffer> newBitstreamBuffer;
     VkDeviceSize newBufferSize = currentBitstreamBuffer->GetMaxSize();
+    // Keep only the data written so far, so that a buffer from a ring can give back its unused end
+    VkDeviceSize usedSize = std::max<VkDeviceSize>(m_nalu.end_offset, copyCurrBuffOffset + copyCurrBuffSize);
+    if ((usedSize > 0) && (usedSize < newBufferSize)) {
+        currentBitstreamBuffer->Resize(usedSize);
+    }
     const uint8_t* pCopyData = nullptr;
     if (copyCurrBuffSize) {
         VkDeviceSize maxSize = 0;
@@ -309,42 +408,245 @@ VkDeviceSize VulkanVideoDecoder::swapBitstreamBuffer(VkDeviceSize copyCurrBuffOf
         assert(!"Cound't GetBitstreamBuffer()!");
         return false;
     }
+    m_stats.AddBitstreamSwapCopy(copyCurrBuffSize);
     // m_bitstreamDataLen = newBufferSize;
     return m_bitstreamData.SetBitstreamBuffer(newBitstreamBuffer);
 }
 
-bool VulkanVideoDecoder::ParseByteStream(const VkParserBitstreamPacket* pck, size_t *pParsedBytes)
+void VulkanVideoDecoder::defer_copy(const uint8_t* pSrc, int64_t dstOffset, int64_t size)
 {
-#if !defined(DISABLE_VK_VIDEO_PARSER_SIMD_OPTIMIZATIONS)
-#if defined(__x86_64__) || defined (_M_X64)
-    if (m_NextStartCode == SIMD_ISA::AVX512)
+    // Slices are usually contiguous both in the packet and in the bitstream buffer
+    if ((m_deferredCopy.size > 0) &&
+        ((m_deferredCopy.pSrc + m_deferredCopy.size) == pSrc) &&
+        ((m_deferredCopy.dst_offset + m_deferredCopy.size) == dstOffset))
     {
-        return ParseByteStreamAVX512(pck, pParsedBytes);
+        m_deferredCopy.size += size;
+        return;
     }
-    else if (m_NextStartCode == SIMD_ISA::AVX2)
+    flush_deferred_copy();
+    m_deferredCopy.pSrc = pSrc;
+    m_deferredCopy.dst_offset = dstOffset;
+    m_deferredCopy.size = size;
+}
+
+void VulkanVideoDecoder::flush_deferred_copy()
+{
+    if (m_deferredCopy.size > 0)
     {
-        return ParseByteStreamAVX2(pck, pParsedBytes);
+        assert((VkDeviceSize)(m_deferredCopy.dst_offset + m_deferredCopy.size) <= m_bitstreamDataLen);
+        VkSharedBaseObj<VulkanBitstreamBuffer> bitstreamBuffer(m_bitstreamData.GetBitstreamBuffer());
+        bitstreamBuffer->CopyDataFromBuffer(m_deferredCopy.pSrc, 0, m_deferredCopy.dst_offset, m_deferredCopy.size);
     }
-    else if (m_NextStartCode == SIMD_ISA::SSSE3)
+    memset(&m_deferredCopy, 0, sizeof(m_deferredCopy));
+}
+
+void VulkanVideoDecoder::StartErrorRecovery()
+{
+    if ((m_decodeSkipPolicy.flags & VK_PARSER_DECODE_SKIP_TO_RANDOM_ACCESS_ON_ERROR) && !m_bErrorRecovery)
     {
-        return ParseByteStreamSSSE3(pck, pParsedBytes);
-    } else
-#elif defined(__aarch64__) || defined(__ARM_ARCH_7A__) || defined(_M_ARM64)
-#if defined(__aarch64__)
-    if (m_NextStartCode == SIMD_ISA::SVE)
+        nvParserLog("Stream error: skipping to the next random access point\n");
+        m_bErrorRecovery = true;
+        m_stats.AddErrorRecovery();
+    }
+}
+
+bool VulkanVideoDecoder::GetStatistics(VkParserStatistics* pStats) const
+{
+    if (!m_stats.Get(pStats)) {
+        return false;
+    }
+    pStats->skippedPictures = GetNumSkippedPictures();
+    return true;
+}
+
+void VulkanVideoDecoder::add_sei_metadata(uint32_t payloadType, uint32_t payloadSize, bool suffix)
+{
+    if (!m_pictureMetadata || m_bNoStartCodes || !byte_aligned()) {
+        return;
+    }
+    // sei_message() starts after the NAL unit header: map the RBSP range of the payload to the escaped data
+    const int64_t dataOffset = m_nalu.start_offset + m_nalu.get_prefix;
+    const uint8_t* pData = nalu_data(dataOffset);
+    const size_t dataSize = (size_t)(m_nalu.end_offset - dataOffset);
+    const size_t rbspBegin = m_nalu.rbsp_bitpos >> 3;
+    const size_t rbspEnd = rbspBegin + payloadSize;
+    size_t rawBegin = rbspBegin, rawEnd = rbspEnd;
+    if (m_bEmulBytesPresent)
     {
-        return ParseByteStreamSVE(pck, pParsedBytes);
-    } else
-#endif //__aarch64__
-    if (m_NextStartCode == SIMD_ISA::NEON)
+        size_t rbspOffset = 0, zeros = 0;
+        rawBegin = rawEnd = dataSize;
+        for (size_t i = 0; i < dataSize; i++)
+        {
+            if ((zeros >= 2) && (pData[i] == 0x03))
+            {
+                zeros = 0; // emulation_prevention_three_byte
+                continue;
+            }
+            if (rbspOffset == rbspBegin) {
+                rawBegin = std::min(rawBegin, i);
+            }
+            if (rbspOffset == rbspEnd)
+            {
+                rawEnd = i;
+                break;
+            }
+            zeros = (pData[i] == 0) ? (zeros + 1) : 0;
+            rbspOffset++;
+        }
+    }
+    if ((rawBegin > rawEnd) || (rawEnd > dataSize)) {
+        return;
+    }
+
+    VkParserMetadataRecord record = VkParserMetadataRecord();
+    record.payloadType = payloadType;
+    record.kind = VK_PARSER_METADATA_KIND_OTHER;
+    switch (payloadType)
     {
-        return ParseByteStreamNEON(pck, pParsedBytes);
-    } else
-#endif
-#endif // DISABLE_VK_VIDEO_PARSER_SIMD_OPTIMIZATIONS
+    case 4: // user_data_registered_itu_t_t35
+        record.kind = GetT35MetadataKind(pData + rawBegin, rawEnd - rawBegin);
+        break;
+    case 5: // user_data_unregistered
+        record.kind = VK_PARSER_METADATA_KIND_USER_DATA_UNREGISTERED;
+        break;
+    case 136: // time_code (H.265 only)
+        if (m_standard == VK_VIDEO_CODEC_OPERATION_DECODE_H265_BIT_KHR) {
+            record.kind = VK_PARSER_METADATA_KIND_TIME_CODE;
+        }
+        break;
+    case 137: // mastering_display_colour_volume
+        record.kind = VK_PARSER_METADATA_KIND_MASTERING_DISPLAY;
+        break;
+    case 144: // content_light_level_info
+        record.kind = VK_PARSER_METADATA_KIND_CONTENT_LIGHT_LEVEL;
+        break;
+    default:
+        break;
+    }
+    assert((dataOffset + rawEnd) <= std::numeric_limits<uint32_t>::max());
+    record.offset = (uint32_t)(dataOffset + rawBegin);
+    record.size = (uint32_t)(rawEnd - rawBegin);
+    record.suffix = suffix;
+    record.emulationPrevention = (record.size != payloadSize);
+    m_metadataRecords.push_back(record);
+}
+
+VkParserMetadataKind VulkanVideoDecoder::GetT35MetadataKind(const uint8_t* pPayload, size_t payloadSize)
+{
+    // ATSC A/53: itu_t_t35_country_code (United States), itu_t_t35_provider_code (ATSC), user_identifier 'GA94',
+    // user_data_type_code 0x03 (cc_data)
+    static const uint8_t a53ClosedCaptions[] = { 0xB5, 0x00, 0x31, 'G', 'A', '9', '4', 0x03 };
+    if ((payloadSize >= sizeof(a53ClosedCaptions)) && !memcmp(pPayload, a53ClosedCaptions, sizeof(a53ClosedCaptions))) {
+        return VK_PARSER_METADATA_KIND_CLOSED_CAPTIONS;
+    }
+    return VK_PARSER_METADATA_KIND_ITU_T_T35;
+}
+
+void VulkanVideoDecoder::discard_pts_queue()
+{
+    uint64_t numDropped = 0;
+    for (int i = 0; i < MAX_QUEUED_PTS; i++) {
+        if (m_PTSQueue[i].bPTSValid) {
+            numDropped++;
+        }
+    }
+    m_stats.AddPtsDrops(numDropped);
+    memset(&m_PTSQueue, 0, sizeof(m_PTSQueue));
+}
+
+bool VulkanVideoDecoder::IsRepeatedParameterSet(uint32_t type, uint32_t id)
+{
+    // The whole NAL unit, including its header
+    const int64_t payloadOffset = m_nalu.start_offset + m_nalu.get_prefix;
+    const int64_t payloadSize = m_nalu.end_offset - payloadOffset;
+    if (!m_bitstreamData || (payloadSize <= 0)) {
+        return false;
+    }
+    return m_parameterSetCache.Lookup(type, id, nalu_data(payloadOffset), (size_t)payloadSize);
+}
+
+bool VulkanVideoDecoder::ParseByteStream(const VkParserBitstreamPacket* pck, size_t *pParsedBytes)
+{
+    return (this->*m_pfnParseByteStream)(pck, pParsedBytes);
+}
+
+bool VulkanVideoDecoder::ParseLengthPrefixedNalUnits(const VkParserBitstreamPacket* pck, const uint8_t* pdatain, VkDeviceSize datasize,
+                                                     unsigned int framesinpkt, size_t *pParsedBytes)
+{
+    // The packet only contains complete NAL units: each one is parsed in place and, if it is a slice, copied to the
+    // bitstream buffer after a 00.00.01 start code prefix. Between NAL units, m_nalu.end_offset == m_nalu.start_offset.
+    while (datasize >= m_nalLengthSize)
+    {
+        // If bPartialParsing is set, we return immediately once we decoded or displayed a frame
+        if ((pck->bPartialParsing) && (m_nCallbackEventCount != 0))
+        {
+            break;
+        }
+        VkDeviceSize nalSize = 0;
+        for (uint32_t i = 0; i < m_nalLengthSize; i++)
+        {
+            nalSize = (nalSize << 8) | pdatain[i];
+        }
+        if (nalSize > (datasize - m_nalLengthSize))
+        {
+            nvParserLog("ERROR: NAL unit length (%llu) exceeds the packet data (%llu)\n",
+                        (unsigned long long)nalSize, (unsigned long long)(datasize - m_nalLengthSize));
+            m_eError = NV_NON_COMPLIANT_STREAM;
+            StartErrorRecovery();
+            break;
+        }
+        // Make room for the start code prefix, the NAL unit and the start code prefix padding the picture data
+        if (((VkDeviceSize)(m_nalu.start_offset + 3 + nalSize + 3) > m_bitstreamDataLen) &&
+                !resizeBitstreamBuffer(m_nalu.start_offset + 3 + nalSize + 3 - m_bitstreamDataLen)) {
+            return false;
+        }
+        m_bitstreamData.SetSliceStartCodeAtOffset(m_nalu.start_offset);
+        m_nalu.end_offset = m_nalu.start_offset + 3 + nalSize;
+        m_llNaluStartLocation = m_llParsedBytes;
+        m_llParsedBytes += m_nalLengthSize + nalSize;
+        m_pInPlaceNaluData = pdatain + m_nalLengthSize;
+        nal_unit();
+        m_pInPlaceNaluData = NULL;
+        if (m_bDecoderInitFailed)
+        {
+            flush_deferred_copy();
+            return false;
+        }
+        pdatain += m_nalLengthSize + nalSize;
+        datasize -= m_nalLengthSize + nalSize;
+    }
+    // The packet data is only valid during this call
+    flush_deferred_copy();
+    if (pParsedBytes)
     {
-        return ParseByteStreamC(pck, pParsedBytes);
+        assert(datasize < std::numeric_limits<size_t>::max());
+        *pParsedBytes = pck->nDataLength - (size_t)datasize;
     }
+    if (pck->bEOP || pck->bEOS)
+    {
+        // Pad the data after the last NAL unit with start_code_prefix
+        m_bitstreamData.SetSliceStartCodeAtOffset(m_nalu.start_offset);
+        m_nalu.end_offset = m_nalu.start_offset + 3;
+
+        // Decode the current picture
+        if ((!pck->bEOP) || (pck->bEOP && framesinpkt < 1))
+        {
+            end_of_picture();
+
+            m_bitstreamDataLen = swapBitstreamBuffer(0, 0);
+        }
+        m_nalu.end_offset = 0;
+        m_nalu.start_offset = 0;
+        m_bitstreamData.ResetStreamMarkers();
+        m_llNaluStartLocation = m_llParsedBytes;
+        if (pck->bEOS)
+        {
+            // Flush everything, release all picture buffers
+            end_of_stream();
+        }
+    }
+
+    return (m_eError == NV_NO_ERROR ? true : false);
 }
 
 void VulkanVideoDecoder::nal_unit()
@@ -356,24 +658,37 @@ void VulkanVideoDecoder::nal_unit()
         init_dbits();
         if (IsPictureBoundary(available_bits() >> 3))
         {
-            if (m_nalu.start_offset > 0)
+            // The data kept ahead of the first slice (metadata) already belongs to the new picture
+            if ((m_nalu.start_offset > 0) && (m_bitstreamData.GetStreamMarkersCount() > 0))
             {
                 end_of_picture();
 
-                // This swap will copy to the new buffer most of the time.
-                m_bitstreamDataLen = swapBitstreamBuffer(m_nalu.start_offset, m_nalu.end_offset - m_nalu.start_offset);
+                // This swap will copy to the new buffer most of the time (unless the NAL unit is parsed in place).
+                m_bitstreamDataLen = swapBitstreamBuffer(m_nalu.start_offset,
+                                                         (m_pInPlaceNaluData == nullptr) ? (m_nalu.end_offset - m_nalu.start_offset) : 0);
                 m_nalu.end_offset -= m_nalu.start_offset;
                 m_nalu.start_offset = 0;
                 m_bitstreamData.ResetStreamMarkers();
                 m_llNaluStartLocation = m_llParsedBytes - m_nalu.end_offset;
             }
         }
+        if (m_nalu.start_offset == 0) {
+            // The data of the previous NAL units is gone
+            m_metadataRecords.clear();
+        }
+        const size_t numMetadataRecords = m_metadataRecords.size();
         init_dbits();
+        const uint64_t startTime = m_stats.Now();
         nal_type = ParseNalUnit();
+        m_stats.AddParseUnitTime(startTime);
+        if ((nal_type == NALU_METADATA) && (m_metadataRecords.size() == numMetadataRecords)) {
+            nal_type = NALU_DISCARD; // Nothing recorded
+        }
         switch(nal_type)
         {
         case NALU_SLICE:
-            if (m_bitstreamData.GetStreamMarkersCount() < MAX_SLICES)
+        case NALU_METADATA:
+            if ((nal_type == NALU_SLICE) && (m_bitstreamData.GetStreamMarkersCount() < MAX_SLICES))
             {
                 if (m_bitstreamData.GetStreamMarkersCount() == 0) {
                     m_llFrameStartLocation = m_llNaluStartLocation;
@@ -381,16 +696,26 @@ void VulkanVideoDecoder::nal_unit()
                 assert(m_nalu.start_offset < std::numeric_limits<int32_t>::max());
                 m_bitstreamData.AddStreamMarker((uint32_t)m_nalu.start_offset);
             }
+            if ((m_pInPlaceNaluData != nullptr) && (m_nalLengthSize == 0))
+            {
+                // Copy the start code prefix from the packet as well, so that contiguous slices are copied in one go
+                defer_copy(m_pInPlaceNaluData - 3, m_nalu.start_offset, m_nalu.end_offset - m_nalu.start_offset);
+            } else if (m_pInPlaceNaluData != nullptr)
+            {
+                // The start code prefix only exists in the bitstream buffer, which may have been swapped since it was set
+                m_bitstreamData.SetSliceStartCodeAtOffset(m_nalu.start_offset);
+                defer_copy(m_pInPlaceNaluData, m_nalu.start_offset + 3, m_nalu.end_offset - m_nalu.start_offset - 3);
+            }
             break;
         //case NALU_DISCARD:
         default:
+            m_metadataRecords.resize(numMetadataRecords);
             if ((nal_type == NALU_UNKNOWN) && (m_pClient))
             {
                 // Called client for handling unsupported NALUs (or user data)
-                const uint8_t* bitstreamDataPtr = m_bitstreamData.GetBitstreamPtr();
                 int64_t cbData = (m_nalu.end_offset - m_nalu.start_offset - 3);
                 assert((uint64_t)cbData < (uint64_t)std::numeric_limits<size_t>::max());
-                m_pClient->UnhandledNALU(bitstreamDataPtr + m_nalu.start_offset + 3, (size_t)cbData);
+                m_pClient->UnhandledNALU(nalu_data(m_nalu.start_offset + 3), (size_t)cbData);
             }
             m_nalu.end_offset = m_nalu.start_offset;
         }
@@ -450,6 +775,8 @@ int VulkanVideoDecoder::init_sequence(VkParserSequenceInfo *pnvsi)
 
 void VulkanVideoDecoder::end_of_picture()
 {
+    const uint64_t startTime = m_stats.Now();
+    flush_deferred_copy();
     if ((m_nalu.end_offset > 3) && (m_bitstreamData.GetStreamMarkersCount() > 0))
     {
         assert(!m_264SvcEnabled);
@@ -461,7 +788,19 @@ void VulkanVideoDecoder::end_of_picture()
         assert((uint64_t)m_nalu.start_offset < (uint64_t)std::numeric_limits<size_t>::max());
         m_pVkPictureData->bitstreamDataLen = (size_t)m_nalu.start_offset;
         m_pVkPictureData->numSlices = m_bitstreamData.GetStreamMarkersCount();
-        if(BeginPicture(m_pVkPictureData))
+        if (!m_metadataRecords.empty())
+        {
+            m_pVkPictureData->pMetadataRecords = m_metadataRecords.data();
+            m_pVkPictureData->numMetadataRecords = (uint32_t)m_metadataRecords.size();
+        }
+        if (m_decodedPictureHash.type != VkVideoDecodedPictureHash::TYPE_NONE)
+        {
+            m_pVkPictureData->pDecodedPictureHash = &m_decodedPictureHash;
+        }
+        const uint64_t beginPictureStartTime = m_stats.Now();
+        const bool pictureStarted = BeginPicture(m_pVkPictureData);
+        m_stats.AddBeginPictureTime(beginPictureStartTime);
+        if (pictureStarted)
         {
             if ((m_pVkPictureData + m_iTargetLayer)->pCurrPic)
             {
@@ -529,6 +868,9 @@ void VulkanVideoDecoder::end_of_picture()
             EndPicture();
         }
     }
+    m_metadataRecords.clear();
+    m_decodedPictureHash.type = VkVideoDecodedPictureHash::TYPE_NONE;
+    m_stats.AddEndOfPictureTime(startTime);
 }
 
 
@@ -626,6 +968,9 @@ void VulkanVideoDecoder::end_of_stream()
     memset(&m_PrevSeqInfo, 0, sizeof(m_PrevSeqInfo));
     memset(&m_PTSQueue, 0, sizeof(m_PTSQueue));
     m_bitstreamData.ResetStreamMarkers();
+    m_bErrorRecovery = false;
+    m_recoveryPointCnt = -1;
+    m_decodedPictureHash.type = VkVideoDecodedPictureHash::TYPE_NONE;
     m_BitBfr = (uint32_t)~0;
     m_llParsedBytes = 0;
     m_llNaluStartLocation = 0;
@@ -641,11 +986,19 @@ void VulkanVideoDecoder::end_of_stream()
     }
 }
 
-#include "nvVulkanh265ScalingList.h"
+#if !defined(DISABLE_VK_VIDEO_PARSER_H264)
 #include "VulkanH264Decoder.h"
+#endif
+#if !defined(DISABLE_VK_VIDEO_PARSER_H265)
+#include "nvVulkanh265ScalingList.h"
 #include "VulkanH265Decoder.h"
+#endif
+#if !defined(DISABLE_VK_VIDEO_PARSER_AV1)
 #include "VulkanAV1Decoder.h"
+#endif
+#if !defined(DISABLE_VK_VIDEO_PARSER_VP9)
 #include "VulkanVP9Decoder.h"
+#endif
 
 static nvParserLogFuncType gParserLogFunc = nullptr;
 static int gLogLevel = 0;
@@ -694,6 +1047,7 @@ VkResult CreateVulkanVideoDecodeParser(VkVideoCodecOperationFlagBitsKHR videoCod
     gLogLevel = logLevel;
     switch((uint32_t)videoCodecOperation)
     {
+#if !defined(DISABLE_VK_VIDEO_PARSER_H264)
     case VK_VIDEO_CODEC_OPERATION_DECODE_H264_BIT_KHR:
     {
         if ((pStdExtensionVersion == nullptr) ||
@@ -711,6 +1065,8 @@ VkResult CreateVulkanVideoDecodeParser(VkVideoCodecOperationFlagBitsKHR videoCod
         nvVideoDecodeParser = nvVideoH264DecodeParser;
     }
         break;
+#endif
+#if !defined(DISABLE_VK_VIDEO_PARSER_H265)
     case VK_VIDEO_CODEC_OPERATION_DECODE_H265_BIT_KHR:
     {
         if ((pStdExtensionVersion == nullptr) ||
@@ -728,6 +1084,8 @@ VkResult CreateVulkanVideoDecodeParser(VkVideoCodecOperationFlagBitsKHR videoCod
         nvVideoDecodeParser = nvVideoH265DecodeParser;
     }
         break;
+#endif
+#if !defined(DISABLE_VK_VIDEO_PARSER_AV1)
     case VK_VIDEO_CODEC_OPERATION_DECODE_AV1_BIT_KHR:
         if ((pStdExtensionVersion == nullptr) ||
                 (0 != strcmp(pStdExtensionVersion->extensionName, VK_STD_VULKAN_VIDEO_CODEC_AV1_DECODE_EXTENSION_NAME)) ||
@@ -739,6 +1097,8 @@ VkResult CreateVulkanVideoDecodeParser(VkVideoCodecOperationFlagBitsKHR videoCod
         }
         nvVideoDecodeParser =  VkSharedBaseObj<VulkanAV1Decoder>(new VulkanAV1Decoder(videoCodecOperation));
         break;
+#endif
+#if !defined(DISABLE_VK_VIDEO_PARSER_VP9)
     case VK_VIDEO_CODEC_OPERATION_DECODE_VP9_BIT_KHR:
         if ((pStdExtensionVersion == nullptr) ||
                 (0 != strcmp(pStdExtensionVersion->extensionName, VK_STD_VULKAN_VIDEO_CODEC_VP9_DECODE_EXTENSION_NAME)) ||
@@ -750,8 +1110,11 @@ VkResult CreateVulkanVideoDecodeParser(VkVideoCodecOperationFlagBitsKHR videoCod
         }
         nvVideoDecodeParser =  VkSharedBaseObj<VulkanVP9Decoder>(new VulkanVP9Decoder(videoCodecOperation));
         break;
+#endif
     default:
+        // Also the codecs left out of the build (VULKAN_VIDEO_PARSER_CODECS)
         nvParserErrorLog("Unsupported codec type!!!\n");
+        return VK_ERROR_VIDEO_PROFILE_CODEC_NOT_SUPPORTED_KHR;
     }
     VkResult result = nvVideoDecodeParser->Initialize(pParserPictureData);
     if (result != VK_SUCCESS) {
@@ -6,6 +6,8 @@
 // Uses the __cpuid intrinsic to get information about
 // CPU extended instruction set support.
 
+#include <stdlib.h>
+#include <string.h>
 #include <cpudetect.h>
 
 #if defined(__aarch64__)
@@ -90,7 +92,7 @@ const InstructionSet::InstructionSet_Internal InstructionSet::CPU_Rep;
 #endif
 
 // Print out supported instruction set extensions
-SIMD_ISA check_simd_support()
+static SIMD_ISA detect_simd_support()
 {
 #if !defined(DISABLE_VK_VIDEO_PARSER_SIMD_OPTIMIZATIONS)
 #if defined(_M_X64)
@@ -110,4 +112,49 @@ SIMD_ISA check_simd_support()
 #endif
 #endif // DISABLE_VK_VIDEO_PARSER_SIMD_OPTIMIZATIONS
     return SIMD_ISA::NOSIMD;
-};
\ No newline at end of file
+}
+
+// An ISA can replace the detected one if it is the C fallback or a lower ISA of the same architecture
+static bool is_simd_isa_supported(SIMD_ISA isa, SIMD_ISA detected)
+{
+    if (isa == SIMD_ISA::NOSIMD) {
+        return true;
+    }
+    const bool isArmIsa = (isa >= SIMD_ISA::NEON);
+    const bool isArmDetected = (detected >= SIMD_ISA::NEON);
+    return (isArmIsa == isArmDetected) && (isa <= detected);
+}
+
+// The VK_VIDEO_PARSER_SIMD_ISA environment variable (c, ssse3, avx2, avx512, neon or sve) selects
+// a lower ISA than the detected one, to compare the start code scan variants on the same machine.
+// The CPU is only queried once per process: the parsers created after the first one skip CPUID.
+SIMD_ISA check_simd_support()
+{
+    static const SIMD_ISA detected = detect_simd_support();
+
+#if defined(_MSC_VER)
+#pragma warning(suppress : 4996)
+#endif
+    const char* pIsaName = getenv("VK_VIDEO_PARSER_SIMD_ISA");
+    if (pIsaName == nullptr) {
+        return detected;
+    }
+
+    static const struct {
+        const char* name;
+        SIMD_ISA    isa;
+    } isaNames[] = {
+        { "c",      SIMD_ISA::NOSIMD },
+        { "ssse3",  SIMD_ISA::SSSE3 },
+        { "avx2",   SIMD_ISA::AVX2 },
+        { "avx512", SIMD_ISA::AVX512 },
+        { "neon",   SIMD_ISA::NEON },
+        { "sve",    SIMD_ISA::SVE },
+    };
+    for (const auto& isaName : isaNames) {
+        if ((strcmp(pIsaName, isaName.name) == 0) && is_simd_isa_supported(isaName.isa, detected)) {
+            return isaName.isa;
+        }
+    }
+    return detected;
+}
\ No newline at end of file
@@ -0,0 +1,609 @@
+/*
+* Copyright 2024 NVIDIA Corporation.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include <stdio.h>
+#include <algorithm>
+#include <future>
+#include <map>
+#include "VkCodecUtils/VkThreadPool.h"
+#include "VkDecoderUtils/AccessUnitPreparser.h"
+
+#define IVF_FRAME_HEADER_SIZE 12
+#define AV1_OBU_SEQUENCE_HEADER 1
+#define AV1_OBU_FRAME_HEADER 3
+#define AV1_OBU_FRAME 6
+#define STREAM_INDEX_FILE_MAGIC 0x58534b56 // "VKSX"
+#define STREAM_INDEX_FILE_VERSION 1
+
+// Chunks smaller than this are not worth handing to another thread.
+static const size_t minPreparseChunkSize = 1024 * 1024;
+
+// Reads the leading fields of a parameter set NAL unit, removing emulation prevention bytes.
+class ParameterSetReader {
+
+public:
+    ParameterSetReader(const uint8_t* pNal, size_t size)
+        : m_size(0)
+        , m_bitOffset(0)
+        , m_overrun(false)
+    {
+        uint32_t zeros = 0;
+        for (size_t i = 0; (i < size) && (m_size < sizeof(m_rbsp)); i++) {
+            if ((zeros >= 2) && (pNal[i] == 3)) {
+                zeros = 0;
+                continue;
+            }
+            zeros = (pNal[i] == 0) ? (zeros + 1) : 0;
+            m_rbsp[m_size++] = pNal[i];
+        }
+    }
+
+    uint32_t u(uint32_t n)
+    {
+        uint32_t value = 0;
+        while (n--) {
+            value = (value << 1) | bit();
+        }
+        return value;
+    }
+
+    uint32_t ue()
+    {
+        uint32_t leadingZeros = 0;
+        while (!bit()) {
+            if (m_overrun || (++leadingZeros > 31)) {
+                m_overrun = true;
+                return 0;
+            }
+        }
+        return ((1U << leadingZeros) - 1) + u(leadingZeros);
+    }
+
+    bool overrun() const { return m_overrun; }
+
+private:
+    uint32_t bit()
+    {
+        if (m_bitOffset >= (m_size * 8)) {
+            m_overrun = true;
+            return 0;
+        }
+        const uint32_t value = (m_rbsp[m_bitOffset >> 3] >> (7 - (m_bitOffset & 7))) & 1;
+        m_bitOffset++;
+        return value;
+    }
+
+    uint8_t  m_rbsp[128];
+    size_t   m_size;
+    size_t   m_bitOffset;
+    bool     m_overrun;
+};
+
+void VkVideoStreamIndex::Clear()
+{
+    codecType = VK_VIDEO_CODEC_OPERATION_NONE_KHR;
+    streamSize = 0;
+    accessUnits.clear();
+    randomAccessPoints.clear();
+    parameterSets.clear();
+}
+
+const VkVideoRandomAccessPoint* VkVideoStreamIndex::FindRandomAccessPoint(uint32_t accessUnit) const
+{
+    auto it = std::upper_bound(randomAccessPoints.begin(), randomAccessPoints.end(), accessUnit,
+                               [](uint32_t au, const VkVideoRandomAccessPoint& rap) { return au < rap.accessUnit; });
+    if (it == randomAccessPoints.begin()) {
+        return nullptr;
+    }
+    return &*(--it);
+}
+
+bool VkVideoStreamIndex::Save(const char* pFileName) const
+{
+    FILE* file = fopen(pFileName, "wb");
+    if (file == nullptr) {
+        return false;
+    }
+
+    const uint32_t header[6] = { STREAM_INDEX_FILE_MAGIC, STREAM_INDEX_FILE_VERSION, (uint32_t)codecType,
+                                 (uint32_t)accessUnits.size(), (uint32_t)randomAccessPoints.size(),
+                                 (uint32_t)parameterSets.size() };
+    bool success = (fwrite(header, sizeof(header), 1, file) == 1) &&
+                   (fwrite(&streamSize, sizeof(streamSize), 1, file) == 1);
+    for (size_t i = 0; success && (i < accessUnits.size()); i++) {
+        const int64_t range[2] = { accessUnits[i].offset, accessUnits[i].size };
+        const uint32_t flags = accessUnits[i].isIrap | (accessUnits[i].isRasl << 1);
+        success = (fwrite(range, sizeof(range), 1, file) == 1) && (fwrite(&flags, sizeof(flags), 1, file) == 1);
+    }
+    for (size_t i = 0; success && (i < randomAccessPoints.size()); i++) {
+        const uint32_t rap[3] = { randomAccessPoints[i].accessUnit, randomAccessPoints[i].firstParameterSet,
+                                  randomAccessPoints[i].numParameterSets };
+        success = (fwrite(rap, sizeof(rap), 1, file) == 1);
+    }
+    for (size_t i = 0; success && (i < parameterSets.size()); i++) {
+        const int64_t range[2] = { parameterSets[i].offset, parameterSets[i].size };
+        success = (fwrite(range, sizeof(range), 1, file) == 1);
+    }
+
+    fclose(file);
+    return success;
+}
+
+bool VkVideoStreamIndex::Load(const char* pFileName, VkVideoCodecOperationFlagBitsKHR expectedCodecType,
+                              uint64_t expectedStreamSize)
+{
+    FILE* file = fopen(pFileName, "rb");
+    if (file == nullptr) {
+        return false;
+    }
+
+    Clear();
+
+    uint32_t header[6] = {};
+    uint64_t fileStreamSize = 0;
+    bool success = (fread(header, sizeof(header), 1, file) == 1) &&
+                   (fread(&fileStreamSize, sizeof(fileStreamSize), 1, file) == 1) &&
+                   (header[0] == STREAM_INDEX_FILE_MAGIC) &&
+                   (header[1] == STREAM_INDEX_FILE_VERSION) &&
+                   (header[2] == (uint32_t)expectedCodecType) &&
+                   (fileStreamSize == expectedStreamSize);
+    if (success) {
+        accessUnits.resize(header[3]);
+        randomAccessPoints.resize(header[4]);
+        parameterSets.resize(header[5]);
+    }
+    for (size_t i = 0; success && (i < accessUnits.size()); i++) {
+        int64_t range[2];
+        uint32_t flags;
+        success = (fread(range, sizeof(range), 1, file) == 1) && (fread(&flags, sizeof(flags), 1, file) == 1) &&
+                  (range[0] >= 0) && (range[1] >= 0) && ((uint64_t)(range[0] + range[1]) <= expectedStreamSize);
+        accessUnits[i].offset = range[0];
+        accessUnits[i].size = range[1];
+        accessUnits[i].isIrap = flags & 1;
+        accessUnits[i].isRasl = (flags >> 1) & 1;
+    }
+    for (size_t i = 0; success && (i < randomAccessPoints.size()); i++) {
+        uint32_t rap[3];
+        success = (fread(rap, sizeof(rap), 1, file) == 1) && (rap[0] < accessUnits.size()) &&
+                  ((uint64_t)rap[1] + rap[2] <= parameterSets.size());
+        randomAccessPoints[i].accessUnit = rap[0];
+        randomAccessPoints[i].firstParameterSet = rap[1];
+        randomAccessPoints[i].numParameterSets = rap[2];
+    }
+    for (size_t i = 0; success && (i < parameterSets.size()); i++) {
+        int64_t range[2];
+        success = (fread(range, sizeof(range), 1, file) == 1) &&
+                  (range[0] >= 0) && (range[1] >= 0) && ((uint64_t)(range[0] + range[1]) <= expectedStreamSize);
+        parameterSets[i].offset = range[0];
+        parameterSets[i].size = range[1];
+    }
+
+    fclose(file);
+
+    if (!success || accessUnits.empty()) {
+        Clear();
+        return false;
+    }
+
+    codecType = expectedCodecType;
+    streamSize = expectedStreamSize;
+    return true;
+}
+
+void AccessUnitPreparser::ClassifyNalH264(const uint8_t* pNal, size_t size, NalRecord& nal)
+{
+    nal.nalClass = NAL_CLASS_OTHER;
+    nal.parameterSetKey = 0;
+    if (size < 1) {
+        return;
+    }
+
+    const uint32_t nal_unit_type = pNal[0] & 0x1f;
+    switch (nal_unit_type) {
+    case 1: case 2: case 3: case 4: case 5:
+        nal.nalClass = NAL_CLASS_VCL;
+        // first_mb_in_slice is ue(v): a leading 1 bit means first_mb_in_slice == 0.
+        if ((size > 1) && (pNal[1] & 0x80)) {
+            nal.nalClass |= NAL_CLASS_FIRST_SLICE;
+        }
+        if (nal_unit_type == 5) {
+            nal.nalClass |= NAL_CLASS_IRAP;
+        }
+        break;
+    case 7: case 8:
+    {
+        nal.nalClass = NAL_CLASS_AU_START;
+        ParameterSetReader reader(pNal, size);
+        reader.u(8);                 // NAL unit header
+        if (nal_unit_type == 7) {
+            reader.u(24);            // profile_idc, constraint_set flags, level_idc
+        }
+        const uint32_t id = reader.ue();
+        if (!reader.overrun() && (id <= ((nal_unit_type == 7) ? 31U : 255U))) {
+            nal.nalClass |= NAL_CLASS_PARAMETER_SET;
+            nal.parameterSetKey = (nal_unit_type << 16) | id;
+        }
+        break;
+    }
+    case 6: case 9:
+    case 14: case 15: case 16: case 17: case 18:
+        nal.nalClass = NAL_CLASS_AU_START;
+        break;
+    default:
+        break;
+    }
+}
+
+void AccessUnitPreparser::ClassifyNalH265(const uint8_t* pNal, size_t size, NalRecord& nal)
+{
+    nal.nalClass = NAL_CLASS_OTHER;
+    nal.parameterSetKey = 0;
+    if (size < 2) {
+        return;
+    }
+
+    const uint32_t nal_unit_type = (pNal[0] >> 1) & 0x3f;
+    const uint32_t nuh_layer_id = ((pNal[0] & 1) << 5) | (pNal[1] >> 3);
+    if (nal_unit_type < 32) {
+        nal.nalClass = NAL_CLASS_VCL;
+        // Only the base layer starts a new access unit.
+        if (nuh_layer_id == 0) {
+            if ((size > 2) && (pNal[2] & 0x80)) { // first_slice_segment_in_pic_flag
+                nal.nalClass |= NAL_CLASS_FIRST_SLICE;
+            }
+            if ((nal_unit_type >= 16) && (nal_unit_type <= 23)) {
+                nal.nalClass |= NAL_CLASS_IRAP;
+            } else if ((nal_unit_type == 8) || (nal_unit_type == 9)) {
+                nal.nalClass |= NAL_CLASS_RASL;
+            }
+        }
+        return;
+    }
+
+    if (nuh_layer_id != 0) {
+        return;
+    }
+
+    if ((nal_unit_type >= 32) && (nal_unit_type <= 34)) {
+        nal.nalClass = NAL_CLASS_AU_START;
+        ParameterSetReader reader(pNal, size);
+        reader.u(16);                // NAL unit header
+        uint32_t id = 0;
+        if (nal_unit_type == 32) {   // VPS
+            id = reader.u(4);
+        } else if (nal_unit_type == 33) { // SPS
+            reader.u(4);             // sps_video_parameter_set_id
+            const uint32_t maxSubLayersMinus1 = reader.u(3);
+            reader.u(1);             // sps_temporal_id_nesting_flag
+            reader.u(32);            // profile_tier_level(): general profile, 88 bits
+            reader.u(32);
+            reader.u(24);
+            reader.u(8);             // general_level_idc
+            uint32_t subLayerProfilePresent = 0, subLayerLevelPresent = 0;
+            for (uint32_t i = 0; i < maxSubLayersMinus1; i++) {
+                subLayerProfilePresent |= reader.u(1) << i;
+                subLayerLevelPresent |= reader.u(1) << i;
+            }
+            if (maxSubLayersMinus1 > 0) {
+                reader.u(2 * (8 - maxSubLayersMinus1)); // reserved_zero_2bits
+            }
+            for (uint32_t i = 0; i < maxSubLayersMinus1; i++) {
+                if (subLayerProfilePresent & (1 << i)) {
+                    reader.u(32);
+                    reader.u(32);
+                    reader.u(24);
+                }
+                if (subLayerLevelPresent & (1 << i)) {
+                    reader.u(8);
+                }
+            }
+            id = reader.ue();
+        } else {                     // PPS
+            id = reader.ue();
+        }
+        if (!reader.overrun() && (id <= ((nal_unit_type == 34) ? 63U : 15U))) {
+            nal.nalClass |= NAL_CLASS_PARAMETER_SET;
+            nal.parameterSetKey = (nal_unit_type << 16) | id;
+        }
+    } else if ((nal_unit_type == 35) ||                     // AUD
+               (nal_unit_type == 39) ||                     // Prefix SEI
+               ((nal_unit_type >= 41) && (nal_unit_type <= 44)) ||
+               ((nal_unit_type >= 48) && (nal_unit_type <= 55))) {
+        nal.nalClass = NAL_CLASS_AU_START;
+    }
+}
+
+// Records every start code prefix that begins within [begin, end). The scan may look at the
+// bytes following end so that prefixes and NAL headers straddling two chunks are not lost.
+void AccessUnitPreparser::ScanChunk(VkVideoCodecOperationFlagBitsKHR codecType,
+                                    const uint8_t* pData, size_t size,
+                                    size_t begin, size_t end,
+                                    std::vector<NalRecord>& nals)
+{
+    const size_t scanEnd = std::min(end + 2, size);
+    size_t i = begin + 2;
+    while (i < scanEnd) {
+        // i is the position of the 0x01 of a candidate 00 00 01 prefix.
+        const uint8_t c = pData[i];
+        if (c > 1) {
+            i += 3;
+        } else if (c == 0) {
+            i += (pData[i - 1] != 0) ? 2 : 1;
+        } else {
+            if ((pData[i - 1] == 0) && (pData[i - 2] == 0)) {
+                const uint8_t* pNal = pData + i + 1;
+                const size_t nalSize = size - (i + 1);
+                NalRecord nal;
+                nal.offset = (int64_t)(i - 2);
+                if (codecType == VK_VIDEO_CODEC_OPERATION_DECODE_H264_BIT_KHR) {
+                    ClassifyNalH264(pNal, nalSize, nal);
+                } else {
+                    ClassifyNalH265(pNal, nalSize, nal);
+                }
+                nals.push_back(nal);
+            }
+            i += 3;
+        }
+    }
+}
+
+bool AccessUnitPreparser::PreparseAnnexB(VkVideoCodecOperationFlagBitsKHR codecType,
+                                         const uint8_t* pData, size_t size,
+                                         uint32_t numThreads,
+                                         VkVideoStreamIndex& streamIndex)
+{
+    // Over-split the stream relative to the thread count to balance uneven NAL density.
+    size_t numChunks = std::min<size_t>((size_t)numThreads * 4, size / minPreparseChunkSize);
+    numChunks = std::max<size_t>(numChunks, 1);
+    const size_t chunkSize = (size + numChunks - 1) / numChunks;
+
+    std::vector<std::vector<NalRecord>> chunkNals(numChunks);
+    if ((numChunks > 1) && (numThreads > 1)) {
+        VkThreadPool threadPool(std::min<size_t>(numThreads, numChunks));
+        std::vector<std::future<void>> results;
+        results.reserve(numChunks);
+        for (size_t chunk = 0; chunk < numChunks; chunk++) {
+            const size_t begin = chunk * chunkSize;
+            const size_t end = std::min(begin + chunkSize, size);
+            results.push_back(threadPool.enqueue(&AccessUnitPreparser::ScanChunk, codecType, pData, size,
+                                                 begin, end, std::ref(chunkNals[chunk])));
+        }
+        for (auto& result : results) {
+            result.get();
+        }
+    } else {
+        ScanChunk(codecType, pData, size, 0, size, chunkNals[0]);
+    }
+
+    // Merge the chunks in stream order. A new access unit starts at the first AU-start NAL unit
+    // or first slice of a picture that follows a VCL NAL unit of the current access unit.
+    // Parameter sets take effect for random access purposes once their access unit is complete,
+    // so that each random access point records the sets that were active before it.
+    std::vector<VkVideoAccessUnit>& accessUnits = streamIndex.accessUnits;
+    std::map<uint32_t, VkVideoStreamRange> activeParameterSets;
+    std::vector<std::pair<uint32_t, VkVideoStreamRange>> auParameterSets;
+    bool parameterSetPending = false;
+    int64_t auStart = 0;
+    int64_t prevNalEnd = 0;
+    bool vclSeen = false;
+    bool isIrap = false;
+    bool isRasl = false;
+
+    // Excludes the leading zero_byte of the next start code and any trailing_zero_8bits.
+    auto trimTrailingZeros = [pData, &prevNalEnd](int64_t end) {
+        while ((end > prevNalEnd) && (pData[end - 1] == 0)) {
+            end--;
+        }
+        return end;
+    };
+
+    auto addAccessUnit = [&](int64_t end) {
+        if (isIrap) {
+            VkVideoRandomAccessPoint rap;
+            rap.accessUnit = (uint32_t)accessUnits.size();
+            rap.firstParameterSet = (uint32_t)streamIndex.parameterSets.size();
+            rap.numParameterSets = (uint32_t)activeParameterSets.size();
+            for (const auto& parameterSet : activeParameterSets) {
+                streamIndex.parameterSets.push_back(parameterSet.second);
+            }
+            streamIndex.randomAccessPoints.push_back(rap);
+        }
+        VkVideoAccessUnit accessUnit = { auStart, end - auStart, isIrap, isRasl };
+        accessUnits.push_back(accessUnit);
+        for (const auto& parameterSet : auParameterSets) {
+            activeParameterSets[parameterSet.first] = parameterSet.second;
+        }
+        auParameterSets.clear();
+    };
+
+    for (const std::vector<NalRecord>& nals : chunkNals) {
+        for (const NalRecord& nal : nals) {
+            if (parameterSetPending) {
+                VkVideoStreamRange& range = auParameterSets.back().second;
+                range.size = trimTrailingZeros(nal.offset) - range.offset;
+                parameterSetPending = false;
+            }
+            if (vclSeen && (nal.nalClass & (NAL_CLASS_AU_START | NAL_CLASS_FIRST_SLICE))) {
+                const int64_t boundary = trimTrailingZeros(nal.offset);
+                addAccessUnit(boundary);
+                auStart = boundary;
+                vclSeen = false;
+                isIrap = false;
+                isRasl = false;
+            }
+            if (nal.nalClass & NAL_CLASS_VCL) {
+                vclSeen = true;
+                isIrap = isIrap || (nal.nalClass & NAL_CLASS_IRAP);
+                isRasl = isRasl || (nal.nalClass & NAL_CLASS_RASL);
+            }
+            if (nal.nalClass & NAL_CLASS_PARAMETER_SET) {
+                VkVideoStreamRange range = { nal.offset, 0 };
+                auParameterSets.push_back(std::make_pair(nal.parameterSetKey, range));
+                parameterSetPending = true;
+            }
+            prevNalEnd = nal.offset + 3;
+        }
+    }
+
+    if (parameterSetPending) {
+        VkVideoStreamRange& range = auParameterSets.back().second;
+        range.size = trimTrailingZeros((int64_t)size) - range.offset;
+    }
+
+    if ((int64_t)size > auStart) {
+        if (!vclSeen && !accessUnits.empty()) {
+            // Trailing non-VCL NAL units (end of sequence/stream) belong to the last access unit.
+            accessUnits.back().size = (int64_t)size - accessUnits.back().offset;
+        } else {
+            addAccessUnit((int64_t)size);
+        }
+    }
+
+    return !accessUnits.empty();
+}
+
+bool AccessUnitPreparser::PreparseIvf(VkVideoCodecOperationFlagBitsKHR codecType,
+                                      const uint8_t* pData, size_t size,
+                                      VkVideoStreamIndex& streamIndex)
+{
+    bool hasSequenceHeader = false;
+    bool reducedStillPictureHeader = false;
+    VkVideoStreamRange sequenceHeader = { 0, 0 };
+
+    size_t offset = 0;
+    while (offset < size) {
+        const uint8_t* pFrameHeader = pData + offset - IVF_FRAME_HEADER_SIZE;
+        const size_t frameSize = pFrameHeader[0] | (pFrameHeader[1] << 8) |
+                                 (pFrameHeader[2] << 16) | ((size_t)pFrameHeader[3] << 24);
+        if (frameSize > (size - offset)) {
+            // Truncated frame
+            break;
+        }
+
+        bool isKeyFrame = false;
+        bool hasNewSequenceHeader = false;
+        VkVideoStreamRange newSequenceHeader = { 0, 0 };
+        const uint8_t* pFrame = pData + offset;
+        if (codecType == VK_VIDEO_CODEC_OPERATION_DECODE_VP9_BIT_KHR) {
+            // uncompressed_header(): frame_marker(2), profile_low_bit, profile_high_bit,
+            // [reserved_zero], show_existing_frame, frame_type (0 = KEY_FRAME).
+            if ((frameSize > 0) && ((pFrame[0] >> 6) == 2)) {
+                const uint32_t profile = ((pFrame[0] >> 5) & 1) | (((pFrame[0] >> 4) & 1) << 1);
+                const uint32_t showExistingFrameBit = (profile == 3) ? 5 : 4;
+                const uint32_t bits = ((uint32_t)pFrame[0] << 8) | ((frameSize > 1) ? pFrame[1] : 0);
+                const bool showExistingFrame = (bits >> (15 - showExistingFrameBit)) & 1;
+                isKeyFrame = !showExistingFrame && !((bits >> (14 - showExistingFrameBit)) & 1);
+            }
+        } else {
+            bool frameHeaderSeen = false;
+            const uint8_t* pObu = pFrame;
+            const uint8_t* pEnd = pFrame + frameSize;
+            while (pObu < pEnd) {
+                const uint8_t* pObuStart = pObu;
+                const uint8_t obuHeader = *pObu++;
+                const uint32_t obuType = (obuHeader >> 3) & 0xf;
+                const bool hasExtension = (obuHeader >> 2) & 1;
+                const bool hasSizeField = (obuHeader >> 1) & 1;
+                pObu += hasExtension ? 1 : 0;
+                uint64_t obuSize = 0;
+                if (hasSizeField) {
+                    for (uint32_t i = 0; (i < 8) && (pObu < pEnd); i++) {
+                        const uint8_t leb128Byte = *pObu++;
+                        obuSize |= (uint64_t)(leb128Byte & 0x7f) << (i * 7);
+                        if (!(leb128Byte & 0x80)) {
+                            break;
+                        }
+                    }
+                } else {
+                    obuSize = (pObu < pEnd) ? (uint64_t)(pEnd - pObu) : 0;
+                }
+                if ((pObu >= pEnd) || (obuSize > (uint64_t)(pEnd - pObu))) {
+                    break;
+                }
+
+                if (obuType == AV1_OBU_SEQUENCE_HEADER) {
+                    // seq_profile(3), still_picture(1), reduced_still_picture_header(1)
+                    reducedStillPictureHeader = (obuSize > 0) && ((pObu[0] >> 3) & 1);
+                    newSequenceHeader.offset = (int64_t)(pObuStart - pData);
+                    newSequenceHeader.size = (int64_t)((pObu + obuSize) - pObuStart);
+                    hasNewSequenceHeader = hasSizeField;
+                } else if (!frameHeaderSeen && ((obuType == AV1_OBU_FRAME_HEADER) || (obuType == AV1_OBU_FRAME))) {
+                    // show_existing_frame(1), frame_type(2) (0 = KEY_FRAME)
+                    frameHeaderSeen = true;
+                    isKeyFrame = reducedStillPictureHeader ||
+                                 ((obuSize > 0) && !(pObu[0] & 0x80) && (((pObu[0] >> 5) & 3) == 0));
+                }
+                pObu += obuSize;
+            }
+        }
+
+        if (isKeyFrame) {
+            // Resend the AV1 sequence header that was active before this temporal unit.
+            VkVideoRandomAccessPoint rap;
+            rap.accessUnit = (uint32_t)streamIndex.accessUnits.size();
+            rap.firstParameterSet = (uint32_t)streamIndex.parameterSets.size();
+            rap.numParameterSets = hasSequenceHeader ? 1 : 0;
+            if (hasSequenceHeader) {
+                streamIndex.parameterSets.push_back(sequenceHeader);
+            }
+            streamIndex.randomAccessPoints.push_back(rap);
+        }
+        hasSequenceHeader = hasSequenceHeader || hasNewSequenceHeader;
+        if (hasNewSequenceHeader) {
+            sequenceHeader = newSequenceHeader;
+        }
+
+        VkVideoAccessUnit accessUnit = { (int64_t)offset, (int64_t)frameSize, isKeyFrame, false };
+        streamIndex.accessUnits.push_back(accessUnit);
+        offset += frameSize + IVF_FRAME_HEADER_SIZE;
+    }
+
+    return !streamIndex.accessUnits.empty();
+}
+
+bool AccessUnitPreparser::Preparse(VkVideoCodecOperationFlagBitsKHR codecType,
+                                   const uint8_t* pData, size_t size,
+                                   uint32_t numThreads,
+                                   VkVideoStreamIndex& streamIndex)
+{
+    streamIndex.Clear();
+    if ((pData == nullptr) || (size == 0)) {
+        return false;
+    }
+
+    bool success = false;
+    switch (codecType) {
+    case VK_VIDEO_CODEC_OPERATION_DECODE_H264_BIT_KHR:
+    case VK_VIDEO_CODEC_OPERATION_DECODE_H265_BIT_KHR:
+        success = PreparseAnnexB(codecType, pData, size, std::max(numThreads, 1U), streamIndex);
+        break;
+    case VK_VIDEO_CODEC_OPERATION_DECODE_AV1_BIT_KHR:
+    case VK_VIDEO_CODEC_OPERATION_DECODE_VP9_BIT_KHR:
+        success = PreparseIvf(codecType, pData, size, streamIndex);
+        break;
+    default:
+        break;
+    }
+
+    if (!success) {
+        streamIndex.Clear();
+        return false;
+    }
+
+    streamIndex.codecType = codecType;
+    streamIndex.streamSize = size;
+    return true;
+}
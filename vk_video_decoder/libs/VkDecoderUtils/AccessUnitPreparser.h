@@ -0,0 +1,120 @@
+/*
+* Copyright 2024 NVIDIA Corporation.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#ifndef _VKDECODERUTILS_ACCESSUNITPREPARSER_H_
+#define _VKDECODERUTILS_ACCESSUNITPREPARSER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+#include <vulkan_interfaces.h>
+
+// One complete access unit (H.264/H.265) or temporal unit (AV1/VP9) of an elementary stream.
+struct VkVideoAccessUnit {
+    int64_t  offset;      // Offset of the first byte of the access unit in the stream
+    int64_t  size;        // Size of the access unit in bytes
+    uint32_t isIrap : 1;  // The access unit is a random access point (IDR/BLA/CRA or AV1/VP9 key frame)
+    uint32_t isRasl : 1;  // H.265 RASL picture, not decodable when decoding starts at the preceding CRA
+};
+
+// A byte range of the stream, e.g. a parameter set NAL unit with its start code prefix.
+struct VkVideoStreamRange {
+    int64_t offset;
+    int64_t size;
+};
+
+// A random access point along with the parameter sets that are active when decoding reaches it.
+struct VkVideoRandomAccessPoint {
+    uint32_t accessUnit;        // Index into VkVideoStreamIndex::accessUnits
+    uint32_t firstParameterSet; // Index into VkVideoStreamIndex::parameterSets
+    uint32_t numParameterSets;
+};
+
+struct VkVideoStreamIndex {
+    VkVideoCodecOperationFlagBitsKHR      codecType;
+    uint64_t                              streamSize;
+    std::vector<VkVideoAccessUnit>        accessUnits;
+    std::vector<VkVideoRandomAccessPoint> randomAccessPoints;
+    std::vector<VkVideoStreamRange>       parameterSets;
+
+    VkVideoStreamIndex()
+        : codecType(VK_VIDEO_CODEC_OPERATION_NONE_KHR)
+        , streamSize(0)
+        , accessUnits()
+        , randomAccessPoints()
+        , parameterSets() { }
+
+    void Clear();
+
+    // Returns the last random access point at or before the given access unit, or nullptr.
+    const VkVideoRandomAccessPoint* FindRandomAccessPoint(uint32_t accessUnit) const;
+
+    // Sidecar file support. Load() fails if the file was built for a different stream.
+    bool Save(const char* pFileName) const;
+    bool Load(const char* pFileName, VkVideoCodecOperationFlagBitsKHR expectedCodecType,
+              uint64_t expectedStreamSize);
+};
+
+// Splits an elementary stream into access units ahead of parsing and indexes its random access points.
+//
+// Annex-B H.264/H.265 streams are cut into chunks that are scanned for start codes in parallel;
+// each NAL unit is classified from its header and the first slice header bit, and the per-chunk
+// results are merged in stream order using the access unit boundary rules of the specs
+// (H.264 7.4.1.2.3, H.265 7.4.2.4.4). AV1 and VP9 streams must be IVF: the temporal units are
+// indexed directly from the IVF frame headers.
+class AccessUnitPreparser {
+
+public:
+    // For AV1 and VP9, pData points at the payload of the first IVF frame, with every frame
+    // preceded by its 12-byte IVF frame header.
+    static bool Preparse(VkVideoCodecOperationFlagBitsKHR codecType,
+                         const uint8_t* pData, size_t size,
+                         uint32_t numThreads,
+                         VkVideoStreamIndex& streamIndex);
+
+private:
+    enum NalClass : uint8_t {
+        NAL_CLASS_OTHER          = 0,
+        NAL_CLASS_AU_START       = (1 << 0), // Non-VCL NAL unit that may only start a new access unit
+        NAL_CLASS_VCL            = (1 << 1),
+        NAL_CLASS_FIRST_SLICE    = (1 << 2), // First slice (segment) of a picture
+        NAL_CLASS_IRAP           = (1 << 3),
+        NAL_CLASS_RASL           = (1 << 4),
+        NAL_CLASS_PARAMETER_SET  = (1 << 5), // VPS/SPS/PPS, parameterSetKey is valid
+    };
+
+    struct NalRecord {
+        int64_t  offset;          // Offset of the 00 00 01 start code prefix
+        uint32_t parameterSetKey; // nal_unit_type << 16 | parameter set id
+        uint8_t  nalClass;
+    };
+
+    static void ClassifyNalH264(const uint8_t* pNal, size_t size, NalRecord& nal);
+    static void ClassifyNalH265(const uint8_t* pNal, size_t size, NalRecord& nal);
+    static void ScanChunk(VkVideoCodecOperationFlagBitsKHR codecType,
+                          const uint8_t* pData, size_t size,
+                          size_t begin, size_t end,
+                          std::vector<NalRecord>& nals);
+    static bool PreparseAnnexB(VkVideoCodecOperationFlagBitsKHR codecType,
+                               const uint8_t* pData, size_t size,
+                               uint32_t numThreads,
+                               VkVideoStreamIndex& streamIndex);
+    static bool PreparseIvf(VkVideoCodecOperationFlagBitsKHR codecType,
+                            const uint8_t* pData, size_t size,
+                            VkVideoStreamIndex& streamIndex);
+};
+
+#endif /* _VKDECODERUTILS_ACCESSUNITPREPARSER_H_ */
@@ -16,8 +16,12 @@
 
 #include <string.h>
 #include <fstream>
+#include <algorithm>
+#include <thread>
+#include <vector>
 #include "mio/mio.hpp"
 #include "VkDecoderUtils/VideoStreamDemuxer.h"
+#include "VkDecoderUtils/AccessUnitPreparser.h"
 #define DKIF_FRAME_CONTAINER_HEADER_SIZE 12
 #define DKIF_HEADER_MAGIC *((const uint32_t*)"DKIF")
 #define DKIF_FILE_HEADER_SIZE 32
@@ -40,7 +44,12 @@ public:
 #endif
         , m_pBitstreamData(nullptr)
         , m_bitstreamDataSize(0)
-        , m_bytesRead(0) {
+        , m_bytesRead(0)
+        , m_streamIndex()
+        , m_nextAccessUnit(0)
+        , m_seekBuffer()
+        , m_seekBufferPending(false)
+        , m_skipRaslPictures(false) {
 
 #ifdef USE_SIMPLE_MALLOC
         FILE* handle = fopen(pFilePath, "rb");
@@ -82,7 +91,7 @@ public:
 
         m_pBitstreamData = m_inputVideoStreamMmap.data();
 #endif
-        if (m_videoCodecType == VK_VIDEO_CODEC_OPERATION_DECODE_AV1_BIT_KHR) {
+        if (IsIvfStream()) {
             // Assume Duck IVF. DKIF.
             assert(*(const uint32_t*)m_pBitstreamData == DKIF_HEADER_MAGIC);
             const uint32_t firstFrameOffset = (DKIF_FILE_HEADER_SIZE + DKIF_FRAME_CONTAINER_HEADER_SIZE);
@@ -103,8 +112,13 @@ public:
         , m_pBitstreamData(pInput)
         , m_bitstreamDataSize(0)
         , m_bytesRead(0)
+        , m_streamIndex()
+        , m_nextAccessUnit(0)
+        , m_seekBuffer()
+        , m_seekBufferPending(false)
+        , m_skipRaslPictures(false)
     {
-        if (m_videoCodecType == VK_VIDEO_CODEC_OPERATION_DECODE_AV1_BIT_KHR) {
+        if (IsIvfStream()) {
             // Assume Duck IVF. DKIF.
             assert(*(const uint32_t*)pInput == DKIF_HEADER_MAGIC);
             const uint32_t firstFrameOffset = (DKIF_FILE_HEADER_SIZE + DKIF_FRAME_CONTAINER_HEADER_SIZE);
@@ -135,7 +149,7 @@ public:
 
     virtual ~ElementaryStream() {
 #ifdef USE_SIMPLE_MALLOC
-        if (m_videoCodecType == VK_VIDEO_CODEC_OPERATION_DECODE_AV1_BIT_KHR) {
+        if (IsIvfStream()) {
             const uint32_t firstFrameOffset = (DKIF_FILE_HEADER_SIZE + DKIF_FRAME_CONTAINER_HEADER_SIZE);
             m_pBitstreamData -= firstFrameOffset;
         }
@@ -147,8 +161,37 @@ public:
     }
 
     virtual bool IsStreamDemuxerEnabled() const { return false; }
-    virtual bool HasFramePreparser() const { return false; }
-    virtual void Rewind() { m_bytesRead = 0; }
+    virtual bool HasFramePreparser() const { return !m_streamIndex.accessUnits.empty(); }
+    virtual void Rewind()
+    {
+        m_bytesRead = 0;
+        m_nextAccessUnit = 0;
+        m_seekBufferPending = false;
+        m_skipRaslPictures = false;
+    }
+    virtual bool PreparseAccessUnits(uint32_t numThreads, const char* pIndexFileName)
+    {
+        if ((m_pBitstreamData == nullptr) || (m_bitstreamDataSize == 0)) {
+            return false;
+        }
+
+        Rewind();
+        if ((pIndexFileName != nullptr) &&
+                m_streamIndex.Load(pIndexFileName, m_videoCodecType, m_bitstreamDataSize)) {
+            return true;
+        }
+
+        if (!AccessUnitPreparser::Preparse(m_videoCodecType, m_pBitstreamData, (size_t)m_bitstreamDataSize,
+                                           numThreads, m_streamIndex)) {
+            return false;
+        }
+
+        if ((pIndexFileName != nullptr) && !m_streamIndex.Save(pIndexFileName)) {
+            fprintf(stderr, "Failed to write the stream index file %s\n", pIndexFileName);
+        }
+        return true;
+    }
+    virtual bool DemuxesAccessUnits() const { return !m_streamIndex.accessUnits.empty(); }
     virtual VkVideoCodecOperationFlagBitsKHR GetVideoCodec() const { return m_videoCodecType; }
 
     virtual VkVideoComponentBitDepthFlagsKHR GetLumaBitDepth() const
@@ -202,6 +245,8 @@ public:
             return STD_VIDEO_H265_PROFILE_IDC_MAIN;
         case VK_VIDEO_CODEC_OPERATION_DECODE_AV1_BIT_KHR:
             return STD_VIDEO_AV1_PROFILE_MAIN;
+        case VK_VIDEO_CODEC_OPERATION_DECODE_VP9_BIT_KHR:
+            return STD_VIDEO_VP9_PROFILE_0;
         default:
             assert(0);
         }
@@ -213,9 +258,54 @@ public:
     virtual int32_t GetBitDepth() const { return m_bitDepth; }
     virtual float GetFrameRate() const { return 0.0f; }
     virtual bool StreamHasEnded() const { return false; };
-    virtual bool Seek(int stream_index, int64_t timestamp, int flags) { return false; }
-    virtual int64_t DemuxFrame(const uint8_t**) {
-        return -1;
+    // Elementary streams have no timestamps: timestamp is the number of the access unit (frame)
+    // to seek to, and decoding resumes from the last random access point at or before it.
+    // The stream index is built on first use if the stream was not pre-parsed.
+    virtual bool Seek(int stream_index, int64_t timestamp, int flags)
+    {
+        if ((timestamp < 0) ||
+            (m_streamIndex.accessUnits.empty() &&
+             !PreparseAccessUnits(std::max(std::thread::hardware_concurrency(), 1U), nullptr))) {
+            return false;
+        }
+
+        const int64_t lastAccessUnit = (int64_t)m_streamIndex.accessUnits.size() - 1;
+        const VkVideoRandomAccessPoint* pRandomAccessPoint =
+            m_streamIndex.FindRandomAccessPoint((uint32_t)std::min(timestamp, lastAccessUnit));
+        if (pRandomAccessPoint == nullptr) {
+            return false;
+        }
+
+        PrepareRandomAccessPoint(*pRandomAccessPoint);
+        return true;
+    }
+    virtual int64_t DemuxFrame(const uint8_t** ppVideo) {
+        if (m_streamIndex.accessUnits.empty()) {
+            return -1;
+        }
+
+        if (m_seekBufferPending) {
+            m_seekBufferPending = false;
+            *ppVideo = m_seekBuffer.data();
+            return (int64_t)m_seekBuffer.size();
+        }
+
+        // RASL pictures reference pictures from before the CRA decoding was restarted from.
+        while (m_skipRaslPictures && (m_nextAccessUnit < m_streamIndex.accessUnits.size()) &&
+               m_streamIndex.accessUnits[m_nextAccessUnit].isRasl) {
+            m_nextAccessUnit++;
+        }
+        m_skipRaslPictures = false;
+
+        if (m_nextAccessUnit >= m_streamIndex.accessUnits.size()) {
+            *ppVideo = nullptr;
+            return 0;
+        }
+
+        const VkVideoAccessUnit& accessUnit = m_streamIndex.accessUnits[m_nextAccessUnit++];
+        *ppVideo = m_pBitstreamData + accessUnit.offset;
+        m_bytesRead = accessUnit.offset + accessUnit.size;
+        return accessUnit.size;
     }
     virtual int64_t ReadBitstreamData(const uint8_t **ppVideo, int64_t offset)
     {
@@ -223,7 +313,7 @@ public:
         assert(m_pBitstreamData != nullptr);
 
         // Compute and return the pointer to data at new offset.
-        if (m_videoCodecType == VK_VIDEO_CODEC_OPERATION_DECODE_AV1_BIT_KHR) {
+        if (IsIvfStream()) {
             *ppVideo = (m_pBitstreamData + offset);
             uint32_t dataSize = *(const uint32_t*)(*ppVideo - DKIF_FRAME_CONTAINER_HEADER_SIZE);
             if ((m_bitstreamDataSize - (offset + dataSize)) == 0) {
@@ -241,6 +331,55 @@ public:
     }
 
 private:
+    bool IsIvfStream() const
+    {
+        return (m_videoCodecType == VK_VIDEO_CODEC_OPERATION_DECODE_AV1_BIT_KHR) ||
+               (m_videoCodecType == VK_VIDEO_CODEC_OPERATION_DECODE_VP9_BIT_KHR);
+    }
+
+    // Builds the first packet after a seek: the random access point access unit preceded by
+    // the parameter sets that were active when the stream reached it.
+    void PrepareRandomAccessPoint(const VkVideoRandomAccessPoint& randomAccessPoint)
+    {
+        const VkVideoAccessUnit& accessUnit = m_streamIndex.accessUnits[randomAccessPoint.accessUnit];
+        const uint8_t* pAccessUnit = m_pBitstreamData + accessUnit.offset;
+
+        // AV1: the temporal delimiter OBU has to stay first in the temporal unit.
+        size_t prefixSize = 0;
+        if ((m_videoCodecType == VK_VIDEO_CODEC_OPERATION_DECODE_AV1_BIT_KHR) && (accessUnit.size >= 2) &&
+            (pAccessUnit[0] == 0x12) && (pAccessUnit[1] == 0x00)) {
+            prefixSize = 2;
+        }
+
+        m_seekBuffer.clear();
+        m_seekBuffer.insert(m_seekBuffer.end(), pAccessUnit, pAccessUnit + prefixSize);
+        for (uint32_t i = 0; i < randomAccessPoint.numParameterSets; i++) {
+            const VkVideoStreamRange& parameterSet =
+                m_streamIndex.parameterSets[randomAccessPoint.firstParameterSet + i];
+            m_seekBuffer.insert(m_seekBuffer.end(), m_pBitstreamData + parameterSet.offset,
+                                m_pBitstreamData + parameterSet.offset + parameterSet.size);
+        }
+        const size_t accessUnitStart = m_seekBuffer.size();
+        m_seekBuffer.insert(m_seekBuffer.end(), pAccessUnit + prefixSize, pAccessUnit + accessUnit.size);
+
+        // H.265: decode a CRA as a BLA_W_LP picture (HandleCraAsBlaFlag), so that the parser
+        // starts a new coded video sequence and its RASL pictures can be dropped.
+        m_skipRaslPictures = false;
+        if (m_videoCodecType == VK_VIDEO_CODEC_OPERATION_DECODE_H265_BIT_KHR) {
+            for (size_t i = accessUnitStart + 3; i < m_seekBuffer.size(); i++) {
+                if ((m_seekBuffer[i - 1] == 1) && (m_seekBuffer[i - 2] == 0) && (m_seekBuffer[i - 3] == 0) &&
+                    (((m_seekBuffer[i] >> 1) & 0x3f) == 21)) { // CRA_NUT
+                    m_seekBuffer[i] = (uint8_t)((m_seekBuffer[i] & 0x81) | (16 << 1)); // BLA_W_LP
+                    m_skipRaslPictures = true;
+                }
+            }
+        }
+
+        m_nextAccessUnit = randomAccessPoint.accessUnit + 1;
+        m_bytesRead = accessUnit.offset + accessUnit.size;
+        m_seekBufferPending = true;
+    }
+
     int32_t    m_width, m_height, m_bitDepth;
     VkVideoCodecOperationFlagBitsKHR m_videoCodecType;
 #ifndef USE_SIMPLE_MALLOC
@@ -249,6 +388,11 @@ private:
     const uint8_t* m_pBitstreamData;
     VkDeviceSize   m_bitstreamDataSize;
     VkDeviceSize   m_bytesRead;
+    VkVideoStreamIndex   m_streamIndex;
+    size_t               m_nextAccessUnit;
+    std::vector<uint8_t> m_seekBuffer;
+    uint32_t             m_seekBufferPending : 1;
+    uint32_t             m_skipRaslPictures : 1;
 };
 
 VkResult ElementaryStreamCreate(const char *pFilePath,
@@ -0,0 +1,600 @@
+/*
+ * Copyright 2024 NVIDIA Corporation.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string.h>
+#include <algorithm>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "mio/mio.hpp"
+#include "VkDecoderUtils/VideoStreamDemuxer.h"
+#include "VkDecoderUtils/AccessUnitPreparser.h"
+
+#define IVF_FILE_HEADER_SIZE 32
+#define IVF_FRAME_HEADER_SIZE 12
+
+static inline uint32_t ReadLe16(const uint8_t* p) { return p[0] | (p[1] << 8); }
+static inline uint32_t ReadLe32(const uint8_t* p) { return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24); }
+static inline uint64_t ReadLe64(const uint8_t* p) { return ReadLe32(p) | ((uint64_t)ReadLe32(p + 4) << 32); }
+
+// MSB-first reader for the AV1 sequence header and the VP9 uncompressed header.
+class IvfHeaderReader {
+
+public:
+    IvfHeaderReader(const uint8_t* pData, size_t size)
+        : m_pData(pData), m_size(size), m_bitOffset(0) { }
+
+    uint32_t f(uint32_t n)
+    {
+        uint32_t value = 0;
+        while (n--) {
+            uint32_t bit = 0;
+            if (m_bitOffset < (m_size * 8)) {
+                bit = (m_pData[m_bitOffset >> 3] >> (7 - (m_bitOffset & 7))) & 1;
+            }
+            m_bitOffset++;
+            value = (value << 1) | bit;
+        }
+        return value;
+    }
+
+    uint32_t uvlc()
+    {
+        uint32_t leadingZeros = 0;
+        while (!f(1) && !overrun()) {
+            leadingZeros++;
+        }
+        if (leadingZeros >= 32) {
+            return UINT32_MAX;
+        }
+        return f(leadingZeros) + ((1U << leadingZeros) - 1);
+    }
+
+    bool overrun() const { return m_bitOffset > (m_size * 8); }
+
+private:
+    const uint8_t* m_pData;
+    size_t         m_size;
+    size_t         m_bitOffset;
+};
+
+class IvfDemuxer : public VideoStreamDemuxer {
+
+public:
+    IvfDemuxer(const char *pFilePath,
+               VkVideoCodecOperationFlagBitsKHR codecType,
+               int32_t defaultWidth,
+               int32_t defaultHeight,
+               int32_t defaultBitDepth)
+        : VideoStreamDemuxer()
+        , m_width(defaultWidth)
+        , m_height(defaultHeight)
+        , m_bitDepth(defaultBitDepth)
+        , m_profile(0)
+        , m_chromaSubsampling(VK_VIDEO_CHROMA_SUBSAMPLING_420_BIT_KHR)
+        , m_videoCodecType(codecType)
+        , m_frameRateNum(0)
+        , m_frameRateDen(0)
+#ifndef USE_SIMPLE_MALLOC
+        , m_inputVideoStreamMmap()
+#endif
+        , m_pFileData(nullptr)
+        , m_fileSize(0)
+        , m_streamIndex()
+        , m_nextFrame(0)
+        , m_frameTimestamp(0)
+        , m_seekBuffer()
+        , m_seekBufferPending(false)
+    {
+#ifdef USE_SIMPLE_MALLOC
+        FILE* handle = fopen(pFilePath, "rb");
+        if (handle == nullptr) {
+            printf("Failed to open video file %s\n", pFilePath);
+            return;
+        }
+
+        fseek(handle, 0, SEEK_END);
+        size_t size = ftell(handle);
+        uint8_t* data = (uint8_t*)malloc(size);
+        if (data == nullptr) {
+            printf("Failed to allocate memory for video file: %i\n", (uint32_t)size);
+            fclose(handle);
+            return;
+        }
+
+        fseek(handle, 0, SEEK_SET);
+        size_t readBytes = fread(data, 1, size, handle);
+        fclose(handle);
+        if (readBytes != size) {
+            free(data);
+            return;
+        }
+        m_pFileData = data;
+        m_fileSize = size;
+#else
+        std::error_code error;
+        m_inputVideoStreamMmap.map(pFilePath, 0, mio::map_entire_file, error);
+        if (error) {
+            return;
+        }
+
+        m_pFileData = m_inputVideoStreamMmap.data();
+        m_fileSize = m_inputVideoStreamMmap.mapped_length();
+#endif
+    }
+
+    int32_t Initialize()
+    {
+        if ((m_pFileData == nullptr) || (m_fileSize < (IVF_FILE_HEADER_SIZE + IVF_FRAME_HEADER_SIZE)) ||
+                (memcmp(m_pFileData, "DKIF", 4) != 0)) {
+            std::cerr << "Not an IVF file" << std::endl;
+            return -1;
+        }
+
+        const uint32_t headerSize = ReadLe16(m_pFileData + 6);
+        if ((headerSize < IVF_FILE_HEADER_SIZE) || (m_fileSize < (headerSize + IVF_FRAME_HEADER_SIZE))) {
+            std::cerr << "Invalid IVF file header size " << headerSize << std::endl;
+            return -1;
+        }
+
+        VkVideoCodecOperationFlagBitsKHR fourccCodecType = VK_VIDEO_CODEC_OPERATION_NONE_KHR;
+        if (memcmp(m_pFileData + 8, "AV01", 4) == 0) {
+            fourccCodecType = VK_VIDEO_CODEC_OPERATION_DECODE_AV1_BIT_KHR;
+        } else if (memcmp(m_pFileData + 8, "VP90", 4) == 0) {
+            fourccCodecType = VK_VIDEO_CODEC_OPERATION_DECODE_VP9_BIT_KHR;
+        } else {
+            std::cerr << "Unsupported IVF fourcc " << std::string((const char*)m_pFileData + 8, 4) << std::endl;
+            return -1;
+        }
+
+        if ((m_videoCodecType != VK_VIDEO_CODEC_OPERATION_NONE_KHR) && (m_videoCodecType != fourccCodecType)) {
+            std::cerr << "The IVF fourcc does not match the requested codec" << std::endl;
+        }
+        m_videoCodecType = fourccCodecType;
+
+        m_width = ReadLe16(m_pFileData + 12);
+        m_height = ReadLe16(m_pFileData + 14);
+        m_frameRateNum = ReadLe32(m_pFileData + 16);
+        m_frameRateDen = ReadLe32(m_pFileData + 20);
+
+        // Index the frames, along with their key frames, from the payload of the first one on.
+        const size_t firstFrameOffset = headerSize + IVF_FRAME_HEADER_SIZE;
+        if (!AccessUnitPreparser::Preparse(m_videoCodecType, m_pFileData + firstFrameOffset,
+                                           (size_t)(m_fileSize - firstFrameOffset), 1, m_streamIndex)) {
+            std::cerr << "The IVF file has no frames" << std::endl;
+            return -1;
+        }
+
+        const VkVideoAccessUnit& firstFrame = m_streamIndex.accessUnits[0];
+        const uint8_t* pFirstFrame = m_pFileData + firstFrameOffset + firstFrame.offset;
+        if (m_videoCodecType == VK_VIDEO_CODEC_OPERATION_DECODE_AV1_BIT_KHR) {
+            ParseAv1StreamParameters(pFirstFrame, (size_t)firstFrame.size);
+        } else {
+            ParseVp9StreamParameters(pFirstFrame, (size_t)firstFrame.size);
+        }
+
+        return 0;
+    }
+
+    static VkResult Create(const char *pFilePath,
+                           VkVideoCodecOperationFlagBitsKHR codecType,
+                           int32_t defaultWidth,
+                           int32_t defaultHeight,
+                           int32_t defaultBitDepth,
+                           VkSharedBaseObj<IvfDemuxer>& ivfDemuxer)
+    {
+        VkSharedBaseObj<IvfDemuxer> newIvfDemuxer(new IvfDemuxer(pFilePath, codecType,
+                                                                 defaultWidth,
+                                                                 defaultHeight,
+                                                                 defaultBitDepth));
+
+        if ((newIvfDemuxer) && (newIvfDemuxer->Initialize() >= 0)) {
+            ivfDemuxer = newIvfDemuxer;
+            return VK_SUCCESS;
+        }
+        return VK_ERROR_INITIALIZATION_FAILED;
+    }
+
+    virtual ~IvfDemuxer() {
+#ifdef USE_SIMPLE_MALLOC
+        free((void*)(m_pFileData));
+#else
+        m_inputVideoStreamMmap.unmap();
+#endif
+    }
+
+    virtual bool IsStreamDemuxerEnabled() const { return true; }
+    virtual bool HasFramePreparser() const { return true; }
+    virtual bool DemuxesAccessUnits() const { return true; }
+    virtual int64_t GetFrameTimestamp() const { return m_frameTimestamp; }
+    virtual void Rewind()
+    {
+        m_nextFrame = 0;
+        m_seekBufferPending = false;
+    }
+    virtual VkVideoCodecOperationFlagBitsKHR GetVideoCodec() const { return m_videoCodecType; }
+
+    virtual VkVideoComponentBitDepthFlagsKHR GetLumaBitDepth() const
+    {
+        switch (m_bitDepth) {
+        case 8:
+            return VK_VIDEO_COMPONENT_BIT_DEPTH_8_BIT_KHR;
+        case 10:
+            return VK_VIDEO_COMPONENT_BIT_DEPTH_10_BIT_KHR;
+        case 12:
+            return VK_VIDEO_COMPONENT_BIT_DEPTH_12_BIT_KHR;
+        default:
+            assert(!"Unknown Luma Bit Depth!");
+        }
+        return VK_VIDEO_COMPONENT_BIT_DEPTH_INVALID_KHR;
+    }
+
+    virtual VkVideoChromaSubsamplingFlagsKHR GetChromaSubsampling() const { return m_chromaSubsampling; }
+
+    virtual VkVideoComponentBitDepthFlagsKHR GetChromaBitDepth() const
+    {
+        if (m_chromaSubsampling == VK_VIDEO_CHROMA_SUBSAMPLING_MONOCHROME_BIT_KHR) {
+            return VK_VIDEO_COMPONENT_BIT_DEPTH_INVALID_KHR;
+        }
+        return GetLumaBitDepth();
+    }
+
+    virtual uint32_t GetProfileIdc() const { return m_profile; }
+    virtual int32_t GetWidth() const { return m_width; }
+    virtual int32_t GetHeight() const { return m_height; }
+    virtual int32_t GetBitDepth() const { return m_bitDepth; }
+    virtual float GetFrameRate() const
+    {
+        return (m_frameRateDen > 0) ? (float)m_frameRateNum / (float)m_frameRateDen : 0.0f;
+    }
+    virtual bool StreamHasEnded() const { return m_nextFrame >= m_streamIndex.accessUnits.size(); }
+
+    // Seeks to the last key frame with a timestamp at or before the given one, in IVF time base units.
+    virtual bool Seek(int stream_index, int64_t timestamp, int flags)
+    {
+        uint32_t frame = 0;
+        while (((frame + 1) < m_streamIndex.accessUnits.size()) &&
+               (GetTimestamp(m_streamIndex.accessUnits[frame + 1]) <= timestamp)) {
+            frame++;
+        }
+
+        const VkVideoRandomAccessPoint* pRandomAccessPoint = m_streamIndex.FindRandomAccessPoint(frame);
+        if (pRandomAccessPoint == nullptr) {
+            return false;
+        }
+
+        m_nextFrame = pRandomAccessPoint->accessUnit;
+        m_seekBufferPending = false;
+        if (pRandomAccessPoint->numParameterSets > 0) {
+            // AV1: resend the active sequence header after the temporal delimiter of the key frame.
+            const VkVideoAccessUnit& keyFrame = m_streamIndex.accessUnits[m_nextFrame];
+            const uint8_t* pKeyFrame = GetFrameData(keyFrame);
+            const size_t prefixSize = ((keyFrame.size >= 2) && (pKeyFrame[0] == 0x12) && (pKeyFrame[1] == 0x00)) ? 2 : 0;
+            const VkVideoStreamRange& sequenceHeader =
+                m_streamIndex.parameterSets[pRandomAccessPoint->firstParameterSet];
+            const uint8_t* pSequenceHeader = GetPayloadBase() + sequenceHeader.offset;
+
+            m_seekBuffer.clear();
+            m_seekBuffer.insert(m_seekBuffer.end(), pKeyFrame, pKeyFrame + prefixSize);
+            m_seekBuffer.insert(m_seekBuffer.end(), pSequenceHeader, pSequenceHeader + sequenceHeader.size);
+            m_seekBuffer.insert(m_seekBuffer.end(), pKeyFrame + prefixSize, pKeyFrame + keyFrame.size);
+            m_seekBufferPending = true;
+        }
+        return true;
+    }
+
+    // Returns one IVF frame: an AV1 temporal unit or a VP9 frame, which may be a superframe
+    // that the VP9 parser splits with its superframe index.
+    virtual int64_t DemuxFrame(const uint8_t** ppVideo)
+    {
+        if (m_nextFrame >= m_streamIndex.accessUnits.size()) {
+            *ppVideo = nullptr;
+            return 0;
+        }
+
+        const VkVideoAccessUnit& frame = m_streamIndex.accessUnits[m_nextFrame++];
+        m_frameTimestamp = GetTimestamp(frame);
+        if (m_seekBufferPending) {
+            m_seekBufferPending = false;
+            *ppVideo = m_seekBuffer.data();
+            return (int64_t)m_seekBuffer.size();
+        }
+
+        *ppVideo = GetFrameData(frame);
+        return frame.size;
+    }
+
+    virtual int64_t ReadBitstreamData(const uint8_t**, int64_t) {
+        return -1;
+    }
+
+    virtual void DumpStreamParameters() const {
+        std::cout << "Width: "     << m_width << std::endl;
+        std::cout << "Height: "    << m_height <<  std::endl;
+        std::cout << "BitDepth: "  << m_bitDepth << std::endl;
+        std::cout << "Profile: "   << m_profile << std::endl;
+        std::cout << "Frames: "    << m_streamIndex.accessUnits.size() << std::endl;
+        std::cout << "Key frames: " << m_streamIndex.randomAccessPoints.size() << std::endl;
+    }
+
+private:
+    // The stream index offsets are relative to the payload of the first frame.
+    const uint8_t* GetPayloadBase() const
+    {
+        return m_pFileData + ReadLe16(m_pFileData + 6) + IVF_FRAME_HEADER_SIZE;
+    }
+
+    const uint8_t* GetFrameData(const VkVideoAccessUnit& frame) const
+    {
+        return GetPayloadBase() + frame.offset;
+    }
+
+    int64_t GetTimestamp(const VkVideoAccessUnit& frame) const
+    {
+        return (int64_t)ReadLe64(GetFrameData(frame) - IVF_FRAME_HEADER_SIZE + 4);
+    }
+
+    void SetChromaSubsampling(bool monochrome, uint32_t subsamplingX, uint32_t subsamplingY)
+    {
+        if (monochrome) {
+            m_chromaSubsampling = VK_VIDEO_CHROMA_SUBSAMPLING_MONOCHROME_BIT_KHR;
+        } else if (subsamplingX && subsamplingY) {
+            m_chromaSubsampling = VK_VIDEO_CHROMA_SUBSAMPLING_420_BIT_KHR;
+        } else if (subsamplingX) {
+            m_chromaSubsampling = VK_VIDEO_CHROMA_SUBSAMPLING_422_BIT_KHR;
+        } else {
+            m_chromaSubsampling = VK_VIDEO_CHROMA_SUBSAMPLING_444_BIT_KHR;
+        }
+    }
+
+    // Reads seq_profile and color_config() from the first sequence header OBU (AV1 5.5).
+    void ParseAv1StreamParameters(const uint8_t* pData, size_t size)
+    {
+        const uint8_t* pObu = pData;
+        const uint8_t* pEnd = pData + size;
+        uint64_t obuSize = 0;
+        while (pObu < pEnd) {
+            const uint8_t obuHeader = *pObu++;
+            const uint32_t obuType = (obuHeader >> 3) & 0xf;
+            pObu += ((obuHeader >> 2) & 1) ? 1 : 0;
+            obuSize = (pObu < pEnd) ? (uint64_t)(pEnd - pObu) : 0;
+            if ((obuHeader >> 1) & 1) {
+                obuSize = 0;
+                for (uint32_t i = 0; (i < 8) && (pObu < pEnd); i++) {
+                    const uint8_t leb128Byte = *pObu++;
+                    obuSize |= (uint64_t)(leb128Byte & 0x7f) << (i * 7);
+                    if (!(leb128Byte & 0x80)) {
+                        break;
+                    }
+                }
+            }
+            if ((pObu > pEnd) || (obuSize > (uint64_t)(pEnd - pObu))) {
+                return;
+            }
+            if (obuType == 1) { // OBU_SEQUENCE_HEADER
+                break;
+            }
+            pObu += obuSize;
+        }
+        if (pObu >= pEnd) {
+            return;
+        }
+
+        IvfHeaderReader r(pObu, (size_t)obuSize);
+        const uint32_t seq_profile = r.f(3);
+        r.f(1); // still_picture
+        const uint32_t reduced_still_picture_header = r.f(1);
+        if (reduced_still_picture_header) {
+            r.f(5); // seq_level_idx[0]
+        } else {
+            uint32_t decoder_model_info_present_flag = 0, buffer_delay_length_minus_1 = 0;
+            if (r.f(1)) { // timing_info_present_flag
+                r.f(32); // num_units_in_display_tick
+                r.f(32); // time_scale
+                if (r.f(1)) { // equal_picture_interval
+                    r.uvlc(); // num_ticks_per_picture_minus_1
+                }
+                decoder_model_info_present_flag = r.f(1);
+                if (decoder_model_info_present_flag) {
+                    buffer_delay_length_minus_1 = r.f(5);
+                    r.f(32); // num_units_in_decoding_tick
+                    r.f(5);  // buffer_removal_time_length_minus_1
+                    r.f(5);  // frame_presentation_time_length_minus_1
+                }
+            }
+            const uint32_t initial_display_delay_present_flag = r.f(1);
+            const uint32_t operating_points_cnt_minus_1 = r.f(5);
+            for (uint32_t i = 0; i <= operating_points_cnt_minus_1; i++) {
+                r.f(12); // operating_point_idc[i]
+                if (r.f(5) > 7) { // seq_level_idx[i]
+                    r.f(1); // seq_tier[i]
+                }
+                if (decoder_model_info_present_flag && r.f(1)) { // decoder_model_present_for_this_op[i]
+                    r.f(buffer_delay_length_minus_1 + 1); // decoder_buffer_delay
+                    r.f(buffer_delay_length_minus_1 + 1); // encoder_buffer_delay
+                    r.f(1); // low_delay_mode_flag
+                }
+                if (initial_display_delay_present_flag && r.f(1)) {
+                    r.f(4); // initial_display_delay_minus_1[i]
+                }
+            }
+        }
+        const uint32_t frame_width_bits_minus_1 = r.f(4);
+        const uint32_t frame_height_bits_minus_1 = r.f(4);
+        const uint32_t max_frame_width_minus_1 = r.f(frame_width_bits_minus_1 + 1);
+        const uint32_t max_frame_height_minus_1 = r.f(frame_height_bits_minus_1 + 1);
+        if (!reduced_still_picture_header && r.f(1)) { // frame_id_numbers_present_flag
+            r.f(4); // delta_frame_id_length_minus_2
+            r.f(3); // additional_frame_id_length_minus_1
+        }
+        r.f(3); // use_128x128_superblock, enable_filter_intra, enable_intra_edge_filter
+        if (!reduced_still_picture_header) {
+            r.f(4); // enable_interintra_compound, enable_masked_compound, enable_warped_motion, enable_dual_filter
+            const uint32_t enable_order_hint = r.f(1);
+            if (enable_order_hint) {
+                r.f(2); // enable_jnt_comp, enable_ref_frame_mvs
+            }
+            uint32_t seq_force_screen_content_tools = 2; // SELECT_SCREEN_CONTENT_TOOLS
+            if (!r.f(1)) { // seq_choose_screen_content_tools
+                seq_force_screen_content_tools = r.f(1);
+            }
+            if ((seq_force_screen_content_tools > 0) && !r.f(1)) { // seq_choose_integer_mv
+                r.f(1); // seq_force_integer_mv
+            }
+            if (enable_order_hint) {
+                r.f(3); // order_hint_bits_minus_1
+            }
+        }
+        r.f(3); // enable_superres, enable_cdef, enable_restoration
+
+        // color_config()
+        const uint32_t high_bitdepth = r.f(1);
+        uint32_t bitDepth = high_bitdepth ? 10 : 8;
+        if ((seq_profile == 2) && high_bitdepth) {
+            bitDepth = r.f(1) ? 12 : 10; // twelve_bit
+        }
+        const uint32_t mono_chrome = (seq_profile == 1) ? 0 : r.f(1);
+        uint32_t color_primaries = 2, transfer_characteristics = 2, matrix_coefficients = 2;
+        if (r.f(1)) { // color_description_present_flag
+            color_primaries = r.f(8);
+            transfer_characteristics = r.f(8);
+            matrix_coefficients = r.f(8);
+        }
+        uint32_t subsampling_x = 1, subsampling_y = 1;
+        if (!mono_chrome) {
+            if ((color_primaries == 1) && (transfer_characteristics == 13) && (matrix_coefficients == 0)) {
+                subsampling_x = subsampling_y = 0; // sRGB
+            } else {
+                r.f(1); // color_range
+                if (seq_profile == 1) {
+                    subsampling_x = subsampling_y = 0;
+                } else if (seq_profile == 2) {
+                    subsampling_y = 0;
+                    if (bitDepth == 12) {
+                        subsampling_x = r.f(1);
+                        subsampling_y = subsampling_x ? r.f(1) : 0;
+                    }
+                }
+            }
+        }
+
+        if (r.overrun()) {
+            return;
+        }
+
+        m_profile = seq_profile;
+        m_bitDepth = bitDepth;
+        SetChromaSubsampling(mono_chrome, subsampling_x, subsampling_y);
+        if ((m_width == 0) || (m_height == 0)) {
+            m_width = max_frame_width_minus_1 + 1;
+            m_height = max_frame_height_minus_1 + 1;
+        }
+    }
+
+    // Reads the profile and color_config() of the first (key) frame (VP9 6.2).
+    void ParseVp9StreamParameters(const uint8_t* pData, size_t size)
+    {
+        IvfHeaderReader r(pData, size);
+        if (r.f(2) != 2) { // frame_marker
+            return;
+        }
+        const uint32_t profile_low_bit = r.f(1);
+        const uint32_t profile = profile_low_bit | (r.f(1) << 1); // profile_high_bit
+        if (profile == 3) {
+            r.f(1); // reserved_zero
+        }
+        m_profile = profile;
+        if (r.f(1) || r.f(1)) { // show_existing_frame, frame_type != KEY_FRAME
+            return;
+        }
+        r.f(2); // show_frame, error_resilient_mode
+        if (r.f(24) != 0x498342) { // frame_sync_code
+            return;
+        }
+
+        uint32_t bitDepth = 8;
+        if (profile >= 2) {
+            bitDepth = r.f(1) ? 12 : 10; // ten_or_twelve_bit
+        }
+        uint32_t subsampling_x = 1, subsampling_y = 1;
+        if (r.f(3) != 7) { // color_space != CS_RGB
+            r.f(1); // color_range
+            if ((profile == 1) || (profile == 3)) {
+                subsampling_x = r.f(1);
+                subsampling_y = r.f(1);
+            }
+        } else if ((profile == 1) || (profile == 3)) {
+            subsampling_x = subsampling_y = 0;
+        }
+
+        if (r.overrun()) {
+            return;
+        }
+
+        m_bitDepth = bitDepth;
+        SetChromaSubsampling(false, subsampling_x, subsampling_y);
+    }
+
+    int32_t    m_width, m_height, m_bitDepth;
+    uint32_t   m_profile;
+    VkVideoChromaSubsamplingFlagsKHR m_chromaSubsampling;
+    VkVideoCodecOperationFlagBitsKHR m_videoCodecType;
+    uint32_t   m_frameRateNum, m_frameRateDen;
+#ifndef USE_SIMPLE_MALLOC
+    mio::basic_mmap<mio::access_mode::read, uint8_t> m_inputVideoStreamMmap;
+#endif
+    const uint8_t*       m_pFileData;
+    VkDeviceSize         m_fileSize;
+    VkVideoStreamIndex   m_streamIndex;
+    size_t               m_nextFrame;
+    int64_t              m_frameTimestamp;
+    std::vector<uint8_t> m_seekBuffer;
+    bool                 m_seekBufferPending;
+};
+
+bool IvfDemuxerCheckFile(const char *pFilePath)
+{
+    uint8_t signature[4] = {};
+    FILE* handle = fopen(pFilePath, "rb");
+    if (handle == nullptr) {
+        return false;
+    }
+    const bool isIvf = (fread(signature, sizeof(signature), 1, handle) == 1) &&
+                       (memcmp(signature, "DKIF", sizeof(signature)) == 0);
+    fclose(handle);
+    return isIvf;
+}
+
+VkResult IvfDemuxerCreate(const char *pFilePath,
+                          VkVideoCodecOperationFlagBitsKHR codecType,
+                          int32_t defaultWidth,
+                          int32_t defaultHeight,
+                          int32_t defaultBitDepth,
+                          VkSharedBaseObj<VideoStreamDemuxer>& videoStreamDemuxer)
+{
+    VkSharedBaseObj<IvfDemuxer> ivfDemuxer;
+    VkResult result = IvfDemuxer::Create(pFilePath,
+                                         codecType,
+                                         defaultWidth,
+                                         defaultHeight,
+                                         defaultBitDepth,
+                                         ivfDemuxer);
+    if (result == VK_SUCCESS) {
+        videoStreamDemuxer = ivfDemuxer;
+    }
+
+    return result;
+}
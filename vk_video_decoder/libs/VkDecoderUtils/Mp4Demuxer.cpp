@@ -0,0 +1,720 @@
+/*
+ * Copyright 2024 NVIDIA Corporation.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string.h>
+#include <algorithm>
+#include <iostream>
+#include <vector>
+#include "mio/mio.hpp"
+#include "VkDecoderUtils/VideoStreamDemuxer.h"
+
+#define MP4_FOURCC(a, b, c, d) (((uint32_t)(a) << 24) | ((uint32_t)(b) << 16) | ((uint32_t)(c) << 8) | (uint32_t)(d))
+#define MP4_VISUAL_SAMPLE_ENTRY_SIZE 78
+
+static inline uint32_t ReadBe16(const uint8_t* p) { return (p[0] << 8) | p[1]; }
+static inline uint32_t ReadBe32(const uint8_t* p) { return ((uint32_t)p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3]; }
+static inline uint64_t ReadBe64(const uint8_t* p) { return ((uint64_t)ReadBe32(p) << 32) | ReadBe32(p + 4); }
+
+// An ISO-BMFF box: its type and payload, excluding the box header.
+struct Mp4Box {
+    uint32_t       type;
+    const uint8_t* pData;
+    size_t         size;
+};
+
+// Reads the box at p and advances p past it. Returns false at the end of the parent or on a
+// truncated box.
+static bool Mp4NextBox(const uint8_t*& p, const uint8_t* pEnd, Mp4Box& box)
+{
+    if ((pEnd - p) < 8) {
+        return false;
+    }
+
+    uint64_t boxSize = ReadBe32(p);
+    box.type = ReadBe32(p + 4);
+    size_t headerSize = 8;
+    if (boxSize == 1) {
+        if ((pEnd - p) < 16) {
+            return false;
+        }
+        boxSize = ReadBe64(p + 8);
+        headerSize = 16;
+    } else if (boxSize == 0) {
+        boxSize = (uint64_t)(pEnd - p);
+    }
+
+    if ((boxSize < headerSize) || (boxSize > (uint64_t)(pEnd - p))) {
+        return false;
+    }
+
+    box.pData = p + headerSize;
+    box.size = (size_t)(boxSize - headerSize);
+    p += boxSize;
+    return true;
+}
+
+static bool Mp4FindBox(const uint8_t* pData, size_t size, uint32_t type, Mp4Box& box)
+{
+    const uint8_t* p = pData;
+    while (Mp4NextBox(p, pData + size, box)) {
+        if (box.type == type) {
+            return true;
+        }
+    }
+    return false;
+}
+
+class Mp4Demuxer : public VideoStreamDemuxer {
+
+    struct Sample {
+        int64_t  offset;
+        uint32_t size;
+        uint32_t isSync : 1;
+        int64_t  dts;
+        int64_t  pts;
+    };
+
+public:
+    Mp4Demuxer(const char *pFilePath,
+               VkVideoCodecOperationFlagBitsKHR codecType,
+               int32_t defaultWidth,
+               int32_t defaultHeight,
+               int32_t defaultBitDepth)
+        : VideoStreamDemuxer()
+        , m_width(defaultWidth)
+        , m_height(defaultHeight)
+        , m_bitDepth(defaultBitDepth)
+        , m_profile(0)
+        , m_chromaSubsampling(VK_VIDEO_CHROMA_SUBSAMPLING_420_BIT_KHR)
+        , m_videoCodecType(codecType)
+        , m_timescale(0)
+        , m_duration(0)
+#ifndef USE_SIMPLE_MALLOC
+        , m_inputVideoStreamMmap()
+#endif
+        , m_pFileData(nullptr)
+        , m_fileSize(0)
+        , m_samples()
+        , m_syncSamples()
+        , m_parameterSets()
+        , m_nalLengthSize(0)
+        , m_nextSample(0)
+        , m_frameTimestamp(0)
+        , m_packetBuffer()
+        , m_sendParameterSets(true)
+    {
+#ifdef USE_SIMPLE_MALLOC
+        FILE* handle = fopen(pFilePath, "rb");
+        if (handle == nullptr) {
+            printf("Failed to open video file %s\n", pFilePath);
+            return;
+        }
+
+        fseek(handle, 0, SEEK_END);
+        size_t size = ftell(handle);
+        uint8_t* data = (uint8_t*)malloc(size);
+        if (data == nullptr) {
+            printf("Failed to allocate memory for video file: %i\n", (uint32_t)size);
+            fclose(handle);
+            return;
+        }
+
+        fseek(handle, 0, SEEK_SET);
+        size_t readBytes = fread(data, 1, size, handle);
+        fclose(handle);
+        if (readBytes != size) {
+            free(data);
+            return;
+        }
+        m_pFileData = data;
+        m_fileSize = size;
+#else
+        std::error_code error;
+        m_inputVideoStreamMmap.map(pFilePath, 0, mio::map_entire_file, error);
+        if (error) {
+            return;
+        }
+
+        m_pFileData = m_inputVideoStreamMmap.data();
+        m_fileSize = m_inputVideoStreamMmap.mapped_length();
+#endif
+    }
+
+    int32_t Initialize()
+    {
+        if (m_pFileData == nullptr) {
+            return -1;
+        }
+
+        Mp4Box moov;
+        if (!Mp4FindBox(m_pFileData, (size_t)m_fileSize, MP4_FOURCC('m', 'o', 'o', 'v'), moov)) {
+            std::cerr << "MP4: no moov box found (fragmented MP4 is not supported)" << std::endl;
+            return -1;
+        }
+
+        // Use the first video track with a supported codec.
+        const uint8_t* p = moov.pData;
+        Mp4Box trak;
+        while (Mp4NextBox(p, moov.pData + moov.size, trak)) {
+            if ((trak.type == MP4_FOURCC('t', 'r', 'a', 'k')) && ParseTrack(trak)) {
+                break;
+            }
+        }
+
+        if (m_samples.empty()) {
+            std::cerr << "MP4: no supported H.264, H.265 or AV1 video track found" << std::endl;
+            return -1;
+        }
+
+        return 0;
+    }
+
+    static VkResult Create(const char *pFilePath,
+                           VkVideoCodecOperationFlagBitsKHR codecType,
+                           int32_t defaultWidth,
+                           int32_t defaultHeight,
+                           int32_t defaultBitDepth,
+                           VkSharedBaseObj<Mp4Demuxer>& mp4Demuxer)
+    {
+        VkSharedBaseObj<Mp4Demuxer> newMp4Demuxer(new Mp4Demuxer(pFilePath, codecType,
+                                                                 defaultWidth,
+                                                                 defaultHeight,
+                                                                 defaultBitDepth));
+
+        if ((newMp4Demuxer) && (newMp4Demuxer->Initialize() >= 0)) {
+            mp4Demuxer = newMp4Demuxer;
+            return VK_SUCCESS;
+        }
+        return VK_ERROR_INITIALIZATION_FAILED;
+    }
+
+    virtual ~Mp4Demuxer() {
+#ifdef USE_SIMPLE_MALLOC
+        free((void*)(m_pFileData));
+#else
+        m_inputVideoStreamMmap.unmap();
+#endif
+    }
+
+    virtual bool IsStreamDemuxerEnabled() const { return true; }
+    virtual bool HasFramePreparser() const { return true; }
+    virtual bool DemuxesAccessUnits() const { return true; }
+    virtual int64_t GetFrameTimestamp() const { return m_frameTimestamp; }
+    virtual uint32_t GetNalLengthSize() const { return m_nalLengthSize; }
+    virtual void Rewind()
+    {
+        m_nextSample = 0;
+        m_sendParameterSets = true;
+    }
+    virtual VkVideoCodecOperationFlagBitsKHR GetVideoCodec() const { return m_videoCodecType; }
+
+    virtual VkVideoComponentBitDepthFlagsKHR GetLumaBitDepth() const
+    {
+        switch (m_bitDepth) {
+        case 8:
+            return VK_VIDEO_COMPONENT_BIT_DEPTH_8_BIT_KHR;
+        case 10:
+            return VK_VIDEO_COMPONENT_BIT_DEPTH_10_BIT_KHR;
+        case 12:
+            return VK_VIDEO_COMPONENT_BIT_DEPTH_12_BIT_KHR;
+        default:
+            assert(!"Unknown Luma Bit Depth!");
+        }
+        return VK_VIDEO_COMPONENT_BIT_DEPTH_INVALID_KHR;
+    }
+
+    virtual VkVideoChromaSubsamplingFlagsKHR GetChromaSubsampling() const { return m_chromaSubsampling; }
+
+    virtual VkVideoComponentBitDepthFlagsKHR GetChromaBitDepth() const
+    {
+        if (m_chromaSubsampling == VK_VIDEO_CHROMA_SUBSAMPLING_MONOCHROME_BIT_KHR) {
+            return VK_VIDEO_COMPONENT_BIT_DEPTH_INVALID_KHR;
+        }
+        return GetLumaBitDepth();
+    }
+
+    virtual uint32_t GetProfileIdc() const { return m_profile; }
+    virtual int32_t GetWidth() const { return m_width; }
+    virtual int32_t GetHeight() const { return m_height; }
+    virtual int32_t GetBitDepth() const { return m_bitDepth; }
+    virtual float GetFrameRate() const
+    {
+        if ((m_duration == 0) || m_samples.empty()) {
+            return 0.0f;
+        }
+        return (float)((double)m_samples.size() * m_timescale / (double)m_duration);
+    }
+    virtual bool StreamHasEnded() const { return m_nextSample >= m_samples.size(); }
+
+    // Seeks to the last sync sample at or before the given presentation time, in media timescale units.
+    virtual bool Seek(int stream_index, int64_t timestamp, int flags)
+    {
+        // Sync samples present in decode order, so their presentation times are increasing.
+        auto syncIt = std::upper_bound(m_syncSamples.begin(), m_syncSamples.end(), timestamp,
+                                       [this](int64_t ts, uint32_t sample) { return ts < m_samples[sample].pts; });
+        if (syncIt == m_syncSamples.begin()) {
+            return false;
+        }
+
+        m_nextSample = *(--syncIt);
+        m_sendParameterSets = true;
+        return true;
+    }
+
+    // Returns one sample (access unit) in place. H.264/H.265 samples keep their length-prefixed NAL units,
+    // which the parser takes as is (GetNalLengthSize()); the first sample and the first one after a seek are
+    // preceded by the parameter sets of the decoder configuration record in a reused buffer.
+    virtual int64_t DemuxFrame(const uint8_t** ppVideo)
+    {
+        if (m_nextSample >= m_samples.size()) {
+            *ppVideo = nullptr;
+            return 0;
+        }
+
+        const Sample& sample = m_samples[m_nextSample++];
+        m_frameTimestamp = sample.pts;
+        const uint8_t* pSample = m_pFileData + sample.offset;
+        if (!m_sendParameterSets || m_parameterSets.empty()) {
+            *ppVideo = pSample;
+            return sample.size;
+        }
+
+        m_sendParameterSets = false;
+        m_packetBuffer.assign(m_parameterSets.begin(), m_parameterSets.end());
+        m_packetBuffer.insert(m_packetBuffer.end(), pSample, pSample + sample.size);
+        *ppVideo = m_packetBuffer.data();
+        return (int64_t)m_packetBuffer.size();
+    }
+
+    virtual int64_t ReadBitstreamData(const uint8_t**, int64_t) {
+        return -1;
+    }
+
+    virtual void DumpStreamParameters() const {
+        std::cout << "Width: "        << m_width << std::endl;
+        std::cout << "Height: "       << m_height <<  std::endl;
+        std::cout << "BitDepth: "     << m_bitDepth << std::endl;
+        std::cout << "Profile: "      << m_profile << std::endl;
+        std::cout << "Samples: "      << m_samples.size() << std::endl;
+        std::cout << "Sync samples: " << m_syncSamples.size() << std::endl;
+    }
+
+private:
+    bool ParseTrack(const Mp4Box& trak)
+    {
+        Mp4Box mdia, hdlr, mdhd, minf, stbl;
+        if (!Mp4FindBox(trak.pData, trak.size, MP4_FOURCC('m', 'd', 'i', 'a'), mdia) ||
+            !Mp4FindBox(mdia.pData, mdia.size, MP4_FOURCC('h', 'd', 'l', 'r'), hdlr) ||
+            (hdlr.size < 12) || (ReadBe32(hdlr.pData + 8) != MP4_FOURCC('v', 'i', 'd', 'e')) ||
+            !Mp4FindBox(mdia.pData, mdia.size, MP4_FOURCC('m', 'd', 'h', 'd'), mdhd) ||
+            !Mp4FindBox(mdia.pData, mdia.size, MP4_FOURCC('m', 'i', 'n', 'f'), minf) ||
+            !Mp4FindBox(minf.pData, minf.size, MP4_FOURCC('s', 't', 'b', 'l'), stbl)) {
+            return false;
+        }
+
+        // mdhd: version 1 uses 64-bit times.
+        if (mdhd.size < 24) {
+            return false;
+        }
+        if (mdhd.pData[0] == 1) {
+            if (mdhd.size < 32) {
+                return false;
+            }
+            m_timescale = ReadBe32(mdhd.pData + 20);
+            m_duration = ReadBe64(mdhd.pData + 24);
+        } else {
+            m_timescale = ReadBe32(mdhd.pData + 12);
+            m_duration = ReadBe32(mdhd.pData + 16);
+        }
+
+        Mp4Box stsd;
+        if (!Mp4FindBox(stbl.pData, stbl.size, MP4_FOURCC('s', 't', 's', 'd'), stsd) ||
+            (stsd.size < 8) || !ParseSampleEntry(stsd.pData + 8, stsd.size - 8)) {
+            return false;
+        }
+
+        if (!BuildSampleTable(stbl)) {
+            m_samples.clear();
+            m_syncSamples.clear();
+            return false;
+        }
+        return true;
+    }
+
+    // Parses the first visual sample entry and its decoder configuration record.
+    bool ParseSampleEntry(const uint8_t* pData, size_t size)
+    {
+        const uint8_t* p = pData;
+        Mp4Box entry;
+        if (!Mp4NextBox(p, pData + size, entry) || (entry.size < MP4_VISUAL_SAMPLE_ENTRY_SIZE)) {
+            return false;
+        }
+
+        const uint8_t* pConfigBoxes = entry.pData + MP4_VISUAL_SAMPLE_ENTRY_SIZE;
+        const size_t configBoxesSize = entry.size - MP4_VISUAL_SAMPLE_ENTRY_SIZE;
+        Mp4Box config;
+        bool success = false;
+        switch (entry.type) {
+        case MP4_FOURCC('a', 'v', 'c', '1'):
+        case MP4_FOURCC('a', 'v', 'c', '3'):
+            success = Mp4FindBox(pConfigBoxes, configBoxesSize, MP4_FOURCC('a', 'v', 'c', 'C'), config) &&
+                      ParseAvcConfig(config.pData, config.size);
+            m_videoCodecType = VK_VIDEO_CODEC_OPERATION_DECODE_H264_BIT_KHR;
+            break;
+        case MP4_FOURCC('h', 'v', 'c', '1'):
+        case MP4_FOURCC('h', 'e', 'v', '1'):
+            success = Mp4FindBox(pConfigBoxes, configBoxesSize, MP4_FOURCC('h', 'v', 'c', 'C'), config) &&
+                      ParseHevcConfig(config.pData, config.size);
+            m_videoCodecType = VK_VIDEO_CODEC_OPERATION_DECODE_H265_BIT_KHR;
+            break;
+        case MP4_FOURCC('a', 'v', '0', '1'):
+            success = Mp4FindBox(pConfigBoxes, configBoxesSize, MP4_FOURCC('a', 'v', '1', 'C'), config) &&
+                      ParseAv1Config(config.pData, config.size);
+            m_videoCodecType = VK_VIDEO_CODEC_OPERATION_DECODE_AV1_BIT_KHR;
+            break;
+        default:
+            break;
+        }
+
+        if (success) {
+            m_width = ReadBe16(entry.pData + 24);
+            m_height = ReadBe16(entry.pData + 26);
+        }
+        return success;
+    }
+
+    // AVCDecoderConfigurationRecord (ISO/IEC 14496-15 5.3.3.1)
+    bool ParseAvcConfig(const uint8_t* pData, size_t size)
+    {
+        if (size < 7) {
+            return false;
+        }
+
+        m_profile = pData[1];
+        m_nalLengthSize = (pData[4] & 3) + 1;
+        m_bitDepth = 8;
+        m_chromaSubsampling = VK_VIDEO_CHROMA_SUBSAMPLING_420_BIT_KHR;
+        m_parameterSets.clear();
+
+        const uint8_t* p = pData + 5;
+        const uint8_t* pEnd = pData + size;
+        for (uint32_t list = 0; list < 2; list++) {
+            if (p >= pEnd) {
+                return false;
+            }
+            const uint32_t numParameterSets = (list == 0) ? (*p++ & 0x1f) : *p++;
+            for (uint32_t i = 0; i < numParameterSets; i++) {
+                if ((pEnd - p) < 2) {
+                    return false;
+                }
+                const uint32_t nalSize = ReadBe16(p);
+                p += 2;
+                if (nalSize > (size_t)(pEnd - p)) {
+                    return false;
+                }
+                if (!AppendParameterSet(p, nalSize)) {
+                    return false;
+                }
+                p += nalSize;
+            }
+        }
+
+        // The high profiles carry the chroma format and bit depths in an extension.
+        if (((m_profile == 100) || (m_profile == 110) || (m_profile == 122) || (m_profile == 244)) &&
+            ((pEnd - p) >= 3)) {
+            static const VkVideoChromaSubsamplingFlagsKHR chromaFormats[4] = {
+                VK_VIDEO_CHROMA_SUBSAMPLING_MONOCHROME_BIT_KHR, VK_VIDEO_CHROMA_SUBSAMPLING_420_BIT_KHR,
+                VK_VIDEO_CHROMA_SUBSAMPLING_422_BIT_KHR, VK_VIDEO_CHROMA_SUBSAMPLING_444_BIT_KHR };
+            m_chromaSubsampling = chromaFormats[p[0] & 3];
+            m_bitDepth = (p[1] & 7) + 8;
+        }
+        return true;
+    }
+
+    // HEVCDecoderConfigurationRecord (ISO/IEC 14496-15 8.3.3.1)
+    bool ParseHevcConfig(const uint8_t* pData, size_t size)
+    {
+        if (size < 23) {
+            return false;
+        }
+
+        static const VkVideoChromaSubsamplingFlagsKHR chromaFormats[4] = {
+            VK_VIDEO_CHROMA_SUBSAMPLING_MONOCHROME_BIT_KHR, VK_VIDEO_CHROMA_SUBSAMPLING_420_BIT_KHR,
+            VK_VIDEO_CHROMA_SUBSAMPLING_422_BIT_KHR, VK_VIDEO_CHROMA_SUBSAMPLING_444_BIT_KHR };
+        m_profile = pData[1] & 0x1f;
+        m_chromaSubsampling = chromaFormats[pData[16] & 3];
+        m_bitDepth = (pData[17] & 7) + 8;
+        m_nalLengthSize = (pData[21] & 3) + 1;
+        m_parameterSets.clear();
+
+        const uint32_t numOfArrays = pData[22];
+        const uint8_t* p = pData + 23;
+        const uint8_t* pEnd = pData + size;
+        for (uint32_t array = 0; array < numOfArrays; array++) {
+            if ((pEnd - p) < 3) {
+                return false;
+            }
+            const uint32_t numNalus = ReadBe16(p + 1);
+            p += 3;
+            for (uint32_t i = 0; i < numNalus; i++) {
+                if ((pEnd - p) < 2) {
+                    return false;
+                }
+                const uint32_t nalSize = ReadBe16(p);
+                p += 2;
+                if (nalSize > (size_t)(pEnd - p)) {
+                    return false;
+                }
+                if (!AppendParameterSet(p, nalSize)) {
+                    return false;
+                }
+                p += nalSize;
+            }
+        }
+        return true;
+    }
+
+    // AV1CodecConfigurationRecord: the samples carry their own sequence header OBUs.
+    bool ParseAv1Config(const uint8_t* pData, size_t size)
+    {
+        if ((size < 4) || ((pData[0] & 0x80) == 0)) { // marker
+            return false;
+        }
+
+        m_profile = pData[1] >> 5;
+        const bool highBitdepth = (pData[2] >> 6) & 1;
+        const bool twelveBit = (pData[2] >> 5) & 1;
+        const bool monochrome = (pData[2] >> 4) & 1;
+        const bool subsamplingX = (pData[2] >> 3) & 1;
+        const bool subsamplingY = (pData[2] >> 2) & 1;
+        m_bitDepth = twelveBit ? 12 : (highBitdepth ? 10 : 8);
+        if (monochrome) {
+            m_chromaSubsampling = VK_VIDEO_CHROMA_SUBSAMPLING_MONOCHROME_BIT_KHR;
+        } else if (subsamplingX && subsamplingY) {
+            m_chromaSubsampling = VK_VIDEO_CHROMA_SUBSAMPLING_420_BIT_KHR;
+        } else if (subsamplingX) {
+            m_chromaSubsampling = VK_VIDEO_CHROMA_SUBSAMPLING_422_BIT_KHR;
+        } else {
+            m_chromaSubsampling = VK_VIDEO_CHROMA_SUBSAMPLING_444_BIT_KHR;
+        }
+        m_nalLengthSize = 0;
+        return true;
+    }
+
+    // Stores a parameter set with the same length prefix as the NAL units of the samples.
+    bool AppendParameterSet(const uint8_t* pNal, size_t nalSize)
+    {
+        if ((m_nalLengthSize < 4) && (nalSize >= (1u << (8 * m_nalLengthSize)))) {
+            std::cerr << "MP4: parameter set too large for " << m_nalLengthSize << "-byte NAL unit lengths" << std::endl;
+            return false;
+        }
+        for (uint32_t i = m_nalLengthSize; i > 0; i--) {
+            m_parameterSets.push_back((uint8_t)(nalSize >> (8 * (i - 1))));
+        }
+        m_parameterSets.insert(m_parameterSets.end(), pNal, pNal + nalSize);
+        return true;
+    }
+
+    // Flattens stsz/stz2, stco/co64, stsc, stts, ctts and stss into one entry per sample.
+    bool BuildSampleTable(const Mp4Box& stbl)
+    {
+        Mp4Box stsz, stco, stsc, stts, ctts, stss;
+        const bool hasStsz = Mp4FindBox(stbl.pData, stbl.size, MP4_FOURCC('s', 't', 's', 'z'), stsz);
+        const bool hasStz2 = !hasStsz && Mp4FindBox(stbl.pData, stbl.size, MP4_FOURCC('s', 't', 'z', '2'), stsz);
+        const bool hasStco = Mp4FindBox(stbl.pData, stbl.size, MP4_FOURCC('s', 't', 'c', 'o'), stco);
+        const bool hasCo64 = !hasStco && Mp4FindBox(stbl.pData, stbl.size, MP4_FOURCC('c', 'o', '6', '4'), stco);
+        if ((!hasStsz && !hasStz2) || (!hasStco && !hasCo64) ||
+            !Mp4FindBox(stbl.pData, stbl.size, MP4_FOURCC('s', 't', 's', 'c'), stsc) ||
+            !Mp4FindBox(stbl.pData, stbl.size, MP4_FOURCC('s', 't', 't', 's'), stts) ||
+            (stsz.size < 12) || (stco.size < 8) || (stsc.size < 8) || (stts.size < 8)) {
+            return false;
+        }
+
+        // Sample sizes
+        const uint32_t sampleCount = ReadBe32(stsz.pData + 8);
+        uint32_t fieldSize = 32;
+        uint32_t constantSize = 0;
+        if (hasStsz) {
+            constantSize = ReadBe32(stsz.pData + 4);
+        } else {
+            fieldSize = stsz.pData[7];
+        }
+        if ((constantSize == 0) &&
+            (((fieldSize != 4) && (fieldSize != 8) && (fieldSize != 16) && (fieldSize != 32)) ||
+             (((uint64_t)sampleCount * fieldSize + 7) / 8 > (stsz.size - 12)))) {
+            return false;
+        }
+        m_samples.resize(sampleCount);
+        const uint8_t* pSizes = stsz.pData + 12;
+        for (uint32_t i = 0; i < sampleCount; i++) {
+            Sample& sample = m_samples[i];
+            switch (constantSize ? 0 : fieldSize) {
+            case 0:  sample.size = constantSize; break;
+            case 4:  sample.size = (pSizes[i / 2] >> ((i & 1) ? 0 : 4)) & 0xf; break;
+            case 8:  sample.size = pSizes[i]; break;
+            case 16: sample.size = ReadBe16(pSizes + 2 * i); break;
+            default: sample.size = ReadBe32(pSizes + 4 * i); break;
+            }
+            sample.isSync = 0;
+            sample.dts = 0;
+            sample.pts = 0;
+        }
+
+        // Sample offsets: chunks are laid out by stsc runs.
+        const uint32_t chunkCount = ReadBe32(stco.pData + 4);
+        const uint32_t offsetSize = hasCo64 ? 8 : 4;
+        const uint32_t stscCount = ReadBe32(stsc.pData + 4);
+        if (((uint64_t)chunkCount * offsetSize > (stco.size - 8)) || ((uint64_t)stscCount * 12 > (stsc.size - 8))) {
+            return false;
+        }
+        uint32_t sampleIndex = 0;
+        for (uint32_t entry = 0; (entry < stscCount) && (sampleIndex < sampleCount); entry++) {
+            const uint8_t* pEntry = stsc.pData + 8 + 12 * entry;
+            const uint32_t firstChunk = ReadBe32(pEntry);
+            const uint32_t samplesPerChunk = ReadBe32(pEntry + 4);
+            const uint32_t lastChunk = ((entry + 1) < stscCount) ? ReadBe32(pEntry + 12) : (chunkCount + 1);
+            if ((firstChunk == 0) || (lastChunk > (chunkCount + 1))) {
+                return false;
+            }
+            for (uint32_t chunk = firstChunk; (chunk < lastChunk) && (sampleIndex < sampleCount); chunk++) {
+                const uint8_t* pOffset = stco.pData + 8 + (size_t)offsetSize * (chunk - 1);
+                uint64_t offset = hasCo64 ? ReadBe64(pOffset) : ReadBe32(pOffset);
+                for (uint32_t i = 0; (i < samplesPerChunk) && (sampleIndex < sampleCount); i++) {
+                    Sample& sample = m_samples[sampleIndex++];
+                    if ((offset + sample.size) > m_fileSize) {
+                        return false;
+                    }
+                    sample.offset = (int64_t)offset;
+                    offset += sample.size;
+                }
+            }
+        }
+        if (sampleIndex != sampleCount) {
+            return false;
+        }
+
+        // Decode and presentation times
+        const uint32_t sttsCount = ReadBe32(stts.pData + 4);
+        if ((uint64_t)sttsCount * 8 > (stts.size - 8)) {
+            return false;
+        }
+        int64_t dts = 0;
+        sampleIndex = 0;
+        for (uint32_t entry = 0; entry < sttsCount; entry++) {
+            const uint32_t count = ReadBe32(stts.pData + 8 + 8 * entry);
+            const uint32_t delta = ReadBe32(stts.pData + 12 + 8 * entry);
+            for (uint32_t i = 0; (i < count) && (sampleIndex < sampleCount); i++) {
+                m_samples[sampleIndex].dts = dts;
+                m_samples[sampleIndex].pts = dts;
+                sampleIndex++;
+                dts += delta;
+            }
+        }
+        for (; sampleIndex < sampleCount; sampleIndex++) {
+            m_samples[sampleIndex].dts = m_samples[sampleIndex].pts = dts;
+        }
+
+        if (Mp4FindBox(stbl.pData, stbl.size, MP4_FOURCC('c', 't', 't', 's'), ctts) && (ctts.size >= 8)) {
+            const bool signedOffsets = (ctts.pData[0] == 1);
+            const uint32_t cttsCount = ReadBe32(ctts.pData + 4);
+            sampleIndex = 0;
+            for (uint32_t entry = 0; (entry < cttsCount) && ((8 + 8 * (uint64_t)entry + 8) <= ctts.size); entry++) {
+                const uint32_t count = ReadBe32(ctts.pData + 8 + 8 * entry);
+                const uint32_t offset = ReadBe32(ctts.pData + 12 + 8 * entry);
+                const int64_t compositionOffset = signedOffsets ? (int64_t)(int32_t)offset : (int64_t)offset;
+                for (uint32_t i = 0; (i < count) && (sampleIndex < sampleCount); i++) {
+                    m_samples[sampleIndex].pts = m_samples[sampleIndex].dts + compositionOffset;
+                    sampleIndex++;
+                }
+            }
+        }
+
+        // Sync samples: every sample is a sync sample if stss is absent.
+        m_syncSamples.clear();
+        if (Mp4FindBox(stbl.pData, stbl.size, MP4_FOURCC('s', 't', 's', 's'), stss) && (stss.size >= 8)) {
+            const uint32_t stssCount = ReadBe32(stss.pData + 4);
+            for (uint32_t entry = 0; (entry < stssCount) && ((8 + 4 * (uint64_t)entry + 4) <= stss.size); entry++) {
+                const uint32_t sampleNumber = ReadBe32(stss.pData + 8 + 4 * entry);
+                if ((sampleNumber > 0) && (sampleNumber <= sampleCount)) {
+                    m_samples[sampleNumber - 1].isSync = 1;
+                    m_syncSamples.push_back(sampleNumber - 1);
+                }
+            }
+            std::sort(m_syncSamples.begin(), m_syncSamples.end());
+        } else {
+            for (uint32_t i = 0; i < sampleCount; i++) {
+                m_samples[i].isSync = 1;
+                m_syncSamples.push_back(i);
+            }
+        }
+
+        return true;
+    }
+
+    int32_t    m_width, m_height, m_bitDepth;
+    uint32_t   m_profile;
+    VkVideoChromaSubsamplingFlagsKHR m_chromaSubsampling;
+    VkVideoCodecOperationFlagBitsKHR m_videoCodecType;
+    uint32_t   m_timescale;
+    uint64_t   m_duration;
+#ifndef USE_SIMPLE_MALLOC
+    mio::basic_mmap<mio::access_mode::read, uint8_t> m_inputVideoStreamMmap;
+#endif
+    const uint8_t*        m_pFileData;
+    VkDeviceSize          m_fileSize;
+    std::vector<Sample>   m_samples;
+    std::vector<uint32_t> m_syncSamples;
+    std::vector<uint8_t>  m_parameterSets;  // Parameter sets of the decoder configuration record, length-prefixed
+    uint32_t              m_nalLengthSize;  // avcC/hvcC lengthSizeMinusOne + 1, 0 for AV1
+    size_t                m_nextSample;
+    int64_t               m_frameTimestamp;
+    std::vector<uint8_t>  m_packetBuffer;   // Parameter sets followed by the sample, reused
+    bool                  m_sendParameterSets;
+};
+
+bool Mp4DemuxerCheckFile(const char *pFilePath)
+{
+    uint8_t header[8] = {};
+    FILE* handle = fopen(pFilePath, "rb");
+    if (handle == nullptr) {
+        return false;
+    }
+    const bool isMp4 = (fread(header, sizeof(header), 1, handle) == 1) &&
+                       ((memcmp(header + 4, "ftyp", 4) == 0) || (memcmp(header + 4, "moov", 4) == 0));
+    fclose(handle);
+    return isMp4;
+}
+
+VkResult Mp4DemuxerCreate(const char *pFilePath,
+                          VkVideoCodecOperationFlagBitsKHR codecType,
+                          int32_t defaultWidth,
+                          int32_t defaultHeight,
+                          int32_t defaultBitDepth,
+                          VkSharedBaseObj<VideoStreamDemuxer>& videoStreamDemuxer)
+{
+    VkSharedBaseObj<Mp4Demuxer> mp4Demuxer;
+    VkResult result = Mp4Demuxer::Create(pFilePath,
+                                         codecType,
+                                         defaultWidth,
+                                         defaultHeight,
+                                         defaultBitDepth,
+                                         mp4Demuxer);
+    if (result == VK_SUCCESS) {
+        videoStreamDemuxer = mp4Demuxer;
+    }
+
+    return result;
+}
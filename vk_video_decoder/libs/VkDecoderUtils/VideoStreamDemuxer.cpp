@@ -41,6 +41,39 @@ VkResult VideoStreamDemuxer::Create(const char *pFilePath,
 {
     VideoStreamDemuxer::CheckFile(pFilePath);
 
+    // IVF (AV1/VP9) is demuxed natively, with the codec taken from the IVF fourcc.
+    if (requiresStreamDemuxing && IvfDemuxerCheckFile(pFilePath)) {
+        return IvfDemuxerCreate(pFilePath,
+                                codecType,
+                                defaultWidth,
+                                defaultHeight,
+                                defaultBitDepth,
+                                videoStreamDemuxer);
+    }
+
+    // MP4 (H.264/H.265/AV1) is demuxed natively; such a file can never be parsed as an elementary stream.
+    if (Mp4DemuxerCheckFile(pFilePath)) {
+        VkResult result = Mp4DemuxerCreate(pFilePath,
+                                           codecType,
+                                           defaultWidth,
+                                           defaultHeight,
+                                           defaultBitDepth,
+                                           videoStreamDemuxer);
+#ifdef FFMPEG_DEMUXER_SUPPORT
+        // Fragmented MP4, .mov files and the sample entries the native demuxer does not support are left to FFmpeg
+        if (result != VK_SUCCESS) {
+            result = FFmpegDemuxerCreate(pFilePath,
+                                         codecType,
+                                         true, // requiresStreamDemuxing
+                                         defaultWidth,
+                                         defaultHeight,
+                                         defaultBitDepth,
+                                         videoStreamDemuxer);
+        }
+#endif // FFMPEG_DEMUXER_SUPPORT
+        return result;
+    }
+
 #ifdef FFMPEG_DEMUXER_SUPPORT
     if (requiresStreamDemuxing || (codecType == VK_VIDEO_CODEC_OPERATION_NONE_KHR)) {
         return FFmpegDemuxerCreate(pFilePath,
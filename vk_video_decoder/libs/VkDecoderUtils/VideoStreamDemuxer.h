@@ -70,6 +70,16 @@ public:
     virtual int64_t ReadBitstreamData(const uint8_t **ppVideo, int64_t offset) = 0;
     virtual void Rewind() = 0;
 
+    // Optionally splits the stream into access units ahead of parsing, using numThreads workers.
+    // On success, HasFramePreparser() becomes true and DemuxFrame() returns one complete
+    // access unit per call. The resulting index is loaded from or saved to pIndexFileName, if set.
+    virtual bool PreparseAccessUnits(uint32_t numThreads, const char* pIndexFileName) { return false; }
+    virtual bool DemuxesAccessUnits() const { return false; }
+    // Presentation timestamp of the last frame returned by DemuxFrame(), 0 if unknown.
+    virtual int64_t GetFrameTimestamp() const { return 0; }
+    // Size of the length prefix of the H.264/H.265 NAL units returned by DemuxFrame(), 0 for Annex-B.
+    virtual uint32_t GetNalLengthSize() const { return 0; }
+
     virtual void DumpStreamParameters() const = 0;
 
 
@@ -90,6 +100,24 @@ VkResult ElementaryStreamCreate(const char *pFilePath,
                                 int32_t defaultBitDepth,
                                 VkSharedBaseObj<VideoStreamDemuxer>& videoStreamDemuxer);
 
+bool IvfDemuxerCheckFile(const char *pFilePath);
+
+VkResult IvfDemuxerCreate(const char *pFilePath,
+                          VkVideoCodecOperationFlagBitsKHR codecType,
+                          int32_t defaultWidth,
+                          int32_t defaultHeight,
+                          int32_t defaultBitDepth,
+                          VkSharedBaseObj<VideoStreamDemuxer>& videoStreamDemuxer);
+
+bool Mp4DemuxerCheckFile(const char *pFilePath);
+
+VkResult Mp4DemuxerCreate(const char *pFilePath,
+                          VkVideoCodecOperationFlagBitsKHR codecType,
+                          int32_t defaultWidth,
+                          int32_t defaultHeight,
+                          int32_t defaultBitDepth,
+                          VkSharedBaseObj<VideoStreamDemuxer>& videoStreamDemuxer);
+
 #ifdef FFMPEG_DEMUXER_SUPPORT
 VkResult FFmpegDemuxerCreate(const char *pFilePath,
                              VkVideoCodecOperationFlagBitsKHR codecType,
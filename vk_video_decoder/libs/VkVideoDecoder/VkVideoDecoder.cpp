@@ -558,41 +558,35 @@ int32_t VkVideoDecoder::StartVideoSequence(VkParserDetectedVideoFormat* pVideoFo
     // There will be no more than VulkanVideoFrameBuffer::maxImages frames in the queue.
     m_decodeFramesData.resize(std::max<uint32_t>(maxDecodeFramesCount, VulkanVideoFrameBuffer::maxImages));
 
-    int32_t availableBuffers = (int32_t)m_decodeFramesData.GetBitstreamBuffersQueue().
-                                                      GetAvailableNodesNumber();
-    if (availableBuffers < m_numBitstreamBuffersToPreallocate) {
-
-        uint32_t allocateNumBuffers = std::min<uint32_t>(
-                m_decodeFramesData.GetBitstreamBuffersQueue().GetMaxNodes(),
-                (m_numBitstreamBuffersToPreallocate - availableBuffers));
-
-        allocateNumBuffers = std::min<uint32_t>(allocateNumBuffers,
-                m_decodeFramesData.GetBitstreamBuffersQueue().GetFreeNodesNumber());
-
-        for (uint32_t i = 0; i < allocateNumBuffers; i++) {
-
-            VkSharedBaseObj<VulkanBitstreamBufferImpl> bitstreamBuffer;
-            VkDeviceSize allocSize = std::max<VkDeviceSize>(m_maxStreamBufferSize, 2 * 1024 * 1024);
-
-            result = VulkanBitstreamBufferImpl::Create(m_vkDevCtx,
-                    m_vkDevCtx->GetVideoDecodeQueueFamilyIdx(),
-                    VK_BUFFER_USAGE_VIDEO_DECODE_SRC_BIT_KHR,
-                    allocSize,
-                    videoCapabilities.minBitstreamBufferOffsetAlignment,
-                    videoCapabilities.minBitstreamBufferSizeAlignment,
-                    nullptr, 0, bitstreamBuffer);
-            assert(result == VK_SUCCESS);
-            if (result != VK_SUCCESS) {
-                fprintf(stderr, "\nERROR: VulkanBitstreamBufferImpl::Create() result: 0x%x\n", result);
-                break;
-            }
+    if (m_numBitstreamBuffersToPreallocate > 0) {
+        const VkDeviceSize allocSize = std::max<VkDeviceSize>(m_maxStreamBufferSize, 2 * 1024 * 1024);
+        result = m_decodeFramesData.GetBitstreamBuffersQueue().Reserve(allocSize, (uint32_t)m_numBitstreamBuffersToPreallocate,
+                [&](VkDeviceSize bufferSize, VkSharedBaseObj<VulkanBitstreamBufferImpl>& bitstreamBuffer) {
+                    return VulkanBitstreamBufferImpl::Create(m_vkDevCtx,
+                            m_vkDevCtx->GetVideoDecodeQueueFamilyIdx(),
+                            VK_BUFFER_USAGE_VIDEO_DECODE_SRC_BIT_KHR,
+                            bufferSize,
+                            videoCapabilities.minBitstreamBufferOffsetAlignment,
+                            videoCapabilities.minBitstreamBufferSizeAlignment,
+                            nullptr, 0, bitstreamBuffer);
+                });
+        assert(result == VK_SUCCESS);
+        if (result != VK_SUCCESS) {
+            fprintf(stderr, "\nERROR: VulkanBitstreamBufferImpl::Create() result: 0x%x\n", result);
+        }
+    }
 
-            int32_t nodeAddedWithIndex = m_decodeFramesData.GetBitstreamBuffersQueue().
-                                                 AddNodeToPool(bitstreamBuffer, false);
-            if (nodeAddedWithIndex < 0) {
-                assert("Could not add the new node to the pool");
-                break;
-            }
+    if ((m_bitstreamBufferRingSize > 0) && !m_bitstreamBufferRing) {
+        result = VulkanBitstreamBufferRing::Create(m_vkDevCtx,
+                                                   m_vkDevCtx->GetVideoDecodeQueueFamilyIdx(),
+                                                   VK_BUFFER_USAGE_VIDEO_DECODE_SRC_BIT_KHR,
+                                                   m_bitstreamBufferRingSize,
+                                                   videoCapabilities.minBitstreamBufferOffsetAlignment,
+                                                   videoCapabilities.minBitstreamBufferSizeAlignment,
+                                                   m_bitstreamBufferRing);
+        assert(result == VK_SUCCESS);
+        if (result != VK_SUCCESS) {
+            fprintf(stderr, "\nERROR: VulkanBitstreamBufferRing::Create() result: 0x%x\n", result);
         }
     }
 
@@ -728,7 +722,8 @@ int VkVideoDecoder::DecodePictureWithParameters(VkParserPerFrameDecodeParameters
     //assert(pCurrFrameDecParams->bitstreamDataOffset == 0);
     assert(pCurrFrameDecParams->firstSliceIndex == 0);
     // TODO: Assert if bitstreamDataOffset is aligned to VkVideoCapabilitiesKHR::minBitstreamBufferOffsetAlignment
-    pCurrFrameDecParams->decodeFrameInfo.srcBufferOffset = pCurrFrameDecParams->bitstreamDataOffset;
+    pCurrFrameDecParams->decodeFrameInfo.srcBufferOffset = pCurrFrameDecParams->bitstreamData->GetBufferOffset() +
+                                                           pCurrFrameDecParams->bitstreamDataOffset;
     // TODO: Assert if bitstreamDataLen is aligned to VkVideoCapabilitiesKHR::minBitstreamBufferSizeAlignment
     pCurrFrameDecParams->decodeFrameInfo.srcBufferRange =  pCurrFrameDecParams->bitstreamDataLen;
 
@@ -1435,45 +1430,45 @@ VkDeviceSize VkVideoDecoder::GetBitstreamBuffer(VkDeviceSize size,
                                                 VkSharedBaseObj<VulkanBitstreamBuffer>& bitstreamBuffer)
 {
     assert(initializeBufferMemorySize <= size);
-    // size_t newSize = 4 * 1024 * 1024;
-    VkDeviceSize newSize = size;
     assert(m_vkDevCtx);
 
-    VkSharedBaseObj<VulkanBitstreamBufferImpl> newBitstreamBuffer;
+    // With the bitstream ring, each picture gets a range of the ring. The pool below takes over while
+    // the ring is full, or for a picture that doesn't fit in it.
+    if (m_bitstreamBufferRing &&
+            (m_bitstreamBufferRing->GetRange(size, pInitializeBufferMemory, initializeBufferMemorySize,
+                                             bitstreamBuffer) == VK_SUCCESS)) {
+        return bitstreamBuffer->GetMaxSize();
+    }
 
-    const bool enablePool = true;
+    // The buffer comes from the power-of-two size class that holds size: when the parser grows its buffer,
+    // an idle larger buffer is reused instead of allocating new device memory.
+    VkSharedBaseObj<VulkanBitstreamBufferImpl> newBitstreamBuffer;
     const bool debugBitstreamBufferDumpAlloc = false;
-    int32_t availablePoolNode = -1;
-    if (enablePool) {
-        availablePoolNode = m_decodeFramesData.GetBitstreamBuffersQueue().GetAvailableNodeFromPool(newBitstreamBuffer);
-    }
-    if (!(availablePoolNode >= 0)) {
-        VkResult result = VulkanBitstreamBufferImpl::Create(m_vkDevCtx,
-                m_vkDevCtx->GetVideoDecodeQueueFamilyIdx(),
-                VK_BUFFER_USAGE_VIDEO_DECODE_SRC_BIT_KHR,
-                newSize, minBitstreamBufferOffsetAlignment,
-                minBitstreamBufferSizeAlignment,
-                pInitializeBufferMemory, initializeBufferMemorySize, newBitstreamBuffer);
-        assert(result == VK_SUCCESS);
-        if (result != VK_SUCCESS) {
-            fprintf(stderr, "\nERROR: VulkanBitstreamBufferImpl::Create() result: 0x%x\n", result);
-            return 0;
-        }
+    bool allocated = false;
+    VkResult result = m_decodeFramesData.GetBitstreamBuffersQueue().GetBuffer(size, newBitstreamBuffer,
+            [&](VkDeviceSize bufferSize, VkSharedBaseObj<VulkanBitstreamBufferImpl>& bitstreamBuffer) {
+                allocated = true;
+                return VulkanBitstreamBufferImpl::Create(m_vkDevCtx,
+                        m_vkDevCtx->GetVideoDecodeQueueFamilyIdx(),
+                        VK_BUFFER_USAGE_VIDEO_DECODE_SRC_BIT_KHR,
+                        bufferSize, minBitstreamBufferOffsetAlignment,
+                        minBitstreamBufferSizeAlignment,
+                        pInitializeBufferMemory, initializeBufferMemorySize, bitstreamBuffer);
+            });
+    assert(result == VK_SUCCESS);
+    if (result != VK_SUCCESS) {
+        fprintf(stderr, "\nERROR: VulkanBitstreamBufferImpl::Create() result: 0x%x\n", result);
+        return 0;
+    }
+
+    const VkDeviceSize newSize = newBitstreamBuffer->GetMaxSize();
+    if (allocated) {
         if (debugBitstreamBufferDumpAlloc) {
             std::cout << "\tAllocated bitstream buffer with size " << newSize << " B, " <<
                              newSize/1024 << " KB, " << newSize/1024/1024 << " MB" << std::endl;
         }
-        if (enablePool) {
-            int32_t nodeAddedWithIndex = m_decodeFramesData.GetBitstreamBuffersQueue().AddNodeToPool(newBitstreamBuffer, true);
-            if (nodeAddedWithIndex < 0) {
-                assert("Could not add the new node to the pool");
-            }
-        }
-
     } else {
 
-        assert(newBitstreamBuffer);
-        newSize = newBitstreamBuffer->GetMaxSize();
         assert(initializeBufferMemorySize <= newSize);
 
         VkDeviceSize copySize = std::min<VkDeviceSize>(initializeBufferMemorySize, newSize);
@@ -1489,9 +1484,7 @@ VkDeviceSize VkVideoDecoder::GetBitstreamBuffer(VkDeviceSize size,
             std::cout << "\t\tFrom bitstream buffer pool with size " << newSize << " B, " <<
                              newSize/1024 << " KB, " << newSize/1024/1024 << " MB" << std::endl;
 
-            std::cout << "\t\t\t FreeNodes " << m_decodeFramesData.GetBitstreamBuffersQueue().GetFreeNodesNumber();
-            std::cout << " of MaxNodes " << m_decodeFramesData.GetBitstreamBuffersQueue().GetMaxNodes();
-            std::cout << ", AvailableNodes " << m_decodeFramesData.GetBitstreamBuffersQueue().GetAvailableNodesNumber();
+            std::cout << "\t\t\t IdleBuffers " << m_decodeFramesData.GetBitstreamBuffersQueue().GetNumIdleBuffers();
             std::cout << std::endl;
         }
     }
@@ -1514,6 +1507,7 @@ VkResult VkVideoDecoder::Create(const VulkanDeviceContext* vkDevCtx,
                                 int32_t numDecodeImagesInFlight,
                                 int32_t,
                                 int32_t numBitstreamBuffersToPreallocate,
+                                VkDeviceSize bitstreamBufferRingSize,
                                 VkSharedBaseObj<VkVideoDecoder>& vkVideoDecoder)
 {
     VkSharedBaseObj<VkVideoDecoder> vkDecoder(new VkVideoDecoder(vkDevCtx,
@@ -1522,7 +1516,8 @@ VkResult VkVideoDecoder::Create(const VulkanDeviceContext* vkDevCtx,
                                                                  enableDecoderFeatures,
                                                                  filterType,
                                                                  numDecodeImagesInFlight,
-                                                                 numBitstreamBuffersToPreallocate));
+                                                                 numBitstreamBuffersToPreallocate,
+                                                                 bitstreamBufferRingSize));
     if (vkDecoder) {
         vkVideoDecoder = vkDecoder;
         return VK_SUCCESS;
@@ -1550,8 +1545,26 @@ void VkVideoDecoder::Deinitialize()
         m_hwLoadBalancingTimelineSemaphore = VK_NULL_HANDLE;
     }
 
+    if (m_dumpDecodeData) {
+        for (uint32_t sizeClass = 0; sizeClass < NvVkDecodeFrameData::VulkanBitstreamBufferPool::NUM_SIZE_CLASSES; sizeClass++) {
+            const NvVkDecodeFrameData::VulkanBitstreamBufferPool::SizeClassStats stats =
+                    m_decodeFramesData.GetBitstreamBuffersQueue().GetStats(sizeClass);
+            if ((stats.allocations + stats.reuses) == 0) {
+                continue;
+            }
+            std::cout << "Bitstream buffer pool " << (NvVkDecodeFrameData::VulkanBitstreamBufferPool::GetSizeClassSize(sizeClass) / 1024)
+                      << " KB: allocations " << stats.allocations << ", reuses " << stats.reuses
+                      << ", releases " << stats.releases << ", buffers " << stats.numBuffers << std::endl;
+        }
+        if (m_bitstreamBufferRing) {
+            std::cout << "Bitstream buffer ring " << (m_bitstreamBufferRing->GetCapacity() / 1024)
+                      << " KB: high-water mark " << (m_bitstreamBufferRing->GetHighWaterMark() / 1024) << " KB" << std::endl;
+        }
+    }
+
     m_videoFrameBuffer = nullptr;
     m_decodeFramesData.deinit();
+    m_bitstreamBufferRing = nullptr;
     m_videoSession = nullptr;
     m_yuvFilter = nullptr;
     m_vkDevCtx = nullptr;
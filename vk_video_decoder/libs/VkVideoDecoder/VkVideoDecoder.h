@@ -27,11 +27,12 @@
 #include <vector>
 
 #include "vulkan_interfaces.h"
-#include "VkCodecUtils/VulkanVideoReferenceCountedPool.h"
+#include "VkCodecUtils/VulkanSizeClassedBufferPool.h"
 #include "VkCodecUtils/VulkanDeviceContext.h"
 #include "VkCodecUtils/Helpers.h"
 #include "VkCodecUtils/VulkanFilterYuvCompute.h"
 #include "VkCodecUtils/VulkanBistreamBufferImpl.h"
+#include "VkCodecUtils/VulkanBitstreamBufferRing.h"
 #include "VkVideoCore/VkVideoCoreProfile.h"
 #include "VkCodecUtils/VulkanVideoSession.h"
 #include "VulkanVideoFrameBuffer/VulkanVideoFrameBuffer.h"
@@ -58,9 +59,9 @@ struct NvVkDecodeFrameDataSlot {
 
 class NvVkDecodeFrameData {
 
-    using VulkanBitstreamBufferPool = VulkanVideoRefCountedPool<VulkanBitstreamBufferImpl, 64>;
-
 public:
+    using VulkanBitstreamBufferPool = VulkanSizeClassedBufferPool<VulkanBitstreamBufferImpl>;
+
     NvVkDecodeFrameData(const VulkanDeviceContext* vkDevCtx)
        : m_vkDevCtx(vkDevCtx),
          m_videoCommandPool(),
@@ -160,6 +161,7 @@ public:
                            int32_t numDecodeImagesInFlight = 8,
                            int32_t numDecodeImagesToPreallocate = -1, // preallocate the maximum required
                            int32_t numBitstreamBuffersToPreallocate = 8,
+                           VkDeviceSize bitstreamBufferRingSize = 0, // 0 disables the bitstream ring
                            VkSharedBaseObj<VkVideoDecoder>& vkVideoDecoder = invalidVkDecoder);
 
     static const char* GetVideoCodecString(VkVideoCodecOperationFlagBitsKHR codec);
@@ -205,7 +207,8 @@ private:
                    VulkanFilterYuvCompute::FilterType filterType = VulkanFilterYuvCompute::YCBCRCOPY,
                    int32_t  numDecodeImagesInFlight = 8,
                    int32_t  numDecodeImagesToPreallocate = -1, // preallocate the maximum required
-                   int32_t  numBitstreamBuffersToPreallocate = 8)
+                   int32_t  numBitstreamBuffersToPreallocate = 8,
+                   VkDeviceSize bitstreamBufferRingSize = 0)
         : m_vkDevCtx(vkDevCtx)
         , m_currentVideoQueueIndx(videoQueueIndx)
         , m_refCount(0)
@@ -236,6 +239,8 @@ private:
         , m_imageSpecsIndex()
         , m_numBitstreamBuffersToPreallocate(numBitstreamBuffersToPreallocate)
         , m_maxStreamBufferSize(2097152) // 2MB max bitstream by default
+        , m_bitstreamBufferRingSize(bitstreamBufferRingSize)
+        , m_bitstreamBufferRing()
         , m_filterType(filterType)
     {
 
@@ -338,6 +343,8 @@ private:
     DecodeFrameBufferIf::ImageSpecsIndex m_imageSpecsIndex;
     int32_t  m_numBitstreamBuffersToPreallocate;
     VkDeviceSize   m_maxStreamBufferSize;
+    VkDeviceSize   m_bitstreamBufferRingSize;
+    VkSharedBaseObj<VulkanBitstreamBufferRing> m_bitstreamBufferRing;
     VulkanFilterYuvCompute::FilterType m_filterType;
     VkSharedBaseObj<VulkanFilter> m_yuvFilter;
 };
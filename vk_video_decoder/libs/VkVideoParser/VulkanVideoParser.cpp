@@ -160,13 +160,7 @@ struct nvVideoDecodeAV1DpbSlotInfo
 };
 
 struct nvVideoAV1PicParameters {
-    // Maximum number of tiles specified by any defined level
-    uint32_t tileOffsets[256];
-    uint32_t tileSizes[256];
-    uint16_t MiColStarts[64];
-    uint16_t MiRowStarts[64];
-    uint16_t width_in_sbs_minus_1[64];
-    uint16_t height_in_sbs_minus_1[64];
+    // The tile table and the tile info arrays are referenced from VkParserAv1PictureData
     StdVideoDecodeAV1PictureInfo stdPictureInfo; // memory for the pointer in pictureInfo
     VkVideoDecodeAV1PictureInfoKHR pictureInfo;
     VkVideoDecodeAV1SessionParametersCreateInfoKHR pictureParameters;
@@ -615,6 +609,8 @@ public:
     virtual VkResult ParseVideoData(VkParserSourceDataPacket* pPacket,
                                     size_t* pParsedBytes,
                                     bool doPartialParsing = false);
+    virtual VkResult GetParserStatistics(VkParserStatistics* pStats) const;
+    virtual VkResult Reset(uint32_t nalLengthSize = 0, const VkParserDecodeSkipPolicy* pDecodeSkipPolicy = nullptr);
 
     // Interface to allow decoder to communicate with the client implementing
     // INvVideoDecoderClient
@@ -667,7 +663,9 @@ protected:
         uint32_t bufferOffsetAlignment,
         uint32_t bufferSizeAlignment,
         bool outOfBandPictureParameters,
-        uint32_t errorThreshold);
+        uint32_t errorThreshold,
+        uint32_t nalLengthSize,
+        const VkParserDecodeSkipPolicy* pDecodeSkipPolicy);
 
     VulkanVideoParser(VkVideoCodecOperationFlagBitsKHR codecType,
         uint32_t maxNumDecodeSurfaces, uint32_t maxNumDpbSurfaces,
@@ -753,6 +751,7 @@ protected:
     uint32_t m_outOfBandPictureParameters : 1;
     uint32_t m_inlinedPictureParametersUseBeginCoding : 1;
     int8_t m_pictureToDpbSlotMap[MAX_FRM_CNT];
+    VkParserInitDecodeParameters m_initDecodeParameters; // Of the current stream, for Reset()
 
 public:
     static bool m_dumpParserData;
@@ -777,6 +776,10 @@ bool VulkanVideoParser::DecodePicture(VkParserPictureData* pd)
         return result;
     }
 
+    if (pd->numMetadataRecords > 0) {
+        m_decoderHandler->PictureMetadata(picIdx, pd->pMetadataRecords, pd->numMetadataRecords, pd->bitstreamData);
+    }
+
     if (m_dumpParserData) {
         std::cout
             << "\t ==> VulkanVideoParser::DecodePicture " << picIdx << std::endl
@@ -823,6 +826,10 @@ bool VulkanVideoParser::DecodePicture(VkParserPictureData* pd)
         }
     }
 
+    if (pd->pDecodedPictureHash) {
+        decodePictureInfo.decodedPictureHash = *pd->pDecodedPictureHash;
+    }
+
     decodePictureInfo.frameSyncinfo.unpairedField = decodePictureInfo.flags.unpairedField;
     decodePictureInfo.frameSyncinfo.syncToFirstField = decodePictureInfo.flags.syncToFirstField;
 
@@ -935,6 +942,7 @@ VulkanVideoParser::VulkanVideoParser(VkVideoCodecOperationFlagBitsKHR codecType,
     , m_dpb(3)
     , m_outOfBandPictureParameters(true)
     , m_inlinedPictureParametersUseBeginCoding(false)
+    , m_initDecodeParameters()
 {
     memset(&m_nvsi, 0, sizeof(m_nvsi));
     for (uint32_t picId = 0; picId < MAX_FRM_CNT; picId++) {
@@ -957,7 +965,9 @@ VkResult VulkanVideoParser::Initialize(
     uint32_t bufferOffsetAlignment,
     uint32_t bufferSizeAlignment,
     bool outOfBandPictureParameters,
-    uint32_t errorThreshold)
+    uint32_t errorThreshold,
+    uint32_t nalLengthSize,
+    const VkParserDecodeSkipPolicy* pDecodeSkipPolicy)
 {
     Deinitialize();
 
@@ -980,6 +990,12 @@ VkResult VulkanVideoParser::Initialize(
     nvdp.referenceClockRate = m_clockRate;
     nvdp.errorThreshold = errorThreshold;
     nvdp.outOfBandPictureParameters = outOfBandPictureParameters;
+    nvdp.nalLengthSize = nalLengthSize;
+    if (pDecodeSkipPolicy) {
+        nvdp.decodeSkipPolicy = *pDecodeSkipPolicy;
+    }
+    nvdp.pictureMetadata = m_decoderHandler->WantsPictureMetadata();
+    nvdp.statisticsTiming = m_decoderHandler->WantsParserStatisticsTiming();
 
     static const VkExtensionProperties h264StdExtensionVersion = { VK_STD_VULKAN_VIDEO_CODEC_H264_DECODE_EXTENSION_NAME, VK_STD_VULKAN_VIDEO_CODEC_H264_DECODE_SPEC_VERSION };
     static const VkExtensionProperties h265StdExtensionVersion = { VK_STD_VULKAN_VIDEO_CODEC_H265_DECODE_EXTENSION_NAME, VK_STD_VULKAN_VIDEO_CODEC_H265_DECODE_SPEC_VERSION };
@@ -1000,9 +1016,36 @@ VkResult VulkanVideoParser::Initialize(
         return VK_ERROR_VIDEO_PROFILE_CODEC_NOT_SUPPORTED_KHR;
     }
 
+    m_initDecodeParameters = nvdp;
     return CreateVulkanVideoDecodeParser(m_codecType, pStdExtensionVersion, &nvParserLog, 0, &nvdp, m_vkParser);
 }
 
+VkResult VulkanVideoParser::Reset(uint32_t nalLengthSize, const VkParserDecodeSkipPolicy* pDecodeSkipPolicy)
+{
+    if (!m_vkParser || !m_decoderHandler) {
+        return VK_ERROR_INITIALIZATION_FAILED;
+    }
+
+    // Flush the pictures of the last stream, as at its end
+    VkParserBitstreamPacket pkt;
+    memset(&pkt, 0, sizeof(pkt));
+    pkt.bEOS = true;
+    m_vkParser->ParseByteStream(&pkt);
+
+    // The next sequence header starts a new video sequence: the decoder handler keeps its video session
+    // and its images if they are compatible with it
+    memset(&m_nvsi, 0, sizeof(m_nvsi));
+    ResetPicDpbSlots(0);
+    m_fieldPicFlagMask = 0;
+    m_nCurrentPictureID = 0;
+
+    m_initDecodeParameters.nalLengthSize = nalLengthSize;
+    m_initDecodeParameters.decodeSkipPolicy = pDecodeSkipPolicy ? *pDecodeSkipPolicy : VkParserDecodeSkipPolicy();
+    m_initDecodeParameters.pictureMetadata = m_decoderHandler->WantsPictureMetadata();
+    m_initDecodeParameters.statisticsTiming = m_decoderHandler->WantsParserStatisticsTiming();
+    return m_vkParser->Initialize(&m_initDecodeParameters);
+}
+
 void VulkanVideoParser::Deinitialize()
 {
     m_vkParser = nullptr;
@@ -1043,6 +1086,14 @@ VkResult VulkanVideoParser::ParseVideoData(VkParserSourceDataPacket* pPacket,
     return result;
 }
 
+VkResult VulkanVideoParser::GetParserStatistics(VkParserStatistics* pStats) const
+{
+    if (!m_vkParser) {
+        return VK_ERROR_INITIALIZATION_FAILED;
+    }
+    return m_vkParser->GetStatistics(pStats) ? VK_SUCCESS : VK_ERROR_FEATURE_NOT_PRESENT;
+}
+
 int8_t VulkanVideoParser::GetPicIdx(vkPicBuffBase* pPicBuf)
 {
     if (pPicBuf) {
@@ -2658,7 +2709,9 @@ VkResult IVulkanVideoParser::Create(
     uint32_t bufferSizeAlignment,
     uint64_t clockRate,
     uint32_t errorThreshold,
-    VkSharedBaseObj<IVulkanVideoParser>& vulkanVideoParser)
+    VkSharedBaseObj<IVulkanVideoParser>& vulkanVideoParser,
+    uint32_t nalLengthSize,
+    const VkParserDecodeSkipPolicy* pDecodeSkipPolicy)
 {
     if (!decoderHandler || !videoFrameBufferCb) {
         return VK_ERROR_INITIALIZATION_FAILED;
@@ -2678,7 +2731,9 @@ VkResult IVulkanVideoParser::Create(
                                                           bufferOffsetAlignment,
                                                           bufferSizeAlignment,
                                                           outOfBandPictureParameters,
-                                                          errorThreshold);
+                                                          errorThreshold,
+                                                          nalLengthSize,
+                                                          pDecodeSkipPolicy);
 
         if (result != VK_SUCCESS) {
             return result;
@@ -2703,7 +2758,9 @@ VkResult vulkanCreateVideoParser(
             uint32_t bufferOffsetAlignment,
             uint32_t bufferSizeAlignment,
             uint64_t clockRate,
-            VkSharedBaseObj<IVulkanVideoParser>& vulkanVideoParser)
+            VkSharedBaseObj<IVulkanVideoParser>& vulkanVideoParser,
+            uint32_t nalLengthSize,
+            const VkParserDecodeSkipPolicy* pDecodeSkipPolicy)
 {
     if (videoCodecOperation == VK_VIDEO_CODEC_OPERATION_DECODE_H264_BIT_KHR) {
         if (!pStdExtensionVersion || strcmp(pStdExtensionVersion->extensionName, VK_STD_VULKAN_VIDEO_CODEC_H264_DECODE_EXTENSION_NAME) || (pStdExtensionVersion->specVersion != VK_STD_VULKAN_VIDEO_CODEC_H264_DECODE_SPEC_VERSION)) {
@@ -2739,5 +2796,7 @@ VkResult vulkanCreateVideoParser(
                                       bufferSizeAlignment,
                                       clockRate,
                                       0, // errorThreshold
-                                      vulkanVideoParser);
+                                      vulkanVideoParser,
+                                      nalLengthSize,
+                                      pDecodeSkipPolicy);
 }
@@ -547,6 +547,7 @@ public:
 
             pDecodedFrame->displayWidth  = m_perFrameDecodeImageSet[pictureIndex].m_picDispInfo.displayWidth;
             pDecodedFrame->displayHeight = m_perFrameDecodeImageSet[pictureIndex].m_picDispInfo.displayHeight;
+            pDecodedFrame->decodedPictureHash = m_perFrameDecodeImageSet[pictureIndex].m_picDispInfo.decodedPictureHash;
 
             if (m_perFrameDecodeImageSet[pictureIndex].m_hasFrameCompleteSignalFence) {
                 pDecodedFrame->frameCompleteFence = m_perFrameDecodeImageSet[pictureIndex].m_frameCompleteFence;
@@ -0,0 +1,2193 @@
+/*
+ * Copyright 2024 NVIDIA Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Headless parser benchmark: runs a stream through the parser, the DPB management and the
+// picture parameters path of VulkanVideoParser against a client that does no decoding,
+// and reports the parser throughput in JSON. It needs neither a Vulkan device nor a loader.
+// With a decode delay, the frames also go through a stub decode queue and a consumer waiting
+// for each of them, parsed ahead of it or not, to measure the pipelining of VulkanVideoProcessor.
+
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <new>
+#include <queue>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "vkvideo_parser/VulkanVideoParserIf.h"
+#include "vkvideo_parser/VulkanVideoParser.h"
+#include "vkvideo_parser/PictureBufferBase.h"
+#include "VkVideoCore/VkVideoCoreProfile.h"
+#include "VkDecoderUtils/VideoStreamDemuxer.h"
+#include "VkCodecUtils/VulkanBitstreamBufferHost.h"
+#include "VkCodecUtils/VkThreadSafeQueue.h"
+#include "VulkanVideoDecoder.h"
+#include "crcgenerator.h"
+
+//
+// Allocation counting: every operator new of the process goes through these counters.
+//
+static std::atomic<uint64_t> g_numAllocations(0);
+static std::atomic<uint64_t> g_allocatedBytes(0);
+
+void* operator new(size_t size)
+{
+    g_numAllocations++;
+    g_allocatedBytes += size;
+    void* ptr = malloc((size != 0) ? size : 1);
+    if (ptr == nullptr) {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+
+void* operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+    g_numAllocations++;
+    g_allocatedBytes += size;
+    return malloc((size != 0) ? size : 1);
+}
+
+void* operator new[](size_t size, const std::nothrow_t& tag) noexcept
+{
+    return operator new(size, tag);
+}
+
+void operator delete(void* ptr) noexcept { free(ptr); }
+void operator delete[](void* ptr) noexcept { free(ptr); }
+void operator delete(void* ptr, size_t) noexcept { free(ptr); }
+void operator delete[](void* ptr, size_t) noexcept { free(ptr); }
+void operator delete(void* ptr, const std::nothrow_t&) noexcept { free(ptr); }
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept { free(ptr); }
+
+typedef std::chrono::steady_clock BenchClock;
+
+static double SecondsSince(const BenchClock::time_point& start)
+{
+    return std::chrono::duration<double>(BenchClock::now() - start).count();
+}
+
+//
+// Decoder stub: accepts every sequence, parameter set and picture without decoding them. With a decode
+// delay, each picture completes that long after the previous one, as on a decode queue.
+//
+class BenchDecoderHandler : public IVulkanVideoDecoderHandler
+{
+public:
+    BenchDecoderHandler(bool useHugePages, bool pictureMetadata, bool stageTiming, uint32_t decodeDelayUs)
+        : m_refCount(0)
+        , m_useHugePages(useHugePages)
+        , m_usesHugePages(false)
+        , m_pictureMetadata(pictureMetadata)
+        , m_stageTiming(stageTiming)
+        , m_numMetadataRecords()
+        , m_metadataBytes(0)
+        , m_numSequences(0)
+        , m_numPictureParameters(0)
+        , m_numDecodedPictures(0)
+        , m_decodedBytes(0)
+        , m_codedWidth(0)
+        , m_codedHeight(0)
+        , m_decodeDelay(std::chrono::microseconds(decodeDelayUs))
+        , m_lastDecodeComplete()
+        , m_decodeCompleteTimes() { }
+
+    virtual int32_t AddRef()
+    {
+        return ++m_refCount;
+    }
+
+    virtual int32_t Release()
+    {
+        uint32_t ret = --m_refCount;
+        if (ret == 0) {
+            delete this;
+        }
+        return ret;
+    }
+
+    virtual int32_t StartVideoSequence(VkParserDetectedVideoFormat* pVideoFormat)
+    {
+        m_numSequences++;
+        m_codedWidth = pVideoFormat->coded_width;
+        m_codedHeight = pVideoFormat->coded_height;
+        return std::min<int32_t>(std::max<int32_t>(pVideoFormat->minNumDecodeSurfaces, 1), MAX_DECODE_SURFACES);
+    }
+
+    virtual bool UpdatePictureParameters(VkSharedBaseObj<StdVideoPictureParametersSet>&,
+                                         VkSharedBaseObj<VkVideoRefCountBase>&)
+    {
+        m_numPictureParameters++;
+        return true;
+    }
+
+    virtual int32_t DecodePictureWithParameters(VkParserPerFrameDecodeParameters* pPicParams, VkParserDecodePictureInfo*)
+    {
+        m_numDecodedPictures++;
+        m_decodedBytes += pPicParams->bitstreamDataLen;
+        if ((m_decodeDelay.count() != 0) &&
+            (pPicParams->currPicIdx >= 0) && (pPicParams->currPicIdx < MAX_DECODE_SURFACES)) {
+            m_lastDecodeComplete = std::max(BenchClock::now(), m_lastDecodeComplete) + m_decodeDelay;
+            m_decodeCompleteTimes[pPicParams->currPicIdx] = m_lastDecodeComplete;
+        }
+        return 0;
+    }
+
+    // The time the last decoding of the picture completes. Read once the picture is displayed: it is only
+    // decoded again after its release.
+    BenchClock::time_point GetDecodeCompleteTime(int32_t picId) const
+    {
+        return m_decodeCompleteTimes[picId];
+    }
+
+    virtual VkDeviceSize GetBitstreamBuffer(VkDeviceSize size,
+                                            VkDeviceSize minBitstreamBufferOffsetAlignment,
+                                            VkDeviceSize minBitstreamBufferSizeAlignment,
+                                            const uint8_t* pInitializeBufferMemory,
+                                            VkDeviceSize initializeBufferMemorySize,
+                                            VkSharedBaseObj<VulkanBitstreamBuffer>& bitstreamBuffer)
+    {
+        VkSharedBaseObj<VulkanBitstreamBufferHost> newBitstreamBuffer;
+        VkResult result = VulkanBitstreamBufferHost::Create(size,
+                                                            minBitstreamBufferOffsetAlignment,
+                                                            minBitstreamBufferSizeAlignment,
+                                                            pInitializeBufferMemory,
+                                                            initializeBufferMemorySize,
+                                                            m_useHugePages,
+                                                            newBitstreamBuffer);
+        if (result != VK_SUCCESS) {
+            return 0;
+        }
+        m_usesHugePages = newBitstreamBuffer->UsesHugePages();
+        bitstreamBuffer = newBitstreamBuffer;
+        return newBitstreamBuffer->GetMaxSize();
+    }
+
+    virtual bool WantsPictureMetadata() const { return m_pictureMetadata; }
+
+    virtual bool WantsParserStatisticsTiming() const { return m_stageTiming; }
+
+    virtual void PictureMetadata(int32_t, const VkParserMetadataRecord* pRecords, uint32_t numRecords,
+                                 VkSharedBaseObj<VulkanBitstreamBuffer>&)
+    {
+        for (uint32_t i = 0; i < numRecords; i++) {
+            m_numMetadataRecords[std::min<uint32_t>(pRecords[i].kind, MAX_METADATA_KINDS - 1)]++;
+            m_metadataBytes += pRecords[i].size;
+        }
+    }
+
+    enum { MAX_DECODE_SURFACES = 32 };
+    enum { MAX_METADATA_KINDS = VK_PARSER_METADATA_KIND_MASTERING_DISPLAY + 1 };
+
+    std::atomic<int32_t> m_refCount;
+    bool     m_useHugePages;
+    bool     m_usesHugePages;
+    bool     m_pictureMetadata;
+    bool     m_stageTiming;
+    uint64_t m_numMetadataRecords[MAX_METADATA_KINDS]; // Per VkParserMetadataKind
+    uint64_t m_metadataBytes;
+    uint64_t m_numSequences;
+    uint64_t m_numPictureParameters;
+    uint64_t m_numDecodedPictures;
+    uint64_t m_decodedBytes;
+    uint32_t m_codedWidth;
+    uint32_t m_codedHeight;
+    BenchClock::duration   m_decodeDelay;
+    BenchClock::time_point m_lastDecodeComplete;
+    BenchClock::time_point m_decodeCompleteTimes[MAX_DECODE_SURFACES];
+};
+
+//
+// Frame buffer stub: hands out picture buffers for the DPB and drops the displayed pictures, or keeps
+// them in a display queue until the consumer releases them.
+//
+class BenchFrameBuffer : public IVulkanVideoFrameBufferParserCb
+{
+public:
+    BenchFrameBuffer(bool holdDisplayedPictures)
+        : m_refCount(0)
+        , m_mutex()
+        , m_pictures()
+        , m_displayQueue()
+        , m_holdDisplayedPictures(holdDisplayedPictures)
+        , m_numDisplayedPictures(0)
+        , m_numReserveFailures(0) { }
+
+    virtual int32_t AddRef()
+    {
+        return ++m_refCount;
+    }
+
+    virtual int32_t Release()
+    {
+        uint32_t ret = --m_refCount;
+        if (ret == 0) {
+            delete this;
+        }
+        return ret;
+    }
+
+    virtual int32_t QueueDecodedPictureForDisplay(int8_t picId, VulkanVideoDisplayPictureInfo*)
+    {
+        m_numDisplayedPictures++;
+        if (m_holdDisplayedPictures && (picId >= 0) && (picId < BenchDecoderHandler::MAX_DECODE_SURFACES)) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_pictures[picId].AddRef();
+            m_displayQueue.push(picId);
+        }
+        return picId;
+    }
+
+    // Returns the next displayed picture, or -1
+    int32_t DequeueDisplayedPicture()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_displayQueue.empty()) {
+            return -1;
+        }
+        const int32_t picId = m_displayQueue.front();
+        m_displayQueue.pop();
+        return picId;
+    }
+
+    void ReleaseDisplayedPicture(int32_t picId)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_pictures[picId].Release();
+    }
+
+    virtual vkPicBuffBase* ReservePictureBuffer()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (int32_t picId = 0; picId < BenchDecoderHandler::MAX_DECODE_SURFACES; picId++) {
+            if (m_pictures[picId].IsAvailable()) {
+                m_pictures[picId].Reset();
+                m_pictures[picId].AddRef();
+                m_pictures[picId].m_picIdx = picId;
+                return &m_pictures[picId];
+            }
+        }
+        m_numReserveFailures++;
+        return nullptr;
+    }
+
+    std::atomic<int32_t> m_refCount;
+    std::mutex    m_mutex;
+    vkPicBuffBase m_pictures[BenchDecoderHandler::MAX_DECODE_SURFACES];
+    std::queue<int32_t> m_displayQueue;
+    bool     m_holdDisplayedPictures;
+    uint64_t m_numDisplayedPictures;
+    uint64_t m_numReserveFailures;
+};
+
+//
+// Gives access to the start code scan kernels of every ISA built into the parser.
+//
+class StartCodeScanner : public VulkanVideoDecoder
+{
+public:
+    StartCodeScanner()
+        : VulkanVideoDecoder(VK_VIDEO_CODEC_OPERATION_DECODE_H264_BIT_KHR) { }
+
+    // One next_start_code() call per start code, the way the byte stream parser used to scan
+    template<SIMD_ISA T>
+    uint64_t ScanStartCodes(const uint8_t* pData, size_t size)
+    {
+        uint64_t numStartCodes = 0;
+        size_t offset = 0;
+        m_BitBfr = (uint32_t)~0;
+        while (offset < size) {
+            bool foundStartCode = false;
+            offset += next_start_code<T>(pData + offset, size - offset, foundStartCode);
+            numStartCodes += foundStartCode ? 1 : 0;
+        }
+        return numStartCodes;
+    }
+
+    // Batched scan, the way the byte stream parser scans a packet
+    template<SIMD_ISA T>
+    uint64_t ScanStartCodeTables(const uint8_t* pData, size_t size)
+    {
+        uint64_t numStartCodes = 0;
+        size_t offset = 0;
+        m_BitBfr = (uint32_t)~0;
+        while (offset < size) {
+            uint32_t numFound = 0;
+            offset += next_start_codes<T>(pData + offset, size - offset, m_startCodes, MAX_START_CODES_PER_SCAN, numFound);
+            numStartCodes += numFound;
+        }
+        return numStartCodes;
+    }
+
+    template<SIMD_ISA T>
+    static uint64_t ScanEmulationPreventionBytes(const uint8_t* pData, size_t size)
+    {
+        uint64_t numEmulationPreventionBytes = 0;
+        size_t offset = find_emulation_prevention_byte<T>(pData, 0, size);
+        while (offset < size) {
+            numEmulationPreventionBytes++;
+            offset = find_emulation_prevention_byte<T>(pData, offset + 1, size);
+        }
+        return numEmulationPreventionBytes;
+    }
+
+protected:
+    virtual void CreatePrivateContext() { }
+    virtual void InitParser() { }
+    virtual bool IsPictureBoundary(int32_t) { return false; }
+    virtual int32_t ParseNalUnit() { return NALU_DISCARD; }
+    virtual bool BeginPicture(VkParserPictureData*) { return false; }
+    virtual void FreeContext() { }
+};
+
+struct StartCodeScanResult {
+    SIMD_ISA isa;
+    uint64_t numStartCodes;
+    uint64_t numStartCodesBatched;
+    uint64_t numEmulationPreventionBytes;
+    double   scannedBytes;
+    double   startCodeSeconds;
+    double   startCodeTableSeconds;
+    double   emulationPreventionSeconds;
+};
+
+template<SIMD_ISA T>
+static StartCodeScanResult RunStartCodeScan(StartCodeScanner& scanner, const std::vector<uint8_t>& data, uint32_t numPasses)
+{
+    StartCodeScanResult result = StartCodeScanResult();
+    result.isa = T;
+    result.scannedBytes = (double)data.size() * numPasses;
+
+    BenchClock::time_point start = BenchClock::now();
+    for (uint32_t pass = 0; pass < numPasses; pass++) {
+        result.numStartCodes = scanner.ScanStartCodes<T>(data.data(), data.size());
+    }
+    result.startCodeSeconds = SecondsSince(start);
+
+    start = BenchClock::now();
+    for (uint32_t pass = 0; pass < numPasses; pass++) {
+        result.numStartCodesBatched = scanner.ScanStartCodeTables<T>(data.data(), data.size());
+    }
+    result.startCodeTableSeconds = SecondsSince(start);
+
+    start = BenchClock::now();
+    for (uint32_t pass = 0; pass < numPasses; pass++) {
+        result.numEmulationPreventionBytes = StartCodeScanner::ScanEmulationPreventionBytes<T>(data.data(), data.size());
+    }
+    result.emulationPreventionSeconds = SecondsSince(start);
+
+    return result;
+}
+
+static const char* SimdIsaToName(SIMD_ISA isa)
+{
+    switch (isa) {
+    case SIMD_ISA::SSSE3:  return "ssse3";
+    case SIMD_ISA::AVX2:   return "avx2";
+    case SIMD_ISA::AVX512: return "avx512";
+    case SIMD_ISA::NEON:   return "neon";
+    case SIMD_ISA::SVE:    return "sve";
+    default:               return "c";
+    }
+}
+
+// Same rule as check_simd_support(): the C fallback, or a lower ISA of the detected architecture
+static bool IsSimdIsaSupported(SIMD_ISA isa, SIMD_ISA detected)
+{
+    if (isa == SIMD_ISA::NOSIMD) {
+        return true;
+    }
+    return ((isa >= SIMD_ISA::NEON) == (detected >= SIMD_ISA::NEON)) && (isa <= detected);
+}
+
+static std::vector<StartCodeScanResult> RunStartCodeScans(const std::vector<uint8_t>& data, SIMD_ISA detectedIsa)
+{
+    std::vector<StartCodeScanResult> results;
+    if (data.empty()) {
+        return results;
+    }
+
+    // Scan about 1 GB per kernel
+    const uint32_t numPasses = (uint32_t)std::min<size_t>(std::max<size_t>((size_t(1) << 30) / data.size(), 1), 1000);
+
+    StartCodeScanner scanner;
+    results.push_back(RunStartCodeScan<SIMD_ISA::NOSIMD>(scanner, data, numPasses));
+#if !defined(DISABLE_VK_VIDEO_PARSER_SIMD_OPTIMIZATIONS)
+#if defined(__x86_64__) || defined (_M_X64)
+    if (IsSimdIsaSupported(SIMD_ISA::SSSE3, detectedIsa)) {
+        results.push_back(RunStartCodeScan<SIMD_ISA::SSSE3>(scanner, data, numPasses));
+    }
+    if (IsSimdIsaSupported(SIMD_ISA::AVX2, detectedIsa)) {
+        results.push_back(RunStartCodeScan<SIMD_ISA::AVX2>(scanner, data, numPasses));
+    }
+    if (IsSimdIsaSupported(SIMD_ISA::AVX512, detectedIsa)) {
+        results.push_back(RunStartCodeScan<SIMD_ISA::AVX512>(scanner, data, numPasses));
+    }
+#elif defined(__aarch64__) || defined(__ARM_ARCH_7A__) || defined(_M_ARM64)
+    if (IsSimdIsaSupported(SIMD_ISA::NEON, detectedIsa)) {
+        results.push_back(RunStartCodeScan<SIMD_ISA::NEON>(scanner, data, numPasses));
+    }
+#if defined(__aarch64__)
+    if (IsSimdIsaSupported(SIMD_ISA::SVE, detectedIsa)) {
+        results.push_back(RunStartCodeScan<SIMD_ISA::SVE>(scanner, data, numPasses));
+    }
+#endif // __aarch64__
+#endif
+#endif // DISABLE_VK_VIDEO_PARSER_SIMD_OPTIMIZATIONS
+
+    return results;
+}
+
+//
+// Frame CRCs: the byte-at-a-time Crc32Table loop the output path ran once per CRC start value, against
+// getCRCs() with each CRC32 update path of the CPU, on frames of the size of an 8K 4:2:0 10-bit one.
+//
+struct CrcResult {
+    std::string path;        // "table" for the byte-at-a-time loop, the getCRCIsa() name otherwise
+    uint32_t    numSeeds;
+    double      frameBytes;  // Bytes checksummed, counted once whatever the number of seeds
+    double      seconds;
+    bool        matchesTable;
+};
+
+static CrcResult RunTableCrc(const std::vector<uint8_t>& frame, uint32_t* pChecksums, uint32_t numSeeds)
+{
+    CrcResult result = CrcResult();
+    result.path = "table";
+    result.numSeeds = numSeeds;
+    result.frameBytes = (double)frame.size();
+    result.matchesTable = true;
+
+    const BenchClock::time_point start = BenchClock::now();
+    for (uint32_t seed = 0; seed < numSeeds; seed++) {
+        uint32_t crc = pChecksums[seed];
+        for (size_t i = 0; i < frame.size(); i++) {
+            crc = (uint32_t)Crc32Table[frame[i] ^ (crc & 0xff)] ^ (crc >> 8);
+        }
+        pChecksums[seed] = crc;
+    }
+    result.seconds = SecondsSince(start);
+    return result;
+}
+
+static std::vector<CrcResult> RunCrcs()
+{
+    std::vector<CrcResult> results;
+    std::vector<uint8_t> frame((size_t)7680 * 4320 * 2 * 3 / 2);
+    uint32_t random = 1;
+    for (uint8_t& byte : frame) {
+        random = random * 1664525 + 1013904223;
+        byte = (uint8_t)(random >> 24);
+    }
+
+    const uint32_t seeds[] = { 0, 0xffffffff, 0x12345678, 0xdeadbeef };
+    const uint32_t numSeedCounts[] = { 1, 4 };
+    const char* isaNames[] = { "c", "pclmul", "crc32" };
+    const std::string selectedIsa = getCRCIsa();
+    for (uint32_t numSeeds : numSeedCounts) {
+        // The table loop once: it is an order of magnitude slower than the other paths
+        uint32_t expected[4];
+        memcpy(expected, seeds, sizeof(seeds));
+        results.push_back(RunTableCrc(frame, expected, numSeeds));
+
+        // About 1 GB per path
+        const uint32_t numPasses = 10;
+        for (const char* pIsaName : isaNames) {
+            if (!setCRCIsa(pIsaName)) {
+                continue;
+            }
+            CrcResult result = CrcResult();
+            result.path = pIsaName;
+            result.numSeeds = numSeeds;
+            result.frameBytes = (double)frame.size() * numPasses;
+
+            uint32_t checksums[4];
+            bool matchesTable = true;
+            const BenchClock::time_point start = BenchClock::now();
+            for (uint32_t pass = 0; pass < numPasses; pass++) {
+                memcpy(checksums, seeds, sizeof(seeds));
+                getCRCs(checksums, numSeeds, frame.data(), frame.size());
+                matchesTable = matchesTable && (memcmp(checksums, expected, numSeeds * sizeof(uint32_t)) == 0);
+            }
+            result.seconds = SecondsSince(start);
+            result.matchesTable = matchesTable;
+            results.push_back(result);
+        }
+    }
+    setCRCIsa(selectedIsa.c_str());
+    return results;
+}
+
+struct NalTypeStats {
+    uint64_t count;
+    uint64_t bytes;
+    double   seconds;
+};
+
+// The frames parsed ahead hold picture buffers on top of the DPB: half of the ones left beyond a 16 picture DPB
+enum { MAX_PARSER_LOOKAHEAD = (BenchDecoderHandler::MAX_DECODE_SURFACES - 16) / 2 };
+
+struct BenchConfig {
+    std::string inputFileName;
+    std::string outputFileName;
+    VkVideoCodecOperationFlagBitsKHR codecType;
+    std::string simdIsaName;
+    uint32_t numLoops;
+    uint32_t numPreparseThreads;
+    bool perNalTiming;
+    bool scanStartCodes;
+    bool bitReader;
+    bool crc;
+    bool useHugePages;
+    bool pictureMetadata;
+    bool stageTiming;
+    bool reuseParser;
+    bool resyncOnError;
+    uint32_t decodeDelayUs;
+    uint32_t parserLookahead;
+};
+
+struct BenchResults {
+    VkVideoCodecOperationFlagBitsKHR codecType;
+    uint64_t numLoops;
+    uint64_t inputBytes;
+    double   parseSeconds;
+    double   parserSetupSeconds; // Creating, or resetting with reuseParser, the parser of each loop
+    uint64_t numSequences;
+    uint64_t numPictureParameters;
+    uint64_t numDecodedPictures;
+    uint64_t numDisplayedPictures;
+    uint64_t numReserveFailures;
+    uint64_t decodedBytes;
+    uint32_t codedWidth;
+    uint32_t codedHeight;
+    bool     hugePages;
+    uint64_t numAllocations;
+    uint64_t allocatedBytes;
+    std::map<uint32_t, NalTypeStats> nalTypes;
+    bool     hasParserStats;
+    VkParserStatistics parserStats; // Summed over the loops
+    bool     pictureMetadata;
+    uint64_t numMetadataRecords[BenchDecoderHandler::MAX_METADATA_KINDS];
+    uint64_t metadataBytes;
+    bool     consumer;
+    uint64_t numConsumedFrames;
+    double   consumerSeconds;  // From the first chunk parsed to the last frame consumed
+};
+
+static void AddParserStatistics(VkParserStatistics& sum, const VkParserStatistics& stats)
+{
+    for (uint32_t i = 0; i < VK_PARSER_STATISTICS_MAX_UNIT_TYPES; i++) {
+        sum.unitCount[i] += stats.unitCount[i];
+        sum.unitBytes[i] += stats.unitBytes[i];
+    }
+    sum.startCodeScanBytes += stats.startCodeScanBytes;
+    sum.startCodeScanNs += stats.startCodeScanNs;
+    sum.parseUnitNs += stats.parseUnitNs;
+    sum.beginPictureNs += stats.beginPictureNs;
+    sum.endOfPictureNs += stats.endOfPictureNs;
+    sum.bitstreamBufferResizes += stats.bitstreamBufferResizes;
+    sum.bitstreamSwapCopyBytes += stats.bitstreamSwapCopyBytes;
+    sum.parameterSetUpdates += stats.parameterSetUpdates;
+    sum.dpbBumpingEvents += stats.dpbBumpingEvents;
+    sum.ptsQueueOverflows += stats.ptsQueueOverflows;
+    sum.ptsDrops += stats.ptsDrops;
+    sum.skippedPictures += stats.skippedPictures;
+    sum.errorRecoveries += stats.errorRecoveries;
+}
+
+static VkResult ParsePacket(VkSharedBaseObj<IVulkanVideoParser>& parser, const uint8_t* pData, size_t size,
+                            uint32_t flags, bool doPartialParsing, int64_t timestamp, size_t* pParsedBytes)
+{
+    VkParserSourceDataPacket packet = { 0 };
+    packet.payload = pData;
+    packet.payload_size = size;
+    packet.flags = flags;
+    if (timestamp) {
+        packet.flags |= VK_PARSER_PKT_TIMESTAMP;
+    }
+    packet.timestamp = timestamp;
+    if (!pData || size == 0) {
+        packet.flags |= VK_PARSER_PKT_ENDOFSTREAM;
+    }
+    *pParsedBytes = 0;
+    return parser->ParseVideoData(&packet, pParsedBytes, doPartialParsing);
+}
+
+static VkResult CreateBenchParser(VkVideoCodecOperationFlagBitsKHR codecType, uint32_t nalLengthSize,
+                                  const VkParserDecodeSkipPolicy& decodeSkipPolicy,
+                                  VkSharedBaseObj<BenchDecoderHandler>& decoderHandler,
+                                  VkSharedBaseObj<BenchFrameBuffer>& frameBuffer,
+                                  VkSharedBaseObj<IVulkanVideoParser>& parser)
+{
+    VkSharedBaseObj<IVulkanVideoDecoderHandler> decoderHandlerIf(decoderHandler);
+    VkSharedBaseObj<IVulkanVideoFrameBufferParserCb> frameBufferIf(frameBuffer);
+    return IVulkanVideoParser::Create(decoderHandlerIf,
+                                      frameBufferIf,
+                                      codecType,
+                                      BenchDecoderHandler::MAX_DECODE_SURFACES,
+                                      BenchDecoderHandler::MAX_DECODE_SURFACES,
+                                      2 * 1024 * 1024, // defaultMinBufferSize
+                                      256, // bufferOffsetAlignment
+                                      256, // bufferSizeAlignment
+                                      0, // clockRate - default 0 = 10Mhz
+                                      0, // errorThreshold
+                                      parser,
+                                      nalLengthSize,
+                                      &decodeSkipPolicy);
+}
+
+// Splits an Annex-B H.264/H.265 elementary stream into packets of one NAL unit each
+static void SplitNalUnits(const uint8_t* pData, size_t size, std::vector<size_t>& nalUnitOffsets)
+{
+    nalUnitOffsets.clear();
+    for (size_t i = 0; (i + 3) <= size; i++) {
+        if ((pData[i] == 0) && (pData[i + 1] == 0) && (pData[i + 2] == 1)) {
+            nalUnitOffsets.push_back(i);
+            i += 2;
+        }
+    }
+    if (nalUnitOffsets.empty() || (nalUnitOffsets[0] != 0)) {
+        nalUnitOffsets.insert(nalUnitOffsets.begin(), 0);
+    }
+}
+
+static uint32_t GetNalUnitType(VkVideoCodecOperationFlagBitsKHR codecType, const uint8_t* pNalUnit, size_t size)
+{
+    // Skip the start code prefix
+    size_t i = 0;
+    while ((i < size) && (pNalUnit[i] == 0)) {
+        i++;
+    }
+    if ((i + 1) >= size) {
+        return uint32_t(-1);
+    }
+    const uint8_t nalHeader = pNalUnit[i + 1];
+    return (codecType == VK_VIDEO_CODEC_OPERATION_DECODE_H264_BIT_KHR) ? (nalHeader & 0x1f) : ((nalHeader >> 1) & 0x3f);
+}
+
+// Feeds one NAL unit per packet. The parser processes a NAL unit once it finds the start code of
+// the next one, so the time of each packet is accounted to the NAL unit type of the previous packet.
+static bool ParseNalUnits(VkSharedBaseObj<IVulkanVideoParser>& parser, VkVideoCodecOperationFlagBitsKHR codecType,
+                          const uint8_t* pData, size_t size, BenchResults& results)
+{
+    std::vector<size_t> nalUnitOffsets;
+    SplitNalUnits(pData, size, nalUnitOffsets);
+    nalUnitOffsets.push_back(size);
+
+    uint32_t prevNalUnitType = uint32_t(-1);
+    for (size_t nalUnit = 0; (nalUnit + 1) < nalUnitOffsets.size(); nalUnit++) {
+        const uint8_t* pNalUnit = pData + nalUnitOffsets[nalUnit];
+        const size_t nalUnitSize = nalUnitOffsets[nalUnit + 1] - nalUnitOffsets[nalUnit];
+        const uint32_t nalUnitType = GetNalUnitType(codecType, pNalUnit, nalUnitSize);
+
+        size_t parsedBytes = 0;
+        const BenchClock::time_point start = BenchClock::now();
+        VkResult result = ParsePacket(parser, pNalUnit, nalUnitSize, 0, false, 0, &parsedBytes);
+        const double seconds = SecondsSince(start);
+        if (result != VK_SUCCESS) {
+            std::cerr << "Parser error " << result << " at offset " << nalUnitOffsets[nalUnit] << std::endl;
+            return false;
+        }
+
+        NalTypeStats& stats = results.nalTypes[nalUnitType];
+        stats.count++;
+        stats.bytes += nalUnitSize;
+        results.nalTypes[(prevNalUnitType != uint32_t(-1)) ? prevNalUnitType : nalUnitType].seconds += seconds;
+        results.parseSeconds += seconds;
+        prevNalUnitType = nalUnitType;
+    }
+
+    size_t parsedBytes = 0;
+    const BenchClock::time_point start = BenchClock::now();
+    ParsePacket(parser, nullptr, 0, 0, false, 0, &parsedBytes);
+    const double seconds = SecondsSince(start);
+    if (prevNalUnitType != uint32_t(-1)) {
+        results.nalTypes[prevNalUnitType].seconds += seconds;
+    }
+    results.parseSeconds += seconds;
+    return true;
+}
+
+//
+// Bit reader benchmark: the H.265 slice segment headers and SEI messages of the stream are parsed with
+// the word-at-a-time RBSP reader of the parser, and with the byte-at-a-time reader it replaced.
+//
+
+// Copy of the reader the parser used before its RBSP reader: one byte and one emulation prevention check at a time
+// through the bitstream buffer, into a 32-bit buffer.
+class ByteBitReader
+{
+public:
+    ByteBitReader(VulkanBitstreamBufferStream& bitstreamData)
+        : m_bitstreamData(bitstreamData)
+        , m_startOffset(0)
+        , m_endOffset(0)
+        , m_getOffset(0)
+        , m_zeroCount(0)
+        , m_bfr(0)
+        , m_bfrOffset(0)
+        , m_emulCount(0) { }
+
+    // The NAL unit starts with its 00.00.01 start code prefix
+    void Begin(int64_t startOffset, int64_t endOffset)
+    {
+        m_startOffset = startOffset;
+        m_endOffset = endOffset;
+        m_getOffset = startOffset + 3;
+        m_zeroCount = 0;
+        m_emulCount = 0;
+        m_bfr = 0;
+        m_bfrOffset = 32;
+        skip_bits(0);
+    }
+
+    int32_t consumed_bits() const { return (int32_t)(m_getOffset - m_startOffset - m_emulCount) * 8 - (32 - m_bfrOffset); }
+    uint32_t next_bits(uint32_t n) const { return (m_bfr << m_bfrOffset) >> (32 - n); } // n in the [1..25] range
+
+    void skip_bits(uint32_t n)
+    {
+        m_bfrOffset += n;
+        while (m_bfrOffset >= 8) {
+            m_bfr <<= 8;
+            if (m_getOffset < m_endOffset) {
+                VkDeviceSize c = m_bitstreamData[m_getOffset++];
+                // detect / discard emulation_prevention_three_byte
+                if (m_zeroCount == 2) {
+                    if (c == 3) {
+                        m_zeroCount = 0;
+                        c = (m_getOffset < m_endOffset) ? m_bitstreamData[m_getOffset] : 0;
+                        m_getOffset++;
+                        m_emulCount++;
+                    }
+                }
+                if (c != 0) {
+                    m_zeroCount = 0;
+                } else {
+                    m_zeroCount += (m_zeroCount < 2);
+                }
+                m_bfr |= c;
+            } else {
+                m_getOffset++;
+            }
+            m_bfrOffset -= 8;
+        }
+    }
+
+    uint32_t u(uint32_t n)
+    {
+        uint32_t bits = 0;
+        if (n > 0) {
+            if (n + m_bfrOffset <= 32) {
+                bits = next_bits(n);
+                skip_bits(n);
+            } else {
+                // n == 26..32
+                bits = next_bits(n - 25) << 25;
+                skip_bits(n - 25);
+                bits |= next_bits(25);
+                skip_bits(25);
+            }
+        }
+        return bits;
+    }
+
+    bool flag() { return (0 != u(1)); }
+
+    uint32_t ue()
+    {
+        int leadingZeroBits = -1;
+        for (int b = 0; (!b) && (leadingZeroBits < 32); leadingZeroBits++) {
+            b = u(1);
+        }
+        if (leadingZeroBits < 32) {
+            return (1 << leadingZeroBits) - 1 + u(leadingZeroBits);
+        }
+        return 0xffffffff + u(leadingZeroBits);
+    }
+
+    int32_t se()
+    {
+        const uint32_t eg = ue();
+        return (eg & 1) ? (int32_t)((eg >> 1) + 1) : -(int32_t)(eg >> 1);
+    }
+
+    bool byte_aligned() const { return ((m_bfrOffset & 7) == 0); }
+    bool more_rbsp_data() const { return ((m_bfr << (m_bfrOffset + 1)) != 0) || (m_getOffset < m_endOffset); }
+
+private:
+    VulkanBitstreamBufferStream& m_bitstreamData;
+    int64_t  m_startOffset;
+    int64_t  m_endOffset;
+    int64_t  m_getOffset;
+    int32_t  m_zeroCount;
+    uint32_t m_bfr;
+    uint32_t m_bfrOffset;
+    uint32_t m_emulCount;
+};
+
+// Holds the stream in the bitstream buffer of a parser, and gives access to its bit reader
+class BitReaderBenchParser : public VulkanVideoDecoder, public VkParserVideoDecodeClient
+{
+public:
+    BitReaderBenchParser()
+        : VulkanVideoDecoder(VK_VIDEO_CODEC_OPERATION_DECODE_H265_BIT_KHR) { }
+
+    // The parser's reader, through the ISA specific emulation prevention search Initialize() selects
+    class RbspReader
+    {
+    public:
+        RbspReader(BitReaderBenchParser& parser) : m_parser(parser) { }
+
+        void Begin(int64_t startOffset, int64_t endOffset)
+        {
+            m_parser.m_nalu.start_offset = startOffset;
+            m_parser.m_nalu.end_offset = endOffset;
+            m_parser.init_dbits();
+        }
+
+        int32_t consumed_bits() { return m_parser.consumed_bits(); }
+        uint32_t next_bits(uint32_t n) { return m_parser.next_bits(n); }
+        uint32_t u(uint32_t n) { return m_parser.u(n); }
+        bool flag() { return m_parser.flag(); }
+        uint32_t ue() { return m_parser.ue(); }
+        int32_t se() { return m_parser.se(); }
+        bool byte_aligned() const { return m_parser.byte_aligned(); }
+        bool more_rbsp_data() { return m_parser.more_rbsp_data(); }
+
+    private:
+        BitReaderBenchParser& m_parser;
+    };
+
+    bool LoadStream(const std::vector<uint8_t>& streamData)
+    {
+        VkParserInitDecodeParameters initParameters = VkParserInitDecodeParameters();
+        initParameters.interfaceVersion = NV_VULKAN_VIDEO_PARSER_API_VERSION;
+        initParameters.pClient = this;
+        initParameters.defaultMinBufferSize = 2 * 1024 * 1024;
+        initParameters.bufferOffsetAlignment = 256;
+        initParameters.bufferSizeAlignment = 256;
+        if (Initialize(&initParameters) != VK_SUCCESS) {
+            return false;
+        }
+        if ((streamData.size() > m_bitstreamDataLen) && !resizeBitstreamBuffer(streamData.size() - m_bitstreamDataLen)) {
+            return false;
+        }
+        VkSharedBaseObj<VulkanBitstreamBuffer> bitstreamBuffer(m_bitstreamData.GetBitstreamBuffer());
+        bitstreamBuffer->CopyDataFromBuffer(streamData.data(), 0, 0, streamData.size());
+        return true;
+    }
+
+    ByteBitReader GetByteReader() { return ByteBitReader(m_bitstreamData); }
+    RbspReader GetRbspReader() { return RbspReader(*this); }
+
+    // VkParserVideoDecodeClient: only the bitstream buffer is used
+    virtual int32_t BeginSequence(const VkParserSequenceInfo*) { return 0; }
+    virtual bool AllocPictureBuffer(VkPicIf**) { return false; }
+    virtual bool DecodePicture(VkParserPictureData*) { return false; }
+    virtual bool UpdatePictureParameters(VkSharedBaseObj<StdVideoPictureParametersSet>&,
+                                         VkSharedBaseObj<VkVideoRefCountBase>&) { return false; }
+    virtual bool DisplayPicture(VkPicIf*, int64_t) { return false; }
+    virtual void UnhandledNALU(const uint8_t*, size_t) { }
+    virtual VkDeviceSize GetBitstreamBuffer(VkDeviceSize size,
+                                            VkDeviceSize minBitstreamBufferOffsetAlignment,
+                                            VkDeviceSize minBitstreamBufferSizeAlignment,
+                                            const uint8_t* pInitializeBufferMemory,
+                                            VkDeviceSize initializeBufferMemorySize,
+                                            VkSharedBaseObj<VulkanBitstreamBuffer>& bitstreamBuffer)
+    {
+        VkSharedBaseObj<VulkanBitstreamBufferHost> newBitstreamBuffer;
+        VkResult result = VulkanBitstreamBufferHost::Create(size,
+                                                            minBitstreamBufferOffsetAlignment,
+                                                            minBitstreamBufferSizeAlignment,
+                                                            pInitializeBufferMemory,
+                                                            initializeBufferMemorySize,
+                                                            false,
+                                                            newBitstreamBuffer);
+        if (result != VK_SUCCESS) {
+            return 0;
+        }
+        bitstreamBuffer = newBitstreamBuffer;
+        return newBitstreamBuffer->GetMaxSize();
+    }
+
+protected:
+    virtual void CreatePrivateContext() { }
+    virtual void InitParser() { m_bEmulBytesPresent = true; }
+    virtual bool IsPictureBoundary(int32_t) { return false; }
+    virtual int32_t ParseNalUnit() { return NALU_DISCARD; }
+    virtual bool BeginPicture(VkParserPictureData*) { return false; }
+    virtual void FreeContext() { }
+};
+
+// The fields of the H.265 parameter sets that the slice segment header syntax depends on
+struct BitReaderSps {
+    bool     valid;
+    uint32_t chromaArrayType;
+    bool     separateColourPlane;
+    uint32_t log2MaxPocLsb;
+    uint32_t picSizeInCtbsY;
+    bool     sampleAdaptiveOffset;
+    uint32_t numShortTermRefPicSets;
+    uint32_t numDeltaPocs[65];     // Per short-term RPS, the last one is the RPS of the current slice
+    uint32_t numUsedByCurrPic[65];
+    bool     longTermRefPicsPresent;
+    uint32_t numLongTermRefPicsSps;
+    bool     usedByCurrPicLtSps[32];
+    bool     temporalMvp;
+};
+
+struct BitReaderPps {
+    bool     valid;
+    uint32_t spsId;
+    bool     dependentSliceSegments;
+    bool     outputFlagPresent;
+    uint32_t numExtraSliceHeaderBits;
+    bool     cabacInitPresent;
+    uint32_t numRefIdxDefaultActive[2];
+    bool     sliceChromaQpOffsetsPresent;
+    bool     weightedPred;
+    bool     weightedBipred;
+    bool     entryPoints;          // tiles_enabled_flag || entropy_coding_sync_enabled_flag
+    bool     loopFilterAcrossSlices;
+    bool     deblockingOverride;
+    bool     deblockingDisabled;
+    bool     listsModificationPresent;
+    bool     sliceHeaderExtensionPresent;
+    bool     chromaQpOffsetList;
+};
+
+struct BitReaderParameterSets {
+    BitReaderSps sps[16];
+    BitReaderPps pps[64];
+};
+
+// Bits of the values 0 to count - 1: Ceil(Log2(count))
+static uint32_t CeilLog2(uint32_t count)
+{
+    uint32_t bits = 0;
+    while ((bits < 32) && ((uint64_t(1) << bits) < count)) {
+        bits++;
+    }
+    return bits;
+}
+
+// 7.3.3
+template<class Reader>
+static void SkipProfileTierLevel(Reader& r, uint32_t maxSubLayersMinus1)
+{
+    // general_profile_space to general_inbld_flag / general_reserved_zero_bit (88 bits), general_level_idc
+    r.u(32); r.u(32); r.u(24); r.u(8);
+    bool subLayerProfilePresent[8] = {};
+    bool subLayerLevelPresent[8] = {};
+    for (uint32_t i = 0; i < maxSubLayersMinus1; i++) {
+        subLayerProfilePresent[i] = r.flag();
+        subLayerLevelPresent[i] = r.flag();
+    }
+    if (maxSubLayersMinus1 > 0) {
+        for (uint32_t i = maxSubLayersMinus1; i < 8; i++) {
+            r.u(2); // reserved_zero_2bits
+        }
+    }
+    for (uint32_t i = 0; i < maxSubLayersMinus1; i++) {
+        if (subLayerProfilePresent[i]) {
+            r.u(32); r.u(32); r.u(24);
+        }
+        if (subLayerLevelPresent[i]) {
+            r.u(8);
+        }
+    }
+}
+
+// 7.3.4
+template<class Reader>
+static void SkipScalingListData(Reader& r)
+{
+    for (uint32_t sizeId = 0; sizeId < 4; sizeId++) {
+        for (uint32_t matrixId = 0; matrixId < 6; matrixId += (sizeId == 3) ? 3 : 1) {
+            if (!r.flag()) { // scaling_list_pred_mode_flag
+                r.ue(); // scaling_list_pred_matrix_id_delta
+            } else {
+                const uint32_t coefNum = std::min<uint32_t>(64, 1 << (4 + (sizeId << 1)));
+                if (sizeId > 1) {
+                    r.se(); // scaling_list_dc_coef_minus8
+                }
+                for (uint32_t i = 0; i < coefNum; i++) {
+                    r.se(); // scaling_list_delta_coef
+                }
+            }
+        }
+    }
+}
+
+// 7.3.7, stores the number of pictures of RPS stRpsIdx
+template<class Reader>
+static bool ParseShortTermRefPicSet(Reader& r, BitReaderSps& sps, uint32_t stRpsIdx)
+{
+    if ((stRpsIdx != 0) && r.flag()) { // inter_ref_pic_set_prediction_flag
+        const uint32_t deltaIdxMinus1 = (stRpsIdx == sps.numShortTermRefPicSets) ? r.ue() : 0;
+        if (deltaIdxMinus1 >= stRpsIdx) {
+            return false;
+        }
+        r.u(1); // delta_rps_sign
+        r.ue(); // abs_delta_rps_minus1
+        const uint32_t refRpsIdx = stRpsIdx - (deltaIdxMinus1 + 1);
+        uint32_t numDeltaPocs = 0, numUsedByCurrPic = 0;
+        for (uint32_t j = 0; j <= sps.numDeltaPocs[refRpsIdx]; j++) {
+            const bool usedByCurrPic = r.flag();
+            const bool useDelta = usedByCurrPic || r.flag();
+            numDeltaPocs += useDelta ? 1 : 0;
+            numUsedByCurrPic += usedByCurrPic ? 1 : 0;
+        }
+        sps.numDeltaPocs[stRpsIdx] = numDeltaPocs;
+        sps.numUsedByCurrPic[stRpsIdx] = numUsedByCurrPic;
+        return (numDeltaPocs <= 32);
+    }
+    const uint32_t numNegativePics = r.ue();
+    const uint32_t numPositivePics = r.ue();
+    if ((numNegativePics > 16) || (numPositivePics > 16)) {
+        return false;
+    }
+    uint32_t numUsedByCurrPic = 0;
+    for (uint32_t i = 0; i < numNegativePics + numPositivePics; i++) {
+        r.ue(); // delta_poc_s0/s1_minus1
+        numUsedByCurrPic += r.u(1);
+    }
+    sps.numDeltaPocs[stRpsIdx] = numNegativePics + numPositivePics;
+    sps.numUsedByCurrPic[stRpsIdx] = numUsedByCurrPic;
+    return true;
+}
+
+// 7.3.2.2, up to the last field the slice segment header depends on
+template<class Reader>
+static void ParseBitReaderSps(Reader& r, BitReaderParameterSets& parameterSets)
+{
+    r.u(4); // sps_video_parameter_set_id
+    const uint32_t maxSubLayersMinus1 = r.u(3);
+    r.u(1); // sps_temporal_id_nesting_flag
+    SkipProfileTierLevel(r, maxSubLayersMinus1);
+    const uint32_t spsId = r.ue();
+    if (spsId >= 16) {
+        return;
+    }
+    BitReaderSps& sps = parameterSets.sps[spsId];
+    sps = BitReaderSps();
+    const uint32_t chromaFormatIdc = r.ue();
+    sps.separateColourPlane = (chromaFormatIdc == 3) && r.flag();
+    sps.chromaArrayType = sps.separateColourPlane ? 0 : chromaFormatIdc;
+    const uint32_t picWidth = r.ue();
+    const uint32_t picHeight = r.ue();
+    if (r.flag()) { // conformance_window_flag
+        r.ue(); r.ue(); r.ue(); r.ue();
+    }
+    r.ue(); // bit_depth_luma_minus8
+    r.ue(); // bit_depth_chroma_minus8
+    sps.log2MaxPocLsb = r.ue() + 4;
+    const bool subLayerOrderingInfoPresent = r.flag();
+    for (uint32_t i = subLayerOrderingInfoPresent ? 0 : maxSubLayersMinus1; i <= maxSubLayersMinus1; i++) {
+        r.ue(); r.ue(); r.ue();
+    }
+    const uint32_t log2MinCbSize = r.ue() + 3;
+    const uint32_t log2CtbSize = log2MinCbSize + r.ue();
+    r.ue(); r.ue(); r.ue(); r.ue(); // transform block sizes and hierarchy depths
+    if ((sps.log2MaxPocLsb > 16) || (log2CtbSize > 6)) {
+        return;
+    }
+    sps.picSizeInCtbsY = ((picWidth + (1 << log2CtbSize) - 1) >> log2CtbSize) *
+                         ((picHeight + (1 << log2CtbSize) - 1) >> log2CtbSize);
+    if (r.flag() && r.flag()) { // scaling_list_enabled_flag, sps_scaling_list_data_present_flag
+        SkipScalingListData(r);
+    }
+    r.u(1); // amp_enabled_flag
+    sps.sampleAdaptiveOffset = r.flag();
+    if (r.flag()) { // pcm_enabled_flag
+        r.u(4); r.u(4); r.ue(); r.ue(); r.u(1);
+    }
+    sps.numShortTermRefPicSets = r.ue();
+    if (sps.numShortTermRefPicSets > 64) {
+        return;
+    }
+    for (uint32_t i = 0; i < sps.numShortTermRefPicSets; i++) {
+        if (!ParseShortTermRefPicSet(r, sps, i)) {
+            return;
+        }
+    }
+    sps.longTermRefPicsPresent = r.flag();
+    if (sps.longTermRefPicsPresent) {
+        sps.numLongTermRefPicsSps = r.ue();
+        if (sps.numLongTermRefPicsSps > 32) {
+            return;
+        }
+        for (uint32_t i = 0; i < sps.numLongTermRefPicsSps; i++) {
+            r.u(sps.log2MaxPocLsb); // lt_ref_pic_poc_lsb_sps
+            sps.usedByCurrPicLtSps[i] = r.flag();
+        }
+    }
+    sps.temporalMvp = r.flag();
+    sps.valid = true;
+}
+
+// 7.3.2.3
+template<class Reader>
+static void ParseBitReaderPps(Reader& r, BitReaderParameterSets& parameterSets)
+{
+    const uint32_t ppsId = r.ue();
+    if (ppsId >= 64) {
+        return;
+    }
+    BitReaderPps& pps = parameterSets.pps[ppsId];
+    pps = BitReaderPps();
+    pps.spsId = r.ue();
+    pps.dependentSliceSegments = r.flag();
+    pps.outputFlagPresent = r.flag();
+    pps.numExtraSliceHeaderBits = r.u(3);
+    r.u(1); // sign_data_hiding_enabled_flag
+    pps.cabacInitPresent = r.flag();
+    pps.numRefIdxDefaultActive[0] = r.ue() + 1;
+    pps.numRefIdxDefaultActive[1] = r.ue() + 1;
+    r.se(); // init_qp_minus26
+    r.u(1); // constrained_intra_pred_flag
+    const bool transformSkip = r.flag();
+    if (r.flag()) { // cu_qp_delta_enabled_flag
+        r.ue();
+    }
+    r.se(); r.se(); // pps_cb_qp_offset, pps_cr_qp_offset
+    pps.sliceChromaQpOffsetsPresent = r.flag();
+    pps.weightedPred = r.flag();
+    pps.weightedBipred = r.flag();
+    r.u(1); // transquant_bypass_enabled_flag
+    const bool tiles = r.flag();
+    const bool entropyCodingSync = r.flag();
+    pps.entryPoints = tiles || entropyCodingSync;
+    if (tiles) {
+        const uint32_t numTileColumnsMinus1 = r.ue();
+        const uint32_t numTileRowsMinus1 = r.ue();
+        if ((numTileColumnsMinus1 >= 20) || (numTileRowsMinus1 >= 22)) {
+            return;
+        }
+        if (!r.flag()) { // uniform_spacing_flag
+            for (uint32_t i = 0; i < numTileColumnsMinus1 + numTileRowsMinus1; i++) {
+                r.ue();
+            }
+        }
+        r.u(1); // loop_filter_across_tiles_enabled_flag
+    }
+    pps.loopFilterAcrossSlices = r.flag();
+    if (r.flag()) { // deblocking_filter_control_present_flag
+        pps.deblockingOverride = r.flag();
+        pps.deblockingDisabled = r.flag();
+        if (!pps.deblockingDisabled) {
+            r.se(); r.se();
+        }
+    }
+    if (r.flag()) { // pps_scaling_list_data_present_flag
+        SkipScalingListData(r);
+    }
+    pps.listsModificationPresent = r.flag();
+    r.ue(); // log2_parallel_merge_level_minus2
+    pps.sliceHeaderExtensionPresent = r.flag();
+    if (r.flag()) { // pps_extension_present_flag
+        const bool rangeExtension = r.flag();
+        const uint32_t otherExtensions = r.u(7); // The multilayer, 3D and SCC extensions add slice header syntax
+        if (otherExtensions & 0x70) {
+            return;
+        }
+        if (rangeExtension) {
+            if (transformSkip) {
+                r.ue(); // log2_max_transform_skip_block_size_minus2
+            }
+            r.u(1); // cross_component_prediction_enabled_flag
+            pps.chromaQpOffsetList = r.flag();
+            if (pps.chromaQpOffsetList) {
+                r.ue(); // diff_cu_chroma_qp_offset_depth
+                const uint32_t chromaQpOffsetListLen = r.ue() + 1;
+                if (chromaQpOffsetListLen > 6) {
+                    return;
+                }
+                for (uint32_t i = 0; i < chromaQpOffsetListLen; i++) {
+                    r.se(); r.se();
+                }
+            }
+        }
+    }
+    pps.valid = true;
+}
+
+// 7.3.6.3
+template<class Reader>
+static void SkipPredWeightTable(Reader& r, uint32_t chromaArrayType, uint32_t numLists, const uint32_t* numRefIdxActive)
+{
+    r.ue(); // luma_log2_weight_denom
+    if (chromaArrayType != 0) {
+        r.se(); // delta_chroma_log2_weight_denom
+    }
+    for (uint32_t list = 0; list < numLists; list++) {
+        // A single layer reference picture never has the POC of the current picture: all the flags are present
+        bool lumaWeight[16] = {}, chromaWeight[16] = {};
+        for (uint32_t i = 0; i < numRefIdxActive[list]; i++) {
+            lumaWeight[i] = r.flag();
+        }
+        if (chromaArrayType != 0) {
+            for (uint32_t i = 0; i < numRefIdxActive[list]; i++) {
+                chromaWeight[i] = r.flag();
+            }
+        }
+        for (uint32_t i = 0; i < numRefIdxActive[list]; i++) {
+            if (lumaWeight[i]) {
+                r.se(); r.se();
+            }
+            if (chromaWeight[i]) {
+                r.se(); r.se(); r.se(); r.se();
+            }
+        }
+    }
+}
+
+struct BitReaderCounts {
+    uint64_t numSliceHeaders;
+    uint64_t sliceHeaderBits;
+    uint64_t sliceChecksum;
+    uint64_t numSeiMessages;
+    uint64_t seiPayloadBytes;
+    uint64_t seiChecksum;
+};
+
+// 7.3.6.1, returns false for the slices of unknown or unsupported parameter sets
+template<class Reader>
+static bool ParseBitReaderSliceHeader(Reader& r, uint32_t nalUnitType, BitReaderParameterSets& parameterSets,
+                                      BitReaderCounts& counts)
+{
+    const bool firstSliceSegmentInPic = r.flag();
+    if ((nalUnitType >= 16) && (nalUnitType <= 23)) {
+        r.u(1); // no_output_of_prior_pics_flag
+    }
+    const uint32_t ppsId = r.ue();
+    if ((ppsId >= 64) || !parameterSets.pps[ppsId].valid || (parameterSets.pps[ppsId].spsId >= 16) ||
+        !parameterSets.sps[parameterSets.pps[ppsId].spsId].valid) {
+        return false;
+    }
+    const BitReaderPps& pps = parameterSets.pps[ppsId];
+    BitReaderSps& sps = parameterSets.sps[pps.spsId];
+    uint64_t checksum = ppsId;
+
+    bool dependentSliceSegment = false;
+    if (!firstSliceSegmentInPic) {
+        dependentSliceSegment = pps.dependentSliceSegments && r.flag();
+        checksum = checksum * 31 + r.u(CeilLog2(sps.picSizeInCtbsY)); // slice_segment_address
+    }
+    if (!dependentSliceSegment) {
+        r.u(pps.numExtraSliceHeaderBits); // slice_reserved_flag
+        const uint32_t sliceType = r.ue();
+        checksum = checksum * 31 + sliceType;
+        if (pps.outputFlagPresent) {
+            r.u(1); // pic_output_flag
+        }
+        if (sps.separateColourPlane) {
+            r.u(2); // colour_plane_id
+        }
+        uint32_t numPicTotalCurr = 0;
+        bool sliceTemporalMvp = false;
+        if ((nalUnitType != 19) && (nalUnitType != 20)) { // Not IDR_W_RADL or IDR_N_LP
+            checksum = checksum * 31 + r.u(sps.log2MaxPocLsb); // slice_pic_order_cnt_lsb
+            uint32_t stRpsIdx = sps.numShortTermRefPicSets;
+            if (!r.flag()) { // short_term_ref_pic_set_sps_flag
+                if (!ParseShortTermRefPicSet(r, sps, sps.numShortTermRefPicSets)) {
+                    return false;
+                }
+            } else if (sps.numShortTermRefPicSets > 1) {
+                stRpsIdx = r.u(CeilLog2(sps.numShortTermRefPicSets));
+            } else {
+                stRpsIdx = 0;
+            }
+            if (stRpsIdx > sps.numShortTermRefPicSets) {
+                return false;
+            }
+            numPicTotalCurr = sps.numUsedByCurrPic[stRpsIdx];
+            if (sps.longTermRefPicsPresent) {
+                const uint32_t numLongTermSps = (sps.numLongTermRefPicsSps > 0) ? r.ue() : 0;
+                const uint32_t numLongTermPics = r.ue();
+                if ((numLongTermSps > sps.numLongTermRefPicsSps) || (numLongTermPics > 32)) {
+                    return false;
+                }
+                for (uint32_t i = 0; i < numLongTermSps + numLongTermPics; i++) {
+                    if (i < numLongTermSps) {
+                        const uint32_t ltIdxSps = (sps.numLongTermRefPicsSps > 1) ? r.u(CeilLog2(sps.numLongTermRefPicsSps)) : 0;
+                        numPicTotalCurr += ((ltIdxSps < 32) && sps.usedByCurrPicLtSps[ltIdxSps]) ? 1 : 0;
+                    } else {
+                        r.u(sps.log2MaxPocLsb); // poc_lsb_lt
+                        numPicTotalCurr += r.u(1); // used_by_curr_pic_lt_flag
+                    }
+                    if (r.flag()) { // delta_poc_msb_present_flag
+                        r.ue(); // delta_poc_msb_cycle_lt
+                    }
+                }
+            }
+            sliceTemporalMvp = sps.temporalMvp && r.flag();
+        }
+        bool sliceSao = false;
+        if (sps.sampleAdaptiveOffset) {
+            sliceSao = r.flag(); // slice_sao_luma_flag
+            if (sps.chromaArrayType != 0) {
+                sliceSao = r.flag() || sliceSao; // slice_sao_chroma_flag
+            }
+        }
+        if (sliceType <= 1) { // B or P
+            const uint32_t numLists = (sliceType == 0) ? 2 : 1;
+            uint32_t numRefIdxActive[2] = { pps.numRefIdxDefaultActive[0], pps.numRefIdxDefaultActive[1] };
+            if (r.flag()) { // num_ref_idx_active_override_flag
+                for (uint32_t list = 0; list < numLists; list++) {
+                    numRefIdxActive[list] = r.ue() + 1;
+                }
+            }
+            if ((numRefIdxActive[0] > 16) || (numRefIdxActive[1] > 16)) {
+                return false;
+            }
+            if (pps.listsModificationPresent && (numPicTotalCurr > 1)) {
+                for (uint32_t list = 0; list < numLists; list++) {
+                    if (r.flag()) { // ref_pic_list_modification_flag_lX
+                        for (uint32_t i = 0; i < numRefIdxActive[list]; i++) {
+                            r.u(CeilLog2(numPicTotalCurr)); // list_entry_lX
+                        }
+                    }
+                }
+            }
+            if (sliceType == 0) {
+                r.u(1); // mvd_l1_zero_flag
+            }
+            if (pps.cabacInitPresent) {
+                r.u(1); // cabac_init_flag
+            }
+            if (sliceTemporalMvp) {
+                const bool collocatedFromL0 = (sliceType == 0) ? r.flag() : true;
+                if (numRefIdxActive[collocatedFromL0 ? 0 : 1] > 1) {
+                    r.ue(); // collocated_ref_idx
+                }
+            }
+            if ((pps.weightedPred && (sliceType == 1)) || (pps.weightedBipred && (sliceType == 0))) {
+                SkipPredWeightTable(r, sps.chromaArrayType, numLists, numRefIdxActive);
+            }
+            r.ue(); // five_minus_max_num_merge_cand
+        }
+        checksum = checksum * 31 + (uint32_t)r.se(); // slice_qp_delta
+        if (pps.sliceChromaQpOffsetsPresent) {
+            r.se(); r.se();
+        }
+        if (pps.chromaQpOffsetList) {
+            r.u(1); // cu_chroma_qp_offset_enabled_flag
+        }
+        bool deblockingDisabled = pps.deblockingDisabled;
+        if (pps.deblockingOverride && r.flag()) { // deblocking_filter_override_flag
+            deblockingDisabled = r.flag();
+            if (!deblockingDisabled) {
+                r.se(); r.se();
+            }
+        }
+        if (pps.loopFilterAcrossSlices && (sliceSao || !deblockingDisabled)) {
+            r.u(1); // slice_loop_filter_across_slices_enabled_flag
+        }
+    }
+    if (pps.entryPoints) {
+        const uint32_t numEntryPointOffsets = r.ue();
+        if (numEntryPointOffsets > sps.picSizeInCtbsY) {
+            return false;
+        }
+        if (numEntryPointOffsets > 0) {
+            const uint32_t offsetLen = r.ue() + 1;
+            if (offsetLen > 32) {
+                return false;
+            }
+            for (uint32_t i = 0; i < numEntryPointOffsets; i++) {
+                checksum = checksum * 31 + r.u(offsetLen); // entry_point_offset_minus1
+            }
+        }
+    }
+    if (pps.sliceHeaderExtensionPresent) {
+        const uint32_t extensionLength = r.ue();
+        if (extensionLength > 256) {
+            return false;
+        }
+        for (uint32_t i = 0; i < extensionLength; i++) {
+            r.u(8);
+        }
+    }
+    // byte_alignment()
+    r.u(1);
+    while (!r.byte_aligned()) {
+        r.u(1);
+    }
+
+    counts.numSliceHeaders++;
+    counts.sliceHeaderBits += r.consumed_bits();
+    counts.sliceChecksum = counts.sliceChecksum * 31 + checksum;
+    return true;
+}
+
+// 7.3.2.4 and 7.3.5: the payload bytes are read one at a time, as the parser reads the payloads it keeps
+template<class Reader>
+static void ParseBitReaderSei(Reader& r, size_t nalUnitSize, BitReaderCounts& counts)
+{
+    do {
+        uint32_t payloadType = 0, payloadSize = 0;
+        while (r.next_bits(8) == 0xff) {
+            payloadType += r.u(8);
+        }
+        payloadType += r.u(8);
+        while (r.next_bits(8) == 0xff) {
+            payloadSize += r.u(8);
+        }
+        payloadSize += r.u(8);
+        if (payloadSize > nalUnitSize) {
+            break;
+        }
+        uint64_t checksum = payloadType;
+        for (uint32_t i = 0; i < payloadSize; i++) {
+            checksum += r.u(8);
+        }
+        counts.numSeiMessages++;
+        counts.seiPayloadBytes += payloadSize;
+        counts.seiChecksum = counts.seiChecksum * 31 + checksum;
+    } while (r.more_rbsp_data());
+}
+
+struct BitReaderNalUnit {
+    int64_t  startOffset;
+    int64_t  endOffset;
+    uint32_t nalUnitType;
+};
+
+template<class Reader>
+static void ParseBitReaderNalUnits(Reader& r, const std::vector<BitReaderNalUnit>& nalUnits,
+                                   BitReaderParameterSets& parameterSets, BitReaderCounts& counts)
+{
+    for (const BitReaderNalUnit& nalUnit : nalUnits) {
+        r.Begin(nalUnit.startOffset, nalUnit.endOffset);
+        r.u(16); // nal_unit_header()
+        if (nalUnit.nalUnitType == 33) {
+            ParseBitReaderSps(r, parameterSets);
+        } else if (nalUnit.nalUnitType == 34) {
+            ParseBitReaderPps(r, parameterSets);
+        } else if ((nalUnit.nalUnitType == 39) || (nalUnit.nalUnitType == 40)) {
+            ParseBitReaderSei(r, (size_t)(nalUnit.endOffset - nalUnit.startOffset), counts);
+        } else {
+            ParseBitReaderSliceHeader(r, nalUnit.nalUnitType, parameterSets, counts);
+        }
+    }
+}
+
+struct BitReaderResult {
+    const char*     name;
+    BitReaderCounts counts;         // Of one pass
+    double          numPasses;
+    double          sliceHeaderSeconds; // The parameter sets parsed in between included
+    double          seiSeconds;
+};
+
+template<class Reader>
+static BitReaderResult RunBitReader(const char* name, Reader reader, const std::vector<BitReaderNalUnit>& sliceNalUnits,
+                                    const std::vector<BitReaderNalUnit>& seiNalUnits, uint32_t numPasses)
+{
+    BitReaderResult result = BitReaderResult();
+    result.name = name;
+    result.numPasses = numPasses;
+
+    BitReaderParameterSets parameterSets;
+    BenchClock::time_point start = BenchClock::now();
+    for (uint32_t pass = 0; pass < numPasses; pass++) {
+        memset(&parameterSets, 0, sizeof(parameterSets));
+        result.counts = BitReaderCounts();
+        ParseBitReaderNalUnits(reader, sliceNalUnits, parameterSets, result.counts);
+    }
+    result.sliceHeaderSeconds = SecondsSince(start);
+
+    BitReaderCounts seiCounts = BitReaderCounts();
+    start = BenchClock::now();
+    for (uint32_t pass = 0; pass < numPasses; pass++) {
+        seiCounts = BitReaderCounts();
+        ParseBitReaderNalUnits(reader, seiNalUnits, parameterSets, seiCounts);
+    }
+    result.seiSeconds = SecondsSince(start);
+    result.counts.numSeiMessages = seiCounts.numSeiMessages;
+    result.counts.seiPayloadBytes = seiCounts.seiPayloadBytes;
+    result.counts.seiChecksum = seiCounts.seiChecksum;
+    return result;
+}
+
+static std::vector<BitReaderResult> RunBitReaders(const std::vector<uint8_t>& data)
+{
+    std::vector<BitReaderResult> results;
+    BitReaderBenchParser parser;
+    if (data.empty() || !parser.LoadStream(data)) {
+        return results;
+    }
+
+    // The parameter sets and the slices of the base layer, in stream order, and the SEI NAL units
+    std::vector<size_t> nalUnitOffsets;
+    SplitNalUnits(data.data(), data.size(), nalUnitOffsets);
+    nalUnitOffsets.push_back(data.size());
+    std::vector<BitReaderNalUnit> sliceNalUnits, seiNalUnits;
+    for (size_t i = 0; (i + 1) < nalUnitOffsets.size(); i++) {
+        const uint8_t* pNalUnit = data.data() + nalUnitOffsets[i];
+        const size_t nalUnitSize = nalUnitOffsets[i + 1] - nalUnitOffsets[i];
+        if ((nalUnitSize < 6) || (pNalUnit[0] != 0) || (pNalUnit[1] != 0) || (pNalUnit[2] != 1) ||
+            (((pNalUnit[3] & 1) | (pNalUnit[4] >> 3)) != 0)) { // nuh_layer_id
+            continue;
+        }
+        const BitReaderNalUnit nalUnit = { (int64_t)nalUnitOffsets[i], (int64_t)nalUnitOffsets[i + 1], (uint32_t)((pNalUnit[3] >> 1) & 0x3f) };
+        if ((nalUnit.nalUnitType <= 9) || ((nalUnit.nalUnitType >= 16) && (nalUnit.nalUnitType <= 21)) ||
+            (nalUnit.nalUnitType == 33) || (nalUnit.nalUnitType == 34)) {
+            sliceNalUnits.push_back(nalUnit);
+        } else if ((nalUnit.nalUnitType == 39) || (nalUnit.nalUnitType == 40)) {
+            seiNalUnits.push_back(nalUnit);
+        }
+    }
+
+    // Parse about a million NAL units per reader
+    const size_t numNalUnits = std::max<size_t>(sliceNalUnits.size() + seiNalUnits.size(), 1);
+    const uint32_t numPasses = (uint32_t)std::min<size_t>(std::max<size_t>((size_t(1) << 20) / numNalUnits, 1), 1000);
+
+    results.push_back(RunBitReader("byte", parser.GetByteReader(), sliceNalUnits, seiNalUnits, numPasses));
+    results.push_back(RunBitReader("rbsp", parser.GetRbspReader(), sliceNalUnits, seiNalUnits, numPasses));
+    return results;
+}
+
+// Feeds the stream one chunk at a time, the same way VulkanVideoProcessor::ParserProcessNextDataChunk() does
+class StreamFeeder
+{
+public:
+    StreamFeeder(VkSharedBaseObj<IVulkanVideoParser>& parser, VkSharedBaseObj<VideoStreamDemuxer>& demuxer,
+                 BenchResults& results)
+        : m_parser(parser)
+        , m_demuxer(demuxer)
+        , m_results(results)
+        , m_usesDemuxFrame(demuxer->IsStreamDemuxerEnabled() || demuxer->HasFramePreparser())
+        , m_flags(demuxer->DemuxesAccessUnits() ? VK_PARSER_PKT_ENDOFPICTURE : 0)
+        , m_bitstreamOffset(0)
+        , m_endOfStream(false)
+        , m_done(false)
+        , m_failed(false) { }
+
+    // Parses the next chunk of the stream, then flushes the display queue once it is all read. Returns false
+    // once the stream is done, with the flush or an error.
+    bool ParseNextChunk()
+    {
+        if (m_done) {
+            return false;
+        }
+
+        const uint8_t* pBitstreamData = nullptr;
+        int64_t timestamp = 0;
+        int64_t chunkSize = 0;
+        if (!m_endOfStream) {
+            if (m_usesDemuxFrame) {
+                chunkSize = m_demuxer->DemuxFrame(&pBitstreamData);
+                timestamp = m_demuxer->GetFrameTimestamp();
+            } else {
+                chunkSize = m_demuxer->ReadBitstreamData(&pBitstreamData, m_bitstreamOffset);
+            }
+        }
+
+        size_t parsedBytes = 0;
+        const BenchClock::time_point start = BenchClock::now();
+        if ((chunkSize <= 0) || (pBitstreamData == nullptr)) {
+            // Flush the display queue
+            ParsePacket(m_parser, nullptr, 0, 0, !m_usesDemuxFrame, 0, &parsedBytes);
+            m_results.parseSeconds += SecondsSince(start);
+            m_done = true;
+            return false;
+        }
+
+        VkResult result = ParsePacket(m_parser, pBitstreamData, (size_t)chunkSize, m_flags, !m_usesDemuxFrame,
+                                      timestamp, &parsedBytes);
+        m_results.parseSeconds += SecondsSince(start);
+        if (result != VK_SUCCESS) {
+            std::cerr << "Parser error " << result << " at offset " << m_bitstreamOffset << std::endl;
+            m_done = true;
+            m_failed = true;
+            return false;
+        }
+        m_results.inputBytes += m_usesDemuxFrame ? (uint64_t)chunkSize : parsedBytes;
+        m_bitstreamOffset += m_usesDemuxFrame ? chunkSize : (int64_t)parsedBytes;
+        if (!m_usesDemuxFrame && (parsedBytes == 0)) {
+            m_endOfStream = true;
+        }
+        return true;
+    }
+
+    bool IsDone() const { return m_done; }
+    bool HasFailed() const { return m_failed; }
+
+private:
+    VkSharedBaseObj<IVulkanVideoParser>& m_parser;
+    VkSharedBaseObj<VideoStreamDemuxer>& m_demuxer;
+    BenchResults& m_results;
+    const bool     m_usesDemuxFrame;
+    const uint32_t m_flags;
+    int64_t m_bitstreamOffset;
+    bool    m_endOfStream;
+    bool    m_done;
+    bool    m_failed;
+};
+
+static bool ParseStream(VkSharedBaseObj<IVulkanVideoParser>& parser, VkSharedBaseObj<VideoStreamDemuxer>& demuxer,
+                        BenchResults& results)
+{
+    StreamFeeder streamFeeder(parser, demuxer, results);
+    while (streamFeeder.ParseNextChunk()) {
+    }
+    return !streamFeeder.HasFailed();
+}
+
+// Waits for the stub decoding of a displayed frame, as the consumer of VulkanVideoProcessor waits on its fence
+static void ConsumeFrame(int32_t picId, VkSharedBaseObj<BenchDecoderHandler>& decoderHandler,
+                         VkSharedBaseObj<BenchFrameBuffer>& frameBuffer, BenchResults& results)
+{
+    std::this_thread::sleep_until(decoderHandler->GetDecodeCompleteTime(picId));
+    frameBuffer->ReleaseDisplayedPicture(picId);
+    results.numConsumedFrames++;
+}
+
+// Runs the displayed frames through a consumer, parsing the stream when it has no frame, as
+// VulkanVideoProcessor::GetNextFrame() does, or on a thread of its own up to parserLookahead frames ahead.
+static bool ConsumeStream(uint32_t parserLookahead, VkSharedBaseObj<IVulkanVideoParser>& parser,
+                          VkSharedBaseObj<VideoStreamDemuxer>& demuxer,
+                          VkSharedBaseObj<BenchDecoderHandler>& decoderHandler,
+                          VkSharedBaseObj<BenchFrameBuffer>& frameBuffer, BenchResults& results)
+{
+    StreamFeeder streamFeeder(parser, demuxer, results);
+    const BenchClock::time_point start = BenchClock::now();
+
+    if (parserLookahead == 0) {
+        for (;;) {
+            int32_t picId = frameBuffer->DequeueDisplayedPicture();
+            while ((picId < 0) && !streamFeeder.IsDone()) {
+                streamFeeder.ParseNextChunk();
+                picId = frameBuffer->DequeueDisplayedPicture();
+            }
+            if (picId < 0) {
+                break;
+            }
+            ConsumeFrame(picId, decoderHandler, frameBuffer, results);
+        }
+    } else {
+        VkThreadSafeQueue<int32_t> readyFrames(parserLookahead);
+        std::thread parserThread([&]() {
+            for (;;) {
+                int32_t picId = frameBuffer->DequeueDisplayedPicture();
+                if (picId < 0) {
+                    if (streamFeeder.IsDone()) {
+                        break;
+                    }
+                    streamFeeder.ParseNextChunk();
+                    continue;
+                }
+                readyFrames.Push(picId);
+            }
+            readyFrames.SetFlushAndExit();
+        });
+
+        int32_t picId = -1;
+        while (readyFrames.WaitAndPop(picId)) {
+            ConsumeFrame(picId, decoderHandler, frameBuffer, results);
+        }
+        parserThread.join();
+    }
+
+    results.consumerSeconds += SecondsSince(start);
+    return !streamFeeder.HasFailed();
+}
+
+// Reads the whole stream, as the parser gets it
+static void ReadStream(VkSharedBaseObj<VideoStreamDemuxer>& demuxer, std::vector<uint8_t>& data)
+{
+    data.clear();
+    const bool usesDemuxFrame = demuxer->IsStreamDemuxerEnabled() || demuxer->HasFramePreparser();
+    for (;;) {
+        const uint8_t* pBitstreamData = nullptr;
+        int64_t chunkSize = usesDemuxFrame ? demuxer->DemuxFrame(&pBitstreamData)
+                                           : demuxer->ReadBitstreamData(&pBitstreamData, (int64_t)data.size());
+        if ((chunkSize <= 0) || (pBitstreamData == nullptr)) {
+            break;
+        }
+        data.insert(data.end(), pBitstreamData, pBitstreamData + chunkSize);
+        if (!usesDemuxFrame) {
+            // The rest of an elementary stream is returned in a single chunk
+            break;
+        }
+    }
+    demuxer->Rewind();
+}
+
+// Adds the counters of a decoder handler / frame buffer once done with them, after one or several streams
+static void AddClientResults(const BenchConfig& config, VkSharedBaseObj<IVulkanVideoParser>& parser,
+                             VkSharedBaseObj<BenchDecoderHandler>& decoderHandler,
+                             VkSharedBaseObj<BenchFrameBuffer>& frameBuffer, BenchResults& results)
+{
+    VkParserStatistics parserStats = VkParserStatistics();
+    if (parser->GetParserStatistics(&parserStats) == VK_SUCCESS) {
+        AddParserStatistics(results.parserStats, parserStats);
+        results.hasParserStats = true;
+    }
+
+    results.numSequences += decoderHandler->m_numSequences;
+    results.numPictureParameters += decoderHandler->m_numPictureParameters;
+    results.numDecodedPictures += decoderHandler->m_numDecodedPictures;
+    results.decodedBytes += decoderHandler->m_decodedBytes;
+    results.numDisplayedPictures += frameBuffer->m_numDisplayedPictures;
+    results.numReserveFailures += frameBuffer->m_numReserveFailures;
+    results.codedWidth = decoderHandler->m_codedWidth;
+    results.codedHeight = decoderHandler->m_codedHeight;
+    results.hugePages = decoderHandler->m_usesHugePages;
+    results.pictureMetadata = config.pictureMetadata;
+    for (uint32_t kind = 0; kind < BenchDecoderHandler::MAX_METADATA_KINDS; kind++) {
+        results.numMetadataRecords[kind] += decoderHandler->m_numMetadataRecords[kind];
+    }
+    results.metadataBytes += decoderHandler->m_metadataBytes;
+}
+
+static bool RunBenchmark(const BenchConfig& config, VkSharedBaseObj<VideoStreamDemuxer>& demuxer,
+                         const std::vector<uint8_t>& streamData, BenchResults& results)
+{
+    results.codecType = demuxer->GetVideoCodec();
+    const bool perNalTiming = config.perNalTiming && !streamData.empty();
+    const bool consumer = !perNalTiming && ((config.decodeDelayUs > 0) || (config.parserLookahead > 0));
+    results.consumer = consumer;
+    VkParserDecodeSkipPolicy decodeSkipPolicy = VkParserDecodeSkipPolicy();
+    if (config.resyncOnError) {
+        decodeSkipPolicy.flags |= VK_PARSER_DECODE_SKIP_TO_RANDOM_ACCESS_ON_ERROR;
+    }
+
+    VkSharedBaseObj<BenchDecoderHandler> decoderHandler;
+    VkSharedBaseObj<BenchFrameBuffer> frameBuffer;
+    VkSharedBaseObj<IVulkanVideoParser> parser;
+    for (uint32_t loop = 0; loop < config.numLoops; loop++) {
+        const uint64_t numAllocations = g_numAllocations;
+        const uint64_t allocatedBytes = g_allocatedBytes;
+
+        // With reuseParser, every loop after the first one parses the stream as a new one, with the same parser
+        const BenchClock::time_point setupStart = BenchClock::now();
+        VkResult result = VK_SUCCESS;
+        if (config.reuseParser && parser) {
+            result = parser->Reset(demuxer->GetNalLengthSize(), &decodeSkipPolicy);
+        } else {
+            decoderHandler = new BenchDecoderHandler(config.useHugePages, config.pictureMetadata, config.stageTiming,
+                                                     config.decodeDelayUs);
+            frameBuffer = new BenchFrameBuffer(consumer);
+            parser = nullptr;
+            result = CreateBenchParser(results.codecType, demuxer->GetNalLengthSize(), decodeSkipPolicy,
+                                       decoderHandler, frameBuffer, parser);
+        }
+        results.parserSetupSeconds += SecondsSince(setupStart);
+        if (result != VK_SUCCESS) {
+            std::cerr << "Can't " << (config.reuseParser ? "reset" : "create") << " the parser: " << result << std::endl;
+            return false;
+        }
+
+        bool parsed = false;
+        if (perNalTiming) {
+            results.inputBytes += streamData.size();
+            parsed = ParseNalUnits(parser, results.codecType, streamData.data(), streamData.size(), results);
+        } else if (consumer) {
+            parsed = ConsumeStream(config.parserLookahead, parser, demuxer, decoderHandler, frameBuffer, results);
+            demuxer->Rewind();
+        } else {
+            parsed = ParseStream(parser, demuxer, results);
+            demuxer->Rewind();
+        }
+
+        results.numAllocations += g_numAllocations - numAllocations;
+        results.allocatedBytes += g_allocatedBytes - allocatedBytes;
+        results.numLoops++;
+
+        const bool lastLoop = !parsed || ((loop + 1) == config.numLoops);
+        if (!config.reuseParser || lastLoop) {
+            AddClientResults(config, parser, decoderHandler, frameBuffer, results);
+        }
+
+        if (!parsed) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static double GigabytesPerSecond(double bytes, double seconds)
+{
+    return bytes / (std::max(seconds, 1e-9) * 1e9);
+}
+
+static void WriteJson(std::ostream& os, const BenchConfig& config, const BenchResults& results,
+                      SIMD_ISA parserIsa, const std::vector<StartCodeScanResult>& scanResults,
+                      const std::vector<BitReaderResult>& bitReaderResults, const std::vector<CrcResult>& crcResults)
+{
+    const double seconds = std::max(results.parseSeconds, 1e-9);
+    const double numFrames = (double)std::max<uint64_t>(results.numDecodedPictures, 1);
+
+    os << "{" << std::endl;
+    os << "  \"input\": \"" << config.inputFileName << "\"," << std::endl;
+    os << "  \"codec\": \"" << VkVideoCoreProfile::CodecToName(results.codecType) << "\"," << std::endl;
+    os << "  \"codedWidth\": " << results.codedWidth << "," << std::endl;
+    os << "  \"codedHeight\": " << results.codedHeight << "," << std::endl;
+    os << "  \"isa\": \"" << SimdIsaToName(parserIsa) << "\"," << std::endl;
+    os << "  \"hugePages\": " << (results.hugePages ? "true" : "false") << "," << std::endl;
+    os << "  \"loops\": " << results.numLoops << "," << std::endl;
+    os << "  \"inputBytes\": " << results.inputBytes << "," << std::endl;
+    os << "  \"parseSeconds\": " << results.parseSeconds << "," << std::endl;
+    os << "  \"reuseParser\": " << (config.reuseParser ? "true" : "false") << "," << std::endl;
+    os << "  \"parserSetupSeconds\": " << results.parserSetupSeconds << "," << std::endl;
+    os << "  \"sequences\": " << results.numSequences << "," << std::endl;
+    os << "  \"pictureParameterUpdates\": " << results.numPictureParameters << "," << std::endl;
+    os << "  \"decodedFrames\": " << results.numDecodedPictures << "," << std::endl;
+    os << "  \"displayedFrames\": " << results.numDisplayedPictures << "," << std::endl;
+    os << "  \"pictureBufferReserveFailures\": " << results.numReserveFailures << "," << std::endl;
+    os << "  \"decodedBytes\": " << results.decodedBytes << "," << std::endl;
+    os << "  \"framesPerSecond\": " << results.numDecodedPictures / seconds << "," << std::endl;
+    os << "  \"megabytesPerSecond\": " << results.inputBytes / (seconds * 1e6) << "," << std::endl;
+    os << "  \"allocations\": " << results.numAllocations << "," << std::endl;
+    os << "  \"allocationsPerFrame\": " << results.numAllocations / numFrames << "," << std::endl;
+    os << "  \"allocatedBytesPerFrame\": " << results.allocatedBytes / numFrames;
+
+    if (!results.nalTypes.empty()) {
+        os << "," << std::endl << "  \"nalUnitTypes\": [";
+        bool first = true;
+        for (const auto& nalType : results.nalTypes) {
+            const NalTypeStats& stats = nalType.second;
+            os << (first ? "" : ",") << std::endl
+               << "    { \"type\": " << (int32_t)nalType.first
+               << ", \"count\": " << stats.count
+               << ", \"bytes\": " << stats.bytes
+               << ", \"seconds\": " << stats.seconds
+               << ", \"microsecondsPerNalUnit\": " << ((stats.count != 0) ? (stats.seconds * 1e6 / stats.count) : 0.0)
+               << " }";
+            first = false;
+        }
+        os << std::endl << "  ]";
+    }
+
+    if (results.hasParserStats) {
+        const VkParserStatistics& stats = results.parserStats;
+        os << "," << std::endl << "  \"parserStatistics\": {" << std::endl
+           << "    \"startCodeScanBytes\": " << stats.startCodeScanBytes << "," << std::endl;
+        if (config.stageTiming) {
+            os << "    \"startCodeScanGBps\": " << GigabytesPerSecond((double)stats.startCodeScanBytes, stats.startCodeScanNs * 1e-9) << "," << std::endl
+               << "    \"parseUnitSeconds\": " << stats.parseUnitNs * 1e-9 << "," << std::endl
+               << "    \"beginPictureSeconds\": " << stats.beginPictureNs * 1e-9 << "," << std::endl
+               << "    \"endOfPictureSeconds\": " << stats.endOfPictureNs * 1e-9 << "," << std::endl;
+        }
+        os << "    \"bitstreamBufferResizes\": " << stats.bitstreamBufferResizes << "," << std::endl
+           << "    \"bitstreamSwapCopyBytes\": " << stats.bitstreamSwapCopyBytes << "," << std::endl
+           << "    \"parameterSetUpdates\": " << stats.parameterSetUpdates << "," << std::endl
+           << "    \"dpbBumpingEvents\": " << stats.dpbBumpingEvents << "," << std::endl
+           << "    \"ptsQueueOverflows\": " << stats.ptsQueueOverflows << "," << std::endl
+           << "    \"ptsDrops\": " << stats.ptsDrops << "," << std::endl
+           << "    \"skippedPictures\": " << stats.skippedPictures << "," << std::endl
+           << "    \"errorRecoveries\": " << stats.errorRecoveries << "," << std::endl
+           << "    \"units\": [";
+        bool first = true;
+        for (uint32_t type = 0; type < VK_PARSER_STATISTICS_MAX_UNIT_TYPES; type++) {
+            if (stats.unitCount[type] == 0) {
+                continue;
+            }
+            os << (first ? "" : ",") << std::endl
+               << "      { \"type\": " << type
+               << ", \"count\": " << stats.unitCount[type]
+               << ", \"bytes\": " << stats.unitBytes[type] << " }";
+            first = false;
+        }
+        os << std::endl << "    ]" << std::endl << "  }";
+    }
+
+    if (results.pictureMetadata) {
+        static const char* const kindNames[BenchDecoderHandler::MAX_METADATA_KINDS] = {
+            "other", "closedCaptions", "ituT35", "userDataUnregistered", "timeCode", "contentLightLevel", "masteringDisplay" };
+        os << "," << std::endl << "  \"metadata\": {" << std::endl
+           << "    \"bytes\": " << results.metadataBytes;
+        for (uint32_t kind = 0; kind < BenchDecoderHandler::MAX_METADATA_KINDS; kind++) {
+            os << "," << std::endl << "    \"" << kindNames[kind] << "\": " << results.numMetadataRecords[kind];
+        }
+        os << std::endl << "  }";
+    }
+
+    if (results.consumer) {
+        os << "," << std::endl << "  \"consumer\": {" << std::endl
+           << "    \"decodeDelayUs\": " << config.decodeDelayUs << "," << std::endl
+           << "    \"parserLookahead\": " << config.parserLookahead << "," << std::endl
+           << "    \"frames\": " << results.numConsumedFrames << "," << std::endl
+           << "    \"seconds\": " << results.consumerSeconds << "," << std::endl
+           << "    \"framesPerSecond\": " << results.numConsumedFrames / std::max(results.consumerSeconds, 1e-9) << std::endl
+           << "  }";
+    }
+
+    if (!scanResults.empty()) {
+        os << "," << std::endl << "  \"startCodeScan\": [";
+        bool first = true;
+        for (const StartCodeScanResult& scan : scanResults) {
+            os << (first ? "" : ",") << std::endl
+               << "    { \"isa\": \"" << SimdIsaToName(scan.isa) << "\""
+               << ", \"startCodes\": " << scan.numStartCodes
+               << ", \"emulationPreventionBytes\": " << scan.numEmulationPreventionBytes
+               << ", \"nextStartCodeGBps\": " << GigabytesPerSecond(scan.scannedBytes, scan.startCodeSeconds)
+               << ", \"nextStartCodesGBps\": " << GigabytesPerSecond(scan.scannedBytes, scan.startCodeTableSeconds)
+               << ", \"findEmulationPreventionByteGBps\": " << GigabytesPerSecond(scan.scannedBytes, scan.emulationPreventionSeconds)
+               << ", \"matchesC\": "
+               << (((scan.numStartCodes == scanResults[0].numStartCodes) &&
+                    (scan.numStartCodesBatched == scanResults[0].numStartCodes) &&
+                    (scan.numEmulationPreventionBytes == scanResults[0].numEmulationPreventionBytes)) ? "true" : "false")
+               << " }";
+            first = false;
+        }
+        os << std::endl << "  ]";
+    }
+
+    if (!bitReaderResults.empty()) {
+        // Both readers must read the same values: the first one is the reference
+        const BitReaderCounts& reference = bitReaderResults[0].counts;
+        os << "," << std::endl << "  \"bitReaders\": [";
+        bool first = true;
+        for (const BitReaderResult& reader : bitReaderResults) {
+            const BitReaderCounts& counts = reader.counts;
+            os << (first ? "" : ",") << std::endl
+               << "    { \"reader\": \"" << reader.name << "\""
+               << ", \"passes\": " << reader.numPasses
+               << ", \"sliceHeaders\": " << counts.numSliceHeaders
+               << ", \"sliceHeaderBits\": " << counts.sliceHeaderBits
+               << ", \"sliceHeadersPerSecond\": " << counts.numSliceHeaders * reader.numPasses / std::max(reader.sliceHeaderSeconds, 1e-9)
+               << ", \"sliceHeaderMbitsPerSecond\": " << counts.sliceHeaderBits * reader.numPasses / (std::max(reader.sliceHeaderSeconds, 1e-9) * 1e6)
+               << ", \"seiMessages\": " << counts.numSeiMessages
+               << ", \"seiPayloadBytes\": " << counts.seiPayloadBytes
+               << ", \"seiMessagesPerSecond\": " << counts.numSeiMessages * reader.numPasses / std::max(reader.seiSeconds, 1e-9)
+               << ", \"seiMegabytesPerSecond\": " << counts.seiPayloadBytes * reader.numPasses / (std::max(reader.seiSeconds, 1e-9) * 1e6)
+               << ", \"matchesByteReader\": "
+               << (((counts.numSliceHeaders == reference.numSliceHeaders) &&
+                    (counts.sliceHeaderBits == reference.sliceHeaderBits) &&
+                    (counts.sliceChecksum == reference.sliceChecksum) &&
+                    (counts.numSeiMessages == reference.numSeiMessages) &&
+                    (counts.seiPayloadBytes == reference.seiPayloadBytes) &&
+                    (counts.seiChecksum == reference.seiChecksum)) ? "true" : "false")
+               << " }";
+            first = false;
+        }
+        os << std::endl << "  ]";
+    }
+
+    if (!crcResults.empty()) {
+        os << "," << std::endl << "  \"crc\": [";
+        bool first = true;
+        for (const CrcResult& crc : crcResults) {
+            os << (first ? "" : ",") << std::endl
+               << "    { \"path\": \"" << crc.path << "\""
+               << ", \"seeds\": " << crc.numSeeds
+               << ", \"frameGBps\": " << GigabytesPerSecond(crc.frameBytes, crc.seconds)
+               << ", \"matchesTable\": " << (crc.matchesTable ? "true" : "false")
+               << " }";
+            first = false;
+        }
+        os << std::endl << "  ]";
+    }
+    os << std::endl << "}" << std::endl;
+}
+
+static void ShowHelp(const char* pProgramName)
+{
+    std::cout << pProgramName << " -i <input file> [options]" << std::endl
+              << "  -i, --input <file>       H.264/H.265 elementary stream, IVF (AV1/VP9) or MP4 file" << std::endl
+              << "  -o, --output <file>      JSON report file (default: stdout)" << std::endl
+              << "  --codec <name>           h264, h265, av1 or vp9, needed for elementary streams" << std::endl
+              << "  --loops <n>              Number of times to parse the stream (default: 1)" << std::endl
+              << "  --reuseParser            Reset the parser of the first loop for the next ones, instead of a new one" << std::endl
+              << "  --preparseThreads <n>    Split the stream into access units ahead of parsing" << std::endl
+              << "  --perNal                 Time each NAL unit type (H.264/H.265 elementary streams)" << std::endl
+              << "  --scanStartCodes         Measure the start code scan kernels of every supported ISA" << std::endl
+              << "  --bitReader              Parse the slice headers and SEI messages with the parser's bit reader and the" << std::endl
+              << "                           byte-at-a-time one it replaced (H.265 elementary streams)" << std::endl
+              << "  --crc                    Measure the frame CRCs of the output path on 8K 4:2:0 10-bit frames: the" << std::endl
+              << "                           Crc32Table loop, and getCRCs() with each CRC32 path of the CPU, for 1 and 4 seeds" << std::endl
+              << "  --isa <name>             Parser ISA: c, ssse3, avx2, avx512, neon or sve" << std::endl
+              << "  --hugePages              Back the bitstream buffers with 2 MB pages" << std::endl
+              << "  --metadata               Count the SEI messages / AV1 metadata OBUs of the pictures" << std::endl
+              << "  --stageTiming            Time the parsing stages in the parser statistics (adds clock reads per NAL unit)" << std::endl
+              << "  --resyncOnError          Skip to the next random access point after a stream error or a lost reference" << std::endl
+              << "  --decodeDelayUs <n>      Complete the stub decoding of each picture n us after the previous one, and wait" << std::endl
+              << "                           for each displayed frame in a consumer" << std::endl
+              << "  --parserLookahead <n>    Parse up to n frames (at most " << (uint32_t)MAX_PARSER_LOOKAHEAD << ") ahead of the consumer, on a thread of its own" << std::endl;
+}
+
+static bool ParseArgs(int argc, const char* argv[], BenchConfig& config)
+{
+    for (int i = 1; i < argc; i++) {
+        const std::string arg(argv[i]);
+        const bool hasValue = ((i + 1) < argc);
+        if ((arg == "-i" || arg == "--input") && hasValue) {
+            config.inputFileName = argv[++i];
+        } else if ((arg == "-o" || arg == "--output") && hasValue) {
+            config.outputFileName = argv[++i];
+        } else if ((arg == "--codec") && hasValue) {
+            const std::string codec(argv[++i]);
+            if (codec == "h264" || codec == "avc") {
+                config.codecType = VK_VIDEO_CODEC_OPERATION_DECODE_H264_BIT_KHR;
+            } else if (codec == "h265" || codec == "hevc") {
+                config.codecType = VK_VIDEO_CODEC_OPERATION_DECODE_H265_BIT_KHR;
+            } else if (codec == "av1") {
+                config.codecType = VK_VIDEO_CODEC_OPERATION_DECODE_AV1_BIT_KHR;
+            } else if (codec == "vp9") {
+                config.codecType = VK_VIDEO_CODEC_OPERATION_DECODE_VP9_BIT_KHR;
+            } else {
+                std::cerr << "Unknown codec " << codec << std::endl;
+                return false;
+            }
+        } else if ((arg == "--loops") && hasValue) {
+            config.numLoops = std::max(atoi(argv[++i]), 1);
+        } else if (arg == "--reuseParser") {
+            config.reuseParser = true;
+        } else if ((arg == "--preparseThreads") && hasValue) {
+            config.numPreparseThreads = std::max(atoi(argv[++i]), 0);
+        } else if ((arg == "--isa") && hasValue) {
+            config.simdIsaName = argv[++i];
+        } else if (arg == "--perNal") {
+            config.perNalTiming = true;
+        } else if (arg == "--scanStartCodes") {
+            config.scanStartCodes = true;
+        } else if (arg == "--bitReader") {
+            config.bitReader = true;
+        } else if (arg == "--crc") {
+            config.crc = true;
+        } else if (arg == "--hugePages") {
+            config.useHugePages = true;
+        } else if (arg == "--metadata") {
+            config.pictureMetadata = true;
+        } else if (arg == "--stageTiming") {
+            config.stageTiming = true;
+        } else if (arg == "--resyncOnError") {
+            config.resyncOnError = true;
+        } else if ((arg == "--decodeDelayUs") && hasValue) {
+            config.decodeDelayUs = (uint32_t)std::max(atoi(argv[++i]), 0);
+        } else if ((arg == "--parserLookahead") && hasValue) {
+            config.parserLookahead = std::min<uint32_t>(std::max(atoi(argv[++i]), 0), MAX_PARSER_LOOKAHEAD);
+        } else {
+            ShowHelp(argv[0]);
+            return false;
+        }
+    }
+    if (config.inputFileName.empty()) {
+        ShowHelp(argv[0]);
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, const char* argv[])
+{
+    BenchConfig config = BenchConfig();
+    config.codecType = VK_VIDEO_CODEC_OPERATION_NONE_KHR;
+    config.numLoops = 1;
+    if (!ParseArgs(argc, argv, config)) {
+        return EXIT_FAILURE;
+    }
+
+    const SIMD_ISA detectedIsa = check_simd_support();
+    if (!config.simdIsaName.empty()) {
+        // Read by the parser when it is initialized
+#if defined(_WIN32)
+        _putenv_s("VK_VIDEO_PARSER_SIMD_ISA", config.simdIsaName.c_str());
+#else
+        setenv("VK_VIDEO_PARSER_SIMD_ISA", config.simdIsaName.c_str(), 1);
+#endif
+    }
+    const SIMD_ISA parserIsa = check_simd_support();
+    if (!config.simdIsaName.empty() && (config.simdIsaName != SimdIsaToName(parserIsa))) {
+        std::cerr << "ISA " << config.simdIsaName << " is not supported, using " << SimdIsaToName(parserIsa) << std::endl;
+    }
+
+    if ((config.codecType == VK_VIDEO_CODEC_OPERATION_NONE_KHR) &&
+        !IvfDemuxerCheckFile(config.inputFileName.c_str()) && !Mp4DemuxerCheckFile(config.inputFileName.c_str())) {
+        std::cerr << "The codec of an elementary stream must be set with --codec" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    VkSharedBaseObj<VideoStreamDemuxer> demuxer;
+    VkResult result = VideoStreamDemuxer::Create(config.inputFileName.c_str(), config.codecType,
+                                                 true, 1920, 1080, 8, demuxer);
+    if (result != VK_SUCCESS) {
+        std::cerr << "Can't open " << config.inputFileName << std::endl;
+        return EXIT_FAILURE;
+    }
+    if (config.numPreparseThreads > 0) {
+        demuxer->PreparseAccessUnits(config.numPreparseThreads, nullptr);
+    }
+
+    const VkVideoCodecOperationFlagBitsKHR codecType = demuxer->GetVideoCodec();
+    const bool isAnnexB = ((codecType == VK_VIDEO_CODEC_OPERATION_DECODE_H264_BIT_KHR) ||
+                           (codecType == VK_VIDEO_CODEC_OPERATION_DECODE_H265_BIT_KHR)) &&
+                          (demuxer->GetNalLengthSize() == 0);
+    if (config.perNalTiming && !isAnnexB) {
+        std::cerr << "Per NAL unit timing needs an H.264/H.265 Annex-B stream, ignored" << std::endl;
+        config.perNalTiming = false;
+    }
+
+    if (config.bitReader && (!isAnnexB || (codecType != VK_VIDEO_CODEC_OPERATION_DECODE_H265_BIT_KHR))) {
+        std::cerr << "The bit reader benchmark needs an H.265 Annex-B stream, ignored" << std::endl;
+        config.bitReader = false;
+    }
+
+    std::vector<uint8_t> streamData;
+    if (config.perNalTiming || config.scanStartCodes || config.bitReader) {
+        ReadStream(demuxer, streamData);
+    }
+
+    BenchResults results = BenchResults();
+    if (!RunBenchmark(config, demuxer, streamData, results)) {
+        return EXIT_FAILURE;
+    }
+
+    std::vector<StartCodeScanResult> scanResults;
+    if (config.scanStartCodes) {
+        scanResults = RunStartCodeScans(streamData, detectedIsa);
+    }
+
+    std::vector<BitReaderResult> bitReaderResults;
+    if (config.bitReader) {
+        bitReaderResults = RunBitReaders(streamData);
+    }
+
+    std::vector<CrcResult> crcResults;
+    if (config.crc) {
+        crcResults = RunCrcs();
+    }
+
+    if (config.outputFileName.empty()) {
+        WriteJson(std::cout, config, results, parserIsa, scanResults, bitReaderResults, crcResults);
+    } else {
+        std::ofstream outputFile(config.outputFileName);
+        if (!outputFile) {
+            std::cerr << "Can't write " << config.outputFileName << std::endl;
+            return EXIT_FAILURE;
+        }
+        WriteJson(outputFile, config, results, parserIsa, scanResults, bitReaderResults, crcResults);
+    }
+
+    return EXIT_SUCCESS;
+}
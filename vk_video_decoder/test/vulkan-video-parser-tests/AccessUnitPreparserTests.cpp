@@ -0,0 +1,298 @@
+/*
+ * Copyright 2024 NVIDIA Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// The parallel Annex-B preparse: start codes and NAL unit headers straddling the edge of two
+// scanned chunks, trailing_zero_8bits, the non-VCL NAL units that end an access unit, and the
+// merged index, which must not depend on the number of threads.
+
+#include <string.h>
+#include <vector>
+
+#include "ParserTests.h"
+#include "VkDecoderUtils/AccessUnitPreparser.h"
+
+// AccessUnitPreparser scans chunks of at least 1 MiB
+static const size_t s_minChunkSize = 1024 * 1024;
+
+// NAL units with a header the preparser classifies, followed by filler bytes that hold no start code.
+class AnnexBWriter
+{
+public:
+    AnnexBWriter() : m_stream(), m_accessUnits(), m_trailingZeros(0) {}
+
+    // The NAL unit starts a new access unit, which begins after the trailing zeros of the previous one
+    void StartAccessUnit() { m_accessUnits.push_back(m_stream.size() - m_trailingZeros); }
+
+    void Nal(const std::vector<uint8_t>& header, size_t size, bool zeroByte = true, uint32_t trailingZeros = 0)
+    {
+        if (zeroByte) {
+            m_stream.push_back(0);
+        }
+        m_stream.push_back(0);
+        m_stream.push_back(0);
+        m_stream.push_back(1);
+        m_stream.insert(m_stream.end(), header.begin(), header.end());
+        for (size_t i = header.size(); i < size; i++) {
+            m_stream.push_back((uint8_t)(0xa0 + (i & 0xf)));
+        }
+        m_stream.insert(m_stream.end(), trailingZeros, 0);
+        m_trailingZeros = trailingZeros;
+    }
+
+    size_t Size() const { return m_stream.size(); }
+    const std::vector<uint8_t>& Stream() const { return m_stream; }
+    const std::vector<size_t>& AccessUnits() const { return m_accessUnits; }
+
+private:
+    std::vector<uint8_t> m_stream;
+    std::vector<size_t>  m_accessUnits; // Expected offset of each access unit
+    uint32_t             m_trailingZeros;
+};
+
+static const std::vector<uint8_t> s_h264Sps = { 0x67, 0x42, 0x00, 0x1e, 0xac };
+static const std::vector<uint8_t> s_h264Pps = { 0x68, 0xce };
+static const std::vector<uint8_t> s_h264Sei = { 0x06, 0x05 };
+static const std::vector<uint8_t> s_h264IdrSlice = { 0x65, 0x88 };   // first_mb_in_slice 0
+static const std::vector<uint8_t> s_h264PSlice = { 0x41, 0x9a };     // first_mb_in_slice 0
+static const std::vector<uint8_t> s_h264NextSlice = { 0x41, 0x42 };  // first_mb_in_slice 1
+static const std::vector<uint8_t> s_h264EndOfSeq = { 0x0a };
+static const std::vector<uint8_t> s_h264EndOfStream = { 0x0b };
+
+static void WriteH264Idr(AnnexBWriter& writer, size_t sliceSize, bool zeroByte = true, uint32_t trailingZeros = 0)
+{
+    writer.StartAccessUnit();
+    writer.Nal(s_h264Sps, 16);
+    writer.Nal(s_h264Pps, 8);
+    writer.Nal(s_h264IdrSlice, sliceSize, zeroByte, trailingZeros);
+}
+
+static bool PreparseH264(const std::vector<uint8_t>& stream, uint32_t numThreads, VkVideoStreamIndex& index)
+{
+    return AccessUnitPreparser::Preparse(VK_VIDEO_CODEC_OPERATION_DECODE_H264_BIT_KHR,
+                                         stream.data(), stream.size(), numThreads, index);
+}
+
+static void CheckAccessUnitOffsets(const VkVideoStreamIndex& index, const AnnexBWriter& writer)
+{
+    TEST_REQUIRE(index.accessUnits.size() == writer.AccessUnits().size());
+    for (size_t i = 0; i < index.accessUnits.size(); i++) {
+        TEST_CHECK(index.accessUnits[i].offset == (int64_t)writer.AccessUnits()[i]);
+        const int64_t end = ((i + 1) < index.accessUnits.size()) ? (int64_t)writer.AccessUnits()[i + 1] : (int64_t)writer.Size();
+        TEST_CHECK(index.accessUnits[i].size == (end - index.accessUnits[i].offset));
+    }
+}
+
+static void CheckSameIndex(const VkVideoStreamIndex& a, const VkVideoStreamIndex& b)
+{
+    TEST_CHECK(a.streamSize == b.streamSize);
+    TEST_REQUIRE(a.accessUnits.size() == b.accessUnits.size());
+    for (size_t i = 0; i < a.accessUnits.size(); i++) {
+        TEST_CHECK(a.accessUnits[i].offset == b.accessUnits[i].offset);
+        TEST_CHECK(a.accessUnits[i].size == b.accessUnits[i].size);
+        TEST_CHECK(a.accessUnits[i].isIrap == b.accessUnits[i].isIrap);
+        TEST_CHECK(a.accessUnits[i].isRasl == b.accessUnits[i].isRasl);
+    }
+    TEST_REQUIRE(a.randomAccessPoints.size() == b.randomAccessPoints.size());
+    for (size_t i = 0; i < a.randomAccessPoints.size(); i++) {
+        TEST_CHECK(a.randomAccessPoints[i].accessUnit == b.randomAccessPoints[i].accessUnit);
+        TEST_CHECK(a.randomAccessPoints[i].firstParameterSet == b.randomAccessPoints[i].firstParameterSet);
+        TEST_CHECK(a.randomAccessPoints[i].numParameterSets == b.randomAccessPoints[i].numParameterSets);
+    }
+    TEST_REQUIRE(a.parameterSets.size() == b.parameterSets.size());
+    for (size_t i = 0; i < a.parameterSets.size(); i++) {
+        TEST_CHECK(a.parameterSets[i].offset == b.parameterSets[i].offset);
+        TEST_CHECK(a.parameterSets[i].size == b.parameterSets[i].size);
+    }
+}
+
+// A 2 MiB stream scanned as two chunks by two threads, with the start code of a picture at every
+// position around the edge of the chunks: from the zero_byte before the edge to the NAL unit
+// header after it, with and without zero_byte and trailing_zero_8bits.
+PARSER_TEST(AccessUnitPreparserChunkEdgeStartCodes)
+{
+    const size_t streamSize = 2 * s_minChunkSize + 4096;
+    const size_t chunkSize = (streamSize + 1) / 2;
+    for (uint32_t shift = 0; shift <= 6; shift++) {
+        for (uint32_t zeroByte = 0; zeroByte < 2; zeroByte++) {
+            for (uint32_t trailingZeros = 0; trailingZeros <= 2; trailingZeros += 2) {
+                // The IDR slice, after the SPS, the PPS and its start code, ends where the P picture starts
+                const size_t startCodeOffset = chunkSize - shift;
+                AnnexBWriter writer;
+                WriteH264Idr(writer, startCodeOffset - trailingZeros - (20 + 12 + 4), true, trailingZeros);
+                TEST_REQUIRE(writer.Size() == startCodeOffset);
+
+                writer.StartAccessUnit();
+                writer.Nal(s_h264PSlice, 64, zeroByte != 0);
+                writer.Nal(s_h264NextSlice, 64);
+                writer.StartAccessUnit();
+                writer.Nal(s_h264PSlice, streamSize - writer.Size() - 4);
+                TEST_REQUIRE(writer.Size() == streamSize);
+
+                VkVideoStreamIndex singleThread, twoThreads;
+                TEST_REQUIRE(PreparseH264(writer.Stream(), 1, singleThread));
+                TEST_REQUIRE(PreparseH264(writer.Stream(), 2, twoThreads));
+                CheckAccessUnitOffsets(singleThread, writer);
+                CheckAccessUnitOffsets(twoThreads, writer);
+                CheckSameIndex(singleThread, twoThreads);
+            }
+        }
+    }
+}
+
+// The parameter sets at the edge of the chunks: their sizes exclude the zero_byte of the next
+// start code and the trailing_zero_8bits, whichever chunk these fall into.
+PARSER_TEST(AccessUnitPreparserChunkEdgeParameterSets)
+{
+    const size_t streamSize = 2 * s_minChunkSize + 4096;
+    const size_t chunkSize = (streamSize + 1) / 2;
+    for (uint32_t shift = 0; shift <= 32; shift++) {
+        // The second IDR picture resends the SPS and PPS at chunkSize - shift
+        AnnexBWriter writer;
+        WriteH264Idr(writer, chunkSize - shift - (20 + 12 + 4) - 9);
+        writer.StartAccessUnit();
+        writer.Nal(s_h264PSlice, 5);
+        TEST_REQUIRE(writer.Size() == (chunkSize - shift));
+        writer.StartAccessUnit();
+        writer.Nal(s_h264Sps, 16, true, 3);
+        writer.Nal(s_h264Pps, 8, false, 1);
+        writer.Nal(s_h264IdrSlice, 16);
+        WriteH264Idr(writer, streamSize - writer.Size() - (20 + 12 + 4));
+        TEST_REQUIRE(writer.Size() == streamSize);
+
+        VkVideoStreamIndex singleThread, twoThreads;
+        TEST_REQUIRE(PreparseH264(writer.Stream(), 1, singleThread));
+        TEST_REQUIRE(PreparseH264(writer.Stream(), 2, twoThreads));
+        CheckAccessUnitOffsets(twoThreads, writer);
+        CheckSameIndex(singleThread, twoThreads);
+
+        // The third IDR picture is preceded by the SPS and PPS of the second one, their start
+        // code prefix included
+        TEST_REQUIRE(twoThreads.randomAccessPoints.size() == 3);
+        const VkVideoRandomAccessPoint& rap = twoThreads.randomAccessPoints[2];
+        TEST_REQUIRE(rap.numParameterSets == 2);
+        const VkVideoStreamRange& sps = twoThreads.parameterSets[rap.firstParameterSet];
+        const VkVideoStreamRange& pps = twoThreads.parameterSets[rap.firstParameterSet + 1];
+        TEST_CHECK((sps.offset == (int64_t)(chunkSize - shift + 1)) && (sps.size == 3 + 16));
+        TEST_CHECK((pps.offset == (sps.offset + 16 + 3 + 3)) && (pps.size == 3 + 8));
+    }
+}
+
+// Non-VCL NAL units after the last VCL NAL unit of a picture belong to its access unit: end of
+// sequence before an IDR picture, end of sequence and end of stream at the end of the stream.
+PARSER_TEST(AccessUnitPreparserEndOfSequence)
+{
+    AnnexBWriter writer;
+    WriteH264Idr(writer, 100);
+    writer.StartAccessUnit();
+    writer.Nal(s_h264PSlice, 100);
+    writer.Nal(s_h264EndOfSeq, 1);
+    WriteH264Idr(writer, 100, false, 1);
+    writer.StartAccessUnit();
+    writer.Nal(s_h264Sei, 20);
+    writer.Nal(s_h264PSlice, 100);
+    writer.Nal(s_h264NextSlice, 100);
+    writer.Nal(s_h264EndOfSeq, 1);
+    writer.Nal(s_h264EndOfStream, 1, true, 2);
+
+    VkVideoStreamIndex index;
+    TEST_REQUIRE(PreparseH264(writer.Stream(), 1, index));
+    CheckAccessUnitOffsets(index, writer);
+    TEST_REQUIRE(index.accessUnits.size() == 4);
+    TEST_CHECK(index.accessUnits[0].isIrap && index.accessUnits[2].isIrap);
+    TEST_CHECK(!index.accessUnits[1].isIrap && !index.accessUnits[3].isIrap);
+}
+
+// H.265: a suffix SEI after the last slice of a picture, end of sequence and end of bitstream
+PARSER_TEST(AccessUnitPreparserH265SuffixNalUnits)
+{
+    static const std::vector<uint8_t> vps = { 0x40, 0x01, 0x0c };
+    static const std::vector<uint8_t> sps = { 0x42, 0x01, 0x01, 0x01, 0x60, 0x90, 0x90, 0x90, 0x90, 0x90,
+                                              0x90, 0x90, 0x90, 0x90, 0x5d, 0xa0 };
+    static const std::vector<uint8_t> pps = { 0x44, 0x01, 0xc1 };
+    static const std::vector<uint8_t> idrSlice = { 0x26, 0x01, 0x80 };   // first_slice_segment_in_pic_flag
+    static const std::vector<uint8_t> trailSlice = { 0x02, 0x01, 0x80 };
+    static const std::vector<uint8_t> nextSlice = { 0x02, 0x01, 0x00 };
+    static const std::vector<uint8_t> suffixSei = { 0x50, 0x01 };
+    static const std::vector<uint8_t> endOfSeq = { 0x48, 0x01 };
+    static const std::vector<uint8_t> endOfBitstream = { 0x4a, 0x01 };
+
+    AnnexBWriter writer;
+    writer.StartAccessUnit();
+    writer.Nal(vps, 24);
+    writer.Nal(sps, 32);
+    writer.Nal(pps, 8);
+    writer.Nal(idrSlice, 100);
+    writer.Nal(suffixSei, 10);
+    writer.StartAccessUnit();
+    writer.Nal(trailSlice, 100);
+    writer.Nal(nextSlice, 100);
+    writer.Nal(suffixSei, 10, false);
+    writer.StartAccessUnit();
+    writer.Nal(trailSlice, 100);
+    writer.Nal(suffixSei, 10);
+    writer.Nal(endOfSeq, 2);
+    writer.Nal(endOfBitstream, 2, true, 1);
+
+    VkVideoStreamIndex index;
+    TEST_REQUIRE(AccessUnitPreparser::Preparse(VK_VIDEO_CODEC_OPERATION_DECODE_H265_BIT_KHR,
+                                               writer.Stream().data(), writer.Size(), 1, index));
+    CheckAccessUnitOffsets(index, writer);
+    TEST_REQUIRE(index.randomAccessPoints.size() == 1);
+    TEST_CHECK(index.accessUnits[0].isIrap);
+}
+
+// A stream of about 13 MiB with pictures of varying sizes and slice counts, SEI, both start code
+// lengths and trailing_zero_8bits: the same index for any number of threads, scanned as 8, 12
+// and 13 chunks by 2, 3 and 4 or more threads.
+PARSER_TEST(AccessUnitPreparserThreadCount)
+{
+    AnnexBWriter writer;
+    uint32_t random = 1;
+    auto nextRandom = [&random](uint32_t range) {
+        random = random * 1103515245 + 12345;
+        return (random >> 16) % range;
+    };
+    uint32_t numPictures = 0;
+    while (writer.Size() < (13 * s_minChunkSize + 12345)) {
+        const bool zeroByte = (nextRandom(2) != 0);
+        const uint32_t trailingZeros = (nextRandom(4) == 0) ? nextRandom(4) : 0;
+        if ((numPictures % 30) == 0) {
+            WriteH264Idr(writer, 1 + nextRandom(60000), zeroByte, trailingZeros);
+        } else {
+            writer.StartAccessUnit();
+            if (nextRandom(3) == 0) {
+                writer.Nal(s_h264Sei, 2 + nextRandom(40), zeroByte);
+            }
+            writer.Nal(s_h264PSlice, 2 + nextRandom(20000), zeroByte, trailingZeros);
+            for (uint32_t slices = nextRandom(4); slices > 0; slices--) {
+                writer.Nal(s_h264NextSlice, 2 + nextRandom(20000), nextRandom(2) != 0, nextRandom(2));
+            }
+        }
+        numPictures++;
+    }
+    TEST_REQUIRE(writer.Size() > 2 * s_minChunkSize);
+
+    VkVideoStreamIndex singleThread;
+    TEST_REQUIRE(PreparseH264(writer.Stream(), 1, singleThread));
+    TEST_CHECK(singleThread.accessUnits.size() == numPictures);
+    CheckAccessUnitOffsets(singleThread, writer);
+    const uint32_t numThreads[] = { 2, 3, 4, 16 };
+    for (uint32_t threads : numThreads) {
+        VkVideoStreamIndex index;
+        TEST_REQUIRE(PreparseH264(writer.Stream(), threads, index));
+        CheckSameIndex(singleThread, index);
+    }
+}
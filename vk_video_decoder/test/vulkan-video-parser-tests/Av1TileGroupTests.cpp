@@ -0,0 +1,459 @@
+/*
+ * Copyright 2024 NVIDIA Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// DecodeTileInfo() and ParseObuTileGroup() on synthetic tile info and tile group OBUs: the tiles
+// of a frame, more of them than the former fixed size tile table held, spread over several tile
+// groups, and the tile groups the parser must reject before they write past the tile table.
+
+#include <algorithm>
+#include <vector>
+
+#include "ParserTests.h"
+#include "VulkanAV1Decoder.h"
+
+// Tile group OBU payload, along with the tiles it carries
+struct TileGroupPayload {
+    std::vector<uint8_t>  data;
+    std::vector<uint32_t> tileOffsets; // Offset of the data of each tile in the payload
+    std::vector<uint32_t> tileSizes;
+};
+
+class TileGroupWriter
+{
+public:
+    TileGroupWriter() : m_data(), m_numBits(0) {}
+
+    void PutBits(uint32_t value, uint32_t numBits)
+    {
+        for (uint32_t i = numBits; i > 0; i--) {
+            if ((m_numBits & 7) == 0) {
+                m_data.push_back(0);
+            }
+            m_data.back() |= (uint8_t)(((value >> (i - 1)) & 1) << (7 - (m_numBits & 7)));
+            m_numBits++;
+        }
+    }
+
+    void ByteAlign() { m_numBits = (m_numBits + 7) & ~7u; }
+
+    void PutBytes(uint64_t value, uint32_t numBytes) // Little endian, as le(n)
+    {
+        for (uint32_t i = 0; i < numBytes; i++) {
+            PutBits((uint32_t)(value >> (8 * i)) & 0xff, 8);
+        }
+    }
+
+    std::vector<uint8_t>& Data() { return m_data; }
+    uint32_t NumBits() const { return m_numBits; }
+
+private:
+    std::vector<uint8_t> m_data;
+    uint32_t             m_numBits;
+};
+
+static uint32_t TileDataSize(uint32_t tileNum)
+{
+    return 1 + ((tileNum * 7) % 23);
+}
+
+// Tile group OBU payload for the tiles [tgStart, tgEnd] of a frame of numTiles tiles
+static TileGroupPayload BuildTileGroup(uint32_t numTiles, uint32_t log2NumTiles, uint32_t tgStart, uint32_t tgEnd,
+                                       uint32_t tileSizeBytes)
+{
+    TileGroupWriter writer;
+    if (numTiles > 1) {
+        const bool tileStartAndEndPresent = (tgStart != 0) || (tgEnd != (numTiles - 1));
+        writer.PutBits(tileStartAndEndPresent ? 1 : 0, 1);
+        if (tileStartAndEndPresent) {
+            writer.PutBits(tgStart, log2NumTiles);
+            writer.PutBits(tgEnd, log2NumTiles);
+        }
+    }
+    writer.ByteAlign();
+
+    TileGroupPayload payload;
+    for (uint32_t tileNum = tgStart; tileNum <= tgEnd; tileNum++) {
+        const uint32_t tileSize = TileDataSize(tileNum);
+        if (tileNum != tgEnd) {
+            writer.PutBytes(tileSize - 1, tileSizeBytes);
+        }
+        payload.tileOffsets.push_back((uint32_t)writer.Data().size());
+        payload.tileSizes.push_back(tileSize);
+        for (uint32_t i = 0; i < tileSize; i++) {
+            writer.PutBits(tileNum & 0xff, 8);
+        }
+    }
+    payload.data = writer.Data();
+    return payload;
+}
+
+// Feeds the tile info of a frame header to DecodeTileInfo(), and the tile group OBUs straight to ParseObuTileGroup()
+class Av1TileGroupParser : public VulkanAV1Decoder
+{
+public:
+    Av1TileGroupParser()
+        : VulkanAV1Decoder(VK_VIDEO_CODEC_OPERATION_DECODE_AV1_BIT_KHR)
+    {
+        m_bNoStartCodes = true;
+        m_bEmulBytesPresent = false;
+        av1_seq_param_s::Create(0, m_sps);
+    }
+
+    // Runs DecodeTileInfo() on the tile_info() syntax of a frame of the given size, and checks that it reads all of it
+    bool ParseTileInfo(TileGroupWriter& tileInfo, uint16_t frameWidth, uint16_t frameHeight, bool use128x128Superblock)
+    {
+        m_sps->flags.use_128x128_superblock = use128x128Superblock ? 1 : 0;
+        frame_width = frameWidth;
+        frame_height = frameHeight;
+
+        m_tileInfo = tileInfo.Data();
+        m_nalu = NvVkNalUnit();
+        m_nalu.rbsp = m_tileInfo.data();
+        m_nalu.rbsp_size = m_tileInfo.size();
+        return DecodeTileInfo() && (consumed_bits() == (int32_t)tileInfo.NumBits());
+    }
+
+    // Parses the first payloadSize bytes of a tile group OBU payload at obuOffset in the bitstream buffer
+    bool ParseTileGroup(const TileGroupPayload& payload, uint32_t obuOffset, uint32_t payloadSize)
+    {
+        AV1ObuHeader hdr = AV1ObuHeader();
+        hdr.type = AV1_OBU_TILE_GROUP;
+        hdr.payload_size = payloadSize;
+
+        m_nalu = NvVkNalUnit();
+        m_nalu.start_offset = obuOffset;
+        m_nalu.end_offset = obuOffset + payloadSize;
+        m_nalu.get_offset = m_nalu.end_offset;
+        m_nalu.rbsp = payload.data.data();
+        m_nalu.rbsp_size = payloadSize;
+        return ParseObuTileGroup(hdr);
+    }
+
+    bool ParseTileGroup(const TileGroupPayload& payload, uint32_t obuOffset)
+    {
+        return ParseTileGroup(payload, obuOffset, (uint32_t)payload.data.size());
+    }
+
+    uint32_t GetTileCols() const { return m_PicData.tileInfo.TileCols; }
+    uint32_t GetTileRows() const { return m_PicData.tileInfo.TileRows; }
+    uint32_t GetContextUpdateTileId() const { return m_PicData.tileInfo.context_update_tile_id; }
+    uint32_t GetTileSizeBytes() const { return tile_size_bytes_minus_1 + 1u; }
+    uint32_t GetTileCount() const { return m_PicData.khr_info.tileCount; }
+    uint32_t GetNumTiles() const { return (uint32_t)m_PicData.tileInfo.TileCols * m_PicData.tileInfo.TileRows; }
+    uint32_t GetLog2NumTiles() const { return log2_tile_cols + log2_tile_rows; }
+    uint32_t GetTileOffset(uint32_t tileNum) const { return m_PicData.tileOffsets[tileNum]; }
+    uint32_t GetTileSize(uint32_t tileNum) const { return m_PicData.tileSizes[tileNum]; }
+    size_t GetTileTableSize() const { return m_tileTable.size(); }
+
+    // The tile offsets, then the tile sizes of the frame, both in the tile table
+    bool TileTableInUse() const
+    {
+        return (m_PicData.tileOffsets == m_tileTable.data()) &&
+               (m_PicData.tileSizes == (m_tileTable.data() + GetNumTiles())) &&
+               (m_tileTable.size() >= (2 * (size_t)GetNumTiles()));
+    }
+
+private:
+    std::vector<uint8_t> m_tileInfo;
+};
+
+static uint32_t Log2(uint32_t n)
+{
+    uint32_t k = 0;
+    while ((1u << k) < n) {
+        k++;
+    }
+    return k;
+}
+
+// ns(n) of the AV1 spec
+static void PutUniform(TileGroupWriter& writer, uint32_t value, uint32_t n)
+{
+    uint32_t w = 0;
+    while ((n >> w) > 1) {
+        w++;
+    }
+    w++;
+    const uint32_t m = (1u << w) - n;
+    if (value < m) {
+        writer.PutBits(value, w - 1);
+    } else {
+        writer.PutBits((value + m) >> 1, w - 1);
+        writer.PutBits((value + m) & 1, 1);
+    }
+}
+
+// tile_info() of a frame of tileCols x tileRows 64x64 superblocks, with a tile per superblock: the
+// tile sizes are coded explicitly, as uniform tile spacing cannot give tile counts that are not a power of two
+static TileGroupWriter BuildTileInfo(uint32_t tileCols, uint32_t tileRows, uint32_t tileSizeBytes, uint32_t contextUpdateTileId)
+{
+    const uint32_t maxTileWidthSb = 64;
+    const uint32_t maxTileAreaSb = 2304;
+    const uint32_t numSuperblocks = tileCols * tileRows;
+    const uint32_t minLog2Tiles = std::max(Log2((tileCols + maxTileWidthSb - 1) / maxTileWidthSb),
+                                           Log2((numSuperblocks + maxTileAreaSb - 1) / maxTileAreaSb));
+    const uint32_t maxTileHeightSb = (minLog2Tiles > 0) ? (numSuperblocks >> (minLog2Tiles + 1)) : numSuperblocks;
+
+    TileGroupWriter writer;
+    writer.PutBits(0, 1); // uniform_tile_spacing_flag
+    for (uint32_t col = 0; col < tileCols; col++) {
+        const uint32_t maxWidth = std::min(tileCols - col, maxTileWidthSb);
+        if (maxWidth > 1) {
+            PutUniform(writer, 0, maxWidth); // width_in_sbs_minus_1
+        }
+    }
+    for (uint32_t row = 0; row < tileRows; row++) {
+        const uint32_t maxHeight = std::min(tileRows - row, std::max(maxTileHeightSb, 1u));
+        if (maxHeight > 1) {
+            PutUniform(writer, 0, maxHeight); // height_in_sbs_minus_1
+        }
+    }
+    if ((tileCols * tileRows) > 1) {
+        writer.PutBits(contextUpdateTileId, Log2(tileCols) + Log2(tileRows));
+        writer.PutBits(tileSizeBytes - 1, 2);
+    }
+    return writer;
+}
+
+// Decodes the tile info of a frame of tileCols x tileRows tiles, and checks the tile table it leaves to the tile groups
+static void BeginFrame(Av1TileGroupParser& parser, uint32_t tileCols, uint32_t tileRows, uint32_t tileSizeBytes)
+{
+    const uint32_t numTiles = tileCols * tileRows;
+    const uint32_t contextUpdateTileId = numTiles / 3;
+    const size_t tileTableSize = std::max(parser.GetTileTableSize(), 2 * (size_t)numTiles);
+    TileGroupWriter tileInfo = BuildTileInfo(tileCols, tileRows, tileSizeBytes, contextUpdateTileId);
+    TEST_REQUIRE(parser.ParseTileInfo(tileInfo, (uint16_t)(tileCols * 64), (uint16_t)(tileRows * 64), false));
+
+    TEST_REQUIRE(parser.GetTileCols() == tileCols);
+    TEST_REQUIRE(parser.GetTileRows() == tileRows);
+    TEST_CHECK(parser.GetLog2NumTiles() == (Log2(tileCols) + Log2(tileRows)));
+    TEST_CHECK(parser.GetContextUpdateTileId() == contextUpdateTileId);
+    TEST_CHECK(parser.GetTileSizeBytes() == tileSizeBytes);
+    TEST_CHECK(parser.GetTileCount() == 0);
+    TEST_CHECK(parser.GetTileTableSize() == tileTableSize);
+    TEST_REQUIRE(parser.TileTableInUse());
+}
+
+// Parses the frame in tile groups ending at the given tiles, and checks every tile of the table
+static void ParseFrameInTileGroups(Av1TileGroupParser& parser, const std::vector<uint32_t>& tileGroupEnds,
+                                   uint32_t tileSizeBytes)
+{
+    const uint32_t numTiles = parser.GetNumTiles();
+    const uint32_t obuHeaderSize = 2;
+    uint32_t obuOffset = 0;
+    uint32_t tgStart = 0;
+    std::vector<uint32_t> tileOffsets;
+    std::vector<uint32_t> tileSizes;
+    for (size_t i = 0; i < tileGroupEnds.size(); i++) {
+        const uint32_t tgEnd = tileGroupEnds[i];
+        const TileGroupPayload payload = BuildTileGroup(numTiles, parser.GetLog2NumTiles(), tgStart, tgEnd, tileSizeBytes);
+        obuOffset += obuHeaderSize;
+        for (size_t tile = 0; tile < payload.tileOffsets.size(); tile++) {
+            tileOffsets.push_back(obuOffset + payload.tileOffsets[tile]);
+            tileSizes.push_back(payload.tileSizes[tile]);
+        }
+
+        // Only the last tile group of the frame completes it
+        TEST_CHECK(parser.ParseTileGroup(payload, obuOffset) == (tgEnd == (numTiles - 1)));
+        TEST_REQUIRE(parser.GetTileCount() == (tgEnd + 1));
+        obuOffset += (uint32_t)payload.data.size();
+        tgStart = tgEnd + 1;
+    }
+
+    TEST_REQUIRE(parser.GetTileCount() == numTiles);
+    for (uint32_t tileNum = 0; tileNum < numTiles; tileNum++) {
+        TEST_CHECK(parser.GetTileOffset(tileNum) == tileOffsets[tileNum]);
+        TEST_CHECK(parser.GetTileSize(tileNum) == tileSizes[tileNum]);
+    }
+}
+
+PARSER_TEST(Av1TileGroupsOver64Tiles)
+{
+    Av1TileGroupParser parser;
+    BeginFrame(parser, 16, 8, 2);
+    ParseFrameInTileGroups(parser, { 40, 99, 127 }, 2);
+
+    // Tile counts that are not a power of two, in tile groups of one tile
+    BeginFrame(parser, 10, 7, 1);
+    std::vector<uint32_t> tileGroupEnds;
+    for (uint32_t tileNum = 0; tileNum < 70; tileNum++) {
+        tileGroupEnds.push_back(tileNum);
+    }
+    ParseFrameInTileGroups(parser, tileGroupEnds, 1);
+}
+
+PARSER_TEST(Av1TileGroupsMaxTileCount)
+{
+    Av1TileGroupParser parser;
+    BeginFrame(parser, 64, 64, 4);
+    TEST_CHECK(parser.GetTileTableSize() == (2 * 4096));
+    ParseFrameInTileGroups(parser, { 1000, 4094, 4095 }, 4);
+
+    // A single tile group, without tile_start_and_end_present_flag
+    BeginFrame(parser, 64, 64, 3);
+    ParseFrameInTileGroups(parser, { 4095 }, 3);
+
+    // A smaller frame keeps the table of the largest one
+    BeginFrame(parser, 2, 2, 1);
+    TEST_CHECK(parser.GetTileTableSize() == (2 * 4096));
+    ParseFrameInTileGroups(parser, { 0, 3 }, 1);
+}
+
+PARSER_TEST(Av1TileInfoUniformSpacing)
+{
+    Av1TileGroupParser parser;
+
+    // 1920x1080 in 30x17 superblocks of 64x64: 4 tile columns of 8 superblocks, 2 tile rows of 9
+    TileGroupWriter tileInfo;
+    tileInfo.PutBits(1, 1);    // uniform_tile_spacing_flag
+    tileInfo.PutBits(0x6, 3);  // increment_tile_cols_log2 1, 1, 0
+    tileInfo.PutBits(0x2, 2);  // increment_tile_rows_log2 1, 0
+    tileInfo.PutBits(5, 3);    // context_update_tile_id
+    tileInfo.PutBits(1, 2);    // tile_size_bytes_minus_1
+    TEST_REQUIRE(parser.ParseTileInfo(tileInfo, 1920, 1080, false));
+    TEST_CHECK(parser.GetTileCols() == 4);
+    TEST_CHECK(parser.GetTileRows() == 2);
+    TEST_CHECK(parser.GetLog2NumTiles() == 3);
+    TEST_CHECK(parser.GetContextUpdateTileId() == 5);
+    TEST_CHECK(parser.GetTileSizeBytes() == 2);
+    TEST_CHECK(parser.GetTileTableSize() == (2 * 8));
+    TEST_REQUIRE(parser.TileTableInUse());
+    ParseFrameInTileGroups(parser, { 2, 7 }, 2);
+
+    // 4096x2176 in 32x17 superblocks of 128x128, at the largest tile_cols_log2 and tile_rows_log2: a tile
+    // per superblock, so 544 tiles, with no increment bit past the largest values
+    tileInfo = TileGroupWriter();
+    tileInfo.PutBits(1, 1);
+    tileInfo.PutBits(0x1f, 5);
+    tileInfo.PutBits(0x1f, 5);
+    tileInfo.PutBits(543, 10);
+    tileInfo.PutBits(3, 2);
+    TEST_REQUIRE(parser.ParseTileInfo(tileInfo, 4096, 2176, true));
+    TEST_CHECK(parser.GetTileCols() == 32);
+    TEST_CHECK(parser.GetTileRows() == 17);
+    TEST_CHECK(parser.GetLog2NumTiles() == 10);
+    TEST_CHECK(parser.GetContextUpdateTileId() == 543);
+    TEST_CHECK(parser.GetTileSizeBytes() == 4);
+    TEST_CHECK(parser.GetTileTableSize() == (2 * 544));
+    TEST_REQUIRE(parser.TileTableInUse());
+    ParseFrameInTileGroups(parser, { 63, 64, 500, 543 }, 4);
+
+    // A single tile: neither context_update_tile_id nor tile_size_bytes_minus_1, and the table of the largest frame
+    tileInfo = TileGroupWriter();
+    tileInfo.PutBits(1, 1);
+    tileInfo.PutBits(0, 1);
+    tileInfo.PutBits(0, 1);
+    TEST_REQUIRE(parser.ParseTileInfo(tileInfo, 352, 288, false));
+    TEST_CHECK(parser.GetNumTiles() == 1);
+    TEST_CHECK(parser.GetLog2NumTiles() == 0);
+    TEST_CHECK(parser.GetContextUpdateTileId() == 0);
+    TEST_CHECK(parser.GetTileSizeBytes() == 4);
+    TEST_CHECK(parser.GetTileTableSize() == (2 * 544));
+    TEST_REQUIRE(parser.TileTableInUse());
+}
+
+PARSER_TEST(Av1TileGroupOutOfRange)
+{
+    Av1TileGroupParser parser;
+    BeginFrame(parser, 12, 8, 2); // 96 tiles, tile numbers coded on 7 bits
+    const uint32_t numTiles = parser.GetNumTiles();
+    const uint32_t log2NumTiles = parser.GetLog2NumTiles();
+
+    TEST_CHECK(!parser.ParseTileGroup(BuildTileGroup(numTiles, log2NumTiles, 0, 31, 2), 0));
+    TEST_REQUIRE(parser.GetTileCount() == 32);
+
+    // A tile group that skips tiles
+    TEST_CHECK(!parser.ParseTileGroup(BuildTileGroup(numTiles, log2NumTiles, 40, 50, 2), 0));
+    TEST_CHECK(parser.GetTileCount() == 32);
+
+    // A tile group that repeats tiles
+    TEST_CHECK(!parser.ParseTileGroup(BuildTileGroup(numTiles, log2NumTiles, 0, 40, 2), 0));
+    TEST_CHECK(!parser.ParseTileGroup(BuildTileGroup(numTiles, log2NumTiles, 31, 40, 2), 0));
+    TEST_CHECK(parser.GetTileCount() == 32);
+
+    // tg_end before tg_start: the tile group header is written by hand, as BuildTileGroup() writes the tiles too
+    TileGroupWriter writer;
+    writer.PutBits(1, 1);
+    writer.PutBits(32, log2NumTiles);
+    writer.PutBits(20, log2NumTiles);
+    writer.ByteAlign();
+    writer.PutBytes(0, 4);
+    TileGroupPayload reversed;
+    reversed.data = writer.Data();
+    TEST_CHECK(!parser.ParseTileGroup(reversed, 0));
+    TEST_CHECK(parser.GetTileCount() == 32);
+
+    // tg_end past the last tile of the frame, but within the range of its log2NumTiles bits
+    TEST_CHECK(!parser.ParseTileGroup(BuildTileGroup(numTiles, log2NumTiles, 32, 100, 2), 0));
+    TEST_CHECK(!parser.ParseTileGroup(BuildTileGroup(numTiles, log2NumTiles, 32, 127, 2), 0));
+    TEST_CHECK(parser.GetTileCount() == 32);
+
+    // The rest of the frame is still accepted
+    TEST_CHECK(parser.ParseTileGroup(BuildTileGroup(numTiles, log2NumTiles, 32, 95, 2), 0));
+    TEST_CHECK(parser.GetTileCount() == numTiles);
+
+    // No tile group past the last one of the frame
+    TEST_CHECK(!parser.ParseTileGroup(BuildTileGroup(numTiles, log2NumTiles, 95, 95, 2), 0));
+    TEST_CHECK(parser.GetTileCount() == numTiles);
+}
+
+PARSER_TEST(Av1TileGroupTruncated)
+{
+    Av1TileGroupParser parser;
+    BeginFrame(parser, 12, 8, 2);
+    const uint32_t numTiles = parser.GetNumTiles();
+    const uint32_t log2NumTiles = parser.GetLog2NumTiles();
+    const TileGroupPayload payload = BuildTileGroup(numTiles, log2NumTiles, 0, 9, 2);
+
+    // Cut within the data of a tile that is not the last one: its size goes past the payload
+    BeginFrame(parser, 12, 8, 2);
+    TEST_CHECK(!parser.ParseTileGroup(payload, 0, payload.tileOffsets[4] + 1));
+    TEST_CHECK(parser.GetTileCount() < 10);
+
+    // Cut within the tile_size_minus_1 of a tile
+    BeginFrame(parser, 12, 8, 2);
+    TEST_CHECK(!parser.ParseTileGroup(payload, 0, payload.tileOffsets[4] - 1));
+    TEST_CHECK(parser.GetTileCount() < 10);
+
+    // Cut within the data of the tile before the last one
+    BeginFrame(parser, 12, 8, 2);
+    TEST_CHECK(!parser.ParseTileGroup(payload, 0, payload.tileOffsets[9] - 1));
+    TEST_CHECK(parser.GetTileCount() < 10);
+
+    // Cut within the tile group header
+    BeginFrame(parser, 12, 8, 2);
+    TEST_CHECK(!parser.ParseTileGroup(payload, 0, 1));
+    TEST_CHECK(parser.GetTileCount() < 10);
+
+    // A tile size larger than the whole payload
+    TileGroupWriter writer;
+    writer.PutBits(1, 1);
+    writer.PutBits(0, log2NumTiles);
+    writer.PutBits(1, log2NumTiles);
+    writer.ByteAlign();
+    writer.PutBytes(0xffff, 2);
+    writer.PutBytes(0, 8);
+    TileGroupPayload oversized;
+    oversized.data = writer.Data();
+    BeginFrame(parser, 12, 8, 2);
+    TEST_CHECK(!parser.ParseTileGroup(oversized, 0));
+    TEST_CHECK(parser.GetTileCount() == 0);
+
+    // The complete tile group parses, and leaves the rest of the frame to the next tile groups
+    BeginFrame(parser, 12, 8, 2);
+    TEST_CHECK(!parser.ParseTileGroup(payload, 0));
+    TEST_CHECK(parser.GetTileCount() == 10);
+}
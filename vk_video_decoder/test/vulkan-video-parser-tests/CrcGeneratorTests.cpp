@@ -0,0 +1,150 @@
+/*
+ * Copyright 2024 NVIDIA Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// getCRC() and getCRCs() with every CRC32 update path the CPU supports, against the byte-at-a-time
+// Crc32Table loop they replaced: several start values, lengths around the block sizes of the paths,
+// and data that is not aligned.
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "ParserTests.h"
+#include "crcgenerator.h"
+
+static uint32_t ReferenceCrc(uint32_t crc, const uint8_t* pData, size_t length)
+{
+    for (size_t i = 0; i < length; i++) {
+        crc = (uint32_t)Crc32Table[pData[i] ^ (crc & 0xff)] ^ (crc >> 8);
+    }
+    return crc;
+}
+
+static std::vector<uint8_t> RandomData(size_t size, uint32_t seed)
+{
+    std::vector<uint8_t> data(size);
+    for (size_t i = 0; i < size; i++) {
+        seed = seed * 1664525 + 1013904223;
+        data[i] = (uint8_t)(seed >> 24);
+    }
+    return data;
+}
+
+static const uint32_t s_crcSeeds[] = { 0, 0xffffffff, 1, 0x80000000, 0x12345678, 0xdeadbeef };
+static const size_t   s_numCrcSeeds = sizeof(s_crcSeeds) / sizeof(s_crcSeeds[0]);
+
+// The update path selected at the first CRC is the one VK_VIDEO_CRC_SIMD_ISA names, if the CPU supports it.
+// Runs first, before the other tests select their paths.
+PARSER_TEST(CrcIsaEnvironment)
+{
+    const std::string selectedIsa = getCRCIsa();
+    const char* pForcedIsa = getenv("VK_VIDEO_CRC_SIMD_ISA");
+    if ((pForcedIsa != nullptr) && setCRCIsa(pForcedIsa)) {
+        TEST_CHECK(selectedIsa == pForcedIsa);
+    }
+    TEST_CHECK(setCRCIsa("c"));
+    TEST_CHECK(!setCRCIsa("sse"));
+    TEST_CHECK(strcmp(getCRCIsa(), "c") == 0);
+    TEST_CHECK(setCRCIsa(selectedIsa.c_str()));
+}
+
+PARSER_TEST(CrcMatchesTableLoop)
+{
+    const std::string selectedIsa = getCRCIsa();
+    const size_t lengths[] = { 0, 1, 3, 8, 15, 16, 17, 31, 63, 64, 65, 79, 127, 128, 129, 191, 255, 256, 1000, 4099, 65543 };
+    const size_t maxOffset = 15;
+    const std::vector<uint8_t> data = RandomData(65543 + maxOffset, 7);
+
+    const char* isaNames[] = { "c", "pclmul", "crc32" };
+    for (const char* pIsaName : isaNames) {
+        if (!setCRCIsa(pIsaName)) {
+            continue; // Not supported by the CPU
+        }
+        TEST_CHECK(strcmp(getCRCIsa(), pIsaName) == 0);
+        for (size_t length : lengths) {
+            for (size_t offset = 0; offset <= maxOffset; offset++) {
+                const uint8_t* pData = data.data() + offset;
+                uint32_t expected[s_numCrcSeeds];
+                uint32_t checksums[s_numCrcSeeds];
+                for (size_t i = 0; i < s_numCrcSeeds; i++) {
+                    expected[i] = ReferenceCrc(s_crcSeeds[i], pData, length);
+                    checksums[i] = s_crcSeeds[i];
+
+                    uint32_t checksum = s_crcSeeds[i];
+                    getCRC(&checksum, pData, length, Crc32Table);
+                    TEST_CHECK(checksum == expected[i]);
+
+                    // A single start value goes straight to the update path
+                    checksum = s_crcSeeds[i];
+                    getCRCs(&checksum, 1, pData, length);
+                    TEST_CHECK(checksum == expected[i]);
+                }
+                getCRCs(checksums, s_numCrcSeeds, pData, length);
+                TEST_CHECK(memcmp(checksums, expected, sizeof(expected)) == 0);
+            }
+        }
+    }
+    TEST_CHECK(setCRCIsa(selectedIsa.c_str()));
+}
+
+// The CRCs of the frames are updated plane after plane, and line after line for the pitched ones
+PARSER_TEST(CrcIncrementalUpdates)
+{
+    const std::string selectedIsa = getCRCIsa();
+    const std::vector<uint8_t> data = RandomData(3 * 4096 + 77, 11);
+    const size_t splits[] = { 1, 13, 64, 100, 4096 };
+
+    const char* isaNames[] = { "c", "pclmul", "crc32" };
+    for (const char* pIsaName : isaNames) {
+        if (!setCRCIsa(pIsaName)) {
+            continue;
+        }
+        for (size_t split : splits) {
+            uint32_t expected[s_numCrcSeeds];
+            uint32_t checksums[s_numCrcSeeds];
+            for (size_t i = 0; i < s_numCrcSeeds; i++) {
+                expected[i] = ReferenceCrc(s_crcSeeds[i], data.data(), data.size());
+                checksums[i] = s_crcSeeds[i];
+            }
+            for (size_t offset = 0; offset < data.size(); offset += split) {
+                const size_t length = std::min(split, data.size() - offset);
+                getCRCs(checksums, s_numCrcSeeds, data.data() + offset, length);
+            }
+            TEST_CHECK(memcmp(checksums, expected, sizeof(expected)) == 0);
+        }
+    }
+    TEST_CHECK(setCRCIsa(selectedIsa.c_str()));
+}
+
+// Other tables than Crc32Table keep the table loop
+PARSER_TEST(CrcOtherTable)
+{
+    static unsigned long crcTable[256];
+    for (uint32_t i = 0; i < 256; i++) {
+        crcTable[i] = Crc32Table[i] ^ 0x5a5a5a5a;
+    }
+    const std::vector<uint8_t> data = RandomData(1000, 3);
+    uint32_t expected = 0x12345678;
+    for (size_t i = 0; i < data.size(); i++) {
+        expected = (uint32_t)crcTable[data[i] ^ (expected & 0xff)] ^ (expected >> 8);
+    }
+    uint32_t checksum = 0x12345678;
+    getCRC(&checksum, data.data(), data.size(), crcTable);
+    TEST_CHECK(checksum == expected);
+}
@@ -0,0 +1,118 @@
+/*
+ * Copyright 2024 NVIDIA Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// VK_PARSER_DECODE_SKIP_TO_RANDOM_ACCESS_ON_ERROR on synthetic streams with lost pictures: the picture
+// that refers to a lost reference starts the recovery, and the pictures are dropped up to the next
+// random access point, an IDR or CRA picture or a picture with a recovery point SEI.
+
+#include <string>
+#include <vector>
+
+#include "ParserTests.h"
+#include "RecordingClient.h"
+#include "SyntheticStreams.h"
+
+struct ErrorRecoveryResult {
+    uint32_t numDecodes;
+    uint64_t skippedPictures;
+    uint64_t errorRecoveries;
+};
+
+static bool ParseWithSkipPolicy(VkVideoCodecOperationFlagBitsKHR codecType, const std::vector<uint8_t>& stream,
+                                uint32_t skipFlags, ErrorRecoveryResult& result)
+{
+    VkParserDecodeSkipPolicy skipPolicy = VkParserDecodeSkipPolicy();
+    skipPolicy.flags = skipFlags;
+    RecordingClient client;
+    if ((CreateRecordingClient(client, codecType, &skipPolicy) != VK_SUCCESS) || !ParseStream(client, stream, 64, true)) {
+        return false;
+    }
+    VkParserStatistics stats = VkParserStatistics();
+    if (client.parser->GetParserStatistics(&stats) != VK_SUCCESS) {
+        return false;
+    }
+    result.numDecodes = CountCallbacks(client.decoderHandler->m_callbacks, "decode");
+    result.skippedPictures = stats.skippedPictures;
+    result.errorRecoveries = stats.errorRecoveries;
+    return true;
+}
+
+// 16 frames, an IDR picture every 12 frames, frames 3, 4 and 10 lost, a recovery point SEI before frame 8:
+// - frame 5 has a frame_num gap and starts the recovery, frames 6 and 7 are skipped,
+// - decoding resumes at frame 8, and frame 9 follows,
+// - frame 11 has another gap, and decoding resumes at the IDR picture of frame 12.
+static const H264StreamDesc s_h264LostFrames = { 4, 4, 1, 16, 12, 0, 1, (1u << 3) | (1u << 4) | (1u << 10), (1u << 8) };
+
+PARSER_TEST(ErrorRecoveryH264ResumesAtRecoveryPoint)
+{
+    const std::vector<uint8_t> stream = BuildH264Stream(s_h264LostFrames);
+
+    ErrorRecoveryResult result;
+    TEST_REQUIRE(ParseWithSkipPolicy(VK_VIDEO_CODEC_OPERATION_DECODE_H264_BIT_KHR, stream,
+                                     VK_PARSER_DECODE_SKIP_TO_RANDOM_ACCESS_ON_ERROR, result));
+    TEST_CHECK(result.numDecodes == 9);      // Frames 0-2, 8, 9 and 12-15
+    TEST_CHECK(result.skippedPictures == 4); // Frames 5-7 and 11
+    TEST_CHECK(result.errorRecoveries == 2);
+
+    // Without the policy, the received frames are all decoded
+    TEST_REQUIRE(ParseWithSkipPolicy(VK_VIDEO_CODEC_OPERATION_DECODE_H264_BIT_KHR, stream, 0, result));
+    TEST_CHECK(result.numDecodes == 13);
+    TEST_CHECK(result.skippedPictures == 0);
+    TEST_CHECK(result.errorRecoveries == 0);
+}
+
+// In decoding order, each TRAIL_R picture referring to the previous POC, POC 3, 4 and 11 lost:
+// - POC 5 misses its reference and starts the recovery, POC 6 and 7 are skipped,
+// - decoding resumes at POC 8, a recovery point with recovery_poc_cnt 0 that refers to the skipped POC 7,
+// - POC 12 misses its reference and starts the recovery again, POC 13 is skipped,
+// - decoding resumes at the CRA picture of POC 16, handled as a BLA: its RASL picture is skipped.
+static const H265PictureDesc s_h265LostPictures[] = {
+    { H265_NUT_IDR_W_RADL,  0,  0, false },
+    { H265_NUT_TRAIL_R,     1,  0, false },
+    { H265_NUT_TRAIL_R,     2,  1, false },
+    { H265_NUT_TRAIL_R,     5,  4, false },
+    { H265_NUT_TRAIL_R,     6,  5, false },
+    { H265_NUT_TRAIL_R,     7,  6, false },
+    { H265_NUT_TRAIL_R,     8,  7, true  },
+    { H265_NUT_TRAIL_R,     9,  8, false },
+    { H265_NUT_TRAIL_R,    10,  9, false },
+    { H265_NUT_TRAIL_R,    12, 11, false },
+    { H265_NUT_TRAIL_R,    13, 12, false },
+    { H265_NUT_CRA,        16, 16, false },
+    { H265_NUT_RASL_N,     15, 16, false },
+    { H265_NUT_TRAIL_R,    17, 16, false },
+    { H265_NUT_TRAIL_R,    18, 17, false },
+};
+
+PARSER_TEST(ErrorRecoveryH265ResumesAtRecoveryPoint)
+{
+    const std::vector<H265PictureDesc> pictures(s_h265LostPictures,
+                                                s_h265LostPictures + sizeof(s_h265LostPictures) / sizeof(s_h265LostPictures[0]));
+    const std::vector<uint8_t> stream = BuildH265Stream(pictures);
+
+    ErrorRecoveryResult result;
+    TEST_REQUIRE(ParseWithSkipPolicy(VK_VIDEO_CODEC_OPERATION_DECODE_H265_BIT_KHR, stream,
+                                     VK_PARSER_DECODE_SKIP_TO_RANDOM_ACCESS_ON_ERROR, result));
+    TEST_CHECK(result.numDecodes == 9);      // POC 0-2, 8-10 and 16-18
+    TEST_CHECK(result.skippedPictures == 6); // POC 5-7, 12, 13 and the RASL picture
+    TEST_CHECK(result.errorRecoveries == 2);
+
+    // Without the policy, the received pictures are all decoded, RASL included
+    TEST_REQUIRE(ParseWithSkipPolicy(VK_VIDEO_CODEC_OPERATION_DECODE_H265_BIT_KHR, stream, 0, result));
+    TEST_CHECK(result.numDecodes == (uint32_t)pictures.size());
+    TEST_CHECK(result.skippedPictures == 0);
+    TEST_CHECK(result.errorRecoveries == 0);
+}
@@ -0,0 +1,415 @@
+/*
+ * Copyright 2024 NVIDIA Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// The IVF demuxer on synthetic AV1 and VP9 files: the profile, bit depth and chroma subsampling
+// read from the AV1 sequence header and the VP9 uncompressed header of the first frame, and the
+// temporal unit Seek() builds for an AV1 key frame, the active sequence header spliced in after
+// its temporal delimiter.
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+#include "ParserTests.h"
+#include "SyntheticStreams.h"
+#include "VkDecoderUtils/VideoStreamDemuxer.h"
+
+static const char* s_ivfFileName = "vulkan-video-parser-tests.ivf";
+
+struct IvfFrame {
+    std::vector<uint8_t> data;
+    uint64_t             timestamp;
+};
+
+// 32-byte file header, then each frame preceded by its size and timestamp
+static std::vector<uint8_t> BuildIvfFile(const char* pFourcc, uint32_t width, uint32_t height,
+                                         const std::vector<IvfFrame>& frames)
+{
+    std::vector<uint8_t> file = { 'D', 'K', 'I', 'F', 0, 0, 32, 0 };
+    file.insert(file.end(), pFourcc, pFourcc + 4);
+    const uint32_t fields[5] = { width | (height << 16), 30, 1, (uint32_t)frames.size(), 0 };
+    for (uint32_t field : fields) {
+        for (uint32_t i = 0; i < 4; i++) {
+            file.push_back((uint8_t)(field >> (8 * i)));
+        }
+    }
+    for (const IvfFrame& frame : frames) {
+        for (uint32_t i = 0; i < 4; i++) {
+            file.push_back((uint8_t)(frame.data.size() >> (8 * i)));
+        }
+        for (uint32_t i = 0; i < 8; i++) {
+            file.push_back((uint8_t)(frame.timestamp >> (8 * i)));
+        }
+        file.insert(file.end(), frame.data.begin(), frame.data.end());
+    }
+    return file;
+}
+
+static VkResult CreateIvfDemuxer(const std::vector<uint8_t>& file, VkSharedBaseObj<VideoStreamDemuxer>& demuxer)
+{
+    if (!WriteStreamFile(s_ivfFileName, file)) {
+        return VK_ERROR_INITIALIZATION_FAILED;
+    }
+    return IvfDemuxerCreate(s_ivfFileName, VK_VIDEO_CODEC_OPERATION_NONE_KHR, 0, 0, 8, demuxer);
+}
+
+struct Av1SequenceHeaderDesc {
+    uint32_t seqProfile;
+    bool     reducedStillPictureHeader;
+    bool     timingInfo;         // With a decoder model, present for every operating point
+    uint32_t numOperatingPoints;
+    uint32_t maxFrameWidth;
+    uint32_t maxFrameHeight;
+    uint32_t bitDepth;
+    bool     monochrome;
+    bool     srgb;               // BT.709 primaries, sRGB transfer, identity matrix: 4:4:4
+    uint32_t subsamplingX;       // Coded for the 12-bit profile 2 only
+    uint32_t subsamplingY;
+};
+
+// sequence_header_obu() (AV1 5.5), with its OBU header and size
+static std::vector<uint8_t> BuildAv1SequenceHeader(const Av1SequenceHeaderDesc& desc)
+{
+    RbspWriter w;
+    w.u(desc.seqProfile, 3);
+    w.u(desc.reducedStillPictureHeader, 1); // still_picture
+    w.u(desc.reducedStillPictureHeader, 1);
+    if (desc.reducedStillPictureHeader) {
+        w.u(8, 5);                          // seq_level_idx[0]
+    } else {
+        w.u(desc.timingInfo, 1);
+        if (desc.timingInfo) {
+            w.u(1001, 32);                  // num_units_in_display_tick
+            w.u(60000, 32);                 // time_scale
+            w.u(1, 1);                      // equal_picture_interval
+            w.u(1, 1);                      // num_ticks_per_picture_minus_1, uvlc() 0
+            w.u(1, 1);                      // decoder_model_info_present_flag
+            w.u(9, 5);                      // buffer_delay_length_minus_1
+            w.u(1001, 32);                  // num_units_in_decoding_tick
+            w.u(20, 5);                     // buffer_removal_time_length_minus_1
+            w.u(20, 5);                     // frame_presentation_time_length_minus_1
+        }
+        w.u(1, 1);                          // initial_display_delay_present_flag
+        w.u(desc.numOperatingPoints - 1, 5);
+        for (uint32_t i = 0; i < desc.numOperatingPoints; i++) {
+            w.u((i == 0) ? 0x103 : 0x101, 12); // operating_point_idc[i]
+            w.u(12 - i, 5);                 // seq_level_idx[i], with seq_tier[i]
+            w.u(1, 1);
+            if (desc.timingInfo) {
+                w.u(1, 1);                  // decoder_model_present_for_this_op[i]
+                w.u(1000, 10);              // decoder_buffer_delay
+                w.u(2000, 10);              // encoder_buffer_delay
+                w.u(0, 1);                  // low_delay_mode_flag
+            }
+            w.u(1, 1);                      // initial_display_delay_present_for_this_op[i]
+            w.u(9, 4);
+        }
+    }
+    w.u(15, 4);                             // frame_width_bits_minus_1
+    w.u(15, 4);                             // frame_height_bits_minus_1
+    w.u(desc.maxFrameWidth - 1, 16);
+    w.u(desc.maxFrameHeight - 1, 16);
+    if (!desc.reducedStillPictureHeader) {
+        w.u(1, 1);                          // frame_id_numbers_present_flag
+        w.u(5, 4);                          // delta_frame_id_length_minus_2
+        w.u(2, 3);                          // additional_frame_id_length_minus_1
+    }
+    w.u(0x7, 3);                            // use_128x128_superblock, enable_filter_intra, enable_intra_edge_filter
+    if (!desc.reducedStillPictureHeader) {
+        w.u(0xf, 4);                        // enable_interintra_compound ... enable_dual_filter
+        w.u(1, 1);                          // enable_order_hint
+        w.u(0x3, 2);                        // enable_jnt_comp, enable_ref_frame_mvs
+        w.u(0, 1);                          // seq_choose_screen_content_tools
+        w.u(1, 1);                          // seq_force_screen_content_tools
+        w.u(0, 1);                          // seq_choose_integer_mv
+        w.u(0, 1);                          // seq_force_integer_mv
+        w.u(6, 3);                          // order_hint_bits_minus_1
+    }
+    w.u(0x3, 3);                            // enable_superres, enable_cdef, enable_restoration
+
+    // color_config()
+    w.u(desc.bitDepth > 8, 1);              // high_bitdepth
+    if ((desc.seqProfile == 2) && (desc.bitDepth > 8)) {
+        w.u(desc.bitDepth == 12, 1);        // twelve_bit
+    }
+    if (desc.seqProfile != 1) {
+        w.u(desc.monochrome, 1);
+    }
+    w.u(1, 1);                              // color_description_present_flag
+    w.u(1, 8);                              // color_primaries
+    w.u(desc.srgb ? 13 : 1, 8);             // transfer_characteristics
+    w.u(desc.srgb ? 0 : 1, 8);              // matrix_coefficients
+    if (desc.monochrome) {
+        w.u(0, 1);                          // color_range
+    } else if (!desc.srgb) {
+        w.u(0, 1);                          // color_range
+        uint32_t subsamplingX = (desc.seqProfile == 0) ? 1 : ((desc.seqProfile == 1) ? 0 : 1);
+        uint32_t subsamplingY = (desc.seqProfile == 0) ? 1 : 0;
+        if ((desc.seqProfile == 2) && (desc.bitDepth == 12)) {
+            subsamplingX = desc.subsamplingX;
+            w.u(subsamplingX, 1);
+            if (subsamplingX) {
+                subsamplingY = desc.subsamplingY;
+                w.u(subsamplingY, 1);
+            }
+        }
+        if (subsamplingX && subsamplingY) {
+            w.u(0, 2);                      // chroma_sample_position
+        }
+    }
+    if (!desc.monochrome) {
+        w.u(0, 1);                          // separate_uv_delta_q
+    }
+    w.u(0, 1);                              // film_grain_params_present
+    w.TrailingBits();
+
+    std::vector<uint8_t> obu = { (1 << 3) | (1 << 1), (uint8_t)w.Data().size() }; // OBU_SEQUENCE_HEADER, obu_size
+    obu.insert(obu.end(), w.Data().begin(), w.Data().end());
+    return obu;
+}
+
+// A temporal unit: temporal delimiter, the sequence header if any, and an OBU_FRAME with the
+// first bits of its uncompressed header (show_existing_frame 0, frame_type, show_frame 1).
+static std::vector<uint8_t> BuildAv1TemporalUnit(const std::vector<uint8_t>& sequenceHeader, bool isKeyFrame,
+                                                 uint8_t frameData)
+{
+    std::vector<uint8_t> temporalUnit = { (2 << 3) | (1 << 1), 0 };
+    temporalUnit.insert(temporalUnit.end(), sequenceHeader.begin(), sequenceHeader.end());
+    const uint8_t frame[] = { (6 << 3) | (1 << 1), 4, (uint8_t)(isKeyFrame ? 0x10 : 0x30), frameData, 0x55, 0xaa };
+    temporalUnit.insert(temporalUnit.end(), frame, frame + sizeof(frame));
+    return temporalUnit;
+}
+
+static void CheckAv1StreamParameters(const Av1SequenceHeaderDesc& desc, uint32_t ivfWidth, uint32_t ivfHeight,
+                                     VkVideoChromaSubsamplingFlagsKHR chromaSubsampling)
+{
+    std::vector<IvfFrame> frames(2);
+    frames[0].data = BuildAv1TemporalUnit(BuildAv1SequenceHeader(desc), true, 0);
+    frames[0].timestamp = 0;
+    frames[1].data = BuildAv1TemporalUnit(std::vector<uint8_t>(), false, 1);
+    frames[1].timestamp = 1;
+
+    VkSharedBaseObj<VideoStreamDemuxer> demuxer;
+    TEST_REQUIRE(CreateIvfDemuxer(BuildIvfFile("AV01", ivfWidth, ivfHeight, frames), demuxer) == VK_SUCCESS);
+    TEST_CHECK(demuxer->GetVideoCodec() == VK_VIDEO_CODEC_OPERATION_DECODE_AV1_BIT_KHR);
+    TEST_CHECK(demuxer->GetProfileIdc() == desc.seqProfile);
+    TEST_CHECK(demuxer->GetBitDepth() == (int32_t)desc.bitDepth);
+    TEST_CHECK(demuxer->GetChromaSubsampling() == chromaSubsampling);
+    // The frame size of the IVF header, or of the sequence header if the IVF one is not set
+    TEST_CHECK(demuxer->GetWidth() == (int32_t)(ivfWidth ? ivfWidth : desc.maxFrameWidth));
+    TEST_CHECK(demuxer->GetHeight() == (int32_t)(ivfHeight ? ivfHeight : desc.maxFrameHeight));
+}
+
+PARSER_TEST(IvfDemuxerAv1StreamParameters)
+{
+    //                             profile still  timing ops width height depth mono   srgb   ssx ssy
+    const Av1SequenceHeaderDesc main8      = { 0, false, false, 1, 1920, 1080,  8, false, false, 0, 0 };
+    const Av1SequenceHeaderDesc main10     = { 0, false, true,  2, 3840, 2160, 10, false, false, 0, 0 };
+    const Av1SequenceHeaderDesc mainMono   = { 0, false, false, 1,  640,  480, 10, true,  false, 0, 0 };
+    const Av1SequenceHeaderDesc still      = { 0, true,  false, 1,  512,  256,  8, false, false, 0, 0 };
+    const Av1SequenceHeaderDesc high444    = { 1, false, true,  1, 1280,  720, 10, false, false, 0, 0 };
+    const Av1SequenceHeaderDesc highSrgb   = { 1, false, false, 1, 1280,  720,  8, false, true,  0, 0 };
+    const Av1SequenceHeaderDesc pro422     = { 2, false, false, 1, 1920, 1080, 10, false, false, 0, 0 };
+    const Av1SequenceHeaderDesc pro12b420  = { 2, false, true,  3, 4096, 2176, 12, false, false, 1, 1 };
+    const Av1SequenceHeaderDesc pro12b422  = { 2, false, false, 1, 4096, 2176, 12, false, false, 1, 0 };
+    const Av1SequenceHeaderDesc pro12b444  = { 2, false, false, 1, 4096, 2176, 12, false, false, 0, 0 };
+
+    CheckAv1StreamParameters(main8, 0, 0, VK_VIDEO_CHROMA_SUBSAMPLING_420_BIT_KHR);
+    CheckAv1StreamParameters(main8, 176, 144, VK_VIDEO_CHROMA_SUBSAMPLING_420_BIT_KHR);
+    CheckAv1StreamParameters(main10, 0, 0, VK_VIDEO_CHROMA_SUBSAMPLING_420_BIT_KHR);
+    CheckAv1StreamParameters(mainMono, 0, 0, VK_VIDEO_CHROMA_SUBSAMPLING_MONOCHROME_BIT_KHR);
+    CheckAv1StreamParameters(still, 0, 0, VK_VIDEO_CHROMA_SUBSAMPLING_420_BIT_KHR);
+    CheckAv1StreamParameters(high444, 0, 0, VK_VIDEO_CHROMA_SUBSAMPLING_444_BIT_KHR);
+    CheckAv1StreamParameters(highSrgb, 0, 0, VK_VIDEO_CHROMA_SUBSAMPLING_444_BIT_KHR);
+    CheckAv1StreamParameters(pro422, 0, 0, VK_VIDEO_CHROMA_SUBSAMPLING_422_BIT_KHR);
+    CheckAv1StreamParameters(pro12b420, 0, 0, VK_VIDEO_CHROMA_SUBSAMPLING_420_BIT_KHR);
+    CheckAv1StreamParameters(pro12b422, 0, 0, VK_VIDEO_CHROMA_SUBSAMPLING_422_BIT_KHR);
+    CheckAv1StreamParameters(pro12b444, 0, 0, VK_VIDEO_CHROMA_SUBSAMPLING_444_BIT_KHR);
+    remove(s_ivfFileName);
+}
+
+struct Vp9FrameDesc {
+    uint32_t profile;
+    bool     isKeyFrame;
+    uint32_t bitDepth;
+    uint32_t colorSpace;   // 7 for CS_RGB
+    uint32_t subsamplingX; // Coded for the profiles 1 and 3 only
+    uint32_t subsamplingY;
+};
+
+// The start of uncompressed_header() (VP9 6.2), up to color_config() for key frames
+static std::vector<uint8_t> BuildVp9Frame(const Vp9FrameDesc& desc, uint8_t frameData)
+{
+    RbspWriter w;
+    w.u(2, 2);                              // frame_marker
+    w.u(desc.profile & 1, 1);               // profile_low_bit
+    w.u(desc.profile >> 1, 1);              // profile_high_bit
+    if (desc.profile == 3) {
+        w.u(0, 1);                          // reserved_zero
+    }
+    w.u(0, 1);                              // show_existing_frame
+    w.u(desc.isKeyFrame ? 0 : 1, 1);        // frame_type
+    w.u(1, 1);                              // show_frame
+    w.u(0, 1);                              // error_resilient_mode
+    if (desc.isKeyFrame) {
+        w.u(0x498342, 24);                  // frame_sync_code
+        if (desc.profile >= 2) {
+            w.u(desc.bitDepth == 12, 1);    // ten_or_twelve_bit
+        }
+        w.u(desc.colorSpace, 3);
+        if (desc.colorSpace != 7) {
+            w.u(0, 1);                      // color_range
+            if ((desc.profile == 1) || (desc.profile == 3)) {
+                w.u(desc.subsamplingX, 1);
+                w.u(desc.subsamplingY, 1);
+                w.u(0, 1);                  // reserved_zero
+            }
+        } else if ((desc.profile == 1) || (desc.profile == 3)) {
+            w.u(0, 1);                      // reserved_zero
+        }
+        w.u(175, 16);                       // frame_width_minus_1
+        w.u(143, 16);                       // frame_height_minus_1
+    } else {
+        w.u(0, 2);                          // reset_frame_context
+    }
+    w.u(frameData, 8);
+    w.TrailingBits();
+    return w.Data();
+}
+
+PARSER_TEST(IvfDemuxerVp9StreamParameters)
+{
+    struct Vp9TestCase {
+        Vp9FrameDesc                     frame;
+        VkVideoChromaSubsamplingFlagsKHR chromaSubsampling;
+    };
+    const Vp9TestCase testCases[] = {
+        { { 0, true,  8, 2, 0, 0 }, VK_VIDEO_CHROMA_SUBSAMPLING_420_BIT_KHR },
+        { { 1, true,  8, 2, 0, 0 }, VK_VIDEO_CHROMA_SUBSAMPLING_444_BIT_KHR },
+        { { 1, true,  8, 2, 1, 0 }, VK_VIDEO_CHROMA_SUBSAMPLING_422_BIT_KHR },
+        { { 1, true,  8, 7, 0, 0 }, VK_VIDEO_CHROMA_SUBSAMPLING_444_BIT_KHR },
+        { { 2, true, 10, 2, 0, 0 }, VK_VIDEO_CHROMA_SUBSAMPLING_420_BIT_KHR },
+        { { 2, true, 12, 2, 0, 0 }, VK_VIDEO_CHROMA_SUBSAMPLING_420_BIT_KHR },
+        { { 3, true, 10, 2, 1, 0 }, VK_VIDEO_CHROMA_SUBSAMPLING_422_BIT_KHR },
+        { { 3, true, 12, 7, 0, 0 }, VK_VIDEO_CHROMA_SUBSAMPLING_444_BIT_KHR },
+    };
+    for (const Vp9TestCase& testCase : testCases) {
+        Vp9FrameDesc interFrame = testCase.frame;
+        interFrame.isKeyFrame = false;
+        std::vector<IvfFrame> frames(2);
+        frames[0].data = BuildVp9Frame(testCase.frame, 0);
+        frames[0].timestamp = 0;
+        frames[1].data = BuildVp9Frame(interFrame, 1);
+        frames[1].timestamp = 1;
+
+        VkSharedBaseObj<VideoStreamDemuxer> demuxer;
+        TEST_REQUIRE(CreateIvfDemuxer(BuildIvfFile("VP90", 176, 144, frames), demuxer) == VK_SUCCESS);
+        TEST_CHECK(demuxer->GetVideoCodec() == VK_VIDEO_CODEC_OPERATION_DECODE_VP9_BIT_KHR);
+        TEST_CHECK(demuxer->GetProfileIdc() == testCase.frame.profile);
+        TEST_CHECK(demuxer->GetBitDepth() == (int32_t)testCase.frame.bitDepth);
+        TEST_CHECK(demuxer->GetChromaSubsampling() == testCase.chromaSubsampling);
+        TEST_CHECK((demuxer->GetWidth() == 176) && (demuxer->GetHeight() == 144));
+        TEST_CHECK(demuxer->GetFrameRate() == 30.0f);
+    }
+    remove(s_ivfFileName);
+}
+
+static void CheckFrame(VideoStreamDemuxer* pDemuxer, const std::vector<uint8_t>& expected, int64_t timestamp)
+{
+    const uint8_t* pData = nullptr;
+    const int64_t size = pDemuxer->DemuxFrame(&pData);
+    TEST_REQUIRE((size == (int64_t)expected.size()) && (pData != nullptr));
+    TEST_CHECK(memcmp(pData, expected.data(), expected.size()) == 0);
+    TEST_CHECK(pDemuxer->GetFrameTimestamp() == timestamp);
+}
+
+// Key frames in the temporal units 0, 2 and 4, a sequence header in 0 and a new one in 4
+PARSER_TEST(IvfDemuxerAv1SeekSplicesSequenceHeader)
+{
+    const Av1SequenceHeaderDesc firstDesc = { 0, false, false, 1, 1920, 1080, 8, false, false, 0, 0 };
+    const Av1SequenceHeaderDesc secondDesc = { 0, false, false, 1, 1280, 720, 8, false, false, 0, 0 };
+    const std::vector<uint8_t> firstSequenceHeader = BuildAv1SequenceHeader(firstDesc);
+    const std::vector<uint8_t> secondSequenceHeader = BuildAv1SequenceHeader(secondDesc);
+    const std::vector<uint8_t> noSequenceHeader;
+    std::vector<IvfFrame> frames(6);
+    for (uint32_t i = 0; i < frames.size(); i++) {
+        frames[i].data = BuildAv1TemporalUnit((i == 0) ? firstSequenceHeader : ((i == 4) ? secondSequenceHeader : noSequenceHeader),
+                                              (i % 2) == 0, (uint8_t)i);
+        frames[i].timestamp = 10 * i;
+    }
+
+    // The temporal delimiter, the sequence header, then the rest of the key frame temporal unit
+    auto splice = [&frames, &firstSequenceHeader](uint32_t keyFrame) {
+        std::vector<uint8_t> temporalUnit(frames[keyFrame].data.begin(), frames[keyFrame].data.begin() + 2);
+        temporalUnit.insert(temporalUnit.end(), firstSequenceHeader.begin(), firstSequenceHeader.end());
+        temporalUnit.insert(temporalUnit.end(), frames[keyFrame].data.begin() + 2, frames[keyFrame].data.end());
+        return temporalUnit;
+    };
+
+    {
+        VkSharedBaseObj<VideoStreamDemuxer> demuxer;
+        TEST_REQUIRE(CreateIvfDemuxer(BuildIvfFile("AV01", 0, 0, frames), demuxer) == VK_SUCCESS);
+        TEST_CHECK((demuxer->GetWidth() == 1920) && (demuxer->GetHeight() == 1080));
+        for (uint32_t i = 0; i < frames.size(); i++) {
+            CheckFrame(demuxer, frames[i].data, frames[i].timestamp);
+        }
+        TEST_CHECK(demuxer->StreamHasEnded());
+
+        // Temporal unit 3 resumes at the key frame of 2, which needs the sequence header of 0
+        TEST_REQUIRE(demuxer->Seek(0, 35, 0));
+        CheckFrame(demuxer, splice(2), 20);
+        CheckFrame(demuxer, frames[3].data, 30);
+
+        // The key frame of 4 carries a new sequence header, after the one active before it
+        TEST_REQUIRE(demuxer->Seek(0, 1000, 0));
+        CheckFrame(demuxer, splice(4), 40);
+        CheckFrame(demuxer, frames[5].data, 50);
+
+        // The first key frame has its sequence header already
+        TEST_REQUIRE(demuxer->Seek(0, 15, 0));
+        CheckFrame(demuxer, frames[0].data, 0);
+        CheckFrame(demuxer, frames[1].data, 10);
+
+        // A pending splice is dropped on rewind
+        TEST_REQUIRE(demuxer->Seek(0, 20, 0));
+        demuxer->Rewind();
+        CheckFrame(demuxer, frames[0].data, 0);
+    }
+    remove(s_ivfFileName);
+}
+
+PARSER_TEST(IvfDemuxerVp9Seek)
+{
+    const Vp9FrameDesc keyFrame = { 0, true, 8, 2, 0, 0 };
+    const Vp9FrameDesc interFrame = { 0, false, 8, 2, 0, 0 };
+    std::vector<IvfFrame> frames(5);
+    for (uint32_t i = 0; i < frames.size(); i++) {
+        frames[i].data = BuildVp9Frame(((i % 3) == 0) ? keyFrame : interFrame, (uint8_t)i);
+        frames[i].timestamp = i;
+    }
+
+    {
+        VkSharedBaseObj<VideoStreamDemuxer> demuxer;
+        TEST_REQUIRE(CreateIvfDemuxer(BuildIvfFile("VP90", 176, 144, frames), demuxer) == VK_SUCCESS);
+        // The key frames are returned in place, VP9 has no sequence header to resend
+        TEST_REQUIRE(demuxer->Seek(0, 4, 0));
+        CheckFrame(demuxer, frames[3].data, 3);
+        CheckFrame(demuxer, frames[4].data, 4);
+        TEST_REQUIRE(demuxer->Seek(0, 2, 0));
+        CheckFrame(demuxer, frames[0].data, 0);
+    }
+    remove(s_ivfFileName);
+}
@@ -0,0 +1,72 @@
+/*
+ * Copyright 2024 NVIDIA Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Headless parser tests: the parser and the bitstream buffer management are run against
+// synthetic streams and stub clients, without a Vulkan device or a loader.
+//
+// Usage: vulkan-video-parser-tests [filter]
+// Runs the tests whose name contains filter, all of them by default.
+
+#include <string.h>
+
+#include "ParserTests.h"
+
+ParserTestRegistry& ParserTestRegistry::Get()
+{
+    static ParserTestRegistry registry;
+    return registry;
+}
+
+void ParserTestRegistry::Register(ParserTest* pTest)
+{
+    // Kept in registration order, which is the link order of the test files
+    if (m_pLast != nullptr) {
+        m_pLast->next = pTest;
+    } else {
+        m_pFirst = pTest;
+    }
+    m_pLast = pTest;
+}
+
+void ParserTestRegistry::Fail(const char* file, int line, const char* expr)
+{
+    fprintf(stderr, "%s:%d: check failed: %s\n", file, line, expr);
+    m_numFailures++;
+}
+
+int ParserTestRegistry::Run(const char* filter)
+{
+    int numFailedTests = 0;
+    uint32_t numTests = 0;
+    for (ParserTest* pTest = m_pFirst; pTest != nullptr; pTest = pTest->next) {
+        if ((filter != nullptr) && (strstr(pTest->name, filter) == nullptr)) {
+            continue;
+        }
+        m_numFailures = 0;
+        pTest->func();
+        printf("%s %s\n", (m_numFailures == 0) ? "[  PASSED ]" : "[  FAILED ]", pTest->name);
+        numFailedTests += (m_numFailures == 0) ? 0 : 1;
+        numTests++;
+    }
+    printf("%u tests, %d failed\n", numTests, numFailedTests);
+    return numFailedTests;
+}
+
+int main(int argc, const char** argv)
+{
+    const char* filter = (argc > 1) ? argv[1] : nullptr;
+    return (ParserTestRegistry::Get().Run(filter) == 0) ? 0 : 1;
+}
@@ -0,0 +1,447 @@
+/*
+ * Copyright 2024 NVIDIA Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// The MP4 demuxer on minimal files built in memory: the sample table flattened from stsz/stz2,
+// stco/co64 and multi-entry stsc, the avcC/hvcC decoder configuration records, the boxes cut
+// short, and the length-prefixed parameter sets DemuxFrame() sends ahead of the first sample
+// and of the first sample after a seek.
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+#include "ParserTests.h"
+#include "SyntheticStreams.h"
+#include "VkDecoderUtils/VideoStreamDemuxer.h"
+
+static const char* s_mp4FileName = "vulkan-video-parser-tests.mp4";
+
+enum Mp4Truncation {
+    MP4_TRUNCATE_NONE,
+    MP4_TRUNCATE_STSZ,   // Last sample size missing
+    MP4_TRUNCATE_STCO,   // Last chunk offset missing
+    MP4_TRUNCATE_STSC,   // Last sample-to-chunk entry cut short
+    MP4_TRUNCATE_CONFIG, // Last parameter set of the avcC/hvcC cut short
+    MP4_TRUNCATE_MOOV,   // File ends within the moov box
+    MP4_TRUNCATE_MDAT,   // File ends within the last sample
+};
+
+struct Mp4FileDesc {
+    bool                  isHevc;
+    uint32_t              nalLengthSize;
+    uint32_t              sampleSizeBits; // 32 for stsz, 4, 8 or 16 for stz2
+    bool                  useCo64;
+    std::vector<uint32_t> chunkSamples;   // Samples of each chunk
+    std::vector<uint32_t> syncSamples;    // 1-based, as in stss
+    Mp4Truncation         truncation;
+};
+
+struct Mp4File {
+    std::vector<uint8_t>              data;
+    std::vector<std::vector<uint8_t>> samples;
+    std::vector<uint8_t>              parameterSets; // As DemuxFrame() sends them, length-prefixed
+};
+
+static const uint32_t s_sampleDuration = 100;
+static const uint32_t s_compositionOffset = 200;
+static const uint8_t s_h264Sps[] = { 0x67, 0x6e, 0x00, 0x1f, 0xac, 0xd9, 0x40, 0x50 };
+static const uint8_t s_h264Pps[] = { 0x68, 0xeb, 0xe3, 0xcb };
+static const uint8_t s_h265Vps[] = { 0x40, 0x01, 0x0c, 0x01, 0xff, 0xff };
+static const uint8_t s_h265Sps[] = { 0x42, 0x01, 0x01, 0x02, 0x60, 0x00, 0x00 };
+static const uint8_t s_h265Pps[] = { 0x44, 0x01, 0xc1, 0x73 };
+
+static void AppendBe(std::vector<uint8_t>& data, uint64_t value, uint32_t numBytes)
+{
+    for (uint32_t i = numBytes; i > 0; i--) {
+        data.push_back((uint8_t)(value >> (8 * (i - 1))));
+    }
+}
+
+static void AppendBytes(std::vector<uint8_t>& data, const uint8_t* pBytes, size_t size)
+{
+    data.insert(data.end(), pBytes, pBytes + size);
+}
+
+static std::vector<uint8_t> Box(const char* pType, const std::vector<uint8_t>& payload)
+{
+    std::vector<uint8_t> box;
+    AppendBe(box, 8 + payload.size(), 4);
+    AppendBytes(box, (const uint8_t*)pType, 4);
+    AppendBytes(box, payload.data(), payload.size());
+    return box;
+}
+
+static std::vector<uint8_t> FullBox(const char* pType, uint8_t version, const std::vector<uint8_t>& payload)
+{
+    std::vector<uint8_t> fullPayload;
+    AppendBe(fullPayload, (uint32_t)version << 24, 4);
+    AppendBytes(fullPayload, payload.data(), payload.size());
+    return Box(pType, fullPayload);
+}
+
+static std::vector<uint8_t> Concat(const std::vector<std::vector<uint8_t>>& boxes)
+{
+    std::vector<uint8_t> data;
+    for (const std::vector<uint8_t>& box : boxes) {
+        AppendBytes(data, box.data(), box.size());
+    }
+    return data;
+}
+
+static void AppendParameterSet(const Mp4FileDesc& desc, std::vector<uint8_t>& config, Mp4File& file,
+                               const uint8_t* pNal, size_t nalSize)
+{
+    AppendBe(config, nalSize, 2);
+    AppendBytes(config, pNal, nalSize);
+    AppendBe(file.parameterSets, nalSize, desc.nalLengthSize);
+    AppendBytes(file.parameterSets, pNal, nalSize);
+}
+
+// avc1 or hvc1 sample entry of a 176x144 track, 10-bit 4:2:0
+static std::vector<uint8_t> BuildSampleEntry(const Mp4FileDesc& desc, Mp4File& file)
+{
+    std::vector<uint8_t> config;
+    if (desc.isHevc) {
+        const uint8_t header[22] = { 1, 0x02, 0x20, 0, 0, 0, 0x90, 0, 0, 0, 0, 0, 93, 0xf0, 0, 0xfc,
+                                     0xfc | 1, 0xf8 | 2, 0xf8 | 2, 0, 0, 0 };
+        AppendBytes(config, header, sizeof(header));
+        config[21] = (uint8_t)(0x0c | (desc.nalLengthSize - 1));
+        config.push_back(3); // numOfArrays
+        const uint8_t* pNals[3] = { s_h265Vps, s_h265Sps, s_h265Pps };
+        const size_t nalSizes[3] = { sizeof(s_h265Vps), sizeof(s_h265Sps), sizeof(s_h265Pps) };
+        for (uint32_t i = 0; i < 3; i++) {
+            config.push_back((uint8_t)(0x80 | ((pNals[i][0] >> 1) & 0x3f)));
+            AppendBe(config, 1, 2);
+            AppendParameterSet(desc, config, file, pNals[i], nalSizes[i]);
+        }
+    } else {
+        const uint8_t header[5] = { 1, 110, 0, 31, (uint8_t)(0xfc | (desc.nalLengthSize - 1)) };
+        AppendBytes(config, header, sizeof(header));
+        config.push_back(0xe0 | 1);
+        AppendParameterSet(desc, config, file, s_h264Sps, sizeof(s_h264Sps));
+        config.push_back(1);
+        AppendParameterSet(desc, config, file, s_h264Pps, sizeof(s_h264Pps));
+        const uint8_t extension[4] = { 0xfc | 1, 0xf8 | 2, 0xf8 | 2, 0 };
+        AppendBytes(config, extension, sizeof(extension));
+    }
+    if (desc.truncation == MP4_TRUNCATE_CONFIG) {
+        config.resize(config.size() - (desc.isHevc ? 1 : 5));
+    }
+
+    std::vector<uint8_t> entry(78, 0);
+    entry[7] = 1;      // data_reference_index
+    entry[25] = 176;   // width
+    entry[27] = 144;   // height
+    const std::vector<uint8_t> configBox = Box(desc.isHevc ? "hvcC" : "avcC", config);
+    AppendBytes(entry, configBox.data(), configBox.size());
+    return Box(desc.isHevc ? "hvc1" : "avc1", entry);
+}
+
+static std::vector<uint8_t> BuildSampleTable(const Mp4FileDesc& desc, Mp4File& file,
+                                             const std::vector<uint64_t>& chunkOffsets)
+{
+    const uint32_t numSamples = (uint32_t)file.samples.size();
+
+    std::vector<uint8_t> stsd;
+    AppendBe(stsd, 1, 4);
+    const std::vector<uint8_t> entry = BuildSampleEntry(desc, file);
+    AppendBytes(stsd, entry.data(), entry.size());
+
+    std::vector<uint8_t> stts, ctts, stss;
+    AppendBe(stts, 1, 4);
+    AppendBe(stts, numSamples, 4);
+    AppendBe(stts, s_sampleDuration, 4);
+    AppendBe(ctts, 1, 4);
+    AppendBe(ctts, numSamples, 4);
+    AppendBe(ctts, s_compositionOffset, 4);
+    AppendBe(stss, desc.syncSamples.size(), 4);
+    for (uint32_t sampleNumber : desc.syncSamples) {
+        AppendBe(stss, sampleNumber, 4);
+    }
+
+    // One stsc entry per run of chunks with the same number of samples
+    std::vector<uint8_t> stscEntries;
+    uint32_t numStscEntries = 0;
+    for (uint32_t chunk = 0; chunk < desc.chunkSamples.size(); chunk++) {
+        if ((chunk == 0) || (desc.chunkSamples[chunk] != desc.chunkSamples[chunk - 1])) {
+            AppendBe(stscEntries, chunk + 1, 4);
+            AppendBe(stscEntries, desc.chunkSamples[chunk], 4);
+            AppendBe(stscEntries, 1, 4);
+            numStscEntries++;
+        }
+    }
+    std::vector<uint8_t> stsc;
+    AppendBe(stsc, numStscEntries, 4);
+    AppendBytes(stsc, stscEntries.data(), stscEntries.size() - ((desc.truncation == MP4_TRUNCATE_STSC) ? 4 : 0));
+
+    std::vector<uint8_t> stsz;
+    if (desc.sampleSizeBits == 32) {
+        AppendBe(stsz, 0, 4);
+    } else {
+        AppendBe(stsz, desc.sampleSizeBits, 4); // reserved, field_size
+    }
+    AppendBe(stsz, numSamples, 4);
+    for (uint32_t i = 0; i < numSamples; i++) {
+        const uint32_t size = (uint32_t)file.samples[i].size();
+        if (desc.sampleSizeBits == 4) {
+            if (i & 1) {
+                stsz.back() |= (uint8_t)size;
+            } else {
+                stsz.push_back((uint8_t)(size << 4));
+            }
+        } else {
+            AppendBe(stsz, size, desc.sampleSizeBits / 8);
+        }
+    }
+    if (desc.truncation == MP4_TRUNCATE_STSZ) {
+        stsz.resize(stsz.size() - ((desc.sampleSizeBits == 4) ? 1 : (desc.sampleSizeBits / 8)));
+    }
+
+    std::vector<uint8_t> stco;
+    AppendBe(stco, chunkOffsets.size(), 4);
+    for (size_t i = 0; i < chunkOffsets.size(); i++) {
+        if ((desc.truncation != MP4_TRUNCATE_STCO) || ((i + 1) < chunkOffsets.size())) {
+            AppendBe(stco, chunkOffsets[i], desc.useCo64 ? 8 : 4);
+        }
+    }
+
+    return Box("stbl", Concat({ FullBox("stsd", 0, stsd), FullBox("stts", 0, stts), FullBox("ctts", 0, ctts),
+                                FullBox("stss", 0, stss), FullBox("stsc", 0, stsc),
+                                FullBox((desc.sampleSizeBits == 32) ? "stsz" : "stz2", 0, stsz),
+                                FullBox(desc.useCo64 ? "co64" : "stco", 0, stco) }));
+}
+
+static std::vector<uint8_t> BuildMoov(const Mp4FileDesc& desc, Mp4File& file, const std::vector<uint64_t>& chunkOffsets)
+{
+    std::vector<uint8_t> mdhd, hdlr;
+    AppendBe(mdhd, 0, 8);                                        // creation, modification times
+    AppendBe(mdhd, 1000, 4);                                     // timescale
+    AppendBe(mdhd, file.samples.size() * s_sampleDuration, 4);   // duration
+    AppendBe(mdhd, 0, 4);
+    AppendBe(hdlr, 0, 4);
+    AppendBytes(hdlr, (const uint8_t*)"vide", 4);
+    hdlr.insert(hdlr.end(), 13, 0);                             // reserved, empty name
+
+    file.parameterSets.clear();
+    const std::vector<uint8_t> minf = Box("minf", Concat({ FullBox("vmhd", 0, std::vector<uint8_t>(8, 0)),
+                                                          BuildSampleTable(desc, file, chunkOffsets) }));
+    const std::vector<uint8_t> mdia = Box("mdia", Concat({ FullBox("mdhd", 0, mdhd), FullBox("hdlr", 0, hdlr), minf }));
+    return Box("moov", Box("trak", Concat({ FullBox("tkhd", 0, std::vector<uint8_t>(80, 0)), mdia })));
+}
+
+// ftyp, moov, then the mdat with a gap before each chunk, so that a sample read from the wrong
+// chunk does not match.
+static Mp4File BuildMp4File(const Mp4FileDesc& desc)
+{
+    Mp4File file;
+    for (uint32_t chunk = 0; chunk < desc.chunkSamples.size(); chunk++) {
+        for (uint32_t i = 0; i < desc.chunkSamples[chunk]; i++) {
+            const uint32_t sampleIndex = (uint32_t)file.samples.size();
+            bool isSync = false;
+            for (uint32_t sampleNumber : desc.syncSamples) {
+                isSync = isSync || (sampleNumber == (sampleIndex + 1));
+            }
+            // A single NAL unit, short enough for the 4-bit sample sizes
+            const uint32_t nalSize = 3 + (sampleIndex % 7);
+            std::vector<uint8_t> sample;
+            AppendBe(sample, nalSize, desc.nalLengthSize);
+            if (desc.isHevc) {
+                sample.push_back((uint8_t)((isSync ? H265_NUT_IDR_W_RADL : H265_NUT_TRAIL_R) << 1));
+                sample.push_back(1);
+            } else {
+                sample.push_back(isSync ? 0x65 : 0x41);
+                sample.push_back(0x88);
+            }
+            for (uint32_t j = 2; j < nalSize; j++) {
+                sample.push_back((uint8_t)(sampleIndex * 16 + j));
+            }
+            file.samples.push_back(sample);
+        }
+    }
+
+    const std::vector<uint8_t> ftyp = Box("ftyp", std::vector<uint8_t>({ 'i', 's', 'o', 'm', 0, 0, 2, 0,
+                                                                          'i', 's', 'o', 'm', 'a', 'v', 'c', '1' }));
+    std::vector<uint8_t> mdatPayload;
+    std::vector<uint64_t> chunkOffsets(desc.chunkSamples.size(), 0);
+    const uint64_t moovSize = BuildMoov(desc, file, chunkOffsets).size();
+    uint32_t sampleIndex = 0;
+    for (uint32_t chunk = 0; chunk < desc.chunkSamples.size(); chunk++) {
+        mdatPayload.insert(mdatPayload.end(), 3, 0xee);
+        chunkOffsets[chunk] = ftyp.size() + moovSize + 8 + mdatPayload.size();
+        for (uint32_t i = 0; i < desc.chunkSamples[chunk]; i++, sampleIndex++) {
+            AppendBytes(mdatPayload, file.samples[sampleIndex].data(), file.samples[sampleIndex].size());
+        }
+    }
+
+    const std::vector<uint8_t> moov = BuildMoov(desc, file, chunkOffsets);
+    file.data = Concat({ ftyp, moov, Box("mdat", mdatPayload) });
+    if (desc.truncation == MP4_TRUNCATE_MOOV) {
+        file.data.resize(ftyp.size() + moov.size() - 1);
+    } else if (desc.truncation == MP4_TRUNCATE_MDAT) {
+        file.data.resize(file.data.size() - 1);
+    }
+    return file;
+}
+
+static VkResult CreateMp4Demuxer(const Mp4File& file, VkSharedBaseObj<VideoStreamDemuxer>& demuxer)
+{
+    if (!WriteStreamFile(s_mp4FileName, file.data)) {
+        return VK_ERROR_INITIALIZATION_FAILED;
+    }
+    return Mp4DemuxerCreate(s_mp4FileName, VK_VIDEO_CODEC_OPERATION_NONE_KHR, 1920, 1080, 8, demuxer);
+}
+
+static bool PacketEquals(const uint8_t* pData, int64_t size, const std::vector<uint8_t>& prefix,
+                         const std::vector<uint8_t>& sample)
+{
+    return (pData != nullptr) && (size == (int64_t)(prefix.size() + sample.size())) &&
+           (prefix.empty() || (memcmp(pData, prefix.data(), prefix.size()) == 0)) &&
+           (memcmp(pData + prefix.size(), sample.data(), sample.size()) == 0);
+}
+
+// Every sample in decoding order, the parameter sets ahead of the first one only
+static void CheckSamples(VideoStreamDemuxer* pDemuxer, const Mp4File& file)
+{
+    const std::vector<uint8_t> noPrefix;
+    for (size_t i = 0; i < file.samples.size(); i++) {
+        const uint8_t* pData = nullptr;
+        const int64_t size = pDemuxer->DemuxFrame(&pData);
+        TEST_CHECK(PacketEquals(pData, size, (i == 0) ? file.parameterSets : noPrefix, file.samples[i]));
+        TEST_CHECK(pDemuxer->GetFrameTimestamp() == (int64_t)(i * s_sampleDuration + s_compositionOffset));
+    }
+    const uint8_t* pData = nullptr;
+    TEST_CHECK(pDemuxer->DemuxFrame(&pData) == 0);
+    TEST_CHECK(pDemuxer->StreamHasEnded());
+}
+
+static void CheckSeek(VideoStreamDemuxer* pDemuxer, const Mp4File& file, int64_t timestamp, uint32_t syncSample)
+{
+    TEST_REQUIRE(pDemuxer->Seek(0, timestamp, 0));
+    const uint8_t* pData = nullptr;
+    int64_t size = pDemuxer->DemuxFrame(&pData);
+    TEST_CHECK(PacketEquals(pData, size, file.parameterSets, file.samples[syncSample]));
+    if ((syncSample + 1) < file.samples.size()) {
+        size = pDemuxer->DemuxFrame(&pData);
+        TEST_CHECK(PacketEquals(pData, size, std::vector<uint8_t>(), file.samples[syncSample + 1]));
+    }
+}
+
+// Chunks of 2, 2, 1, 3, 3 and 1 samples: four stsc entries
+static const uint32_t s_chunkSamples[] = { 2, 2, 1, 3, 3, 1 };
+
+static Mp4FileDesc GetMp4FileDesc(bool isHevc, uint32_t nalLengthSize, uint32_t sampleSizeBits, bool useCo64)
+{
+    Mp4FileDesc desc;
+    desc.isHevc = isHevc;
+    desc.nalLengthSize = nalLengthSize;
+    desc.sampleSizeBits = sampleSizeBits;
+    desc.useCo64 = useCo64;
+    desc.chunkSamples.assign(s_chunkSamples, s_chunkSamples + sizeof(s_chunkSamples) / sizeof(s_chunkSamples[0]));
+    desc.syncSamples = { 1, 5, 9 };
+    desc.truncation = MP4_TRUNCATE_NONE;
+    return desc;
+}
+
+PARSER_TEST(Mp4DemuxerH264SampleTable)
+{
+    const Mp4File file = BuildMp4File(GetMp4FileDesc(false, 4, 32, false));
+    {
+        VkSharedBaseObj<VideoStreamDemuxer> demuxer;
+        TEST_REQUIRE(CreateMp4Demuxer(file, demuxer) == VK_SUCCESS);
+        TEST_CHECK(demuxer->GetVideoCodec() == VK_VIDEO_CODEC_OPERATION_DECODE_H264_BIT_KHR);
+        TEST_CHECK((demuxer->GetWidth() == 176) && (demuxer->GetHeight() == 144));
+        TEST_CHECK(demuxer->GetProfileIdc() == 110);
+        TEST_CHECK(demuxer->GetBitDepth() == 10);
+        TEST_CHECK(demuxer->GetChromaSubsampling() == VK_VIDEO_CHROMA_SUBSAMPLING_420_BIT_KHR);
+        TEST_CHECK(demuxer->GetNalLengthSize() == 4);
+        TEST_CHECK(demuxer->GetFrameRate() == 10.0f);
+        CheckSamples(demuxer, file);
+
+        // Rewinding sends the parameter sets again
+        demuxer->Rewind();
+        CheckSamples(demuxer, file);
+    }
+    remove(s_mp4FileName);
+}
+
+PARSER_TEST(Mp4DemuxerStz2Co64)
+{
+    const uint32_t sampleSizeBits[] = { 4, 8, 16 };
+    for (uint32_t bits : sampleSizeBits) {
+        const Mp4File file = BuildMp4File(GetMp4FileDesc(false, 2, bits, true));
+        VkSharedBaseObj<VideoStreamDemuxer> demuxer;
+        TEST_REQUIRE(CreateMp4Demuxer(file, demuxer) == VK_SUCCESS);
+        TEST_CHECK(demuxer->GetNalLengthSize() == 2);
+        CheckSamples(demuxer, file);
+    }
+    remove(s_mp4FileName);
+}
+
+PARSER_TEST(Mp4DemuxerH265Config)
+{
+    const Mp4File file = BuildMp4File(GetMp4FileDesc(true, 4, 32, false));
+    {
+        VkSharedBaseObj<VideoStreamDemuxer> demuxer;
+        TEST_REQUIRE(CreateMp4Demuxer(file, demuxer) == VK_SUCCESS);
+        TEST_CHECK(demuxer->GetVideoCodec() == VK_VIDEO_CODEC_OPERATION_DECODE_H265_BIT_KHR);
+        TEST_CHECK(demuxer->GetProfileIdc() == 2);
+        TEST_CHECK(demuxer->GetBitDepth() == 10);
+        TEST_CHECK(demuxer->GetChromaSubsampling() == VK_VIDEO_CHROMA_SUBSAMPLING_420_BIT_KHR);
+        TEST_CHECK(demuxer->GetNalLengthSize() == 4);
+        // VPS, SPS and PPS, in the order of the hvcC arrays
+        TEST_CHECK(file.parameterSets.size() ==
+                   (12 + sizeof(s_h265Vps) + sizeof(s_h265Sps) + sizeof(s_h265Pps)));
+        CheckSamples(demuxer, file);
+    }
+    remove(s_mp4FileName);
+}
+
+PARSER_TEST(Mp4DemuxerSeekSendsParameterSets)
+{
+    const Mp4File file = BuildMp4File(GetMp4FileDesc(false, 4, 32, false));
+    {
+        VkSharedBaseObj<VideoStreamDemuxer> demuxer;
+        TEST_REQUIRE(CreateMp4Demuxer(file, demuxer) == VK_SUCCESS);
+
+        // Presentation time of sample i: i * 100 + 200
+        CheckSeek(demuxer, file, 5 * s_sampleDuration + s_compositionOffset, 4);
+        CheckSeek(demuxer, file, 4 * s_sampleDuration + s_compositionOffset - 1, 0);
+        CheckSeek(demuxer, file, 1000000, 8);
+        TEST_CHECK(!demuxer->Seek(0, s_compositionOffset - 1, 0));
+    }
+    remove(s_mp4FileName);
+}
+
+PARSER_TEST(Mp4DemuxerTruncatedBoxes)
+{
+    const Mp4Truncation truncations[] = { MP4_TRUNCATE_STSZ, MP4_TRUNCATE_STCO, MP4_TRUNCATE_STSC,
+                                          MP4_TRUNCATE_CONFIG, MP4_TRUNCATE_MOOV, MP4_TRUNCATE_MDAT };
+    for (Mp4Truncation truncation : truncations) {
+        for (uint32_t isHevc = 0; isHevc < 2; isHevc++) {
+            Mp4FileDesc desc = GetMp4FileDesc(isHevc != 0, 4, 32, false);
+            desc.truncation = truncation;
+            VkSharedBaseObj<VideoStreamDemuxer> demuxer;
+            TEST_CHECK(CreateMp4Demuxer(BuildMp4File(desc), demuxer) != VK_SUCCESS);
+            TEST_CHECK(!demuxer);
+        }
+        // The 4-bit sample sizes, packed two per byte
+        Mp4FileDesc desc = GetMp4FileDesc(false, 2, 4, true);
+        desc.truncation = truncation;
+        VkSharedBaseObj<VideoStreamDemuxer> demuxer;
+        TEST_CHECK(CreateMp4Demuxer(BuildMp4File(desc), demuxer) != VK_SUCCESS);
+    }
+    remove(s_mp4FileName);
+}
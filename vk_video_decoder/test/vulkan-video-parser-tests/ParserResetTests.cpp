@@ -0,0 +1,142 @@
+/*
+ * Copyright 2024 NVIDIA Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// IVulkanVideoParser::Reset() against a fresh parser: a stream decoded after a warm reset must
+// produce the same client callbacks, with the same picture indices and DPB slots, as the same
+// stream decoded by a parser that was just created. The parameter set update counts are the
+// exception: the client keeps its parameter set objects across the reset, so they must keep
+// increasing instead. The client is a CPU stub that records every callback, on synthetic H.264
+// streams of which only the headers are valid.
+
+#include <algorithm>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "ParserTests.h"
+#include "RecordingClient.h"
+#include "SyntheticStreams.h"
+
+// Callbacks of the stream parsed to its end by a parser that was just created
+static std::vector<std::string> ParseWithFreshParser(const std::vector<uint8_t>& stream, size_t packetSize)
+{
+    RecordingClient client;
+    if ((CreateRecordingClient(client) != VK_SUCCESS) || !ParseStream(client, stream, packetSize, true)) {
+        return std::vector<std::string>();
+    }
+    client.decoderHandler->Record("picturesInUse=%u", client.frameBuffer->GetNumPicturesInUse());
+    return client.decoderHandler->m_callbacks;
+}
+
+static void CheckSameCallbacks(const std::vector<std::string>& callbacks, const std::vector<std::string>& expected)
+{
+    TEST_CHECK(callbacks.size() == expected.size());
+    for (size_t i = 0; i < std::min(callbacks.size(), expected.size()); i++) {
+        if (callbacks[i] != expected[i]) {
+            fprintf(stderr, "callback %zu: '%s', expected '%s'\n", i, callbacks[i].c_str(), expected[i].c_str());
+            TEST_CHECK(callbacks[i] == expected[i]);
+            return;
+        }
+    }
+}
+
+static const H264StreamDesc s_streamA = { 4, 4, 1, 12, 12, 0, 1 };   // 64x64, a single reference picture
+static const H264StreamDesc s_streamB = { 8, 4, 3, 20, 8, 3, 2 };    // 128x64, non-reference pictures, two slices
+
+PARSER_TEST(ParserResetMatchesFreshParser)
+{
+    const std::vector<uint8_t> streamA = BuildH264Stream(s_streamA);
+    const std::vector<uint8_t> streamB = BuildH264Stream(s_streamB);
+    const size_t packetSize = 100;
+
+    const std::vector<std::string> freshA = ParseWithFreshParser(streamA, packetSize);
+    const std::vector<std::string> freshB = ParseWithFreshParser(streamB, packetSize);
+    TEST_REQUIRE(!freshA.empty() && !freshB.empty());
+    TEST_CHECK(freshA.back() == "picturesInUse=0");
+
+    RecordingClient client;
+    TEST_REQUIRE(CreateRecordingClient(client) == VK_SUCCESS);
+
+    // Reset in the middle of a stream: the parser still holds pictures, which the reset flushes
+    TEST_REQUIRE(ParseStream(client, streamB, packetSize, false));
+    TEST_REQUIRE(client.parser->Reset() == VK_SUCCESS);
+    TEST_CHECK(client.frameBuffer->GetNumPicturesInUse() == 0);
+
+    client.decoderHandler->m_callbacks.clear();
+    TEST_REQUIRE(ParseStream(client, streamA, packetSize, true));
+    client.decoderHandler->Record("picturesInUse=%u", client.frameBuffer->GetNumPicturesInUse());
+    CheckSameCallbacks(client.decoderHandler->m_callbacks, freshA);
+
+    // Reset at the end of a stream, to another picture size
+    TEST_REQUIRE(client.parser->Reset() == VK_SUCCESS);
+    client.decoderHandler->m_callbacks.clear();
+    TEST_REQUIRE(ParseStream(client, streamB, packetSize, true));
+    client.decoderHandler->Record("picturesInUse=%u", client.frameBuffer->GetNumPicturesInUse());
+    CheckSameCallbacks(client.decoderHandler->m_callbacks, freshB);
+
+    // The same stream again
+    TEST_REQUIRE(client.parser->Reset() == VK_SUCCESS);
+    client.decoderHandler->m_callbacks.clear();
+    TEST_REQUIRE(ParseStream(client, streamB, packetSize, true));
+    client.decoderHandler->Record("picturesInUse=%u", client.frameBuffer->GetNumPicturesInUse());
+    CheckSameCallbacks(client.decoderHandler->m_callbacks, freshB);
+
+    TEST_CHECK(client.decoderHandler->m_numStaleUpdates == 0);
+}
+
+PARSER_TEST(ParserResetKeepsUpdateCounts)
+{
+    const std::vector<uint8_t> stream = BuildH264Stream(s_streamA);
+
+    RecordingClient client;
+    TEST_REQUIRE(CreateRecordingClient(client) == VK_SUCCESS);
+    TEST_REQUIRE(ParseStream(client, stream, stream.size(), true));
+    const size_t numParameterSets = client.decoderHandler->m_updateSequenceCounts.size();
+    TEST_REQUIRE(numParameterSets == 2);
+    const std::map<std::string, uint32_t> firstUpdateCounts = client.decoderHandler->m_updateSequenceCounts;
+
+    // The same SPS and PPS ids after each reset: every one of them is sent again, with a higher count
+    for (uint32_t i = 0; i < 3; i++) {
+        TEST_REQUIRE(client.parser->Reset() == VK_SUCCESS);
+        client.decoderHandler->m_callbacks.clear();
+        TEST_REQUIRE(ParseStream(client, stream, stream.size(), true));
+        TEST_CHECK(std::count_if(client.decoderHandler->m_callbacks.begin(), client.decoderHandler->m_callbacks.end(),
+                                 [](const std::string& callback) { return callback.compare(0, 10, "parameters") == 0; }) ==
+                   (ptrdiff_t)numParameterSets);
+    }
+    TEST_CHECK(client.decoderHandler->m_numStaleUpdates == 0);
+    TEST_CHECK(client.decoderHandler->m_updateSequenceCounts.size() == numParameterSets);
+    for (const std::pair<const std::string, uint32_t>& updateCount : client.decoderHandler->m_updateSequenceCounts) {
+        TEST_CHECK(updateCount.second > firstUpdateCounts.at(updateCount.first));
+    }
+}
+
+PARSER_TEST(ParserResetSyntheticStream)
+{
+    const std::vector<std::string> callbacks = ParseWithFreshParser(BuildH264Stream(s_streamB), 4096);
+    uint32_t numSequences = 0;
+    uint32_t numDecodes = 0;
+    uint32_t numDisplays = 0;
+    for (size_t i = 0; i < callbacks.size(); i++) {
+        numSequences += (callbacks[i].compare(0, 8, "sequence") == 0) ? 1 : 0;
+        numDecodes += (callbacks[i].compare(0, 6, "decode") == 0) ? 1 : 0;
+        numDisplays += (callbacks[i].compare(0, 7, "display") == 0) ? 1 : 0;
+    }
+    // The stub client is only a valid reference if the synthetic stream goes through the whole parser
+    TEST_CHECK(numSequences == 1);
+    TEST_CHECK(numDecodes == s_streamB.numFrames);
+    TEST_CHECK(numDisplays == s_streamB.numFrames);
+}
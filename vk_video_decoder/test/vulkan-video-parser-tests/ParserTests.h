@@ -0,0 +1,77 @@
+/*
+ * Copyright 2024 NVIDIA Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _PARSERTESTS_H_
+#define _PARSERTESTS_H_
+
+#include <stdio.h>
+#include <stdint.h>
+
+// Minimal test registry of the headless parser tests: every test registers itself at static
+// initialization time, and reports its failures through TEST_CHECK().
+typedef void (*ParserTestFunc)();
+
+struct ParserTest {
+    const char*    name;
+    ParserTestFunc func;
+    ParserTest*    next;
+};
+
+class ParserTestRegistry {
+public:
+    static ParserTestRegistry& Get();
+
+    void Register(ParserTest* pTest);
+    void Fail(const char* file, int line, const char* expr);
+
+    // Runs the tests whose name contains filter (all of them if it is null), returns the number of failed tests
+    int Run(const char* filter);
+
+private:
+    ParserTestRegistry() : m_pFirst(nullptr), m_pLast(nullptr), m_numFailures(0) {}
+
+    ParserTest* m_pFirst;
+    ParserTest* m_pLast;
+    uint32_t    m_numFailures; // Failed checks of the running test
+};
+
+struct ParserTestRegistration {
+    ParserTestRegistration(ParserTest* pTest) { ParserTestRegistry::Get().Register(pTest); }
+};
+
+#define PARSER_TEST(testName) \
+    static void testName(); \
+    static ParserTest testName##_test = { #testName, testName, nullptr }; \
+    static ParserTestRegistration testName##_registration(&testName##_test); \
+    static void testName()
+
+#define TEST_CHECK(expr) \
+    do { \
+        if (!(expr)) { \
+            ParserTestRegistry::Get().Fail(__FILE__, __LINE__, #expr); \
+        } \
+    } while (0)
+
+// Returns from the test if the check fails, for the checks the rest of the test depends on
+#define TEST_REQUIRE(expr) \
+    do { \
+        if (!(expr)) { \
+            ParserTestRegistry::Get().Fail(__FILE__, __LINE__, #expr); \
+            return; \
+        } \
+    } while (0)
+
+#endif /* _PARSERTESTS_H_ */
@@ -0,0 +1,74 @@
+/*
+ * Copyright 2024 NVIDIA Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string.h>
+
+#include "RecordingClient.h"
+
+VkResult CreateRecordingClient(RecordingClient& client,
+                               VkVideoCodecOperationFlagBitsKHR codecType,
+                               const VkParserDecodeSkipPolicy* pDecodeSkipPolicy)
+{
+    client.decoderHandler = new RecordingDecoderHandler();
+    client.frameBuffer = new RecordingFrameBuffer(client.decoderHandler);
+    VkSharedBaseObj<IVulkanVideoDecoderHandler> decoderHandlerIf(client.decoderHandler);
+    VkSharedBaseObj<IVulkanVideoFrameBufferParserCb> frameBufferIf(client.frameBuffer);
+    return IVulkanVideoParser::Create(decoderHandlerIf,
+                                      frameBufferIf,
+                                      codecType,
+                                      RecordingDecoderHandler::MAX_DECODE_SURFACES,
+                                      RecordingDecoderHandler::MAX_DECODE_SURFACES,
+                                      256 * 1024, // defaultMinBufferSize
+                                      256, // bufferOffsetAlignment
+                                      256, // bufferSizeAlignment
+                                      0, // clockRate - default 0 = 10Mhz
+                                      0, // errorThreshold
+                                      client.parser,
+                                      0, // nalLengthSize: Annex-B
+                                      pDecodeSkipPolicy);
+}
+
+bool ParseStream(RecordingClient& client, const std::vector<uint8_t>& stream, size_t packetSize, bool endOfStream)
+{
+    for (size_t offset = 0; offset < stream.size(); offset += packetSize) {
+        VkParserSourceDataPacket packet = VkParserSourceDataPacket();
+        packet.payload = stream.data() + offset;
+        packet.payload_size = std::min(packetSize, stream.size() - offset);
+        size_t parsedBytes = 0;
+        if (client.parser->ParseVideoData(&packet, &parsedBytes) != VK_SUCCESS) {
+            return false;
+        }
+    }
+    if (endOfStream) {
+        VkParserSourceDataPacket packet = VkParserSourceDataPacket();
+        packet.flags = VK_PARSER_PKT_ENDOFSTREAM;
+        size_t parsedBytes = 0;
+        if (client.parser->ParseVideoData(&packet, &parsedBytes) != VK_SUCCESS) {
+            return false;
+        }
+    }
+    return true;
+}
+
+uint32_t CountCallbacks(const std::vector<std::string>& callbacks, const char* prefix)
+{
+    const size_t prefixLength = strlen(prefix);
+    uint32_t count = 0;
+    for (size_t i = 0; i < callbacks.size(); i++) {
+        count += (callbacks[i].compare(0, prefixLength, prefix) == 0) ? 1 : 0;
+    }
+    return count;
+}
@@ -0,0 +1,221 @@
+/*
+ * Copyright 2024 NVIDIA Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _RECORDINGCLIENT_H_
+#define _RECORDINGCLIENT_H_
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "vkvideo_parser/VulkanVideoParserIf.h"
+#include "vkvideo_parser/VulkanVideoParser.h"
+#include "vkvideo_parser/PictureBufferBase.h"
+#include "VkCodecUtils/VulkanBitstreamBufferHost.h"
+
+//
+// CPU stub client: accepts every sequence, parameter set and picture without decoding them, and records
+// each callback along with the picture and DPB state it carries.
+//
+class RecordingDecoderHandler : public IVulkanVideoDecoderHandler
+{
+public:
+    enum { MAX_DECODE_SURFACES = 32 };
+
+    RecordingDecoderHandler()
+        : m_refCount(0)
+        , m_callbacks()
+        , m_updateSequenceCounts()
+        , m_numStaleUpdates(0) { }
+
+    virtual int32_t AddRef()
+    {
+        return ++m_refCount;
+    }
+
+    virtual int32_t Release()
+    {
+        uint32_t ret = --m_refCount;
+        if (ret == 0) {
+            delete this;
+        }
+        return ret;
+    }
+
+    virtual int32_t StartVideoSequence(VkParserDetectedVideoFormat* pVideoFormat)
+    {
+        Record("sequence codec=%d coded=%ux%u minSurfaces=%u maxDpbSlots=%u",
+               (int)pVideoFormat->codec, pVideoFormat->coded_width, pVideoFormat->coded_height,
+               pVideoFormat->minNumDecodeSurfaces, pVideoFormat->maxNumDpbSlots);
+        return std::min<int32_t>(std::max<int32_t>(pVideoFormat->minNumDecodeSurfaces, 1), MAX_DECODE_SURFACES);
+    }
+
+    virtual bool UpdatePictureParameters(VkSharedBaseObj<StdVideoPictureParametersSet>& pictureParametersObject,
+                                         VkSharedBaseObj<VkVideoRefCountBase>&)
+    {
+        bool isSps = false;
+        bool isPps = false;
+        const int32_t spsId = pictureParametersObject->GetSpsId(isSps);
+        const int32_t ppsId = pictureParametersObject->GetPpsId(isPps);
+        Record("parameters type=%d sps=%d pps=%d",
+               (int)pictureParametersObject->GetStdType(), spsId, isPps ? ppsId : -1);
+        // As with the decoder's session parameters, which are keyed on the type and id: a parameter set
+        // sent again must come with a higher update count, or it would be added twice.
+        const uint32_t updateSequenceCount = pictureParametersObject->GetUpdateSequenceCount();
+        const std::string key = m_callbacks.back();
+        std::map<std::string, uint32_t>::const_iterator it = m_updateSequenceCounts.find(key);
+        if ((it != m_updateSequenceCounts.end()) && (updateSequenceCount <= it->second)) {
+            fprintf(stderr, "'%s' sent again with updateSequenceCount=%u\n", key.c_str(), updateSequenceCount);
+            m_numStaleUpdates++;
+        }
+        m_updateSequenceCounts[key] = updateSequenceCount;
+        return true;
+    }
+
+    virtual int32_t DecodePictureWithParameters(VkParserPerFrameDecodeParameters* pPicParams,
+                                                VkParserDecodePictureInfo* pDecodePictureInfo)
+    {
+        const VkVideoDecodeInfoKHR& decodeInfo = pPicParams->decodeFrameInfo;
+        std::string refs;
+        for (uint32_t i = 0; i < decodeInfo.referenceSlotCount; i++) {
+            refs += " " + std::to_string(decodeInfo.pReferenceSlots[i].slotIndex) + ":" +
+                    std::to_string(((int32_t)i < pPicParams->numGopReferenceSlots) ? pPicParams->pGopReferenceImagesIndexes[i] : -1);
+        }
+        Record("decode pic=%d setupSlot=%d refPic=%u slices=%u bytes=%zu refs=[%s ]",
+               pPicParams->currPicIdx,
+               (decodeInfo.pSetupReferenceSlot != nullptr) ? decodeInfo.pSetupReferenceSlot->slotIndex : -1,
+               (uint32_t)pDecodePictureInfo->flags.refPic, pPicParams->numSlices,
+               pPicParams->bitstreamDataLen, refs.c_str());
+        return 0;
+    }
+
+    virtual VkDeviceSize GetBitstreamBuffer(VkDeviceSize size,
+                                            VkDeviceSize minBitstreamBufferOffsetAlignment,
+                                            VkDeviceSize minBitstreamBufferSizeAlignment,
+                                            const uint8_t* pInitializeBufferMemory,
+                                            VkDeviceSize initializeBufferMemorySize,
+                                            VkSharedBaseObj<VulkanBitstreamBuffer>& bitstreamBuffer)
+    {
+        VkSharedBaseObj<VulkanBitstreamBufferHost> newBitstreamBuffer;
+        VkResult result = VulkanBitstreamBufferHost::Create(size,
+                                                            minBitstreamBufferOffsetAlignment,
+                                                            minBitstreamBufferSizeAlignment,
+                                                            pInitializeBufferMemory,
+                                                            initializeBufferMemorySize,
+                                                            false, // useHugePages
+                                                            newBitstreamBuffer);
+        if (result != VK_SUCCESS) {
+            return 0;
+        }
+        bitstreamBuffer = newBitstreamBuffer;
+        return newBitstreamBuffer->GetMaxSize();
+    }
+
+    void Record(const char* format, ...)
+    {
+        char entry[256];
+        va_list args;
+        va_start(args, format);
+        vsnprintf(entry, sizeof(entry), format, args);
+        va_end(args);
+        m_callbacks.push_back(entry);
+    }
+
+    std::atomic<int32_t>            m_refCount;
+    std::vector<std::string>        m_callbacks;
+    std::map<std::string, uint32_t> m_updateSequenceCounts; // Last update count sent per parameter set type and id
+    uint32_t                        m_numStaleUpdates;
+};
+
+class RecordingFrameBuffer : public IVulkanVideoFrameBufferParserCb
+{
+public:
+    RecordingFrameBuffer(RecordingDecoderHandler* pDecoderHandler)
+        : m_refCount(0)
+        , m_pDecoderHandler(pDecoderHandler)
+        , m_pictures() { }
+
+    virtual int32_t AddRef()
+    {
+        return ++m_refCount;
+    }
+
+    virtual int32_t Release()
+    {
+        uint32_t ret = --m_refCount;
+        if (ret == 0) {
+            delete this;
+        }
+        return ret;
+    }
+
+    // The displayed pictures are dropped right away
+    virtual int32_t QueueDecodedPictureForDisplay(int8_t picId, VulkanVideoDisplayPictureInfo* pDispInfo)
+    {
+        m_pDecoderHandler->Record("display pic=%d timestamp=%lld", (int)picId, (long long)pDispInfo->timestamp);
+        return picId;
+    }
+
+    virtual vkPicBuffBase* ReservePictureBuffer()
+    {
+        for (int32_t picId = 0; picId < RecordingDecoderHandler::MAX_DECODE_SURFACES; picId++) {
+            if (m_pictures[picId].IsAvailable()) {
+                m_pictures[picId].Reset();
+                m_pictures[picId].AddRef();
+                m_pictures[picId].m_picIdx = picId;
+                return &m_pictures[picId];
+            }
+        }
+        m_pDecoderHandler->Record("reserve failed");
+        return nullptr;
+    }
+
+    // Pictures the parser still holds
+    uint32_t GetNumPicturesInUse() const
+    {
+        uint32_t numPicturesInUse = 0;
+        for (int32_t picId = 0; picId < RecordingDecoderHandler::MAX_DECODE_SURFACES; picId++) {
+            numPicturesInUse += m_pictures[picId].IsAvailable() ? 0 : 1;
+        }
+        return numPicturesInUse;
+    }
+
+    std::atomic<int32_t>     m_refCount;
+    RecordingDecoderHandler* m_pDecoderHandler;
+    vkPicBuffBase            m_pictures[RecordingDecoderHandler::MAX_DECODE_SURFACES];
+};
+
+struct RecordingClient {
+    VkSharedBaseObj<RecordingDecoderHandler> decoderHandler;
+    VkSharedBaseObj<RecordingFrameBuffer>    frameBuffer;
+    VkSharedBaseObj<IVulkanVideoParser>      parser;
+};
+
+VkResult CreateRecordingClient(RecordingClient& client,
+                               VkVideoCodecOperationFlagBitsKHR codecType = VK_VIDEO_CODEC_OPERATION_DECODE_H264_BIT_KHR,
+                               const VkParserDecodeSkipPolicy* pDecodeSkipPolicy = nullptr);
+
+// Parses the stream in packets of packetSize bytes, and flushes it with an end of stream packet if endOfStream
+bool ParseStream(RecordingClient& client, const std::vector<uint8_t>& stream, size_t packetSize, bool endOfStream);
+
+// Number of the recorded callbacks that start with prefix ("decode", "display", ...)
+uint32_t CountCallbacks(const std::vector<std::string>& callbacks, const char* prefix);
+
+#endif /* _RECORDINGCLIENT_H_ */
@@ -0,0 +1,344 @@
+/*
+ * Copyright 2024 NVIDIA Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// VulkanRingAllocator with fake completions: the allocations are submitted to a fake queue, and
+// freed when the test signals their fence, in any order, the way VulkanBitstreamBufferRing frees
+// a range once the frame buffer has waited for its decode.
+
+#include <deque>
+#include <vector>
+
+#include "ParserTests.h"
+#include "VkCodecUtils/VulkanRingAllocator.h"
+
+class FakeDecodeQueue
+{
+public:
+    FakeDecodeQueue(VulkanRingAllocator& allocator)
+        : m_allocator(allocator)
+        , m_nextFenceValue(1)
+        , m_submissions()
+        , m_liveAllocations() { }
+
+    // Allocates like VulkanBitstreamBufferRing::GetRange(), checks the range against the
+    // allocations the ring still holds, and returns the fence value of its submission.
+    uint64_t Submit(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& offset, uint64_t& allocationId)
+    {
+        if (!m_allocator.Allocate(size, alignment, offset, allocationId)) {
+            return 0;
+        }
+        Submission submission = { m_nextFenceValue++, allocationId, offset, offset + size, false };
+        TEST_CHECK((offset & (alignment - 1)) == 0);
+        TEST_CHECK(submission.end <= m_allocator.GetCapacity());
+        TEST_CHECK(!Overlaps(submission));
+        m_submissions.push_back(submission);
+        m_liveAllocations.push_back(submission);
+        return submission.fenceValue;
+    }
+
+    bool Shrink(uint64_t allocationId, VkDeviceSize newSize)
+    {
+        if (!m_allocator.Shrink(allocationId, newSize)) {
+            return false;
+        }
+        for (Submission& allocation : m_liveAllocations) {
+            if (allocation.allocationId == allocationId) {
+                allocation.end = allocation.offset + newSize;
+            }
+        }
+        return true;
+    }
+
+    // Simulates the completion of a submission: the owner of its range waits for the fence and
+    // releases the range.
+    void Signal(uint64_t fenceValue)
+    {
+        for (size_t i = 0; i < m_submissions.size(); i++) {
+            if (m_submissions[i].fenceValue == fenceValue) {
+                m_allocator.Free(m_submissions[i].allocationId);
+                m_submissions.erase(m_submissions.begin() + i);
+                break;
+            }
+        }
+        for (Submission& allocation : m_liveAllocations) {
+            if (allocation.fenceValue == fenceValue) {
+                allocation.completed = true;
+            }
+        }
+        // The space of a completed allocation comes back once all the older ones completed too
+        while (!m_liveAllocations.empty() && m_liveAllocations.front().completed) {
+            m_liveAllocations.pop_front();
+        }
+        TEST_CHECK(m_allocator.GetNumAllocations() == m_liveAllocations.size());
+    }
+
+    void SignalAll()
+    {
+        while (!m_submissions.empty()) {
+            Signal(m_submissions.back().fenceValue);
+        }
+    }
+
+    size_t GetNumPending() const { return m_submissions.size(); }
+    uint64_t GetPendingFenceValue(size_t index) const { return m_submissions[index].fenceValue; }
+
+private:
+    struct Submission {
+        uint64_t     fenceValue;
+        uint64_t     allocationId;
+        VkDeviceSize offset;
+        VkDeviceSize end;
+        bool         completed;
+    };
+
+    bool Overlaps(const Submission& submission) const
+    {
+        for (const Submission& allocation : m_liveAllocations) {
+            if ((submission.offset < allocation.end) && (allocation.offset < submission.end)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    VulkanRingAllocator&     m_allocator;
+    uint64_t                 m_nextFenceValue;
+    std::vector<Submission>  m_submissions;
+    std::deque<Submission>   m_liveAllocations;
+};
+
+PARSER_TEST(RingAllocatorAlignmentPadding)
+{
+    VulkanRingAllocator ring(4096);
+    FakeDecodeQueue queue(ring);
+
+    VkDeviceSize offset = 0;
+    uint64_t allocationId = 0;
+    TEST_REQUIRE(queue.Submit(100, 1, offset, allocationId) != 0);
+    TEST_CHECK((offset == 0) && (allocationId == 0));
+    TEST_REQUIRE(queue.Submit(100, 256, offset, allocationId) != 0);
+    TEST_CHECK((offset == 256) && (allocationId == 1));
+    // The alignment padding counts as used
+    TEST_CHECK(ring.GetUsedSize() == 356);
+
+    queue.SignalAll();
+    TEST_CHECK(ring.GetUsedSize() == 0);
+    TEST_CHECK(ring.GetNumAllocations() == 0);
+
+    // An empty ring starts over at offset 0, the IDs keep increasing
+    TEST_REQUIRE(queue.Submit(100, 256, offset, allocationId) != 0);
+    TEST_CHECK((offset == 0) && (allocationId == 2));
+    queue.SignalAll();
+}
+
+PARSER_TEST(RingAllocatorWrapPadding)
+{
+    VulkanRingAllocator ring(1024);
+    FakeDecodeQueue queue(ring);
+
+    VkDeviceSize offset = 0;
+    uint64_t allocationId = 0;
+    const uint64_t fence0 = queue.Submit(400, 1, offset, allocationId);
+    const uint64_t fence1 = queue.Submit(400, 1, offset, allocationId);
+    TEST_REQUIRE((fence0 != 0) && (fence1 != 0));
+    TEST_CHECK(offset == 400);
+
+    // 300 bytes don't fit at the end of the ring, and its start is still in use
+    TEST_CHECK(queue.Submit(300, 1, offset, allocationId) == 0);
+
+    queue.Signal(fence0);
+    TEST_CHECK(ring.GetUsedSize() == 400);
+
+    // Wraps around: the last 224 bytes of the ring are padding of the new allocation
+    const uint64_t fence2 = queue.Submit(300, 1, offset, allocationId);
+    TEST_REQUIRE(fence2 != 0);
+    TEST_CHECK(offset == 0);
+    TEST_CHECK(ring.GetUsedSize() == (400 + 224 + 300));
+
+    // The padding stays in use until the wrapped allocation completes
+    queue.Signal(fence1);
+    TEST_CHECK(ring.GetUsedSize() == (224 + 300));
+    TEST_CHECK(queue.Submit(800, 1, offset, allocationId) == 0);
+
+    // The wrapped head must stay clear of the tail: head == tail means an empty ring
+    const uint64_t fence3 = queue.Submit(499, 1, offset, allocationId);
+    TEST_REQUIRE(fence3 != 0);
+    TEST_CHECK(offset == 300);
+    TEST_CHECK(queue.Submit(1, 1, offset, allocationId) == 0);
+
+    queue.Signal(fence2);
+    queue.Signal(fence3);
+    TEST_CHECK(ring.GetUsedSize() == 0);
+}
+
+PARSER_TEST(RingAllocatorOutOfOrderCompletion)
+{
+    VulkanRingAllocator ring(1024);
+    FakeDecodeQueue queue(ring);
+
+    VkDeviceSize offset = 0;
+    uint64_t allocationId = 0;
+    uint64_t fences[4] = {};
+    for (uint32_t i = 0; i < 4; i++) {
+        fences[i] = queue.Submit(200, 1, offset, allocationId);
+        TEST_REQUIRE(fences[i] != 0);
+    }
+    TEST_CHECK(ring.GetUsedSize() == 800);
+
+    // The newer allocations complete first: nothing is reclaimed while the oldest one is pending
+    queue.Signal(fences[3]);
+    queue.Signal(fences[1]);
+    TEST_CHECK(ring.GetNumAllocations() == 4);
+    TEST_CHECK(ring.GetUsedSize() == 800);
+    TEST_CHECK(queue.Submit(300, 1, offset, allocationId) == 0);
+
+    // Reclaims the oldest and the completed one following it, up to the pending allocation
+    queue.Signal(fences[0]);
+    TEST_CHECK(ring.GetNumAllocations() == 2);
+    TEST_CHECK(ring.GetUsedSize() == 400);
+
+    const uint64_t fence4 = queue.Submit(300, 1, offset, allocationId);
+    TEST_REQUIRE(fence4 != 0);
+    TEST_CHECK(offset == 0);
+
+    // Reclaims the rest, including the allocation that completed long ago
+    queue.Signal(fences[2]);
+    TEST_CHECK(ring.GetNumAllocations() == 1);
+    TEST_CHECK(ring.GetUsedSize() == (224 + 300));
+
+    queue.Signal(fence4);
+    TEST_CHECK(ring.GetNumAllocations() == 0);
+    TEST_CHECK(ring.GetUsedSize() == 0);
+}
+
+PARSER_TEST(RingAllocatorShrinkNewest)
+{
+    VulkanRingAllocator ring(1024);
+    FakeDecodeQueue queue(ring);
+
+    VkDeviceSize offset = 0;
+    uint64_t allocationId = 0;
+    TEST_REQUIRE(queue.Submit(600, 1, offset, allocationId) != 0);
+    const uint64_t firstId = allocationId;
+
+    // A range can't grow or become empty
+    TEST_CHECK(!queue.Shrink(firstId, 601));
+    TEST_CHECK(!queue.Shrink(firstId, 0));
+
+    // Gives back the end of the range: the next picture starts right after its data
+    TEST_CHECK(queue.Shrink(firstId, 100));
+    TEST_CHECK(ring.GetUsedSize() == 100);
+    TEST_REQUIRE(queue.Submit(600, 1, offset, allocationId) != 0);
+    TEST_CHECK(offset == 100);
+
+    // Only the most recent allocation can shrink
+    TEST_CHECK(!queue.Shrink(firstId, 50));
+    TEST_CHECK(ring.GetUsedSize() == 700);
+    TEST_CHECK(queue.Shrink(allocationId, 24));
+    TEST_CHECK(ring.GetUsedSize() == 124);
+
+    // A wrapped allocation keeps its padding when it shrinks
+    queue.Signal(queue.GetPendingFenceValue(0));
+    TEST_REQUIRE(queue.Submit(900, 1, offset, allocationId) != 0);
+    TEST_CHECK(offset == 124);
+    queue.Signal(queue.GetPendingFenceValue(0));
+    TEST_REQUIRE(queue.Submit(100, 1, offset, allocationId) != 0);
+    TEST_CHECK(offset == 0);
+    TEST_CHECK(ring.GetUsedSize() == 1000);
+    TEST_CHECK(queue.Shrink(allocationId, 10));
+    TEST_CHECK(ring.GetUsedSize() == 910);
+
+    queue.SignalAll();
+    TEST_CHECK(ring.GetUsedSize() == 0);
+    // Nothing left to shrink
+    TEST_CHECK(!queue.Shrink(allocationId, 1));
+}
+
+PARSER_TEST(RingAllocatorBackPressure)
+{
+    VulkanRingAllocator ring(1024);
+    FakeDecodeQueue queue(ring);
+
+    VkDeviceSize offset = 0;
+    uint64_t allocationId = 0;
+    for (uint32_t i = 0; i < 4; i++) {
+        TEST_REQUIRE(queue.Submit(256, 256, offset, allocationId) != 0);
+        TEST_CHECK(offset == (i * 256));
+    }
+    TEST_CHECK(ring.GetUsedSize() == 1024);
+
+    // The ring is full until the oldest submission completes
+    TEST_CHECK(queue.Submit(1, 1, offset, allocationId) == 0);
+    queue.Signal(queue.GetPendingFenceValue(3));
+    TEST_CHECK(queue.Submit(1, 1, offset, allocationId) == 0);
+
+    // Wrapping into all of the reclaimed space would make the full ring look empty
+    queue.Signal(queue.GetPendingFenceValue(0));
+    TEST_CHECK(ring.GetUsedSize() == 768);
+    TEST_CHECK(queue.Submit(256, 256, offset, allocationId) == 0);
+    TEST_REQUIRE(queue.Submit(255, 1, offset, allocationId) != 0);
+    TEST_CHECK(offset == 0);
+    TEST_CHECK(queue.Submit(1, 1, offset, allocationId) == 0);
+
+    // Larger than the ring never fits
+    queue.SignalAll();
+    TEST_CHECK(queue.Submit(1025, 1, offset, allocationId) == 0);
+    TEST_CHECK(queue.Submit(0, 1, offset, allocationId) == 0);
+    TEST_REQUIRE(queue.Submit(1024, 1, offset, allocationId) != 0);
+    queue.SignalAll();
+}
+
+// The decoder's pattern: a maximum size range per picture, shrunk to its data, with a few
+// decodes in flight that complete in a scrambled order.
+PARSER_TEST(RingAllocatorDecodeLoop)
+{
+    const VkDeviceSize capacity = 64 * 1024;
+    const VkDeviceSize maxPictureSize = 16 * 1024;
+    const size_t maxInFlight = 6;
+    VulkanRingAllocator ring(capacity);
+    FakeDecodeQueue queue(ring);
+
+    uint32_t random = 12345;
+    uint32_t numPictures = 0;
+    uint32_t numStalls = 0;
+    for (uint32_t i = 0; i < 2000; i++) {
+        random = random * 1664525 + 1013904223;
+        const VkDeviceSize dataSize = 1 + ((random >> 8) % maxPictureSize);
+
+        VkDeviceSize offset = 0;
+        uint64_t allocationId = 0;
+        if ((queue.GetNumPending() < maxInFlight) && (queue.Submit(maxPictureSize, 256, offset, allocationId) != 0)) {
+            TEST_CHECK(queue.Shrink(allocationId, dataSize));
+            numPictures++;
+        } else {
+            TEST_REQUIRE(queue.GetNumPending() != 0);
+            numStalls++;
+        }
+
+        // Completes one of the two oldest pending submissions
+        if ((queue.GetNumPending() >= maxInFlight) || (random & 0x10000)) {
+            const size_t index = ((queue.GetNumPending() > 1) && (random & 0x20000)) ? 1 : 0;
+            queue.Signal(queue.GetPendingFenceValue(index));
+        }
+        TEST_CHECK(ring.GetUsedSize() <= capacity);
+    }
+    TEST_CHECK(numPictures > 1000);
+    TEST_CHECK(numStalls > 0);
+
+    queue.SignalAll();
+    TEST_CHECK(ring.GetNumAllocations() == 0);
+    TEST_CHECK(ring.GetUsedSize() == 0);
+}
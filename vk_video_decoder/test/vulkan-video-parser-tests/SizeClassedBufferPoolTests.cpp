@@ -0,0 +1,276 @@
+/*
+ * Copyright 2024 NVIDIA Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// VulkanSizeClassedBufferPool with a mock allocator: the buffers are plain reference counted
+// objects, and the allocate callable counts its calls.
+
+#include <atomic>
+
+#include "ParserTests.h"
+#include "VkCodecUtils/VulkanSizeClassedBufferPool.h"
+
+class CountingBuffer : public VkVideoRefCountBase
+{
+public:
+    CountingBuffer(VkDeviceSize size)
+        : m_refCount(0)
+        , m_size(size) { s_numLiveBuffers++; }
+
+    virtual int32_t AddRef()
+    {
+        return ++m_refCount;
+    }
+
+    virtual int32_t Release()
+    {
+        uint32_t ret = --m_refCount;
+        if (ret == 0) {
+            delete this;
+        }
+        return ret;
+    }
+
+    int32_t GetRefCount() const { return m_refCount; }
+    VkDeviceSize GetSize() const { return m_size; }
+
+    static std::atomic<int32_t> s_numLiveBuffers;
+
+private:
+    virtual ~CountingBuffer() { s_numLiveBuffers--; }
+
+    std::atomic<int32_t> m_refCount;
+    VkDeviceSize         m_size;
+};
+
+std::atomic<int32_t> CountingBuffer::s_numLiveBuffers(0);
+
+typedef VulkanSizeClassedBufferPool<CountingBuffer> CountingBufferPool;
+
+struct CountingAllocator {
+    uint32_t numCalls;
+    VkDeviceSize lastSize;
+    VkResult result;
+
+    CountingAllocator() : numCalls(0), lastSize(0), result(VK_SUCCESS) {}
+
+    VkResult operator()(VkDeviceSize size, VkSharedBaseObj<CountingBuffer>& buffer)
+    {
+        numCalls++;
+        lastSize = size;
+        if (result == VK_SUCCESS) {
+            buffer = new CountingBuffer(size);
+        }
+        return result;
+    }
+};
+
+// The pool copies its allocate callable: it gets a reference to the counters
+struct AllocateRef {
+    CountingAllocator& allocator;
+    VkResult operator()(VkDeviceSize size, VkSharedBaseObj<CountingBuffer>& buffer) { return allocator(size, buffer); }
+};
+
+static const VkDeviceSize KB = 1024;
+static const VkDeviceSize MB = 1024 * 1024;
+
+PARSER_TEST(SizeClassedPoolClassRounding)
+{
+    TEST_CHECK(CountingBufferPool::GetSizeClassSize(0) == 64 * KB);
+    TEST_CHECK(CountingBufferPool::GetSizeClass(1) == 0);
+    TEST_CHECK(CountingBufferPool::GetSizeClass(64 * KB) == 0);
+    TEST_CHECK(CountingBufferPool::GetSizeClass(64 * KB + 1) == 1);
+    TEST_CHECK(CountingBufferPool::GetSizeClass(128 * KB) == 1);
+    TEST_CHECK(CountingBufferPool::GetSizeClass(3 * MB) == 6);
+    TEST_CHECK(CountingBufferPool::GetSizeClassSize(6) == 4 * MB);
+    TEST_CHECK(CountingBufferPool::GetSizeClassSize(CountingBufferPool::NUM_SIZE_CLASSES - 1) == 2048 * MB);
+
+    CountingAllocator allocator;
+    CountingBufferPool pool;
+
+    // Requests are allocated to the size of their class
+    VkSharedBaseObj<CountingBuffer> buffer;
+    TEST_REQUIRE(pool.GetBuffer(100 * KB, buffer, AllocateRef{ allocator }) == VK_SUCCESS);
+    TEST_CHECK(allocator.numCalls == 1);
+    TEST_CHECK(buffer->GetSize() == 128 * KB);
+    TEST_CHECK(pool.GetStats(1).allocations == 1);
+    TEST_CHECK(pool.GetStats(1).numBuffers == 1);
+
+    VkSharedBaseObj<CountingBuffer> smallBuffer;
+    TEST_REQUIRE(pool.GetBuffer(1, smallBuffer, AllocateRef{ allocator }) == VK_SUCCESS);
+    TEST_CHECK(smallBuffer->GetSize() == 64 * KB);
+
+    // Past the largest class, the requests are allocated to size and not pooled
+    const VkDeviceSize hugeSize = 3072 * MB;
+    VkSharedBaseObj<CountingBuffer> hugeBuffer;
+    TEST_REQUIRE(pool.GetBuffer(hugeSize, hugeBuffer, AllocateRef{ allocator }) == VK_SUCCESS);
+    TEST_CHECK(hugeBuffer->GetSize() == hugeSize);
+    TEST_CHECK(pool.GetStats(CountingBufferPool::NUM_SIZE_CLASSES - 1).numBuffers == 0);
+    hugeBuffer = nullptr;
+    TEST_REQUIRE(pool.GetBuffer(hugeSize, hugeBuffer, AllocateRef{ allocator }) == VK_SUCCESS);
+    TEST_CHECK(allocator.numCalls == 4);
+}
+
+PARSER_TEST(SizeClassedPoolReuse)
+{
+    CountingAllocator allocator;
+    {
+        CountingBufferPool pool(2);
+        const uint32_t sizeClass = CountingBufferPool::GetSizeClass(1 * MB);
+
+        VkSharedBaseObj<CountingBuffer> first;
+        TEST_REQUIRE(pool.GetBuffer(1 * MB, first, AllocateRef{ allocator }) == VK_SUCCESS);
+        CountingBuffer* pFirst = first;
+        first = nullptr;
+
+        // Any request of the class gets the idle buffer back
+        VkSharedBaseObj<CountingBuffer> second;
+        TEST_REQUIRE(pool.GetBuffer(600 * KB, second, AllocateRef{ allocator }) == VK_SUCCESS);
+        TEST_CHECK(second.Get() == pFirst);
+        TEST_CHECK(allocator.numCalls == 1);
+        TEST_CHECK(pool.GetStats(sizeClass).reuses == 1);
+
+        // A buffer in use is not handed out again
+        VkSharedBaseObj<CountingBuffer> third;
+        TEST_REQUIRE(pool.GetBuffer(1 * MB, third, AllocateRef{ allocator }) == VK_SUCCESS);
+        TEST_CHECK(third.Get() != second.Get());
+        TEST_CHECK(allocator.numCalls == 2);
+        TEST_CHECK(pool.GetStats(sizeClass).inUseHighWaterMark == 2);
+
+        // Nor is an idle buffer of a larger class
+        VkSharedBaseObj<CountingBuffer> larger;
+        TEST_REQUIRE(pool.GetBuffer(2 * MB, larger, AllocateRef{ allocator }) == VK_SUCCESS);
+        larger = nullptr;
+        VkSharedBaseObj<CountingBuffer> fourth;
+        TEST_REQUIRE(pool.GetBuffer(1 * MB, fourth, AllocateRef{ allocator }) == VK_SUCCESS);
+        TEST_CHECK(fourth->GetSize() == 1 * MB);
+        TEST_CHECK(allocator.numCalls == 4);
+
+        // Past maxBuffersPerClass, the buffers are handed out without being pooled
+        TEST_CHECK(pool.GetStats(sizeClass).allocations == 3);
+        TEST_CHECK(pool.GetStats(sizeClass).numBuffers == 2);
+        fourth = nullptr;
+        TEST_CHECK(pool.GetNumIdleBuffers() == 1); // The 2 MB buffer
+
+        // An allocation failure is returned, and leaves the pool as it was
+        allocator.result = VK_ERROR_OUT_OF_DEVICE_MEMORY;
+        VkSharedBaseObj<CountingBuffer> failed;
+        TEST_CHECK(pool.GetBuffer(1 * MB, failed, AllocateRef{ allocator }) == VK_ERROR_OUT_OF_DEVICE_MEMORY);
+        TEST_CHECK(!failed);
+        TEST_CHECK(pool.GetStats(sizeClass).allocations == 3);
+    }
+    TEST_CHECK(CountingBuffer::s_numLiveBuffers == 0);
+}
+
+PARSER_TEST(SizeClassedPoolReserve)
+{
+    CountingAllocator allocator;
+    CountingBufferPool pool(6);
+    const uint32_t sizeClass = CountingBufferPool::GetSizeClass(1 * MB);
+
+    TEST_REQUIRE(pool.Reserve(1 * MB, 4, AllocateRef{ allocator }) == VK_SUCCESS);
+    TEST_CHECK(allocator.numCalls == 4);
+    TEST_CHECK(allocator.lastSize == 1 * MB);
+    TEST_CHECK(pool.GetStats(sizeClass).numBuffers == 4);
+    TEST_CHECK(pool.GetNumIdleBuffers() == 4);
+
+    // A class that holds enough buffers already is left as it is
+    TEST_REQUIRE(pool.Reserve(700 * KB, 2, AllocateRef{ allocator }) == VK_SUCCESS);
+    TEST_CHECK(allocator.numCalls == 4);
+
+    // The reserved buffers serve the next requests of the class
+    VkSharedBaseObj<CountingBuffer> buffers[5];
+    for (uint32_t i = 0; i < 4; i++) {
+        TEST_REQUIRE(pool.GetBuffer(1 * MB, buffers[i], AllocateRef{ allocator }) == VK_SUCCESS);
+    }
+    TEST_CHECK(allocator.numCalls == 4);
+    TEST_CHECK(pool.GetStats(sizeClass).reuses == 4);
+    TEST_REQUIRE(pool.GetBuffer(1 * MB, buffers[4], AllocateRef{ allocator }) == VK_SUCCESS);
+    TEST_CHECK(allocator.numCalls == 5);
+    for (uint32_t i = 0; i < 5; i++) {
+        buffers[i] = nullptr;
+    }
+
+    // Reserve is bounded by maxBuffersPerClass
+    TEST_REQUIRE(pool.Reserve(1 * MB, 100, AllocateRef{ allocator }) == VK_SUCCESS);
+    TEST_CHECK(pool.GetStats(sizeClass).numBuffers == 6);
+    TEST_CHECK(allocator.numCalls == 6);
+
+    // The reserved buffers outlive the first trim, not the ones after it if they stay unused
+    TEST_CHECK(pool.Trim() == 0);
+    TEST_CHECK(pool.GetStats(sizeClass).numBuffers == 6);
+    TEST_CHECK(pool.Trim() == 6);
+    TEST_CHECK(pool.GetStats(sizeClass).numBuffers == 0);
+    TEST_CHECK(pool.GetStats(sizeClass).releases == 6);
+
+    // An allocation failure is returned, with the buffers allocated before it kept
+    allocator.result = VK_ERROR_OUT_OF_DEVICE_MEMORY;
+    TEST_CHECK(pool.Reserve(1 * MB, 2, AllocateRef{ allocator }) == VK_ERROR_OUT_OF_DEVICE_MEMORY);
+    TEST_CHECK(pool.GetStats(sizeClass).numBuffers == 0);
+}
+
+PARSER_TEST(SizeClassedPoolTrimInterval)
+{
+    CountingAllocator allocator;
+    {
+        CountingBufferPool pool;
+        TEST_REQUIRE(CountingBufferPool::DEFAULT_TRIM_INTERVAL == 256);
+        const uint32_t sizeClass = CountingBufferPool::GetSizeClass(1 * MB);
+        uint32_t numRequests = 0;
+
+        // A burst of 4 buffers in use at once
+        VkSharedBaseObj<CountingBuffer> burst[4];
+        for (uint32_t i = 0; i < 4; i++, numRequests++) {
+            TEST_REQUIRE(pool.GetBuffer(1 * MB, burst[i], AllocateRef{ allocator }) == VK_SUCCESS);
+        }
+        for (uint32_t i = 0; i < 4; i++) {
+            burst[i] = nullptr;
+        }
+        TEST_CHECK(allocator.numCalls == 4);
+
+        // Then one buffer at a time: the trim at the 256th request keeps the 4 buffers of the burst
+        for (; numRequests < 256; numRequests++) {
+            VkSharedBaseObj<CountingBuffer> buffer;
+            TEST_REQUIRE(pool.GetBuffer(1 * MB, buffer, AllocateRef{ allocator }) == VK_SUCCESS);
+        }
+        TEST_CHECK(pool.GetStats(sizeClass).numBuffers == 4);
+        TEST_CHECK(pool.GetStats(sizeClass).releases == 0);
+        TEST_CHECK(pool.GetStats(sizeClass).inUseHighWaterMark == 1); // The buffer of the request that trimmed
+
+        // No trim before the next 256 requests
+        for (; numRequests < 511; numRequests++) {
+            VkSharedBaseObj<CountingBuffer> buffer;
+            TEST_REQUIRE(pool.GetBuffer(1 * MB, buffer, AllocateRef{ allocator }) == VK_SUCCESS);
+        }
+        TEST_CHECK(pool.GetStats(sizeClass).numBuffers == 4);
+        TEST_CHECK(CountingBuffer::s_numLiveBuffers == 4);
+
+        // The 512th request trims the class down to its high-water mark since the last trim
+        VkSharedBaseObj<CountingBuffer> buffer;
+        TEST_REQUIRE(pool.GetBuffer(1 * MB, buffer, AllocateRef{ allocator }) == VK_SUCCESS);
+        TEST_CHECK(pool.GetStats(sizeClass).numBuffers == 1);
+        TEST_CHECK(pool.GetStats(sizeClass).releases == 3);
+        TEST_CHECK(CountingBuffer::s_numLiveBuffers == 1);
+        TEST_CHECK(allocator.numCalls == 4);
+
+        // The buffer in use is kept, and served the trimming request
+        TEST_CHECK(buffer->GetRefCount() == 2);
+        buffer = nullptr;
+        VkSharedBaseObj<CountingBuffer> next;
+        TEST_REQUIRE(pool.GetBuffer(1 * MB, next, AllocateRef{ allocator }) == VK_SUCCESS);
+        TEST_CHECK(allocator.numCalls == 4);
+    }
+    TEST_CHECK(CountingBuffer::s_numLiveBuffers == 0);
+}
@@ -0,0 +1,287 @@
+/*
+ * Copyright 2024 NVIDIA Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// The access unit index of the Annex-B elementary streams: AccessUnitPreparser on synthetic H.264
+// and H.265 streams, the VkVideoStreamIndex sidecar file, and the packet ElementaryStream::Seek()
+// builds from the index, parameter sets first and with an H.265 CRA picture turned into a BLA one.
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+#include "ParserTests.h"
+#include "SyntheticStreams.h"
+#include "VkDecoderUtils/AccessUnitPreparser.h"
+#include "VkDecoderUtils/VideoStreamDemuxer.h"
+
+static const char* s_indexFileName = "vulkan-video-parser-tests.idx";
+static const char* s_streamFileName = "vulkan-video-parser-tests.es";
+
+// 64x64, two slices per frame, an IDR picture every 8 frames
+static const H264StreamDesc s_h264Stream = { 4, 4, 1, 20, 8, 3, 2 };
+
+// A CRA picture followed by a RASL picture in decoding order
+static const H265PictureDesc s_h265Pictures[] = {
+    { H265_NUT_IDR_W_RADL,  0,  0, false },
+    { H265_NUT_TRAIL_R,     1,  0, false },
+    { H265_NUT_TRAIL_R,     2,  1, false },
+    { H265_NUT_CRA,         4,  4, false },
+    { H265_NUT_RASL_N,      3,  4, false },
+    { H265_NUT_TRAIL_R,     5,  4, false },
+    { H265_NUT_TRAIL_R,     6,  5, false },
+};
+
+static std::vector<uint8_t> BuildH265TestStream()
+{
+    return BuildH265Stream(std::vector<H265PictureDesc>(s_h265Pictures,
+                                                        s_h265Pictures + sizeof(s_h265Pictures) / sizeof(s_h265Pictures[0])));
+}
+
+// Bytes of the stream range, its start code prefix included
+static std::vector<uint8_t> RangeData(const std::vector<uint8_t>& stream, int64_t offset, int64_t size)
+{
+    return std::vector<uint8_t>(stream.begin() + (size_t)offset, stream.begin() + (size_t)(offset + size));
+}
+
+// The access units tile the whole stream, each starting with its start code
+static void CheckAccessUnitsCoverStream(const VkVideoStreamIndex& index, const std::vector<uint8_t>& stream)
+{
+    int64_t offset = 0;
+    for (size_t i = 0; i < index.accessUnits.size(); i++) {
+        TEST_CHECK(index.accessUnits[i].offset == offset);
+        TEST_CHECK(index.accessUnits[i].size > 4);
+        TEST_CHECK(memcmp(&stream[(size_t)offset], "\x00\x00\x00\x01", 4) == 0);
+        offset += index.accessUnits[i].size;
+    }
+    TEST_CHECK(offset == (int64_t)stream.size());
+}
+
+PARSER_TEST(StreamIndexH264AccessUnits)
+{
+    const std::vector<uint8_t> stream = BuildH264Stream(s_h264Stream);
+    VkVideoStreamIndex index;
+    TEST_REQUIRE(AccessUnitPreparser::Preparse(VK_VIDEO_CODEC_OPERATION_DECODE_H264_BIT_KHR,
+                                               stream.data(), stream.size(), 1, index));
+    TEST_CHECK(index.codecType == VK_VIDEO_CODEC_OPERATION_DECODE_H264_BIT_KHR);
+    TEST_CHECK(index.streamSize == stream.size());
+    TEST_REQUIRE(index.accessUnits.size() == s_h264Stream.numFrames);
+    CheckAccessUnitsCoverStream(index, stream);
+    for (uint32_t i = 0; i < s_h264Stream.numFrames; i++) {
+        TEST_CHECK(index.accessUnits[i].isIrap == ((i % s_h264Stream.idrPeriod) == 0));
+        TEST_CHECK(!index.accessUnits[i].isRasl);
+    }
+
+    // The parameter sets of the first access unit are in it, the next random access points resend them
+    TEST_REQUIRE(index.randomAccessPoints.size() == 3);
+    TEST_CHECK(index.randomAccessPoints[0].accessUnit == 0);
+    TEST_CHECK(index.randomAccessPoints[0].numParameterSets == 0);
+    for (uint32_t i = 1; i < 3; i++) {
+        const VkVideoRandomAccessPoint& rap = index.randomAccessPoints[i];
+        TEST_CHECK(rap.accessUnit == i * s_h264Stream.idrPeriod);
+        TEST_REQUIRE(rap.numParameterSets == 2);
+        TEST_REQUIRE((rap.firstParameterSet + rap.numParameterSets) <= index.parameterSets.size());
+        const VkVideoStreamRange& sps = index.parameterSets[rap.firstParameterSet];
+        const VkVideoStreamRange& pps = index.parameterSets[rap.firstParameterSet + 1];
+        TEST_CHECK(memcmp(&stream[(size_t)sps.offset], "\x00\x00\x01\x67", 4) == 0);
+        TEST_CHECK(memcmp(&stream[(size_t)pps.offset], "\x00\x00\x01\x68", 4) == 0);
+        // Each range ends where the zero_byte of the next start code begins
+        TEST_CHECK(sps.offset + sps.size + 1 == pps.offset);
+        TEST_CHECK(stream[(size_t)(sps.offset + sps.size - 1)] != 0);
+    }
+    TEST_CHECK(index.FindRandomAccessPoint(7) == &index.randomAccessPoints[0]);
+    TEST_CHECK(index.FindRandomAccessPoint(8) == &index.randomAccessPoints[1]);
+    TEST_CHECK(index.FindRandomAccessPoint(19) == &index.randomAccessPoints[2]);
+}
+
+PARSER_TEST(StreamIndexH265AccessUnits)
+{
+    const std::vector<uint8_t> stream = BuildH265TestStream();
+    VkVideoStreamIndex index;
+    TEST_REQUIRE(AccessUnitPreparser::Preparse(VK_VIDEO_CODEC_OPERATION_DECODE_H265_BIT_KHR,
+                                               stream.data(), stream.size(), 1, index));
+    TEST_REQUIRE(index.accessUnits.size() == 7);
+    CheckAccessUnitsCoverStream(index, stream);
+    TEST_CHECK(index.accessUnits[0].isIrap && index.accessUnits[3].isIrap);
+    TEST_CHECK(!index.accessUnits[1].isIrap && !index.accessUnits[4].isIrap);
+    TEST_CHECK(index.accessUnits[4].isRasl);
+    TEST_CHECK(!index.accessUnits[3].isRasl && !index.accessUnits[5].isRasl);
+
+    TEST_REQUIRE(index.randomAccessPoints.size() == 2);
+    const VkVideoRandomAccessPoint& cra = index.randomAccessPoints[1];
+    TEST_CHECK(cra.accessUnit == 3);
+    TEST_REQUIRE(cra.numParameterSets == 3);
+    const uint8_t nalUnitTypes[3] = { 32, 33, 34 }; // VPS, SPS, PPS
+    for (uint32_t i = 0; i < 3; i++) {
+        const VkVideoStreamRange& parameterSet = index.parameterSets[cra.firstParameterSet + i];
+        TEST_CHECK(((stream[(size_t)parameterSet.offset + 3] >> 1) & 0x3f) == nalUnitTypes[i]);
+    }
+}
+
+PARSER_TEST(StreamIndexSaveLoad)
+{
+    const std::vector<uint8_t> stream = BuildH264Stream(s_h264Stream);
+    VkVideoStreamIndex index;
+    TEST_REQUIRE(AccessUnitPreparser::Preparse(VK_VIDEO_CODEC_OPERATION_DECODE_H264_BIT_KHR,
+                                               stream.data(), stream.size(), 1, index));
+    TEST_REQUIRE(index.Save(s_indexFileName));
+
+    VkVideoStreamIndex loaded;
+    TEST_REQUIRE(loaded.Load(s_indexFileName, VK_VIDEO_CODEC_OPERATION_DECODE_H264_BIT_KHR, stream.size()));
+    TEST_CHECK(loaded.codecType == index.codecType);
+    TEST_CHECK(loaded.streamSize == index.streamSize);
+    TEST_REQUIRE(loaded.accessUnits.size() == index.accessUnits.size());
+    for (size_t i = 0; i < index.accessUnits.size(); i++) {
+        TEST_CHECK(loaded.accessUnits[i].offset == index.accessUnits[i].offset);
+        TEST_CHECK(loaded.accessUnits[i].size == index.accessUnits[i].size);
+        TEST_CHECK(loaded.accessUnits[i].isIrap == index.accessUnits[i].isIrap);
+        TEST_CHECK(loaded.accessUnits[i].isRasl == index.accessUnits[i].isRasl);
+    }
+    TEST_REQUIRE(loaded.randomAccessPoints.size() == index.randomAccessPoints.size());
+    for (size_t i = 0; i < index.randomAccessPoints.size(); i++) {
+        TEST_CHECK(loaded.randomAccessPoints[i].accessUnit == index.randomAccessPoints[i].accessUnit);
+        TEST_CHECK(loaded.randomAccessPoints[i].firstParameterSet == index.randomAccessPoints[i].firstParameterSet);
+        TEST_CHECK(loaded.randomAccessPoints[i].numParameterSets == index.randomAccessPoints[i].numParameterSets);
+    }
+    TEST_REQUIRE(loaded.parameterSets.size() == index.parameterSets.size());
+    for (size_t i = 0; i < index.parameterSets.size(); i++) {
+        TEST_CHECK(loaded.parameterSets[i].offset == index.parameterSets[i].offset);
+        TEST_CHECK(loaded.parameterSets[i].size == index.parameterSets[i].size);
+    }
+
+    // An index built for another stream is rejected, and leaves the index empty
+    TEST_CHECK(!loaded.Load(s_indexFileName, VK_VIDEO_CODEC_OPERATION_DECODE_H265_BIT_KHR, stream.size()));
+    TEST_CHECK(loaded.accessUnits.empty() && (loaded.codecType == VK_VIDEO_CODEC_OPERATION_NONE_KHR));
+    TEST_CHECK(!loaded.Load(s_indexFileName, VK_VIDEO_CODEC_OPERATION_DECODE_H264_BIT_KHR, stream.size() + 1));
+    TEST_CHECK(!loaded.Load(s_indexFileName, VK_VIDEO_CODEC_OPERATION_DECODE_H264_BIT_KHR, stream.size() - 1));
+    TEST_CHECK(loaded.accessUnits.empty());
+
+    // A truncated index file
+    std::vector<uint8_t> indexFile;
+    FILE* file = fopen(s_indexFileName, "rb");
+    TEST_REQUIRE(file != nullptr);
+    uint8_t buffer[256];
+    size_t readSize;
+    while ((readSize = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+        indexFile.insert(indexFile.end(), buffer, buffer + readSize);
+    }
+    fclose(file);
+    indexFile.resize(indexFile.size() - 1);
+    TEST_REQUIRE(WriteStreamFile(s_indexFileName, indexFile));
+    TEST_CHECK(!loaded.Load(s_indexFileName, VK_VIDEO_CODEC_OPERATION_DECODE_H264_BIT_KHR, stream.size()));
+    TEST_CHECK(loaded.accessUnits.empty());
+
+    remove(s_indexFileName);
+}
+
+PARSER_TEST(StreamIndexSeekH264)
+{
+    const std::vector<uint8_t> stream = BuildH264Stream(s_h264Stream);
+    VkVideoStreamIndex index;
+    TEST_REQUIRE(AccessUnitPreparser::Preparse(VK_VIDEO_CODEC_OPERATION_DECODE_H264_BIT_KHR,
+                                               stream.data(), stream.size(), 1, index));
+    TEST_REQUIRE(WriteStreamFile(s_streamFileName, stream));
+
+    {
+        VkSharedBaseObj<VideoStreamDemuxer> demuxer;
+        TEST_REQUIRE(ElementaryStreamCreate(s_streamFileName, VK_VIDEO_CODEC_OPERATION_DECODE_H264_BIT_KHR,
+                                            64, 64, 8, demuxer) == VK_SUCCESS);
+        TEST_REQUIRE(demuxer->PreparseAccessUnits(1, nullptr));
+
+        // Frame 11 resumes at the IDR picture of frame 8, preceded by the SPS and PPS
+        TEST_REQUIRE(demuxer->Seek(0, 11, 0));
+        const VkVideoRandomAccessPoint& rap = index.randomAccessPoints[1];
+        const VkVideoStreamRange& sps = index.parameterSets[rap.firstParameterSet];
+        const VkVideoStreamRange& pps = index.parameterSets[rap.firstParameterSet + 1];
+        const VkVideoAccessUnit& idr = index.accessUnits[8];
+        std::vector<uint8_t> expected = RangeData(stream, sps.offset, sps.size);
+        const std::vector<uint8_t> ppsData = RangeData(stream, pps.offset, pps.size);
+        const std::vector<uint8_t> idrData = RangeData(stream, idr.offset, idr.size);
+        expected.insert(expected.end(), ppsData.begin(), ppsData.end());
+        expected.insert(expected.end(), idrData.begin(), idrData.end());
+
+        const uint8_t* pData = nullptr;
+        int64_t size = demuxer->DemuxFrame(&pData);
+        TEST_REQUIRE((size == (int64_t)expected.size()) && (pData != nullptr));
+        TEST_CHECK(memcmp(pData, expected.data(), expected.size()) == 0);
+
+        // Then the access units that follow it, in place
+        size = demuxer->DemuxFrame(&pData);
+        TEST_CHECK(size == index.accessUnits[9].size);
+        TEST_CHECK(pData != nullptr);
+
+        // Frame 3 resumes at the start of the stream, which holds the parameter sets already
+        TEST_REQUIRE(demuxer->Seek(0, 3, 0));
+        size = demuxer->DemuxFrame(&pData);
+        TEST_REQUIRE((size == index.accessUnits[0].size) && (pData != nullptr));
+        TEST_CHECK(memcmp(pData, stream.data(), (size_t)size) == 0);
+
+        // Past the end of the stream: the last random access point
+        TEST_REQUIRE(demuxer->Seek(0, 1000, 0));
+        size = demuxer->DemuxFrame(&pData);
+        TEST_CHECK(size == (int64_t)(sps.size + pps.size + index.accessUnits[16].size));
+        TEST_CHECK(!demuxer->Seek(0, -1, 0));
+    }
+    remove(s_streamFileName);
+}
+
+PARSER_TEST(StreamIndexSeekH265CraAsBla)
+{
+    const std::vector<uint8_t> stream = BuildH265TestStream();
+    VkVideoStreamIndex index;
+    TEST_REQUIRE(AccessUnitPreparser::Preparse(VK_VIDEO_CODEC_OPERATION_DECODE_H265_BIT_KHR,
+                                               stream.data(), stream.size(), 1, index));
+    TEST_REQUIRE(WriteStreamFile(s_streamFileName, stream));
+
+    {
+        VkSharedBaseObj<VideoStreamDemuxer> demuxer;
+        TEST_REQUIRE(ElementaryStreamCreate(s_streamFileName, VK_VIDEO_CODEC_OPERATION_DECODE_H265_BIT_KHR,
+                                            64, 64, 8, demuxer) == VK_SUCCESS);
+
+        // Seek() builds the index on first use
+        TEST_REQUIRE(demuxer->Seek(0, 5, 0));
+        const VkVideoRandomAccessPoint& rap = index.randomAccessPoints[1];
+        std::vector<uint8_t> expected;
+        for (uint32_t i = 0; i < rap.numParameterSets; i++) {
+            const VkVideoStreamRange& parameterSet = index.parameterSets[rap.firstParameterSet + i];
+            const std::vector<uint8_t> data = RangeData(stream, parameterSet.offset, parameterSet.size);
+            expected.insert(expected.end(), data.begin(), data.end());
+        }
+        const size_t craStart = expected.size();
+        const VkVideoAccessUnit& cra = index.accessUnits[rap.accessUnit];
+        const std::vector<uint8_t> craData = RangeData(stream, cra.offset, cra.size);
+        expected.insert(expected.end(), craData.begin(), craData.end());
+        TEST_REQUIRE(((expected[craStart + 4] >> 1) & 0x3f) == H265_NUT_CRA);
+        expected[craStart + 4] = (uint8_t)(16 << 1); // BLA_W_LP, nuh_layer_id 0
+
+        const uint8_t* pData = nullptr;
+        int64_t size = demuxer->DemuxFrame(&pData);
+        TEST_REQUIRE((size == (int64_t)expected.size()) && (pData != nullptr));
+        TEST_CHECK(memcmp(pData, expected.data(), expected.size()) == 0);
+
+        // The RASL picture that follows the CRA picture is dropped
+        size = demuxer->DemuxFrame(&pData);
+        TEST_REQUIRE((size == index.accessUnits[5].size) && (pData != nullptr));
+        TEST_CHECK(memcmp(pData, &stream[(size_t)index.accessUnits[5].offset], (size_t)size) == 0);
+
+        // From the start of the stream, it is kept
+        demuxer->Rewind();
+        for (uint32_t i = 0; i < 5; i++) {
+            size = demuxer->DemuxFrame(&pData);
+            TEST_CHECK(size == index.accessUnits[i].size);
+        }
+    }
+    remove(s_streamFileName);
+}
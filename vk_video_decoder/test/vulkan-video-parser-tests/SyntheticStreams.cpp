@@ -0,0 +1,305 @@
+/*
+ * Copyright 2024 NVIDIA Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+
+#include "SyntheticStreams.h"
+
+void AppendNalUnit(std::vector<uint8_t>& stream, const uint8_t* pNalHeader, uint32_t nalHeaderSize,
+                   const std::vector<uint8_t>& rbsp)
+{
+    static const uint8_t startCode[] = { 0, 0, 0, 1 };
+    stream.insert(stream.end(), startCode, startCode + sizeof(startCode));
+    stream.insert(stream.end(), pNalHeader, pNalHeader + nalHeaderSize);
+    uint32_t numZeros = 0;
+    for (size_t i = 0; i < rbsp.size(); i++) {
+        if ((numZeros == 2) && (rbsp[i] <= 3)) {
+            stream.push_back(3);
+            numZeros = 0;
+        }
+        stream.push_back(rbsp[i]);
+        numZeros = (rbsp[i] == 0) ? (numZeros + 1) : 0;
+    }
+}
+
+std::vector<uint8_t> BuildH264Stream(const H264StreamDesc& desc)
+{
+    const uint32_t log2MaxFrameNum = 4;
+    std::vector<uint8_t> stream;
+
+    RbspWriter sps;
+    sps.u(66, 8);                  // profile_idc: baseline
+    sps.u(0, 8);                   // constraint_set_flags
+    sps.u(30, 8);                  // level_idc
+    sps.ue(0);                     // seq_parameter_set_id
+    sps.ue(log2MaxFrameNum - 4);   // log2_max_frame_num_minus4
+    sps.ue(2);                     // pic_order_cnt_type: output in decoding order
+    sps.ue(desc.maxNumRefFrames);  // max_num_ref_frames
+    sps.u(0, 1);                   // gaps_in_frame_num_value_allowed_flag
+    sps.ue(desc.widthInMbs - 1);   // pic_width_in_mbs_minus1
+    sps.ue(desc.heightInMbs - 1);  // pic_height_in_map_units_minus1
+    sps.u(1, 1);                   // frame_mbs_only_flag
+    sps.u(1, 1);                   // direct_8x8_inference_flag
+    sps.u(0, 1);                   // frame_cropping_flag
+    sps.u(0, 1);                   // vui_parameters_present_flag
+    sps.TrailingBits();
+    AppendNalUnit(stream, 0x67, sps.Data());
+
+    RbspWriter pps;
+    pps.ue(0);                     // pic_parameter_set_id
+    pps.ue(0);                     // seq_parameter_set_id
+    pps.u(0, 1);                   // entropy_coding_mode_flag
+    pps.u(0, 1);                   // bottom_field_pic_order_in_frame_present_flag
+    pps.ue(0);                     // num_slice_groups_minus1
+    pps.ue(0);                     // num_ref_idx_l0_default_active_minus1
+    pps.ue(0);                     // num_ref_idx_l1_default_active_minus1
+    pps.u(0, 1);                   // weighted_pred_flag
+    pps.u(0, 2);                   // weighted_bipred_idc
+    pps.se(0);                     // pic_init_qp_minus26
+    pps.se(0);                     // pic_init_qs_minus26
+    pps.se(0);                     // chroma_qp_index_offset
+    pps.u(1, 1);                   // deblocking_filter_control_present_flag
+    pps.u(0, 1);                   // constrained_intra_pred_flag
+    pps.u(0, 1);                   // redundant_pic_cnt_present_flag
+    pps.TrailingBits();
+    AppendNalUnit(stream, 0x68, pps.Data());
+
+    const uint32_t mbsPerSlice = (desc.widthInMbs * desc.heightInMbs) / desc.slicesPerFrame;
+    uint32_t frameNum = 0;
+    uint32_t idrPicId = 0;
+    for (uint32_t frame = 0; frame < desc.numFrames; frame++) {
+        const uint32_t gopFrame = frame % desc.idrPeriod;
+        const bool idr = (gopFrame == 0);
+        const bool refPic = idr || (desc.nonRefPeriod == 0) || ((gopFrame % desc.nonRefPeriod) != 0);
+        const bool lost = (frame < 32) && ((desc.lostFrames >> frame) & 1);
+        if (idr) {
+            frameNum = 0;
+        }
+        if (!lost && (frame < 32) && ((desc.recoveryPointFrames >> frame) & 1)) {
+            RbspWriter sei;
+            sei.u(6, 8);                               // last_payload_type_byte: recovery_point
+            sei.u(1, 8);                               // last_payload_size_byte
+            sei.ue(0);                                 // recovery_frame_cnt
+            sei.u(1, 1);                               // exact_match_flag
+            sei.u(0, 1);                               // broken_link_flag
+            sei.u(0, 2);                               // changing_slice_group_idc
+            sei.ByteAlign();
+            sei.TrailingBits();
+            AppendNalUnit(stream, 0x06, sei.Data());
+        }
+        for (uint32_t slice = 0; !lost && (slice < desc.slicesPerFrame); slice++) {
+            RbspWriter slh;
+            slh.ue(slice * mbsPerSlice);               // first_mb_in_slice
+            slh.ue(idr ? 7 : 5);                       // slice_type: I or P, for all the slices of the picture
+            slh.ue(0);                                 // pic_parameter_set_id
+            slh.u(frameNum, log2MaxFrameNum);          // frame_num
+            if (idr) {
+                slh.ue(idrPicId);                      // idr_pic_id
+            } else {
+                slh.u(0, 1);                           // num_ref_idx_active_override_flag
+                slh.u(0, 1);                           // ref_pic_list_modification_flag_l0
+            }
+            if (refPic) {
+                if (idr) {
+                    slh.u(0, 1);                       // no_output_of_prior_pics_flag
+                    slh.u(0, 1);                       // long_term_reference_flag
+                } else {
+                    slh.u(0, 1);                       // adaptive_ref_pic_marking_mode_flag
+                }
+            }
+            slh.se(0);                                 // slice_qp_delta
+            slh.ue(1);                                 // disable_deblocking_filter_idc
+            for (uint32_t i = 0; i < 16 + frame; i++) { // slice_data()
+                slh.u(0xa5, 8);
+            }
+            slh.TrailingBits();
+            const uint8_t nalRefIdc = refPic ? (idr ? 3 : 2) : 0;
+            AppendNalUnit(stream, (uint8_t)((nalRefIdc << 5) | (idr ? 5 : 1)), slh.Data());
+        }
+        if (refPic) {
+            frameNum = (frameNum + 1) % (1 << log2MaxFrameNum);
+        }
+        idrPicId += idr ? 1 : 0;
+    }
+    return stream;
+}
+
+static void AppendH265NalUnit(std::vector<uint8_t>& stream, uint32_t nalUnitType, const std::vector<uint8_t>& rbsp)
+{
+    const uint8_t nalHeader[2] = { (uint8_t)(nalUnitType << 1), 1 }; // nuh_layer_id 0, nuh_temporal_id_plus1 1
+    AppendNalUnit(stream, nalHeader, sizeof(nalHeader), rbsp);
+}
+
+static void WriteH265ProfileTierLevel(RbspWriter& rbsp)
+{
+    rbsp.u(0, 2);                  // general_profile_space
+    rbsp.u(0, 1);                  // general_tier_flag
+    rbsp.u(1, 5);                  // general_profile_idc: Main
+    rbsp.u(0x6000, 16);            // general_profile_compatibility_flag[0..15]
+    rbsp.u(0, 16);                 // general_profile_compatibility_flag[16..31]
+    rbsp.u(0, 24);                 // general source/constraint flags, general_reserved_zero_43bits
+    rbsp.u(0, 24);
+    rbsp.u(90, 8);                 // general_level_idc: 3.0
+}
+
+std::vector<uint8_t> BuildH265Stream(const std::vector<H265PictureDesc>& pictures)
+{
+    const uint32_t log2MaxPocLsb = 8;
+    const uint32_t maxDecPicBufferingMinus1 = 4;
+    std::vector<uint8_t> stream;
+
+    RbspWriter vps;
+    vps.u(0, 4);                   // vps_video_parameter_set_id
+    vps.u(1, 1);                   // vps_base_layer_internal_flag
+    vps.u(1, 1);                   // vps_base_layer_available_flag
+    vps.u(0, 6);                   // vps_max_layers_minus1
+    vps.u(0, 3);                   // vps_max_sub_layers_minus1
+    vps.u(1, 1);                   // vps_temporal_id_nesting_flag
+    vps.u(0xffff, 16);             // vps_reserved_0xffff_16bits
+    WriteH265ProfileTierLevel(vps);
+    vps.u(1, 1);                   // vps_sub_layer_ordering_info_present_flag
+    vps.ue(maxDecPicBufferingMinus1); // vps_max_dec_pic_buffering_minus1
+    vps.ue(0);                     // vps_max_num_reorder_pics
+    vps.ue(0);                     // vps_max_latency_increase_plus1
+    vps.u(0, 6);                   // vps_max_layer_id
+    vps.ue(0);                     // vps_num_layer_sets_minus1
+    vps.u(0, 1);                   // vps_timing_info_present_flag
+    vps.u(0, 1);                   // vps_extension_flag
+    vps.TrailingBits();
+    AppendH265NalUnit(stream, 32, vps.Data());
+
+    RbspWriter sps;
+    sps.u(0, 4);                   // sps_video_parameter_set_id
+    sps.u(0, 3);                   // sps_max_sub_layers_minus1
+    sps.u(1, 1);                   // sps_temporal_id_nesting_flag
+    WriteH265ProfileTierLevel(sps);
+    sps.ue(0);                     // sps_seq_parameter_set_id
+    sps.ue(1);                     // chroma_format_idc: 4:2:0
+    sps.ue(64);                    // pic_width_in_luma_samples
+    sps.ue(64);                    // pic_height_in_luma_samples
+    sps.u(0, 1);                   // conformance_window_flag
+    sps.ue(0);                     // bit_depth_luma_minus8
+    sps.ue(0);                     // bit_depth_chroma_minus8
+    sps.ue(log2MaxPocLsb - 4);     // log2_max_pic_order_cnt_lsb_minus4
+    sps.u(1, 1);                   // sps_sub_layer_ordering_info_present_flag
+    sps.ue(maxDecPicBufferingMinus1); // sps_max_dec_pic_buffering_minus1
+    sps.ue(0);                     // sps_max_num_reorder_pics: output in decoding order
+    sps.ue(0);                     // sps_max_latency_increase_plus1
+    sps.ue(0);                     // log2_min_luma_coding_block_size_minus3
+    sps.ue(1);                     // log2_diff_max_min_luma_coding_block_size: 16x16 CTBs
+    sps.ue(0);                     // log2_min_luma_transform_block_size_minus2
+    sps.ue(0);                     // log2_diff_max_min_luma_transform_block_size
+    sps.ue(0);                     // max_transform_hierarchy_depth_inter
+    sps.ue(0);                     // max_transform_hierarchy_depth_intra
+    sps.u(0, 1);                   // scaling_list_enabled_flag
+    sps.u(0, 1);                   // amp_enabled_flag
+    sps.u(0, 1);                   // sample_adaptive_offset_enabled_flag
+    sps.u(0, 1);                   // pcm_enabled_flag
+    sps.ue(0);                     // num_short_term_ref_pic_sets: all the RPS are in the slice headers
+    sps.u(0, 1);                   // long_term_ref_pics_present_flag
+    sps.u(0, 1);                   // sps_temporal_mvp_enabled_flag
+    sps.u(0, 1);                   // strong_intra_smoothing_enabled_flag
+    sps.u(0, 1);                   // vui_parameters_present_flag
+    sps.u(0, 1);                   // sps_extension_present_flag
+    sps.TrailingBits();
+    AppendH265NalUnit(stream, 33, sps.Data());
+
+    RbspWriter pps;
+    pps.ue(0);                     // pps_pic_parameter_set_id
+    pps.ue(0);                     // pps_seq_parameter_set_id
+    pps.u(0, 1);                   // dependent_slice_segments_enabled_flag
+    pps.u(0, 1);                   // output_flag_present_flag
+    pps.u(0, 3);                   // num_extra_slice_header_bits
+    pps.u(0, 1);                   // sign_data_hiding_enabled_flag
+    pps.u(0, 1);                   // cabac_init_present_flag
+    pps.ue(0);                     // num_ref_idx_l0_default_active_minus1
+    pps.ue(0);                     // num_ref_idx_l1_default_active_minus1
+    pps.se(0);                     // init_qp_minus26
+    pps.u(0, 1);                   // constrained_intra_pred_flag
+    pps.u(0, 1);                   // transform_skip_enabled_flag
+    pps.u(0, 1);                   // cu_qp_delta_enabled_flag
+    pps.se(0);                     // pps_cb_qp_offset
+    pps.se(0);                     // pps_cr_qp_offset
+    pps.u(0, 1);                   // pps_slice_chroma_qp_offsets_present_flag
+    pps.u(0, 1);                   // weighted_pred_flag
+    pps.u(0, 1);                   // weighted_bipred_flag
+    pps.u(0, 1);                   // transquant_bypass_enabled_flag
+    pps.u(0, 1);                   // tiles_enabled_flag
+    pps.u(0, 1);                   // entropy_coding_sync_enabled_flag
+    pps.u(0, 1);                   // pps_loop_filter_across_slices_enabled_flag
+    pps.u(0, 1);                   // deblocking_filter_control_present_flag
+    pps.u(0, 1);                   // pps_scaling_list_data_present_flag
+    pps.u(0, 1);                   // lists_modification_present_flag
+    pps.ue(0);                     // log2_parallel_merge_level_minus2
+    pps.u(0, 1);                   // slice_segment_header_extension_present_flag
+    pps.u(0, 1);                   // pps_extension_present_flag
+    pps.TrailingBits();
+    AppendH265NalUnit(stream, 34, pps.Data());
+
+    for (size_t i = 0; i < pictures.size(); i++) {
+        const H265PictureDesc& picture = pictures[i];
+        const bool irap = (picture.nalUnitType >= 16) && (picture.nalUnitType <= 23);
+        const bool idr = (picture.nalUnitType == H265_NUT_IDR_W_RADL);
+        if (picture.recoveryPoint) {
+            RbspWriter sei;
+            sei.u(6, 8);                               // last_payload_type_byte: recovery_point
+            sei.u(1, 8);                               // last_payload_size_byte
+            sei.se(0);                                 // recovery_poc_cnt
+            sei.u(1, 1);                               // exact_match_flag
+            sei.u(0, 1);                               // broken_link_flag
+            sei.ByteAlign();
+            sei.TrailingBits();
+            AppendH265NalUnit(stream, 39, sei.Data()); // PREFIX_SEI_NUT
+        }
+        RbspWriter slh;
+        slh.u(1, 1);                                   // first_slice_segment_in_pic_flag
+        if (irap) {
+            slh.u(0, 1);                               // no_output_of_prior_pics_flag
+        }
+        slh.ue(0);                                     // slice_pic_parameter_set_id
+        slh.ue(irap ? 2 : 1);                          // slice_type: I or P
+        if (!idr) {
+            slh.u((uint32_t)picture.poc & ((1 << log2MaxPocLsb) - 1), log2MaxPocLsb); // slice_pic_order_cnt_lsb
+            slh.u(0, 1);                               // short_term_ref_pic_set_sps_flag
+            const int32_t deltaPoc = picture.refPoc - picture.poc;
+            slh.ue((!irap && (deltaPoc < 0)) ? 1 : 0); // num_negative_pics
+            slh.ue((!irap && (deltaPoc > 0)) ? 1 : 0); // num_positive_pics
+            if (!irap) {
+                slh.ue((deltaPoc < 0) ? (-deltaPoc - 1) : (deltaPoc - 1)); // delta_poc_s0/s1_minus1
+                slh.u(1, 1);                           // used_by_curr_pic_s0/s1_flag
+            }
+        }
+        if (!irap) {
+            slh.u(0, 1);                               // num_ref_idx_active_override_flag
+        }
+        for (uint32_t j = 0; j < 16 + i; j++) {        // rest of the slice header, slice_data()
+            slh.u(0xa5, 8);
+        }
+        slh.TrailingBits();
+        AppendH265NalUnit(stream, picture.nalUnitType, slh.Data());
+    }
+    return stream;
+}
+
+bool WriteStreamFile(const char* pFileName, const std::vector<uint8_t>& stream)
+{
+    FILE* file = fopen(pFileName, "wb");
+    if (file == nullptr) {
+        return false;
+    }
+    const bool success = stream.empty() || (fwrite(stream.data(), stream.size(), 1, file) == 1);
+    return (fclose(file) == 0) && success;
+}
@@ -0,0 +1,119 @@
+/*
+ * Copyright 2024 NVIDIA Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _SYNTHETICSTREAMS_H_
+#define _SYNTHETICSTREAMS_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+// Synthetic H.264 and H.265 Annex-B streams: parameter sets, SEI and slice headers, followed by
+// slice data the parser does not read.
+class RbspWriter
+{
+public:
+    RbspWriter() : m_data(), m_numBits(0) {}
+
+    void u(uint32_t value, uint32_t numBits)
+    {
+        for (uint32_t i = numBits; i > 0; i--) {
+            if ((m_numBits & 7) == 0) {
+                m_data.push_back(0);
+            }
+            m_data.back() |= (uint8_t)(((value >> (i - 1)) & 1) << (7 - (m_numBits & 7)));
+            m_numBits++;
+        }
+    }
+
+    void ue(uint32_t value)
+    {
+        uint32_t leadingZeroBits = 0;
+        while (((uint64_t)value + 1) >> (leadingZeroBits + 1)) {
+            leadingZeroBits++;
+        }
+        u(0, leadingZeroBits);
+        u(value + 1, leadingZeroBits + 1);
+    }
+
+    void se(int32_t value) { ue((value > 0) ? (2 * value - 1) : (-2 * value)); }
+
+    void ByteAlign()
+    {
+        while (m_numBits & 7) {
+            u(0, 1);
+        }
+    }
+
+    void TrailingBits()
+    {
+        u(1, 1);
+        ByteAlign();
+    }
+
+    const std::vector<uint8_t>& Data() const { return m_data; }
+
+private:
+    std::vector<uint8_t> m_data;
+    uint32_t             m_numBits;
+};
+
+// Appends the NAL unit with a 4-byte start code, inserting the emulation prevention bytes
+void AppendNalUnit(std::vector<uint8_t>& stream, const uint8_t* pNalHeader, uint32_t nalHeaderSize,
+                   const std::vector<uint8_t>& rbsp);
+
+inline void AppendNalUnit(std::vector<uint8_t>& stream, uint8_t nalHeader, const std::vector<uint8_t>& rbsp)
+{
+    AppendNalUnit(stream, &nalHeader, 1, rbsp);
+}
+
+struct H264StreamDesc {
+    uint32_t widthInMbs;
+    uint32_t heightInMbs;
+    uint32_t maxNumRefFrames;
+    uint32_t numFrames;
+    uint32_t idrPeriod;           // Frames from one IDR picture to the next
+    uint32_t nonRefPeriod;        // Every nonRefPeriod-th P picture is not a reference picture, 0 for none
+    uint32_t slicesPerFrame;
+    uint32_t lostFrames;          // Mask of the first 32 frames left out of the stream, as if lost in transmission
+    uint32_t recoveryPointFrames; // Mask of the first 32 frames preceded by a recovery point SEI (recovery_frame_cnt 0)
+};
+
+// Baseline profile, pic_order_cnt_type 2, log2_max_frame_num 4
+std::vector<uint8_t> BuildH264Stream(const H264StreamDesc& desc);
+
+enum H265NalUnitType {
+    H265_NUT_TRAIL_N    = 0,
+    H265_NUT_TRAIL_R    = 1,
+    H265_NUT_RASL_N     = 8,
+    H265_NUT_IDR_W_RADL = 19,
+    H265_NUT_CRA        = 21,
+};
+
+struct H265PictureDesc {
+    H265NalUnitType nalUnitType;
+    int32_t         poc;
+    int32_t         refPoc;        // POC of the single reference picture of the RPS, ignored for the IRAP pictures
+    bool            recoveryPoint; // Preceded by a recovery point SEI with recovery_poc_cnt 0
+};
+
+// 64x64 Main profile pictures, in decoding order, each a single P slice (I slice for the IRAP pictures)
+std::vector<uint8_t> BuildH265Stream(const std::vector<H265PictureDesc>& pictures);
+
+// Writes the stream to a file, for the demuxers that only read from a file
+bool WriteStreamFile(const char* pFileName, const std::vector<uint8_t>& stream);
+
+#endif /* _SYNTHETICSTREAMS_H_ */
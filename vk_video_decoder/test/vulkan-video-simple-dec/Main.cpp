@@ -143,14 +143,19 @@ int main(int argc, const char** argv)
     }
 
     VkSharedBaseObj<VkVideoFrameOutput> frameToFile;
-    if (!decoderConfig.outputFileName.empty()) {
+    if (!decoderConfig.outputFileName.empty() || decoderConfig.verifyPictureHash) {
         const char* crcOutputFile = decoderConfig.outputcrcPerFrame ? decoderConfig.crcOutputFileName.c_str() : nullptr;
-        result = VkVideoFrameOutput::Create(decoderConfig.outputFileName.c_str(),
+        result = VkVideoFrameOutput::Create(decoderConfig.verifyPictureHash ? nullptr : decoderConfig.outputFileName.c_str(),
                                           decoderConfig.outputy4m,
                                           decoderConfig.outputcrcPerFrame,
                                           crcOutputFile,
                                           decoderConfig.crcInitValue,
-                                          frameToFile);
+                                          frameToFile,
+                                          (uint32_t)decoderConfig.numOutputBuffers,
+                                          decoderConfig.outputDirectIo,
+                                          decoderConfig.outputNativeLayout,
+                                          decoderConfig.outputLsbAligned,
+                                          decoderConfig.verifyPictureHash);
         if (result != VK_SUCCESS) {
             fprintf(stderr, "Error creating output file %s\n", decoderConfig.outputFileName.c_str());
             return -1;
@@ -187,6 +192,10 @@ int main(int argc, const char** argv)
 
     deinit(frameDataQueue, curFrameDataQueueIndex);
 
+    if (decoderConfig.verifyPictureHash && (frameToFile->GetPictureHashResults(nullptr, nullptr) > 0)) {
+        return -1;
+    }
+
     std::cout << "Exit decoder test" << std::endl;
 }
 